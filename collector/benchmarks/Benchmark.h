@@ -0,0 +1,122 @@
+#ifndef COLLECTOR_BENCHMARK_H
+#define COLLECTOR_BENCHMARK_H
+
+// Minimal helpers for the benchmark executables in this directory. These intentionally do not depend on any
+// benchmarking framework, such that they can be built with just the dependencies of collector itself.
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace collector {
+
+// DoNotOptimize prevents the compiler from optimizing away the computation of value.
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+  asm volatile(""
+               :
+               : "g"(&value)
+               : "memory");
+}
+
+// BenchmarkResult holds the wall times of the individual runs of a benchmark.
+class BenchmarkResult {
+ public:
+  explicit BenchmarkResult(std::vector<double> samples_ns) : samples_ns_(std::move(samples_ns)) {
+    std::sort(samples_ns_.begin(), samples_ns_.end());
+  }
+
+  size_t num_runs() const { return samples_ns_.size(); }
+
+  // Percentile returns the p-th percentile (0 <= p <= 100) of the run times, in nanoseconds.
+  double Percentile(double p) const {
+    if (samples_ns_.empty()) return 0;
+    size_t idx = static_cast<size_t>(p / 100 * (samples_ns_.size() - 1) + 0.5);
+    return samples_ns_[std::min(idx, samples_ns_.size() - 1)];
+  }
+
+  double Median() const { return Percentile(50); }
+
+ private:
+  std::vector<double> samples_ns_;
+};
+
+// RunBenchmark invokes fn repeatedly and measures the wall time of each invocation, until at least min_runs
+// invocations have been made and min_duration has passed.
+template <typename F>
+BenchmarkResult RunBenchmark(F&& fn, int min_runs = 10, std::chrono::milliseconds min_duration = std::chrono::milliseconds(500)) {
+  using Clock = std::chrono::steady_clock;
+
+  fn();  // warm-up
+
+  std::vector<double> samples;
+  auto deadline = Clock::now() + min_duration;
+  while (samples.size() < static_cast<size_t>(min_runs) || Clock::now() < deadline) {
+    auto start = Clock::now();
+    fn();
+    samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+  }
+  return BenchmarkResult(std::move(samples));
+}
+
+// CountSyscalls runs fn once in a forked child process and returns the number of system calls it made, counted by
+// tracing the child with ptrace. Returns -1 if the child could not be traced (e.g., when ptrace is not permitted).
+template <typename F>
+long CountSyscalls(F&& fn) {
+  std::fflush(stdout);
+  pid_t pid = fork();
+  if (pid < 0) return -1;
+  if (pid == 0) {
+    if (ptrace(PTRACE_TRACEME, 0, nullptr, nullptr) != 0) _exit(1);
+    raise(SIGSTOP);
+    fn();
+    _exit(0);
+  }
+
+  int status;
+  if (waitpid(pid, &status, 0) < 0 || !WIFSTOPPED(status) ||
+      ptrace(PTRACE_SETOPTIONS, pid, nullptr, PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL) != 0) {
+    kill(pid, SIGKILL);
+    waitpid(pid, &status, 0);
+    return -1;
+  }
+
+  // Every system call results in two stops, on entry and on exit, except for the final exit_group.
+  long stops = 0;
+  int signal = 0;
+  for (;;) {
+    if (ptrace(PTRACE_SYSCALL, pid, nullptr, signal) != 0) return -1;
+    if (waitpid(pid, &status, 0) < 0) return -1;
+    if (WIFEXITED(status) || WIFSIGNALED(status)) break;
+
+    signal = 0;
+    if (WSTOPSIG(status) == (SIGTRAP | 0x80)) {
+      stops++;
+    } else if (WSTOPSIG(status) != SIGTRAP) {
+      signal = WSTOPSIG(status);
+    }
+  }
+
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) return -1;
+  // Do not count the final exit_group.
+  return (stops + 1) / 2 - 1;
+}
+
+// PrintThroughput prints a single result line, with the throughput computed from the median run time and the number
+// of items and bytes processed per run.
+inline void PrintThroughput(const std::string& name, const BenchmarkResult& result, double items, double bytes) {
+  double secs = result.Median() / 1e9;
+  std::printf("%-40s %10.1f us/run %10.2f Mitems/s %10.1f MiB/s  (%zu runs)\n", name.c_str(), result.Median() / 1e3,
+              items / secs / 1e6, bytes / secs / (1024 * 1024), result.num_runs());
+}
+
+}  // namespace collector
+
+#endif
@@ -0,0 +1,104 @@
+// Benchmark for extracting container IDs from cgroup files, as done for every new process when scraping `/proc`:
+//  - validating full container IDs character by character (IsContainerID) and 8 characters at a time
+//    (IsContainerIDFast),
+//  - extracting the container ID from the cgroup file of every process, by parsing it line by line with
+//    ParseContainerID, and through a ContainerIDCache keyed by the cgroup v2 path (i.e., shared by all processes of a
+//    container), for cgroup v1 and v2 files and a varying number of processes per container.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+#include "ProcfsScraper.h"
+#include "ProcfsScraper_internal.h"
+#include "SyntheticProcDir.h"
+
+using namespace collector;
+
+namespace {
+
+// Every fourth process runs on the host.
+std::vector<std::string> MakeCgroupFiles(SyntheticProcDir* proc, int num_processes, int num_containers, bool cgroup_v2) {
+  std::vector<std::string> container_ids;
+  for (int i = 0; i < num_containers; i++) {
+    container_ids.push_back(proc->RandomContainerID());
+  }
+
+  std::vector<std::string> cgroup_files;
+  for (int i = 0; i < num_processes; i++) {
+    std::string container_id = i % 4 == 0 ? std::string() : container_ids[i % num_containers];
+    cgroup_files.push_back(cgroup_v2 ? SyntheticProcDir::FormatCgroupV2(container_id) : SyntheticProcDir::FormatCgroups(container_id));
+  }
+  return cgroup_files;
+}
+
+void BenchmarkValidate(SyntheticProcDir* proc) {
+  constexpr int kNumIDs = 10000;
+  std::vector<std::string> ids;
+  for (int i = 0; i < kNumIDs; i++) {
+    ids.push_back(proc->RandomContainerID());
+  }
+
+  std::printf("validate, %d container IDs\n", kNumIDs);
+  auto result = RunBenchmark([&]() {
+    int valid = 0;
+    for (const auto& id : ids) valid += IsContainerID(id);
+    DoNotOptimize(valid);
+  });
+  PrintThroughput("  IsContainerID", result, kNumIDs, kNumIDs * 64);
+  result = RunBenchmark([&]() {
+    int valid = 0;
+    for (const auto& id : ids) valid += IsContainerIDFast(id);
+    DoNotOptimize(valid);
+  });
+  PrintThroughput("  IsContainerIDFast", result, kNumIDs, kNumIDs * 64);
+}
+
+void BenchmarkExtract(SyntheticProcDir* proc, int num_processes, int num_containers, bool cgroup_v2) {
+  std::vector<std::string> cgroup_files = MakeCgroupFiles(proc, num_processes, num_containers, cgroup_v2);
+  size_t total_bytes = 0;
+  for (const auto& cgroups : cgroup_files) total_bytes += cgroups.size();
+
+  std::printf("extract, cgroup %s, %d processes in %d containers\n", cgroup_v2 ? "v2" : "v1", num_processes, num_containers);
+  std::string container_id;
+  auto result = RunBenchmark([&]() {
+    int found = 0;
+    for (const auto& cgroups : cgroup_files) found += ParseContainerID(cgroups, &container_id);
+    DoNotOptimize(found);
+  });
+  PrintThroughput("  ParseContainerID", result, num_processes, total_bytes);
+
+  // A fresh cache per run, as seen by a scraper starting up.
+  result = RunBenchmark([&]() {
+    ContainerIDCache cache;
+    int found = 0;
+    for (const auto& cgroups : cgroup_files) found += cache.Resolve(cgroups, &container_id);
+    DoNotOptimize(found);
+  });
+  PrintThroughput("  ContainerIDCache, cold", result, num_processes, total_bytes);
+
+  ContainerIDCache cache;
+  result = RunBenchmark([&]() {
+    int found = 0;
+    for (const auto& cgroups : cgroup_files) found += cache.Resolve(cgroups, &container_id);
+    DoNotOptimize(found);
+  });
+  PrintThroughput("  ContainerIDCache, warm", result, num_processes, total_bytes);
+}
+
+}  // namespace
+
+int main() {
+  SyntheticProcDir proc;
+
+  BenchmarkValidate(&proc);
+
+  for (bool cgroup_v2 : {false, true}) {
+    for (int num_containers : {10, 100, 1000}) {
+      BenchmarkExtract(&proc, 10000, num_containers, cgroup_v2);
+    }
+  }
+
+  return 0;
+}
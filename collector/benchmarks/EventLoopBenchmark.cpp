@@ -0,0 +1,151 @@
+// Benchmark for the synchronization overhead of the SysdigService event loop, with a synthetic event source in place
+// of libsinsp. It compares the previous loop, which locked a mutex for the pending process requests and another one
+// (shared with GetStats) around fetching every event, with the current one, which checks a lock-free request queue and
+// periodically publishes the stats through a seqlock. Another thread concurrently reads the stats and requests process
+// information, as the stats exporter and the network status notifier do.
+
+#include <atomic>
+#include <cstdio>
+#include <list>
+#include <mutex>
+#include <thread>
+
+#include "Benchmark.h"
+#include "MPSCQueue.h"
+#include "SeqLock.h"
+#include "Sysdig.h"
+#include "TimeUtil.h"
+
+using namespace collector;
+
+namespace {
+
+constexpr int kEventsPerRun = 1000000;
+constexpr int64_t kStatsPublishIntervalMicros = 100000;
+
+// SyntheticEventSource stands in for the inspector: it returns events of cycling types, at no cost.
+class SyntheticEventSource {
+ public:
+  int Next() {
+    next_type_ = (next_type_ + 1) % 64;
+    return next_type_;
+  }
+
+ private:
+  int next_type_ = 0;
+};
+
+// HandleEvent updates the stats of an event, as SysdigService::GetNext does.
+inline void HandleEvent(SysdigStats* stats, int type, int64_t parse_start) {
+  stats->event_parse_micros[type] += NowMicros() - parse_start;
+  ++stats->nUserspaceEvents[type];
+  ++stats->nFilteredEvents[type];
+}
+
+using Request = std::pair<uint64_t, int>;
+
+class LockingLoop {
+ public:
+  void Run(int num_events) {
+    for (int i = 0; i < num_events; i++) {
+      {
+        std::lock_guard<std::mutex> lock(requests_mutex_);
+        while (!requests_.empty()) {
+          DoNotOptimize(requests_.front());
+          requests_.pop_front();
+        }
+      }
+
+      std::lock_guard<std::mutex> lock(libsinsp_mutex_);
+      auto start = NowMicros();
+      HandleEvent(&stats_, source_.Next(), start);
+    }
+  }
+
+  void Request(uint64_t pid) {
+    std::lock_guard<std::mutex> lock(requests_mutex_);
+    requests_.emplace_back(pid, 0);
+  }
+
+  void GetStats(SysdigStats* stats) {
+    std::lock_guard<std::mutex> lock(libsinsp_mutex_);
+    *stats = stats_;
+  }
+
+ private:
+  SyntheticEventSource source_;
+  std::mutex libsinsp_mutex_;
+  SysdigStats stats_;
+  std::mutex requests_mutex_;
+  std::list<::Request> requests_;
+};
+
+class LockFreeLoop {
+ public:
+  void Run(int num_events) {
+    for (int i = 0; i < num_events; i++) {
+      if (!requests_.empty()) {
+        requests_.ConsumeAll([](::Request&& request) { DoNotOptimize(request); });
+      }
+
+      // As in SysdigService::Run, the parse start time is also used to decide when to publish the stats.
+      auto start = NowMicros();
+      if (start >= next_publish_micros_) {
+        published_stats_.Store(stats_);
+        next_publish_micros_ = start + kStatsPublishIntervalMicros;
+      }
+      HandleEvent(&stats_, source_.Next(), start);
+    }
+  }
+
+  void Request(uint64_t pid) { requests_.Push({pid, 0}); }
+
+  void GetStats(SysdigStats* stats) { published_stats_.Load(stats); }
+
+ private:
+  SyntheticEventSource source_;
+  SysdigStats stats_;
+  SeqLock<SysdigStats> published_stats_;
+  int64_t next_publish_micros_ = 0;
+  MPSCQueue<::Request> requests_;
+};
+
+// BenchmarkLoop runs the event loop, while another thread reads the stats and requests process information every
+// interval (if positive).
+template <typename Loop>
+void BenchmarkLoop(const char* name, std::chrono::microseconds interval) {
+  Loop loop;
+  std::atomic<bool> done(false);
+  std::thread client([&loop, &done, interval] {
+    SysdigStats stats;
+    uint64_t pid = 0;
+    while (interval.count() > 0 && !done.load(std::memory_order_relaxed)) {
+      loop.GetStats(&stats);
+      loop.Request(++pid);
+      std::this_thread::sleep_for(interval);
+    }
+  });
+
+  auto result = RunBenchmark([&loop]() { loop.Run(kEventsPerRun); });
+  done = true;
+  client.join();
+
+  PrintThroughput(name, result, kEventsPerRun, 0);
+}
+
+}  // namespace
+
+int main() {
+  std::printf("%d synthetic events per run\n", kEventsPerRun);
+  for (auto interval : {std::chrono::microseconds(0), std::chrono::microseconds(1000), std::chrono::microseconds(10)}) {
+    if (interval.count() > 0) {
+      std::printf("stats read and process requested every %ld us\n", static_cast<long>(interval.count()));
+    } else {
+      std::printf("no concurrent stats reads or process requests\n");
+    }
+    BenchmarkLoop<LockingLoop>("  mutexes", interval);
+    BenchmarkLoop<LockFreeLoop>("  lock-free", interval);
+  }
+
+  return 0;
+}
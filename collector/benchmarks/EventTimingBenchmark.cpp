@@ -0,0 +1,77 @@
+// Benchmark for the overhead of timing the steps of handling events (parse, filter and process), as the SysdigService
+// event loop does for the per event type timing metrics, with each clock and sample rate. The events are synthetic and
+// cost nothing to handle, so the differences to the run without timing are the overhead per event.
+
+#include <cstdio>
+
+#include "Benchmark.h"
+#include "EventTimer.h"
+#include "Sysdig.h"
+
+using namespace collector;
+
+namespace {
+
+constexpr int kEventsPerRun = 1000000;
+constexpr int kEventTypes = 64;
+
+// RunLoop times the events as SysdigService::Run and GetNext do.
+void RunLoop(EventTimer* timer, SysdigStats* stats) {
+  int type = 0;
+  for (int i = 0; i < kEventsPerRun; i++) {
+    int64_t parse_start = timer->Now();
+    DoNotOptimize(parse_start);
+    type = (type + 1) % kEventTypes;
+
+    bool timed = timer->Sample(type);
+    int64_t filter_start = 0;
+    if (timed) {
+      filter_start = timer->Now();
+      stats->event_parse_micros[type] += timer->Scale(filter_start - parse_start);
+    }
+    ++stats->nUserspaceEvents[type];
+    if (timed) {
+      stats->event_filter_micros[type] += timer->Scale(timer->Now() - filter_start);
+    }
+
+    int64_t process_start = timed ? timer->Now() : 0;
+    if (timed) {
+      stats->event_process_micros[type] += timer->Scale(timer->Now() - process_start);
+    }
+  }
+}
+
+// RunLoopUntimed only counts the events.
+void RunLoopUntimed(SysdigStats* stats) {
+  int type = 0;
+  for (int i = 0; i < kEventsPerRun; i++) {
+    type = (type + 1) % kEventTypes;
+    ++stats->nUserspaceEvents[type];
+  }
+}
+
+}  // namespace
+
+int main() {
+  std::printf("%d synthetic events per run\n", kEventsPerRun);
+
+  SysdigStats stats;
+  auto result = RunBenchmark([&stats]() { RunLoopUntimed(&stats); });
+  PrintThroughput("untimed", result, kEventsPerRun, 0);
+
+  for (auto clock : {EventTimer::Clock::SYSTEM, EventTimer::Clock::COARSE, EventTimer::Clock::TSC}) {
+    for (int sample_rate : {1, 16, 256}) {
+      EventTimer timer(clock, sample_rate);
+      if (timer.clock() != clock) {
+        std::printf("%s clock not available\n", EventTimerClockName(clock));
+        break;
+      }
+
+      auto result = RunBenchmark([&timer, &stats]() { RunLoop(&timer, &stats); });
+      std::string name = std::string(EventTimerClockName(clock)) + ", 1 in " + std::to_string(sample_rate);
+      PrintThroughput(name, result, kEventsPerRun, 0);
+    }
+  }
+
+  return 0;
+}
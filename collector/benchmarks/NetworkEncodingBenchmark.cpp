@@ -0,0 +1,104 @@
+// Benchmark for building and serializing the messages reporting connection deltas to Sensor, with and without the
+// encoding cache, for deltas of long-lived connections that flap between active and closed (i.e., every connection is
+// reported in every delta, with alternating status). Serialization is included, as the messages are serialized when
+// they are written to the stream.
+
+#include <cstdio>
+#include <random>
+#include <string>
+
+#include "Benchmark.h"
+#include "NetworkMessageBuilder.h"
+
+using namespace collector;
+
+namespace {
+
+std::string RandomContainerID(std::mt19937* rng) {
+  static const char kHexDigits[] = "0123456789abcdef";
+  std::string id(12, '0');
+  for (auto& c : id) c = kHexDigits[(*rng)() % 16];
+  return id;
+}
+
+ConnMap MakeDelta(int num_conns, int num_containers) {
+  std::mt19937 rng(42);
+  std::vector<std::string> containers;
+  for (int i = 0; i < num_containers; i++) {
+    containers.push_back(RandomContainerID(&rng));
+  }
+
+  ConnMap delta;
+  for (int i = 0; i < num_conns; i++) {
+    Endpoint local(Address(10, 0, (i >> 8) & 0xff, i & 0xff), 8080);
+    Endpoint remote(Address(192, 168, rng() % 256, rng() % 256), 1024 + rng() % 60000);
+    delta.emplace(Connection(containers[i % num_containers], local, remote, L4Proto::TCP, i % 2 == 0), ConnStatus(1000, true));
+  }
+  return delta;
+}
+
+// SendDelta builds and serializes all messages for delta, and returns the total size of the messages.
+size_t SendDelta(NetworkMessageBuilder* builder, const ConnMap& delta, std::string* buf) {
+  AdvertisedEndpointMap no_endpoints;
+  auto conn_it = delta.begin();
+  auto cep_it = no_endpoints.cbegin();
+  size_t bytes = 0;
+  while (auto* msg = builder->CreateInfoMessage(&conn_it, delta.end(), &cep_it, no_endpoints.cend())) {
+    msg->SerializeToString(buf);
+    bytes += buf->size();
+  }
+  return bytes;
+}
+
+void BenchmarkDelta(int num_conns, int num_containers) {
+  ConnMap delta = MakeDelta(num_conns, num_containers);
+  std::string buf;
+
+  // Flip the status of every connection between runs.
+  int64_t time_micros = 1000;
+  auto flap = [&delta, &time_micros]() {
+    time_micros += 1000;
+    for (auto& entry : delta) {
+      entry.second = ConnStatus(time_micros, !entry.second.IsActive());
+    }
+  };
+
+  std::printf("%d connections in %d containers, 1000 per message\n", num_conns, num_containers);
+
+  NetworkMessageBuilder uncached(1000, 0, 0);
+  size_t bytes = 0;
+  auto result = RunBenchmark([&]() {
+    flap();
+    bytes = SendDelta(&uncached, delta, &buf);
+    DoNotOptimize(bytes);
+  });
+  PrintThroughput("  field by field", result, num_conns, bytes);
+
+  // Every connection is in the cache after the warm-up run.
+  NetworkMessageBuilder cached(1000, 0, 2 * num_conns);
+  result = RunBenchmark([&]() {
+    flap();
+    bytes = SendDelta(&cached, delta, &buf);
+    DoNotOptimize(bytes);
+  });
+  PrintThroughput("  encoding cache, warm", result, num_conns, bytes);
+
+  // A fresh cache per run: the overhead of populating the cache.
+  result = RunBenchmark([&]() {
+    NetworkMessageBuilder cold(1000, 0, 2 * num_conns);
+    flap();
+    bytes = SendDelta(&cold, delta, &buf);
+    DoNotOptimize(bytes);
+  });
+  PrintThroughput("  encoding cache, cold", result, num_conns, bytes);
+}
+
+}  // namespace
+
+int main() {
+  for (int num_conns : {1000, 10000, 100000}) {
+    BenchmarkDelta(num_conns, 100);
+  }
+
+  return 0;
+}
@@ -0,0 +1,131 @@
+// Benchmark comparing the reference (fgets-based, character-by-character) and the fast (bulk read, SWAR-based) parsers
+// for `net/tcp[6]` files, on synthetic tables of different sizes.
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "Benchmark.h"
+#include "FileSystem.h"
+#include "ProcfsScraper_internal.h"
+#include "SyntheticProcDir.h"
+
+using namespace collector;
+
+namespace {
+
+// ReadFile reads the whole file at path into buf.
+bool ReadFile(const std::string& path, std::vector<char>* buf) {
+  FDHandle fd = open(path.c_str(), O_RDONLY);
+  if (!fd.valid()) return false;
+
+  size_t total = 0;
+  for (;;) {
+    if (total == buf->size()) buf->resize(std::max<size_t>(64 * 1024, 2 * buf->size()));
+    ssize_t nread = read(fd, buf->data() + total, buf->size() - total);
+    if (nread < 0) return false;
+    if (nread == 0) break;
+    total += nread;
+  }
+  buf->resize(total);
+  return true;
+}
+
+// ParseReference parses the table at path the way the scraper used to: line by line through stdio.
+int ParseReference(const std::string& path, Address::Family family) {
+  FileHandle f(FDHandle(open(path.c_str(), O_RDONLY)), "r");
+  char line[512];
+  if (!std::fgets(line, sizeof(line), f)) return -1;
+
+  int count = 0;
+  while (std::fgets(line, sizeof(line), f)) {
+    ConnLineData data;
+    if (ParseConnLine(line, line + sizeof(line), family, &data)) count++;
+  }
+  return count;
+}
+
+// ParseFastBuffer parses an in-memory table with the fast parser.
+int ParseFastBuffer(const std::vector<char>& buf, Address::Family family) {
+  const char* p = buf.data();
+  const char* endp = p + buf.size();
+  auto eol = static_cast<const char*>(std::memchr(p, '\n', endp - p));
+  if (!eol) return -1;
+
+  int count = 0;
+  for (p = eol + 1; p < endp; p = eol + 1) {
+    eol = static_cast<const char*>(std::memchr(p, '\n', endp - p));
+    if (!eol) eol = endp;
+    ConnLineData data;
+    if (ParseConnLineFast(p, eol, family, &data)) count++;
+  }
+  return count;
+}
+
+// ParseReferenceBuffer parses an in-memory table with the reference parser.
+int ParseReferenceBuffer(const std::vector<char>& buf, Address::Family family) {
+  const char* p = buf.data();
+  const char* endp = p + buf.size();
+  auto eol = static_cast<const char*>(std::memchr(p, '\n', endp - p));
+  if (!eol) return -1;
+
+  int count = 0;
+  char line[512];
+  for (p = eol + 1; p < endp; p = eol + 1) {
+    eol = static_cast<const char*>(std::memchr(p, '\n', endp - p));
+    if (!eol) eol = endp;
+    size_t len = std::min<size_t>(eol - p, sizeof(line) - 1);
+    std::memcpy(line, p, len);
+    line[len] = '\0';
+    ConnLineData data;
+    if (ParseConnLine(line, line + sizeof(line), family, &data)) count++;
+  }
+  return count;
+}
+
+}  // namespace
+
+int main() {
+  SyntheticProcDir proc;
+
+  for (auto family : {Address::Family::IPV4, Address::Family::IPV6}) {
+    const char* family_name = (family == Address::Family::IPV4) ? "tcp" : "tcp6";
+
+    for (int num_entries : {100, 1000, 10000, 100000}) {
+      std::string path = proc.WriteNetTable(num_entries, family, num_entries);
+
+      std::vector<char> contents;
+      if (!ReadFile(path, &contents)) {
+        std::fprintf(stderr, "Failed to read %s\n", path.c_str());
+        return 1;
+      }
+
+      int expected = ParseReferenceBuffer(contents, family);
+      if (ParseFastBuffer(contents, family) != expected || ParseReference(path, family) != expected) {
+        std::fprintf(stderr, "Parsers disagree on %s\n", path.c_str());
+        return 1;
+      }
+
+      std::printf("%s, %d entries (%zu bytes)\n", family_name, num_entries, contents.size());
+
+      auto result = RunBenchmark([&]() { DoNotOptimize(ParseReferenceBuffer(contents, family)); });
+      PrintThroughput("  parse only, reference", result, num_entries, contents.size());
+      result = RunBenchmark([&]() { DoNotOptimize(ParseFastBuffer(contents, family)); });
+      PrintThroughput("  parse only, fast", result, num_entries, contents.size());
+
+      result = RunBenchmark([&]() { DoNotOptimize(ParseReference(path, family)); });
+      PrintThroughput("  read+parse, reference (stdio)", result, num_entries, contents.size());
+      std::vector<char> buf;
+      result = RunBenchmark([&]() {
+        ReadFile(path, &buf);
+        DoNotOptimize(ParseFastBuffer(buf, family));
+      });
+      PrintThroughput("  read+parse, fast (bulk read)", result, num_entries, contents.size());
+    }
+  }
+
+  return 0;
+}
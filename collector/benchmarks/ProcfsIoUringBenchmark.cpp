@@ -0,0 +1,65 @@
+// Benchmark comparing the synchronous and the io_uring-based ways of scraping a synthetic `/proc` with a varying number
+// of processes, with a cold and a warm process metadata cache, in terms of wall time and the number of system calls
+// made by the scraping thread.
+
+#include <cstdio>
+#include <vector>
+
+#include "Benchmark.h"
+#include "IoUring.h"
+#include "ProcfsScraper.h"
+#include "SyntheticProcDir.h"
+
+using namespace collector;
+
+namespace {
+
+// RunAndPrint benchmarks fn and prints the result, along with the number of system calls of a single run made after those of
+// the benchmark, such that caches are warmed up in the same way.
+template <typename F>
+void RunAndPrint(const char* name, F&& fn) {
+  BenchmarkResult result = RunBenchmark(fn);
+  long syscalls = CountSyscalls(fn);
+  std::printf("  %-32s %10.1f us/run (p99 %10.1f us) %8ld syscalls/run  (%zu runs)\n", name, result.Median() / 1e3,
+              result.Percentile(99) / 1e3, syscalls, result.num_runs());
+}
+
+void BenchmarkScrape(int num_processes) {
+  SyntheticProcDir proc;
+  // One in four processes runs in a container, with one network namespace per container.
+  for (int i = 0; i < num_processes; i++) {
+    bool in_container = i % 4 == 0;
+    proc.WriteProcess(1000 + i, 100000 + i, in_container ? proc.RandomContainerID() : std::string(),
+                      in_container ? 4026532000 + i : 4026531992);
+  }
+
+  std::printf("scrape, %d processes\n", num_processes);
+  for (bool use_io_uring : {false, true}) {
+    std::vector<Connection> connections;
+
+    auto cold_scrape = [&]() {
+      ConnScraper scraper(proc.path(), nullptr, use_io_uring);
+      scraper.Scrape(&connections, nullptr);
+    };
+    RunAndPrint(use_io_uring ? "cold cache, io_uring" : "cold cache, sync", cold_scrape);
+
+    ConnScraper scraper(proc.path(), nullptr, use_io_uring);
+    auto warm_scrape = [&]() { scraper.Scrape(&connections, nullptr); };
+    RunAndPrint(use_io_uring ? "warm cache, io_uring" : "warm cache, sync", warm_scrape);
+  }
+}
+
+}  // namespace
+
+int main() {
+  if (!IoUring::Create(256)) {
+    std::fprintf(stderr, "io_uring is not available\n");
+    return 1;
+  }
+
+  for (int num_processes : {100, 1000, 5000}) {
+    BenchmarkScrape(num_processes);
+  }
+
+  return 0;
+}
@@ -0,0 +1,96 @@
+// Benchmark for dispatching events to the signal handlers in the SysdigService event loop. It compares the previous
+// dispatch, which checked the event filter of every handler for every event, with the dispatch table, which lists the
+// handlers interested in each event type. As in collector, each handler is interested in a couple of event types only.
+
+#include <bitset>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+#include "SignalDispatchTable.h"
+
+using namespace collector;
+
+namespace {
+
+constexpr int kEventsPerRun = 1000000;
+constexpr int kEventTypes = 64;
+
+class CountingHandler : public SignalHandler {
+ public:
+  std::string GetName() override { return "CountingHandler"; }
+  Result HandleSignal(sinsp_evt* evt) override {
+    ++count_;
+    return PROCESSED;
+  }
+  std::vector<std::string> GetRelevantEvents() override { return {}; }
+
+  uint64_t count() const { return count_; }
+
+ private:
+  uint64_t count_ = 0;
+};
+
+struct Entry {
+  std::unique_ptr<SignalHandler> handler;
+  std::bitset<PPM_EVENT_MAX> event_filter;
+  std::vector<uint16_t> event_types;
+};
+
+std::vector<Entry> MakeHandlers(int num_handlers) {
+  std::vector<Entry> entries;
+  for (int i = 0; i < num_handlers; i++) {
+    Entry entry{std::make_unique<CountingHandler>(), {}, {}};
+    entry.event_types = {static_cast<uint16_t>((3 * i) % kEventTypes), static_cast<uint16_t>((3 * i + 1) % kEventTypes)};
+    for (uint16_t type : entry.event_types) {
+      entry.event_filter.set(type);
+    }
+    entries.push_back(std::move(entry));
+  }
+  return entries;
+}
+
+void RunFilterLoop(const std::vector<Entry>& entries) {
+  int type = 0;
+  for (int i = 0; i < kEventsPerRun; i++) {
+    type = (type + 1) % kEventTypes;
+    for (const auto& entry : entries) {
+      if (!entry.event_filter[type]) continue;
+      DoNotOptimize(entry.handler->HandleSignal(nullptr));
+    }
+  }
+}
+
+void RunTableLoop(const SignalDispatchTable& table) {
+  int type = 0;
+  for (int i = 0; i < kEventsPerRun; i++) {
+    type = (type + 1) % kEventTypes;
+    const auto& handlers = table.Handlers(type);
+    for (size_t j = 0; j < handlers.size(); j++) {
+      DoNotOptimize(handlers[j]->HandleSignal(nullptr));
+    }
+  }
+}
+
+}  // namespace
+
+int main() {
+  std::printf("%d synthetic events of %d types per run\n", kEventsPerRun, kEventTypes);
+
+  for (int num_handlers : {5, 10}) {
+    auto entries = MakeHandlers(num_handlers);
+    SignalDispatchTable table;
+    for (const auto& entry : entries) {
+      table.Add(entry.handler.get(), entry.event_types);
+    }
+
+    auto result = RunBenchmark([&entries]() { RunFilterLoop(entries); });
+    PrintThroughput(std::to_string(num_handlers) + " handlers, filters", result, kEventsPerRun, 0);
+    result = RunBenchmark([&table]() { RunTableLoop(table); });
+    PrintThroughput(std::to_string(num_handlers) + " handlers, dispatch table", result, kEventsPerRun, 0);
+  }
+
+  return 0;
+}
@@ -0,0 +1,194 @@
+#include "SyntheticProcDir.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include <netinet/tcp.h>
+
+namespace collector {
+
+namespace {
+
+const char kNetTCPHeader[] = "  sl  local_address rem_address   st tx_queue rx_queue tr tm->when retrnsmt   uid  timeout inode\n";
+const char kNetTCP6Header[] = "  sl  local_address                         remote_address                        st tx_queue rx_queue tr tm->when retrnsmt   uid  timeout inode\n";
+const char kNetUDPHeader[] = "   sl  local_address rem_address   st tx_queue rx_queue tr tm->when retrnsmt   uid  timeout inode ref pointer drops\n";
+const char kNetUDP6Header[] = "  sl  local_address                         remote_address                        st tx_queue rx_queue tr tm->when retrnsmt   uid  timeout inode ref pointer drops\n";
+
+// FormatEndpoint formats an endpoint as in `net/tcp[6]`, where each 32-bit word of the address is printed as a number
+// in host byte order.
+std::string FormatEndpoint(const Endpoint& endpoint) {
+  const Address& address = endpoint.address();
+  const auto* bytes = static_cast<const uint8_t*>(address.data());
+
+  std::string result;
+  char buf[16];
+  for (size_t i = 0; i < address.length(); i += sizeof(uint32_t)) {
+    uint32_t word;
+    std::memcpy(&word, bytes + i, sizeof(word));
+    std::snprintf(buf, sizeof(buf), "%08X", word);
+    result += buf;
+  }
+  std::snprintf(buf, sizeof(buf), ":%04X", endpoint.port());
+  return result + buf;
+}
+
+}  // namespace
+
+SyntheticProcDir::SyntheticProcDir() : rng_(42) {
+  char path_template[] = "/tmp/synthetic-proc-XXXXXX";
+  if (!mkdtemp(path_template)) {
+    throw std::runtime_error("could not create temporary directory");
+  }
+  path_ = path_template;
+}
+
+SyntheticProcDir::~SyntheticProcDir() {
+  std::error_code ec;
+  std::filesystem::remove_all(path_, ec);
+}
+
+std::string SyntheticProcDir::FormatNetTableLine(int sl, const Endpoint& local, const Endpoint& remote, uint8_t state, uint64_t inode) {
+  char line[512];
+  std::snprintf(line, sizeof(line), "%4d: %s %s %02X %08X:%08X %02X:%08X %08X %5u %8d %lu %d 0000000000000000 %u %u %u %u %d\n",
+                sl, FormatEndpoint(local).c_str(), FormatEndpoint(remote).c_str(), state, 0, 0, 0, 0, 0, 1000, 0,
+                static_cast<unsigned long>(inode), 1, 20, 4, 30, 10, -1);
+  return line;
+}
+
+std::string SyntheticProcDir::RandomContainerID() {
+  char container_id[65];
+  std::snprintf(container_id, sizeof(container_id), "%016lx%016lx%016lx%016lx", static_cast<unsigned long>(rng_()),
+                static_cast<unsigned long>(rng_()), static_cast<unsigned long>(rng_()), static_cast<unsigned long>(rng_()));
+  return container_id;
+}
+
+std::string SyntheticProcDir::FormatCgroups(const std::string& container_id) {
+  std::string cgroup_path = !container_id.empty() ? "/kubepods.slice/kubepods-burstable.slice/docker-" + container_id + ".scope"
+                                                  : std::string("/user.slice/user-1000.slice/session-2.scope");
+  std::string cgroups;
+  int id = 12;
+  for (const char* controller : {"pids", "hugetlb", "memory", "cpuset", "perf_event", "net_cls,net_prio", "blkio", "freezer",
+                                 "devices", "cpu,cpuacct", "rdma"}) {
+    cgroups += std::to_string(id--) + ":" + controller + ":" + cgroup_path + "\n";
+  }
+  cgroups += "1:name=systemd:" + cgroup_path + "\n";
+  return cgroups;
+}
+
+std::string SyntheticProcDir::FormatCgroupV2(const std::string& container_id) {
+  if (container_id.empty()) return "0::/user.slice/user-1000.slice/session-2.scope\n";
+  return "0::/kubepods.slice/kubepods-burstable.slice/kubepods-burstable-pod" + container_id.substr(0, 8) + "_" +
+         container_id.substr(8, 4) + "_" + container_id.substr(12, 4) + "_" + container_id.substr(16, 4) + "_" +
+         container_id.substr(20, 12) + ".slice/cri-containerd-" + container_id + ".scope\n";
+}
+
+void SyntheticProcDir::WriteProcess(uint64_t pid, uint64_t start_time, const std::string& container_id, uint64_t netns_inode) {
+  std::string pid_dir = PidDir(pid);
+  std::filesystem::create_directories(pid_dir + "/fd");
+  std::filesystem::create_directories(pid_dir + "/ns");
+  std::filesystem::create_directories(pid_dir + "/net");
+
+  std::ofstream(pid_dir + "/stat") << pid << " (synthetic) S 1 1 1 0 -1 4194560 100 0 0 0 0 0 0 0 20 0 1 0 " << start_time
+                                   << " 1000 100 18446744073709551615 1 1 0 0 0 0 0 0 0 0 0 0 17 0 0 0 0 0 0\n";
+
+  std::ofstream(pid_dir + "/cgroup") << FormatCgroups(container_id);
+
+  std::filesystem::create_symlink("net:[" + std::to_string(netns_inode) + "]", pid_dir + "/ns/net");
+  std::ofstream(pid_dir + "/net/tcp") << kNetTCPHeader;
+  std::ofstream(pid_dir + "/net/tcp6") << kNetTCP6Header;
+  std::ofstream(pid_dir + "/net/udp") << kNetUDPHeader;
+  std::ofstream(pid_dir + "/net/udp6") << kNetUDP6Header;
+}
+
+void SyntheticProcDir::WriteScrapeFixture(const ScrapeFixture& fixture) {
+  const int num_netns = std::max(fixture.num_netns, 1);
+  const int num_listen = fixture.sockets_per_netns / 20;
+
+  // The first process of each network namespace holds its socket tables, which the others link to.
+  std::vector<std::string> container_ids;
+  std::vector<std::string> table_pid_dirs;
+  for (int n = 0; n < num_netns; n++) {
+    container_ids.push_back(RandomContainerID());
+  }
+
+  for (int i = 0; i < fixture.num_pids; i++) {
+    uint64_t pid = 1000 + i;
+    int netns = i % num_netns;
+    WriteProcess(pid, 100000 + i, container_ids[netns], 4026532000 + netns);
+    std::string pid_dir = PidDir(pid);
+
+    // Socket j of the network namespace is held by its process j % procs_in_netns.
+    int procs_in_netns = (fixture.num_pids - netns + num_netns - 1) / num_netns;
+    int fd = 3;
+    for (int j = i / num_netns; j < fixture.sockets_per_netns && fd < 3 + fixture.fds_per_pid; j += procs_in_netns) {
+      std::filesystem::create_symlink("socket:[" + std::to_string(SocketINode(netns, j, fixture)) + "]",
+                                      pid_dir + "/fd/" + std::to_string(fd++));
+    }
+    for (; fd < 3 + fixture.fds_per_pid; fd++) {
+      std::filesystem::create_symlink("/dev/null", pid_dir + "/fd/" + std::to_string(fd));
+    }
+
+    if (i >= num_netns) {
+      for (const char* table : {"/net/tcp", "/net/tcp6", "/net/udp", "/net/udp6"}) {
+        std::filesystem::remove(pid_dir + table);
+        std::filesystem::create_hard_link(table_pid_dirs[netns] + table, pid_dir + table);
+      }
+      continue;
+    }
+
+    table_pid_dirs.push_back(pid_dir);
+    std::string content = kNetTCPHeader;
+    for (int j = 0; j < fixture.sockets_per_netns; j++) {
+      Address local(10, (netns >> 8) & 0xFF, netns & 0xFF, 2);
+      uint64_t inode = SocketINode(netns, j, fixture);
+      if (j < num_listen) {
+        content += FormatNetTableLine(j, Endpoint(Address::Any(Address::Family::IPV4), 1024 + j),
+                                      Endpoint(Address::Any(Address::Family::IPV4), 0), TCP_LISTEN, inode);
+        continue;
+      }
+      content += FormatNetTableLine(j, Endpoint(local, 1024 + rng_() % std::max(num_listen, 1)),
+                                    Endpoint(Address(192, 168, rng_() % 256, rng_() % 256), 32768 + rng_() % 28232),
+                                    TCP_ESTABLISHED, inode);
+    }
+    std::ofstream(pid_dir + "/net/tcp") << content;
+  }
+}
+
+std::string SyntheticProcDir::WriteNetTable(uint64_t pid, Address::Family family, int num_entries) {
+  std::string net_dir = PidDir(pid) + "/net";
+  std::filesystem::create_directories(net_dir);
+
+  auto random_address = [&]() {
+    if (family == Address::Family::IPV4) {
+      return Address(static_cast<uint32_t>(rng_()));
+    }
+    return Address(rng_(), rng_());
+  };
+
+  int num_listen = num_entries / 20;
+  std::string content = (family == Address::Family::IPV4) ? kNetTCPHeader : kNetTCP6Header;
+  for (int sl = 0; sl < num_entries; sl++) {
+    uint64_t inode = 100000 + rng_() % 1000000000;
+    if (sl < num_listen) {
+      content += FormatNetTableLine(sl, Endpoint(Address::Any(family), 1024 + sl), Endpoint(Address::Any(family), 0), TCP_LISTEN, inode);
+      continue;
+    }
+    // Sprinkle in some connections in TIME_WAIT, which have no associated socket.
+    bool time_wait = rng_() % 10 == 0;
+    content += FormatNetTableLine(sl, Endpoint(random_address(), 1024 + rng_() % std::max(num_listen, 1)),
+                                  Endpoint(random_address(), 32768 + rng_() % 28232), time_wait ? TCP_TIME_WAIT : TCP_ESTABLISHED,
+                                  time_wait ? 0 : inode);
+  }
+
+  std::string path = net_dir + (family == Address::Family::IPV4 ? "/tcp" : "/tcp6");
+  std::ofstream out(path);
+  out << content;
+  return path;
+}
+
+}  // namespace collector
@@ -0,0 +1,74 @@
+#ifndef COLLECTOR_SYNTHETICPROCDIR_H
+#define COLLECTOR_SYNTHETICPROCDIR_H
+
+#include <cstdint>
+#include <random>
+#include <string>
+
+#include "NetworkConnection.h"
+
+namespace collector {
+
+// SyntheticProcDir generates `/proc`-like directory structures in a temporary directory, for benchmarking code that
+// reads from procfs at a scale that is hard to come by on a development machine. The generated files mimic the
+// format used by the kernel.
+class SyntheticProcDir {
+ public:
+  SyntheticProcDir();
+  ~SyntheticProcDir();
+
+  const std::string& path() const { return path_; }
+
+  // WriteNetTable writes a `net/tcp` (for IPv4) or `net/tcp6` (for IPv6) file with num_entries random entries into
+  // the `net` subdirectory of the directory for the given pid. About 5% of the entries are listen sockets, which are
+  // listed first. Returns the path of the written file.
+  std::string WriteNetTable(uint64_t pid, Address::Family family, int num_entries);
+
+  // WriteProcess creates the directory for a process with the given start time, consisting of `stat`, a cgroup v1
+  // style `cgroup` file (of the container with the given ID, or of a host process if it is empty), a `ns/net` link, an
+  // empty `fd` directory, and empty `net/tcp[6]` and `net/udp[6]` tables.
+  void WriteProcess(uint64_t pid, uint64_t start_time, const std::string& container_id, uint64_t netns_inode);
+
+  // ScrapeFixture describes a `/proc` with container processes holding sockets, for benchmarking entire scrapes.
+  struct ScrapeFixture {
+    int num_pids = 1000;
+    int fds_per_pid = 64;
+    int num_netns = 100;
+    int sockets_per_netns = 500;
+  };
+
+  // WriteScrapeFixture writes fixture.num_pids processes, spread evenly over fixture.num_netns network namespaces with a
+  // container each. The `net/tcp` table of each network namespace has fixture.sockets_per_netns entries (5% of which
+  // are listen sockets), and their sockets are spread over the fd tables of the processes in the network namespace.
+  // Each process has fixture.fds_per_pid fds, the ones not taken up by sockets refer to `/dev/null`. Sockets that do
+  // not fit into the fd tables are not held by any process.
+  void WriteScrapeFixture(const ScrapeFixture& fixture);
+
+  // RandomContainerID returns a random (full, 64 character) container ID.
+  std::string RandomContainerID();
+
+  // FormatCgroups formats the contents of a cgroup v1 style `cgroup` file, of the container with the given ID, or of a
+  // host process if it is empty.
+  static std::string FormatCgroups(const std::string& container_id);
+
+  // FormatCgroupV2 formats the contents of a cgroup v2 `cgroup` file (a single `0::<path>` line), of the container with
+  // the given ID in a Kubernetes pod, or of a host process if it is empty.
+  static std::string FormatCgroupV2(const std::string& container_id);
+
+  // FormatNetTableLine formats a single line of a `net/tcp[6]` file (including the trailing newline).
+  static std::string FormatNetTableLine(int sl, const Endpoint& local, const Endpoint& remote, uint8_t state, uint64_t inode);
+
+ private:
+  std::string PidDir(uint64_t pid) const { return path_ + "/" + std::to_string(pid); }
+
+  static uint64_t SocketINode(int netns, int socket, const ScrapeFixture& fixture) {
+    return 1000000 + static_cast<uint64_t>(netns) * fixture.sockets_per_netns + socket;
+  }
+
+  std::string path_;
+  std::mt19937_64 rng_;
+};
+
+}  // namespace collector
+
+#endif
@@ -118,11 +118,16 @@ void gplNotice() {
   CLOG(INFO) << "";
 }
 
-void initialChecks() {
+void initialChecks(const CollectorConfig& config) {
   if (!g_control.is_lock_free()) {
     CLOG(FATAL) << "Internal error: could not create a lock-free control variable.";
   }
 
+  // Replaying a capture file does not need a kernel driver.
+  if (!config.ReplayFile().empty()) {
+    return;
+  }
+
   struct stat st;
   if (stat("/module", &st) != 0 || !S_ISDIR(st.st_mode)) {
     CLOG(FATAL) << "Internal error: /module directory does not exist.";
@@ -130,8 +135,6 @@ void initialChecks() {
 }
 
 int main(int argc, char** argv) {
-  initialChecks();
-
   CollectorArgs* args = CollectorArgs::getInstance();
   int exitCode = 0;
   if (!args->parse(argc, argv, exitCode)) {
@@ -142,6 +145,7 @@ int main(int argc, char** argv) {
   }
 
   CollectorConfig config(args);
+  initialChecks(config);
 
   setCoreDumpLimit(config.IsCoreDumpEnabled());
 
@@ -177,7 +181,11 @@ int main(int argc, char** argv) {
 
   CollectorService collector(config, &g_control, &g_signum);
 
-  if (!SetupKernelDriver(collector, args->GRPCServer(), config)) {
+  if (!config.ReplayFile().empty()) {
+    if (!collector.InitReplay()) {
+      CLOG(FATAL) << "Failed to open the capture file to replay.";
+    }
+  } else if (!SetupKernelDriver(collector, args->GRPCServer(), config)) {
     startup_diagnostics.Log();
     CLOG(FATAL) << "Failed to initialize collector kernel components.";
   }
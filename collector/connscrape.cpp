@@ -1,26 +1,55 @@
 // Test program for demonstrating connection scraping.
+//
+// With BENCHMARK=true, it instead performs timed scrapes of the given `/proc`-like directory (or of a synthetic one
+// generated according to the BENCHMARK_* variables below, if none is given), and reports the latency, system calls
+// and heap allocations per scrape, for a cold and a warm scraper.
 
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <new>
 
 #include "EnvVar.h"
 #include "ProcfsScraper.h"
+#include "benchmarks/Benchmark.h"
+#include "benchmarks/SyntheticProcDir.h"
 
 using namespace collector;
 
 namespace {
 
 BoolEnvVar scrape_endpoints("SCRAPE_ENDPOINTS", true);
+BoolEnvVar scrape_io_uring("SCRAPE_IO_URING", false);
 
-}  // namespace
+BoolEnvVar benchmark("BENCHMARK", false);
+IntEnvVar benchmark_scrapes("BENCHMARK_SCRAPES", 100);
+IntEnvVar benchmark_pids("BENCHMARK_PIDS", 1000);
+IntEnvVar benchmark_fds_per_pid("BENCHMARK_FDS_PER_PID", 64);
+IntEnvVar benchmark_netns("BENCHMARK_NETNS", 100);
+IntEnvVar benchmark_sockets_per_netns("BENCHMARK_SOCKETS_PER_NETNS", 500);
 
-int main(int argc, char** argv) {
-  const char* proc_dir = "/proc";
+// Heap allocations made through operator new, counted by the replacements below.
+std::atomic<uint64_t> num_allocations;
+std::atomic<uint64_t> allocated_bytes;
 
-  if (argc > 1) {
-    proc_dir = argv[1];
-  }
+// AllocationCounter measures the heap allocations made during its lifetime.
+class AllocationCounter {
+ public:
+  AllocationCounter() : start_allocations_(num_allocations), start_bytes_(allocated_bytes) {}
+
+  uint64_t allocations() const { return num_allocations - start_allocations_; }
+  uint64_t bytes() const { return allocated_bytes - start_bytes_; }
 
-  ConnScraper scraper(proc_dir);
+ private:
+  uint64_t start_allocations_;
+  uint64_t start_bytes_;
+};
+
+int PrintScrape(const char* proc_dir) {
+  ConnScraper scraper(proc_dir, nullptr, scrape_io_uring.value());
   std::vector<Connection> conns;
   std::vector<ContainerEndpoint> endpoints;
 
@@ -46,3 +75,104 @@ int main(int argc, char** argv) {
 
   return 0;
 }
+
+int Benchmark(const char* proc_dir) {
+  std::unique_ptr<SyntheticProcDir> synthetic_proc;
+  if (!proc_dir) {
+    SyntheticProcDir::ScrapeFixture fixture;
+    fixture.num_pids = benchmark_pids.value();
+    fixture.fds_per_pid = benchmark_fds_per_pid.value();
+    fixture.num_netns = benchmark_netns.value();
+    fixture.sockets_per_netns = benchmark_sockets_per_netns.value();
+
+    std::printf("Generating %d processes with %d fds each, in %d network namespaces with %d sockets each\n",
+                fixture.num_pids, fixture.fds_per_pid, fixture.num_netns, fixture.sockets_per_netns);
+    synthetic_proc = std::make_unique<SyntheticProcDir>();
+    synthetic_proc->WriteScrapeFixture(fixture);
+    proc_dir = synthetic_proc->path().c_str();
+  }
+
+  const bool use_io_uring = scrape_io_uring.value();
+  std::vector<Connection> conns;
+  std::vector<ContainerEndpoint> endpoints;
+  auto* endpoints_ptr = scrape_endpoints ? &endpoints : nullptr;
+
+  auto scrape = [&](ConnScraper* scraper) {
+    conns.clear();
+    endpoints.clear();
+    if (!scraper->Scrape(&conns, endpoints_ptr)) {
+      std::cerr << "Failed to scrape " << proc_dir << std::endl;
+      std::exit(1);
+    }
+  };
+
+  std::printf("Scraping %s (%s)\n", proc_dir, use_io_uring ? "io_uring" : "synchronous reads");
+
+  // A cold scrape starts without any cached process metadata.
+  {
+    AllocationCounter allocs;
+    auto start = std::chrono::steady_clock::now();
+    ConnScraper scraper(proc_dir, nullptr, use_io_uring);
+    scrape(&scraper);
+    double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    uint64_t allocations = allocs.allocations(), bytes = allocs.bytes();
+
+    long syscalls = CountSyscalls([&]() {
+      ConnScraper scraper(proc_dir, nullptr, use_io_uring);
+      scrape(&scraper);
+    });
+    std::printf("  cold scrape: %10.1f us %8ld syscalls %8lu allocations %10lu bytes allocated\n", micros, syscalls,
+                static_cast<unsigned long>(allocations), static_cast<unsigned long>(bytes));
+  }
+
+  ConnScraper scraper(proc_dir, nullptr, use_io_uring);
+  scrape(&scraper);
+
+  const int num_scrapes = std::max(benchmark_scrapes.value(), 1);
+  std::vector<double> samples;
+  AllocationCounter allocs;
+  for (int i = 0; i < num_scrapes; i++) {
+    auto start = std::chrono::steady_clock::now();
+    scrape(&scraper);
+    samples.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+  }
+  uint64_t allocations = allocs.allocations(), bytes = allocs.bytes();
+  BenchmarkResult result(std::move(samples));
+  long syscalls = CountSyscalls([&]() { scrape(&scraper); });
+
+  std::printf("  warm scrape: %10.1f us (p99 %.1f us) %8ld syscalls %8lu allocations %10lu bytes allocated  (%d scrapes)\n",
+              result.Median() / 1e3, result.Percentile(99) / 1e3, syscalls,
+              static_cast<unsigned long>(allocations / num_scrapes), static_cast<unsigned long>(bytes / num_scrapes), num_scrapes);
+  std::printf("  %zu connections, %zu listen endpoints\n", conns.size(), endpoints.size());
+  return 0;
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+  num_allocations.fetch_add(1, std::memory_order_relaxed);
+  allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  if (void* ptr = std::malloc(size ? size : 1)) return ptr;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  std::free(ptr);
+}
+
+int main(int argc, char** argv) {
+  const char* proc_dir = nullptr;
+
+  if (argc > 1) {
+    proc_dir = argv[1];
+  }
+
+  if (benchmark) {
+    return Benchmark(proc_dir);
+  }
+  return PrintScrape(proc_dir ? proc_dir : "/proc");
+}
@@ -0,0 +1,76 @@
+#include "AdaptiveScrapeInterval.h"
+
+#include <algorithm>
+
+namespace collector {
+
+namespace {
+
+// Weight of the latest delta in the moving average of the delta size.
+constexpr double kDeltaRateWeight = 0.25;
+
+}  // namespace
+
+constexpr size_t AdaptiveScrapeInterval::kMinSpikeDeltaSize;
+constexpr double AdaptiveScrapeInterval::kSpikeFactor;
+constexpr size_t AdaptiveScrapeInterval::kMaxQuietDeltaSize;
+
+AdaptiveScrapeInterval::AdaptiveScrapeInterval(std::chrono::seconds interval, std::chrono::seconds min_interval,
+                                               std::chrono::seconds max_interval)
+    : min_interval_(std::max(min_interval, std::chrono::seconds(1))),
+      max_interval_(std::max(max_interval, min_interval_)) {
+  interval_ = base_interval_ = std::clamp(interval, min_interval_, max_interval_);
+}
+
+AdaptiveScrapeInterval::Reason AdaptiveScrapeInterval::Update(uint64_t total_drops, size_t delta_size) {
+  uint64_t drops = total_drops - std::min(last_total_drops_, total_drops);
+  last_total_drops_ = total_drops;
+
+  double delta_rate = static_cast<double>(delta_size) / interval_.count();
+  bool first_update = avg_delta_rate_ < 0;
+  double avg_delta_rate = first_update ? delta_rate : avg_delta_rate_;
+  avg_delta_rate_ = first_update ? delta_rate : (1 - kDeltaRateWeight) * avg_delta_rate_ + kDeltaRateWeight * delta_rate;
+
+  if (!enabled()) return Reason::NONE;
+
+  Reason reason = Reason::NONE;
+  auto interval = interval_;
+  auto lengthened = interval_ + std::max(interval_ / 4, std::chrono::seconds(1));
+  if (drops > 0) {
+    reason = Reason::DROPS;
+    interval = interval_ / 2;
+  } else if (delta_size >= kMinSpikeDeltaSize && delta_rate > kSpikeFactor * avg_delta_rate) {
+    reason = Reason::DELTA_SPIKE;
+    interval = interval_ / 2;
+  } else if (delta_size <= kMaxQuietDeltaSize) {
+    reason = Reason::QUIET;
+    interval = lengthened;
+  } else if (interval_ < base_interval_) {
+    reason = Reason::STEADY;
+    interval = std::min(lengthened, base_interval_);
+  }
+
+  interval = std::clamp(interval, min_interval_, max_interval_);
+  if (interval == interval_) return Reason::NONE;
+
+  interval_ = interval;
+  return reason;
+}
+
+const char* AdaptiveScrapeInterval::ReasonName(Reason reason) {
+  switch (reason) {
+    case Reason::NONE:
+      return "none";
+    case Reason::DROPS:
+      return "dropped events";
+    case Reason::DELTA_SPIKE:
+      return "delta size spike";
+    case Reason::QUIET:
+      return "quiet";
+    case Reason::STEADY:
+      return "steady";
+  }
+  return "unknown";
+}
+
+}  // namespace collector
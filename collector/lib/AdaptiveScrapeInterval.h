@@ -0,0 +1,60 @@
+#ifndef COLLECTOR_ADAPTIVESCRAPEINTERVAL_H
+#define COLLECTOR_ADAPTIVESCRAPEINTERVAL_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace collector {
+
+// AdaptiveScrapeInterval chooses the interval between two scrapes (and network connection info messages) within
+// configured bounds, depending on how well the event stream alone can be expected to keep track of connections:
+//  - when the kernel has dropped events since the last scrape, or the size of the last delta (per second) spikes, the
+//    interval is halved, such that the scrapes correct the missing or lagging state sooner,
+//  - when no events were dropped and the last delta was small (at most kMaxQuietDeltaSize entries), the interval is
+//    lengthened by a quarter,
+//  - otherwise, an interval that was shortened is lengthened by a quarter again, up to the configured interval.
+// If the bounds are equal, the interval is fixed.
+class AdaptiveScrapeInterval {
+ public:
+  enum class Reason {
+    NONE,         // the interval was not changed
+    DROPS,        // shortened because events were dropped
+    DELTA_SPIKE,  // shortened because the delta size spiked
+    QUIET,        // lengthened because no events were dropped and the delta was small
+    STEADY,       // lengthened towards the configured interval because there were neither drops nor a spike
+  };
+
+  // A delta of at least this many entries, and kSpikeFactor times its usual size, counts as a spike.
+  static constexpr size_t kMinSpikeDeltaSize = 100;
+  static constexpr double kSpikeFactor = 2.0;
+  // A delta of at most this many entries counts as small.
+  static constexpr size_t kMaxQuietDeltaSize = 10;
+
+  AdaptiveScrapeInterval(std::chrono::seconds interval, std::chrono::seconds min_interval, std::chrono::seconds max_interval);
+
+  bool enabled() const { return min_interval_ < max_interval_; }
+  std::chrono::seconds interval() const { return interval_; }
+
+  // Update adjusts the interval after a scrape, given the total number of events dropped by the kernel so far and the
+  // number of entries in the delta computed for that scrape. Returns the reason for the change, if any.
+  Reason Update(uint64_t total_drops, size_t delta_size);
+
+  static const char* ReasonName(Reason reason);
+
+ private:
+  std::chrono::seconds interval_;
+  // The configured interval, clamped to the bounds.
+  std::chrono::seconds base_interval_;
+  std::chrono::seconds min_interval_;
+  std::chrono::seconds max_interval_;
+
+  uint64_t last_total_drops_ = 0;
+  // Exponentially weighted moving average of the delta size per second of scrape interval, negative until the first
+  // update.
+  double avg_delta_rate_ = -1;
+};
+
+}  // namespace collector
+
+#endif  // COLLECTOR_ADAPTIVESCRAPEINTERVAL_H
@@ -0,0 +1,92 @@
+#ifndef COLLECTOR_BOUNDEDQUEUE_H
+#define COLLECTOR_BOUNDEDQUEUE_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace collector {
+
+// BoundedQueue is a blocking queue for passing items between threads that holds at most a fixed number of items.
+// Instead of blocking the producer when the queue is full, the pushed item is merged into the last queued one, such
+// that a slow consumer receives fewer, larger items rather than an ever growing backlog.
+template <typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(size_t capacity) : capacity_(std::max<size_t>(capacity, 1)) {}
+
+  BoundedQueue(const BoundedQueue&) = delete;
+  BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+  // Push appends item to the queue. If the queue is full, merge(T* last, T&& item) is called to merge item into the
+  // last queued item instead, and false is returned. After Shutdown, items are dropped.
+  template <typename Merge>
+  bool Push(T&& item, Merge&& merge) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (shutdown_) {
+        return true;
+      }
+      if (items_.size() >= capacity_) {
+        merge(&items_.back(), std::move(item));
+        return false;
+      }
+      items_.push_back(std::move(item));
+    }
+    cond_.notify_one();
+    return true;
+  }
+
+  // Pop waits until an item is available and moves it to *item. Returns false once the queue has been shut down.
+  bool Pop(T* item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this] { return shutdown_ || !items_.empty(); });
+    return PopLocked(item);
+  }
+
+  // PopFor is like Pop, but waits at most for the given duration. Returns false if no item became available.
+  template <typename Rep, typename Period>
+  bool PopFor(T* item, const std::chrono::duration<Rep, Period>& timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait_for(lock, timeout, [this] { return shutdown_ || !items_.empty(); });
+    return PopLocked(item);
+  }
+
+  // Shutdown discards all queued items and wakes up all waiting consumers.
+  void Shutdown() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      shutdown_ = true;
+      items_.clear();
+    }
+    cond_.notify_all();
+  }
+
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return items_.size();
+  }
+
+ private:
+  bool PopLocked(T* item) {
+    if (shutdown_ || items_.empty()) {
+      return false;
+    }
+    *item = std::move(items_.front());
+    items_.pop_front();
+    return true;
+  }
+
+  const size_t capacity_;
+  mutable std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<T> items_;
+  bool shutdown_ = false;
+};
+
+}  // namespace collector
+
+#endif  // COLLECTOR_BOUNDEDQUEUE_H
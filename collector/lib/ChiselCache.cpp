@@ -0,0 +1,62 @@
+#include "ChiselCache.h"
+
+#include <algorithm>
+
+namespace collector {
+
+ChiselCache::ChiselCache(size_t capacity) : slots_(std::max<size_t>(capacity, 1)) {
+  index_.reserve(slots_.size());
+}
+
+ChiselCache::Result ChiselCache::Lookup(const std::string& container_id) {
+  auto it = index_.find(container_id);
+  if (it == index_.end()) {
+    return MISS;
+  }
+
+  Slot& slot = slots_[it->second];
+  if (slot.generation != generation_) {
+    return MISS;
+  }
+  slot.referenced = true;
+  return slot.accepted ? ACCEPTED : BLOCKED;
+}
+
+bool ChiselCache::Insert(const std::string& container_id, bool accepted) {
+  bool evicted = false;
+  uint32_t id;
+  auto it = index_.find(container_id);
+  if (it != index_.end()) {
+    id = it->second;
+  } else {
+    id = used_ < slots_.size() ? used_++ : ReclaimSlot(&evicted);
+    // The slots never move, so the index can refer to the id stored in the slot.
+    slots_[id].container_id = container_id;
+    index_.emplace(slots_[id].container_id, id);
+  }
+
+  Slot& slot = slots_[id];
+  slot.generation = generation_;
+  slot.referenced = true;
+  slot.accepted = accepted;
+  return evicted;
+}
+
+uint32_t ChiselCache::ReclaimSlot(bool* evicted) {
+  for (;;) {
+    uint32_t id = hand_;
+    hand_ = (hand_ + 1) % slots_.size();
+
+    Slot& slot = slots_[id];
+    if (slot.generation == generation_ && slot.referenced) {
+      slot.referenced = false;
+      continue;
+    }
+
+    *evicted = (slot.generation == generation_);
+    index_.erase(slot.container_id);
+    return id;
+  }
+}
+
+}  // namespace collector
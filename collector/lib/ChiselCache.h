@@ -0,0 +1,67 @@
+#ifndef COLLECTOR_CHISELCACHE_H
+#define COLLECTOR_CHISELCACHE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace collector {
+
+// ChiselCache holds the result of the chisel filter for up to capacity containers.
+//
+// Container ids are interned: each id is stored once, in the slot holding its result, and the index refers to it. Once
+// the cache is full, a slot is reclaimed with the CLOCK algorithm, which approximates LRU: a hand sweeps over the
+// slots, clearing the referenced bit of those used since its last pass, and evicts the first one that was not.
+//
+// Results are tagged with the generation they were computed in. Invalidate starts a new generation in constant time,
+// after which the results of previous generations are treated as missing, and their slots are reclaimed first.
+class ChiselCache {
+ public:
+  enum Result {
+    MISS,
+    ACCEPTED,
+    BLOCKED,
+  };
+
+  explicit ChiselCache(size_t capacity);
+
+  // The index refers to the ids stored in the slots, so the cache can't be copied.
+  ChiselCache(const ChiselCache&) = delete;
+  ChiselCache& operator=(const ChiselCache&) = delete;
+
+  // Lookup returns the cached result for the container, or MISS if there is none for the current generation.
+  Result Lookup(const std::string& container_id);
+
+  // Insert caches the result for the container. Returns true if it evicted the result of another container of the
+  // current generation to do so.
+  bool Insert(const std::string& container_id, bool accepted);
+
+  void Invalidate() { ++generation_; }
+
+  size_t size() const { return used_; }
+  size_t capacity() const { return slots_.size(); }
+
+ private:
+  struct Slot {
+    std::string container_id;
+    uint32_t generation = 0;
+    bool referenced = false;
+    bool accepted = false;
+  };
+
+  // ReclaimSlot returns the slot to reuse for a new container, with its id removed from the index. Sets *evicted if the
+  // slot held a result of the current generation.
+  uint32_t ReclaimSlot(bool* evicted);
+
+  std::vector<Slot> slots_;
+  std::unordered_map<std::string_view, uint32_t> index_;
+  size_t used_ = 0;
+  size_t hand_ = 0;
+  uint32_t generation_ = 0;
+};
+
+}  // namespace collector
+
+#endif  // COLLECTOR_CHISELCACHE_H
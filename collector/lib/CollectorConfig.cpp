@@ -1,9 +1,12 @@
 #include "CollectorConfig.h"
 
+#include <algorithm>
 #include <sstream>
 
 #include "CollectorArgs.h"
 #include "EnvVar.h"
+#include "EventTimer.h"
+#include "GRPCCompression.h"
 #include "HostHeuristics.h"
 #include "HostInfo.h"
 #include "Logging.h"
@@ -36,11 +39,89 @@ BoolEnvVar core_bpf_hardfail("ROX_COLLECTOR_CORE_BPF_HARDFAIL", false);
 
 BoolEnvVar set_import_users("ROX_COLLECTOR_SET_IMPORT_USERS", false);
 
+// If positive, spread the scraping of /proc over the scrape interval, spending at most this many milliseconds of CPU
+// time per second on it.
+IntEnvVar scrape_cpu_budget_ms("ROX_COLLECTOR_SCRAPE_CPU_BUDGET_MS", 0);
+
+// Read the files in /proc in batches through io_uring when scraping, if the kernel supports it.
+BoolEnvVar scrape_io_uring("ROX_COLLECTOR_SCRAPE_IO_URING", false);
+
+// Bounds (in seconds) within which the scrape interval is adapted to the event drops and delta sizes. If unset, the
+// scrape interval is fixed.
+IntEnvVar scrape_interval_min("ROX_COLLECTOR_SCRAPE_INTERVAL_MIN", 0);
+IntEnvVar scrape_interval_max("ROX_COLLECTOR_SCRAPE_INTERVAL_MAX", 0);
+
+// If positive, split network connection and endpoint deltas into messages of at most this many entries, or
+// (approximately) bytes, respectively.
+IntEnvVar network_max_chunk_entries("ROX_COLLECTOR_NETWORK_MAX_CHUNK_ENTRIES", 0);
+IntEnvVar network_max_chunk_bytes("ROX_COLLECTOR_NETWORK_MAX_CHUNK_BYTES", 0);
+
+// If positive, network deltas that could not be sent to Sensor are merged and kept for the next stream, up to this
+// many entries in memory, beyond which they are written to the spool file, if set.
+IntEnvVar network_spool_max_entries("ROX_COLLECTOR_NETWORK_SPOOL_MAX_ENTRIES", 0);
+StringEnvVar network_spool_file("ROX_COLLECTOR_NETWORK_SPOOL_FILE", "");
+// Maximum size of the spool file, beyond which the spooled deltas are discarded and the full state is resent instead.
+// 0 does not limit the size.
+IntEnvVar network_spool_file_max_bytes("ROX_COLLECTOR_NETWORK_SPOOL_FILE_MAX_BYTES", CollectorConfig::kNetworkSpoolFileMaxBytes);
+
+// If positive, the serialized form of up to this many reported connections and endpoints is cached, such that they do
+// not have to be serialized again when reported repeatedly.
+IntEnvVar network_encoding_cache_entries("ROX_COLLECTOR_NETWORK_ENCODING_CACHE_ENTRIES", 0);
+
+// gRPC compression algorithm ("none", "deflate" or "gzip") for the network and signal streams to Sensor, and the size
+// (in bytes) below which messages are sent uncompressed.
+StringEnvVar network_compression("ROX_COLLECTOR_NETWORK_COMPRESSION", "none");
+StringEnvVar signal_compression("ROX_COLLECTOR_SIGNAL_COMPRESSION", "none");
+IntEnvVar compression_min_bytes("ROX_COLLECTOR_COMPRESSION_MIN_BYTES", 1024);
+
+// If positive, the process and network signal handlers process events on their own worker thread, which the capture
+// thread hands the events to over a queue of this size.
+IntEnvVar signal_queue_size("ROX_COLLECTOR_SIGNAL_QUEUE_SIZE", 0);
+
+// If true, chisels that only filter events are evaluated natively instead of through Lua.
+BoolEnvVar native_filter("ROX_COLLECTOR_NATIVE_FILTER", true);
+
+// Number of containers for which the result of the chisel is cached.
+IntEnvVar chisel_cache_size("ROX_COLLECTOR_CHISEL_CACHE_SIZE", 1024);
+
+// Clock ("system", "coarse" or "tsc") used to time the steps of handling events, and the rate (one in every N events of
+// each type) at which events are timed.
+StringEnvVar event_timing_clock("ROX_COLLECTOR_EVENT_TIMING_CLOCK", "system");
+IntEnvVar event_timing_sample_rate("ROX_COLLECTOR_EVENT_TIMING_SAMPLE_RATE", 1);
+
+// Size in bytes of the kernel ring buffers of the driver, and number of CPUs sharing each buffer (modern eBPF only). 0
+// uses the driver defaults, or the auto-sized values if auto-sizing is enabled.
+IntEnvVar driver_buffer_bytes("ROX_COLLECTOR_DRIVER_BUFFER_BYTES", 0);
+IntEnvVar driver_cpus_per_buffer("ROX_COLLECTOR_DRIVER_CPUS_PER_BUFFER", 0);
+
+// If true, the kernel ring buffers are sized at startup from the number of CPUs and the available memory.
+BoolEnvVar driver_buffer_auto_size("ROX_COLLECTOR_DRIVER_BUFFER_AUTO_SIZE", false);
+
+// If true, low priority syscalls stop being captured while the kernel drops more than the given events per thousand,
+// and are captured again once the drops have stayed low for the given number of seconds.
+BoolEnvVar overload_shedding("ROX_COLLECTOR_OVERLOAD_SHEDDING", false);
+IntEnvVar overload_drop_permille("ROX_COLLECTOR_OVERLOAD_DROP_PERMILLE", 10);
+IntEnvVar overload_restore_seconds("ROX_COLLECTOR_OVERLOAD_RESTORE_SECONDS", 30);
+
+// Capture file replayed instead of capturing events with a kernel driver, and capture file events are recorded to.
+StringEnvVar replay_file("ROX_COLLECTOR_REPLAY_FILE", "");
+StringEnvVar record_file("ROX_COLLECTOR_RECORD_FILE", "");
+
+grpc_compression_algorithm CompressionAlgorithmFromEnv(const StringEnvVar& env_var) {
+  grpc_compression_algorithm algorithm;
+  if (!ParseCompressionAlgorithm(env_var.value(), &algorithm)) {
+    CLOG(WARNING) << "Unsupported compression algorithm " << env_var.value() << ". Messages will not be compressed.";
+    return GRPC_COMPRESS_NONE;
+  }
+  return algorithm;
+}
+
 }  // namespace
 
 constexpr bool CollectorConfig::kUseChiselCache;
 constexpr bool CollectorConfig::kTurnOffScrape;
 constexpr int CollectorConfig::kScrapeInterval;
+constexpr int CollectorConfig::kNetworkSpoolFileMaxBytes;
 constexpr CollectionMethod CollectorConfig::kCollectionMethod;
 constexpr char CollectorConfig::kChisel[];
 constexpr const char* CollectorConfig::kSyscalls[];
@@ -59,6 +140,46 @@ CollectorConfig::CollectorConfig(CollectorArgs* args) {
   enable_processes_listening_on_ports_ = set_processes_listening_on_ports.value();
   core_bpf_hardfail_ = core_bpf_hardfail.value();
   import_users_ = set_import_users.value();
+  scrape_cpu_budget_ms_ = scrape_cpu_budget_ms.value();
+  if (scrape_cpu_budget_ms_ < 0) {
+    CLOG(WARNING) << "Invalid scrape CPU budget " << scrape_cpu_budget_ms_ << ". ROX_COLLECTOR_SCRAPE_CPU_BUDGET_MS must not be negative.";
+    scrape_cpu_budget_ms_ = 0;
+  }
+  scrape_io_uring_ = scrape_io_uring.value();
+  scrape_interval_min_ = scrape_interval_min.value();
+  scrape_interval_max_ = scrape_interval_max.value();
+  if (scrape_interval_min_ < 0 || scrape_interval_max_ < 0 ||
+      (scrape_interval_min_ > 0 && scrape_interval_max_ > 0 && scrape_interval_min_ > scrape_interval_max_)) {
+    CLOG(WARNING) << "Invalid scrape interval bounds [" << scrape_interval_min_ << ", " << scrape_interval_max_
+                  << "]. The scrape interval will not be adapted.";
+    scrape_interval_min_ = 0;
+    scrape_interval_max_ = 0;
+  }
+  network_max_chunk_entries_ = std::max(network_max_chunk_entries.value(), 0);
+  network_max_chunk_bytes_ = std::max(network_max_chunk_bytes.value(), 0);
+  network_spool_max_entries_ = std::max(network_spool_max_entries.value(), 0);
+  network_spool_file_ = network_spool_file.value();
+  network_spool_file_max_bytes_ = std::max(network_spool_file_max_bytes.value(), 0);
+  network_encoding_cache_entries_ = std::max(network_encoding_cache_entries.value(), 0);
+  network_compression_ = CompressionAlgorithmFromEnv(network_compression);
+  signal_compression_ = CompressionAlgorithmFromEnv(signal_compression);
+  compression_min_bytes_ = std::max(compression_min_bytes.value(), 0);
+  signal_queue_size_ = std::max(signal_queue_size.value(), 0);
+  use_native_filter_ = native_filter.value();
+  chisel_cache_size_ = std::max(chisel_cache_size.value(), 1);
+  if (!ParseEventTimerClock(event_timing_clock.value(), &event_timing_clock_)) {
+    CLOG(WARNING) << "Unsupported event timing clock " << event_timing_clock.value() << ". Using the system clock.";
+    event_timing_clock_ = EventTimer::Clock::SYSTEM;
+  }
+  event_timing_sample_rate_ = std::max(event_timing_sample_rate.value(), 1);
+  driver_buffer_bytes_ = std::max(driver_buffer_bytes.value(), 0);
+  driver_cpus_per_buffer_ = std::max(driver_cpus_per_buffer.value(), 0);
+  driver_buffer_auto_size_ = driver_buffer_auto_size.value();
+  overload_shedding_ = overload_shedding.value();
+  overload_drop_permille_ = std::max(overload_drop_permille.value(), 1);
+  overload_restore_seconds_ = std::max(overload_restore_seconds.value(), 1);
+  replay_file_ = replay_file.value();
+  record_file_ = record_file.value();
 
   for (const auto& syscall : kSyscalls) {
     syscalls_.push_back(syscall);
@@ -253,8 +374,34 @@ std::ostream& operator<<(std::ostream& os, const CollectorConfig& c) {
   return os
          << "collection_method:" << c.GetCollectionMethod()
          << ", useChiselCache:" << c.UseChiselCache()
+         << ", chisel_cache_size:" << c.ChiselCacheSize()
+         << ", event_timing_clock:" << EventTimerClockName(c.EventTimingClock())
+         << ", event_timing_sample_rate:" << c.EventTimingSampleRate()
+         << ", driver_buffer_bytes:" << c.DriverBufferBytes()
+         << ", driver_cpus_per_buffer:" << c.DriverCPUsPerBuffer()
+         << ", driver_buffer_auto_size:" << c.DriverBufferAutoSize()
+         << ", overload_shedding:" << c.OverloadShedding()
+         << ", overload_drop_permille:" << c.OverloadDropPermille()
+         << ", overload_restore_seconds:" << c.OverloadRestoreSeconds()
+         << ", replay_file:" << c.ReplayFile()
+         << ", record_file:" << c.RecordFile()
          << ", scrape_interval:" << c.ScrapeInterval()
          << ", turn_off_scrape:" << c.TurnOffScrape()
+         << ", scrape_cpu_budget_ms:" << c.ScrapeCPUBudgetMillis()
+         << ", scrape_io_uring:" << c.ScrapeIoUring()
+         << ", scrape_interval_min:" << c.ScrapeIntervalMin()
+         << ", scrape_interval_max:" << c.ScrapeIntervalMax()
+         << ", network_max_chunk_entries:" << c.NetworkMaxChunkEntries()
+         << ", network_max_chunk_bytes:" << c.NetworkMaxChunkBytes()
+         << ", network_spool_max_entries:" << c.NetworkSpoolMaxEntries()
+         << ", network_spool_file:" << c.NetworkSpoolFile()
+         << ", network_spool_file_max_bytes:" << c.NetworkSpoolFileMaxBytes()
+         << ", network_encoding_cache_entries:" << c.NetworkEncodingCacheEntries()
+         << ", network_compression:" << CompressionAlgorithmName(c.NetworkCompression())
+         << ", signal_compression:" << CompressionAlgorithmName(c.SignalCompression())
+         << ", compression_min_bytes:" << c.CompressionMinBytes()
+         << ", signal_queue_size:" << c.SignalQueueSize()
+         << ", native_filter:" << c.UseNativeFilter()
          << ", hostname:" << c.Hostname()
          << ", processesListeningOnPorts:" << c.IsProcessesListeningOnPortsEnabled()
          << ", logLevel:" << c.LogLevel()
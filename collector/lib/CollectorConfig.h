@@ -6,9 +6,11 @@
 
 #include <json/json.h>
 
+#include <grpc/compression.h>
 #include <grpcpp/channel.h>
 
 #include "CollectionMethod.h"
+#include "EventTimer.h"
 #include "HostConfig.h"
 #include "NetworkConnection.h"
 
@@ -21,6 +23,7 @@ class CollectorConfig {
   static constexpr bool kUseChiselCache = true;
   static constexpr bool kTurnOffScrape = false;
   static constexpr int kScrapeInterval = 30;
+  static constexpr int kNetworkSpoolFileMaxBytes = 64 * 1024 * 1024;
   static constexpr CollectionMethod kCollectionMethod = CollectionMethod::EBPF;
   static constexpr const char* kSyscalls[] = {
       "accept",
@@ -68,6 +71,32 @@ end
   bool TurnOffScrape() const;
   bool ScrapeListenEndpoints() const { return scrape_listen_endpoints_; }
   int ScrapeInterval() const;
+  int ScrapeCPUBudgetMillis() const { return scrape_cpu_budget_ms_; }
+  bool ScrapeIoUring() const { return scrape_io_uring_; }
+  int ScrapeIntervalMin() const { return scrape_interval_min_; }
+  int ScrapeIntervalMax() const { return scrape_interval_max_; }
+  int NetworkMaxChunkEntries() const { return network_max_chunk_entries_; }
+  int NetworkMaxChunkBytes() const { return network_max_chunk_bytes_; }
+  int NetworkSpoolMaxEntries() const { return network_spool_max_entries_; }
+  const std::string& NetworkSpoolFile() const { return network_spool_file_; }
+  int NetworkSpoolFileMaxBytes() const { return network_spool_file_max_bytes_; }
+  int NetworkEncodingCacheEntries() const { return network_encoding_cache_entries_; }
+  grpc_compression_algorithm NetworkCompression() const { return network_compression_; }
+  grpc_compression_algorithm SignalCompression() const { return signal_compression_; }
+  int CompressionMinBytes() const { return compression_min_bytes_; }
+  int SignalQueueSize() const { return signal_queue_size_; }
+  bool UseNativeFilter() const { return use_native_filter_; }
+  int ChiselCacheSize() const { return chisel_cache_size_; }
+  EventTimer::Clock EventTimingClock() const { return event_timing_clock_; }
+  int EventTimingSampleRate() const { return event_timing_sample_rate_; }
+  int DriverBufferBytes() const { return driver_buffer_bytes_; }
+  int DriverCPUsPerBuffer() const { return driver_cpus_per_buffer_; }
+  bool DriverBufferAutoSize() const { return driver_buffer_auto_size_; }
+  bool OverloadShedding() const { return overload_shedding_; }
+  int OverloadDropPermille() const { return overload_drop_permille_; }
+  int OverloadRestoreSeconds() const { return overload_restore_seconds_; }
+  const std::string& ReplayFile() const { return replay_file_; }
+  const std::string& RecordFile() const { return record_file_; }
   std::string Chisel() const;
   std::string Hostname() const;
   std::string HostProc() const;
@@ -93,6 +122,32 @@ end
   CollectionMethod collection_method_;
   std::string chisel_;
   bool turn_off_scrape_;
+  int scrape_cpu_budget_ms_ = 0;
+  bool scrape_io_uring_ = false;
+  int scrape_interval_min_ = 0;
+  int scrape_interval_max_ = 0;
+  int network_max_chunk_entries_ = 0;
+  int network_max_chunk_bytes_ = 0;
+  int network_spool_max_entries_ = 0;
+  std::string network_spool_file_;
+  int network_spool_file_max_bytes_ = kNetworkSpoolFileMaxBytes;
+  int network_encoding_cache_entries_ = 0;
+  grpc_compression_algorithm network_compression_ = GRPC_COMPRESS_NONE;
+  grpc_compression_algorithm signal_compression_ = GRPC_COMPRESS_NONE;
+  int compression_min_bytes_ = 0;
+  int signal_queue_size_ = 0;
+  bool use_native_filter_ = true;
+  int chisel_cache_size_ = 1024;
+  EventTimer::Clock event_timing_clock_ = EventTimer::Clock::SYSTEM;
+  int event_timing_sample_rate_ = 1;
+  int driver_buffer_bytes_ = 0;
+  int driver_cpus_per_buffer_ = 0;
+  bool driver_buffer_auto_size_ = false;
+  bool overload_shedding_ = false;
+  int overload_drop_permille_ = 10;
+  int overload_restore_seconds_ = 30;
+  std::string replay_file_;
+  std::string record_file_;
   std::vector<std::string> syscalls_;
   std::string hostname_;
   std::string host_proc_;
@@ -25,6 +25,13 @@ extern unsigned char g_bpf_drop_syscalls[];  // defined in libscap
 
 namespace collector {
 
+namespace {
+
+// Maximum time to wait for the final network delta of a replay to be sent.
+constexpr auto kReplayFlushTimeout = std::chrono::seconds(10);
+
+}  // namespace
+
 CollectorService::CollectorService(const CollectorConfig& config, std::atomic<ControlValue>* control,
                                    const std::atomic<int>* signum)
     : config_(config), control_(control), signum_(*signum) {
@@ -75,16 +82,26 @@ void CollectorService::RunForever() {
     if (config_.IsProcessesListeningOnPortsEnabled()) {
       process_store = std::make_shared<ProcessStore>(&sysdig_);
     }
-    std::shared_ptr<IConnScraper> conn_scraper = std::make_shared<ConnScraper>(config_.HostProc(), process_store);
+    std::shared_ptr<IConnScraper> conn_scraper = std::make_shared<ConnScraper>(config_.HostProc(), process_store, config_.ScrapeIoUring());
     conn_tracker = std::make_shared<ConnectionTracker>();
     UnorderedSet<L4ProtoPortPair> ignored_l4proto_port_pairs(config_.IgnoredL4ProtoPortPairs());
     conn_tracker->UpdateIgnoredL4ProtoPortPairs(std::move(ignored_l4proto_port_pairs));
 
-    auto network_connection_info_service_comm = std::make_shared<NetworkConnectionInfoServiceComm>(config_.Hostname(), config_.grpc_channel);
+    auto network_connection_info_service_comm = std::make_shared<NetworkConnectionInfoServiceComm>(config_.Hostname(), config_.grpc_channel,
+                                                                                                   config_.NetworkCompression(), config_.CompressionMinBytes());
 
-    net_status_notifier = MakeUnique<NetworkStatusNotifier>(conn_scraper, config_.ScrapeInterval(), config_.ScrapeListenEndpoints(), config_.TurnOffScrape(),
+    // The connections of a replayed capture file have nothing to do with the ones found in the local /proc.
+    bool turn_off_scrape = config_.TurnOffScrape() || !config_.ReplayFile().empty();
+    if (turn_off_scrape && !config_.TurnOffScrape()) {
+      CLOG(INFO) << "Scraping of /proc is turned off while replaying a capture file";
+    }
+    net_status_notifier = MakeUnique<NetworkStatusNotifier>(conn_scraper, config_.ScrapeInterval(), config_.ScrapeListenEndpoints(), turn_off_scrape,
                                                             conn_tracker, config_.AfterglowPeriod(), config_.EnableAfterglow(),
-                                                            network_connection_info_service_comm);
+                                                            network_connection_info_service_comm, config_.ScrapeCPUBudgetMillis(),
+                                                            config_.ScrapeIntervalMin(), config_.ScrapeIntervalMax(),
+                                                            config_.NetworkMaxChunkEntries(), config_.NetworkMaxChunkBytes(),
+                                                            config_.NetworkSpoolMaxEntries(), config_.NetworkSpoolFile(), config_.NetworkSpoolFileMaxBytes(),
+                                                            config_.NetworkEncodingCacheEntries(), &sysdig_);
     net_status_notifier->Start();
   }
 
@@ -99,6 +116,17 @@ void CollectorService::RunForever() {
   ControlValue cv;
   while ((cv = control_->load(std::memory_order_relaxed)) != STOP_COLLECTOR) {
     sysdig_.Run(*control_);
+    if (sysdig_.ReplayFinished()) {
+      // The network deltas are otherwise computed at the scrape interval, which has nothing to do with the pace of the
+      // replay, so the connections of the last events still have to be sent.
+      if (net_status_notifier) {
+        if (!net_status_notifier->Flush(kReplayFlushTimeout)) {
+          CLOG(WARNING) << "Timed out sending the final network delta of the replay";
+        }
+        net_status_notifier->LogStageTimings();
+      }
+      break;
+    }
     CLOG(DEBUG) << "Interrupted collector!";
 
     std::lock_guard<std::mutex> lock(chisel_mutex_);
@@ -134,6 +162,10 @@ bool CollectorService::InitKernel(const DriverCandidate& candidate) {
   return sysdig_.InitKernel(config_, candidate);
 }
 
+bool CollectorService::InitReplay() {
+  return sysdig_.InitReplay(config_);
+}
+
 bool CollectorService::WaitForGRPCServer() {
   std::string error_str;
   auto interrupt = [this] { return control_->load(std::memory_order_relaxed) == STOP_COLLECTOR; };
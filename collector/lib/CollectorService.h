@@ -20,6 +20,7 @@ class CollectorService {
   void RunForever();
 
   bool InitKernel(const DriverCandidate& candidate);
+  bool InitReplay();
 
  private:
   void OnChiselReceived(const std::string& chisel);
@@ -8,12 +8,17 @@
 
 #include "TimeUtil.h"
 
-#define TIMER_NAMES     \
-  X(net_scrape_read)    \
-  X(net_scrape_update)  \
-  X(net_fetch_state)    \
-  X(net_create_message) \
-  X(net_write_message)  \
+#define TIMER_NAMES       \
+  X(net_scrape_read)      \
+  X(net_scrape_update)    \
+  X(net_scrape_sweep)     \
+  X(net_fetch_state)      \
+  X(net_create_message)   \
+  X(net_write_message)    \
+  X(net_scraper_stage)    \
+  X(net_delta_stage)      \
+  X(net_sender_stage)     \
+  X(net_delta_queue_wait) \
   X(process_info_wait)
 
 #define COUNTER_NAMES                       \
@@ -25,6 +30,39 @@
   X(net_cep_inactive)                       \
   X(net_known_ip_networks)                  \
   X(net_known_public_ips)                   \
+  X(net_scrape_interval_seconds)            \
+  X(net_scrape_interval_shortened_drops)    \
+  X(net_scrape_interval_shortened_delta)    \
+  X(net_scrape_interval_lengthened)         \
+  X(net_scrapes_coalesced)                  \
+  X(net_deltas_merged)                      \
+  X(net_delta_chunks)                       \
+  X(net_delta_chunk_bytes)                  \
+  X(net_delta_max_chunk_bytes)              \
+  X(net_spool_entries)                      \
+  X(net_spool_file_bytes)                   \
+  X(net_spool_entries_added)                \
+  X(net_spool_entries_merged)               \
+  X(net_spool_spills)                       \
+  X(net_spool_dropped)                      \
+  X(net_encoding_cache_hits)                \
+  X(net_encoding_cache_misses)              \
+  X(net_encoding_cache_evictions)           \
+  X(net_grpc_bytes)                         \
+  X(net_grpc_compressed_bytes)              \
+  X(net_grpc_compression_us)                \
+  X(signal_grpc_bytes)                      \
+  X(signal_grpc_compressed_bytes)           \
+  X(signal_grpc_compression_us)             \
+  X(process_signal_queue_depth)             \
+  X(process_signal_queue_drops)             \
+  X(process_signal_lag_us)                  \
+  X(network_signal_queue_depth)             \
+  X(network_signal_queue_drops)             \
+  X(network_signal_lag_us)                  \
+  X(driver_buffer_bytes)                    \
+  X(driver_cpus_per_buffer)                 \
+  X(overload_shedding_level)                \
   X(process_lineage_counts)                 \
   X(process_lineage_total)                  \
   X(process_lineage_sqr_total)              \
@@ -38,7 +76,17 @@
   X(procfs_could_not_get_network_namespace) \
   X(procfs_could_not_get_socket_inodes)     \
   X(procfs_could_not_read_exe)              \
-  X(procfs_could_not_read_cmdline)
+  X(procfs_could_not_read_cmdline)          \
+  X(procfs_metadata_cache_hits)             \
+  X(procfs_metadata_cache_misses)           \
+  X(procfs_metadata_cache_evictions)        \
+  X(procfs_container_id_cache_hits)         \
+  X(procfs_container_id_cache_misses)       \
+  X(procfs_fd_tables_skipped)               \
+  X(procfs_fd_readlinks_avoided)            \
+  X(procfs_io_uring_ops)                    \
+  X(procfs_io_uring_submissions)            \
+  X(procfs_scrape_peak_alloc_bytes)
 
 namespace collector {
 
@@ -3,6 +3,8 @@
 #include <chrono>
 #include <iostream>
 #include <math.h>
+#include <string>
+#include <vector>
 
 #include "Containers.h"
 #include "EventNames.h"
@@ -56,6 +58,8 @@ void CollectorStatsExporter::run() {
   auto& userspaceEvents = collectorEventCounters.Add({{"type", "userspace"}});
   auto& chiselCacheHitsAccept = collectorEventCounters.Add({{"type", "chiselCacheHitsAccept"}});
   auto& chiselCacheHitsReject = collectorEventCounters.Add({{"type", "chiselCacheHitsReject"}});
+  auto& chiselCacheMisses = collectorEventCounters.Add({{"type", "chiselCacheMisses"}});
+  auto& chiselCacheEvictions = collectorEventCounters.Add({{"type", "chiselCacheEvictions"}});
   auto& grpcSendFailures = collectorEventCounters.Add({{"type", "grpcSendFailures"}});
 
   auto& processSent = collectorEventCounters.Add({{"type", "processSent"}});
@@ -109,6 +113,18 @@ void CollectorStatsExporter::run() {
   prometheus::Gauge* lineage_std_dev = &collectorProcessLineageInfo.Add({{"type", "std_dev"}});
   prometheus::Gauge* lineage_avg_string_len = &collectorProcessLineageInfo.Add({{"type", "lineage_avg_string_len"}});
 
+  // The per-CPU gauges are only added once the driver reports per-CPU stats.
+  auto& collectorCPUEventCounters = prometheus::BuildGauge()
+                                        .Name("rox_collector_events_per_cpu")
+                                        .Help("Collector kernel events by CPU")
+                                        .Register(*registry_);
+
+  struct PerCPUGauges {
+    prometheus::Gauge* kernel;
+    prometheus::Gauge* drops;
+  };
+  std::vector<PerCPUGauges> per_cpu;
+
   struct {
     prometheus::Gauge* filtered = nullptr;
     prometheus::Gauge* userspace = nullptr;
@@ -116,9 +132,11 @@ void CollectorStatsExporter::run() {
     prometheus::Gauge* chiselCacheHitsReject = nullptr;
 
     prometheus::Gauge* parse_micros_total = nullptr;
+    prometheus::Gauge* filter_micros_total = nullptr;
     prometheus::Gauge* process_micros_total = nullptr;
 
     prometheus::Gauge* parse_micros_avg = nullptr;
+    prometheus::Gauge* filter_micros_avg = nullptr;
     prometheus::Gauge* process_micros_avg = nullptr;
   } typed[PPM_EVENT_MAX] = {};
 
@@ -146,11 +164,15 @@ void CollectorStatsExporter::run() {
 
     typed[i].parse_micros_total = &collectorTypedEventTimesTotal.Add(
         std::map<std::string, std::string>{{"step", "parse"}, {"event_type", event_name}, {"event_dir", event_dir}});
+    typed[i].filter_micros_total = &collectorTypedEventTimesTotal.Add(
+        std::map<std::string, std::string>{{"step", "filter"}, {"event_type", event_name}, {"event_dir", event_dir}});
     typed[i].process_micros_total = &collectorTypedEventTimesTotal.Add(
         std::map<std::string, std::string>{{"step", "process"}, {"event_type", event_name}, {"event_dir", event_dir}});
 
     typed[i].parse_micros_avg = &collectorTypedEventTimesAvg.Add(
         std::map<std::string, std::string>{{"step", "parse"}, {"event_type", event_name}, {"event_dir", event_dir}});
+    typed[i].filter_micros_avg = &collectorTypedEventTimesAvg.Add(
+        std::map<std::string, std::string>{{"step", "filter"}, {"event_type", event_name}, {"event_dir", event_dir}});
     typed[i].process_micros_avg = &collectorTypedEventTimesAvg.Add(
         std::map<std::string, std::string>{{"step", "process"}, {"event_type", event_name}, {"event_dir", event_dir}});
   }
@@ -165,6 +187,16 @@ void CollectorStatsExporter::run() {
     drops.Set(stats.nDrops);
     preemptions.Set(stats.nPreemptions);
 
+    for (uint64_t cpu = per_cpu.size(); cpu < stats.nCPUs; cpu++) {
+      std::string cpu_label = std::to_string(cpu);
+      per_cpu.push_back({&collectorCPUEventCounters.Add({{"type", "kernel"}, {"cpu", cpu_label}}),
+                         &collectorCPUEventCounters.Add({{"type", "drops"}, {"cpu", cpu_label}})});
+    }
+    for (uint64_t cpu = 0; cpu < stats.nCPUs; cpu++) {
+      per_cpu[cpu].kernel->Set(stats.nEventsPerCPU[cpu]);
+      per_cpu[cpu].drops->Set(stats.nDropsPerCPU[cpu]);
+    }
+
     uint64_t nFiltered = 0, nUserspace = 0, nChiselCacheHitsAccept = 0, nChiselCacheHitsReject = 0;
     for (int i = 0; i < PPM_EVENT_MAX; i++) {
       auto& counters = typed[i];
@@ -174,6 +206,7 @@ void CollectorStatsExporter::run() {
       auto chiselCacheHitsAccept = stats.nChiselCacheHitsAccept[i];
       auto chiselCacheHitsReject = stats.nChiselCacheHitsReject[i];
       auto parse_micros_total = stats.event_parse_micros[i];
+      auto filter_micros_total = stats.event_filter_micros[i];
       auto process_micros_total = stats.event_process_micros[i];
 
       nFiltered += filtered;
@@ -187,9 +220,11 @@ void CollectorStatsExporter::run() {
       if (counters.chiselCacheHitsReject) counters.chiselCacheHitsReject->Set(chiselCacheHitsReject);
 
       if (counters.parse_micros_total) counters.parse_micros_total->Set(parse_micros_total);
+      if (counters.filter_micros_total) counters.filter_micros_total->Set(filter_micros_total);
       if (counters.process_micros_total) counters.process_micros_total->Set(process_micros_total);
 
       if (counters.parse_micros_avg) counters.parse_micros_avg->Set(userspace ? parse_micros_total / userspace : 0);
+      if (counters.filter_micros_avg) counters.filter_micros_avg->Set(userspace ? filter_micros_total / userspace : 0);
       if (counters.process_micros_avg) counters.process_micros_avg->Set(filtered ? process_micros_total / filtered : 0);
     }
 
@@ -197,6 +232,8 @@ void CollectorStatsExporter::run() {
     userspaceEvents.Set(nUserspace);
     chiselCacheHitsAccept.Set(nChiselCacheHitsAccept);
     chiselCacheHitsReject.Set(nChiselCacheHitsReject);
+    chiselCacheMisses.Set(stats.nChiselCacheMisses);
+    chiselCacheEvictions.Set(stats.nChiselCacheEvictions);
 
     grpcSendFailures.Set(stats.nGRPCSendFailures);
 
@@ -46,6 +46,14 @@ void ConnectionTracker::UpdateConnection(const Connection& conn, int64_t timesta
   }
 }
 
+void ConnectionTracker::UpdateConnections(const ConnectionUpdate* updates, size_t count) {
+  WITH_LOCK(mutex_) {
+    for (size_t i = 0; i < count; i++) {
+      EmplaceOrUpdateNoLock(updates[i].conn, ConnStatus(updates[i].timestamp, updates[i].added));
+    }
+  }
+}
+
 void ConnectionTracker::Update(
     const std::vector<Connection>& all_conns,
     const std::vector<ContainerEndpoint>& all_listen_endpoints,
@@ -71,6 +79,31 @@ void ConnectionTracker::Update(
   }
 }
 
+void ConnectionTracker::UpdateFromSweep(
+    const std::vector<Connection>& all_conns,
+    const std::vector<ContainerEndpoint>& all_listen_endpoints,
+    int64_t sweep_start) {
+  WITH_LOCK(mutex_) {
+    // Only mark connections and listen endpoints as inactive if the sweep has had a chance to observe their status.
+    for (auto& prev_conn : conn_state_) {
+      if (prev_conn.second.LastActiveTime() < sweep_start) prev_conn.second.SetActive(false);
+    }
+    for (auto& prev_endpoint : endpoint_state_) {
+      if (prev_endpoint.second.LastActiveTime() < sweep_start) prev_endpoint.second.SetActive(false);
+    }
+
+    // Entries updated after the sweep started have a more recent timestamp, and are hence left untouched.
+    ConnStatus new_status(sweep_start, true);
+
+    for (const auto& curr_conn : all_conns) {
+      EmplaceOrUpdateNoLock(curr_conn, new_status);
+    }
+    for (const auto& curr_endpoint : all_listen_endpoints) {
+      EmplaceOrUpdateNoLock(curr_endpoint, new_status);
+    }
+  }
+}
+
 IPNet ConnectionTracker::NormalizeAddressNoLock(const Address& address) const {
   if (address.IsNull()) {
     return {};
@@ -76,6 +76,13 @@ class AdvertisedEndpointEquality {
   bool operator()(const ContainerEndpoint& lhs, const ContainerEndpoint& rhs) const;
 };
 
+// An update of a connection, extracted from a connect, accept, close or shutdown event.
+struct ConnectionUpdate {
+  Connection conn;
+  int64_t timestamp = 0;
+  bool added = false;
+};
+
 using ConnMap = UnorderedMap<Connection, ConnStatus>;
 using ContainerEndpointMap = UnorderedMap<ContainerEndpoint, ConnStatus>;
 using AdvertisedEndpointMap = UnorderedMap<ContainerEndpoint, ConnStatus, AdvertisedEndpointEquality>;
@@ -91,9 +98,17 @@ class ConnectionTracker {
   void RemoveConnection(const Connection& conn, int64_t timestamp) {
     UpdateConnection(conn, timestamp, false);
   }
+  // UpdateConnections applies count updates in order, taking the lock only once.
+  void UpdateConnections(const ConnectionUpdate* updates, size_t count);
 
   void Update(const std::vector<Connection>& all_conns, const std::vector<ContainerEndpoint>& all_listen_endpoints, int64_t timestamp);
 
+  // UpdateFromSweep is the equivalent of Update for the results of an incremental scrape which started at sweep_start.
+  // As parts of the sweep may have been observed at any time after sweep_start, connections and listen endpoints whose
+  // status was updated (e.g., from an event) after sweep_start keep that status, while all others are marked active
+  // as of sweep_start if contained in the sweep results, and inactive otherwise.
+  void UpdateFromSweep(const std::vector<Connection>& all_conns, const std::vector<ContainerEndpoint>& all_listen_endpoints, int64_t sweep_start);
+
   // Atomically fetch a snapshot of the current state, removing all inactive connections if requested.
   ConnMap FetchConnState(bool normalize = false, bool clear_inactive = true);
   AdvertisedEndpointMap FetchEndpointState(bool normalize = false, bool clear_inactive = true);
@@ -0,0 +1,125 @@
+#include "DeltaSpool.h"
+
+#include <cstdio>
+
+#include "CollectorStats.h"
+#include "Logging.h"
+#include "Utility.h"
+
+namespace collector {
+
+namespace {
+
+template <typename Map>
+size_t MergeMap(Map* map, Map&& later) {
+  // Moves the nodes of the entries that are not in map yet, leaving only the superseding ones in later.
+  map->merge(later);
+  for (auto& entry : later) {
+    map->find(entry.first)->second = std::move(entry.second);
+  }
+  return later.size();
+}
+
+}  // namespace
+
+size_t NetworkDelta::MergeFrom(NetworkDelta&& later) {
+  return MergeMap(&conns, std::move(later.conns)) + MergeMap(&endpoints, std::move(later.endpoints));
+}
+
+DeltaSpool::DeltaSpool(size_t max_entries, std::string overflow_path, size_t max_overflow_bytes)
+    : max_entries_(max_entries), overflow_path_(std::move(overflow_path)), max_overflow_bytes_(max_overflow_bytes) {}
+
+DeltaSpool::~DeltaSpool() {
+  Clear();
+}
+
+bool DeltaSpool::Add(NetworkDelta&& delta) {
+  COUNTER_ADD(CollectorStats::net_spool_entries_added, delta.size());
+  size_t superseded = delta_.MergeFrom(std::move(delta));
+  COUNTER_ADD(CollectorStats::net_spool_entries_merged, superseded);
+  UpdateStats();
+  return delta_.size() <= max_entries_;
+}
+
+bool DeltaSpool::Spill(const std::string& message) {
+  uint32_t size = message.size();
+  if (max_overflow_bytes_ > 0 && spilled_bytes_ + sizeof(size) + message.size() > max_overflow_bytes_) {
+    CLOG(WARNING) << "Network delta spool file " << overflow_path_ << " reached its maximum size of " << max_overflow_bytes_
+                  << " bytes";
+    return false;
+  }
+
+  if (!overflow_file_) {
+    overflow_file_ = std::fopen(overflow_path_.c_str(), "w+b");
+    if (!overflow_file_) {
+      CLOG(ERROR) << "Failed to open network delta spool file " << overflow_path_ << ": " << StrError();
+      return false;
+    }
+  }
+
+  if (std::fseek(overflow_file_, 0, SEEK_END) != 0 ||
+      std::fwrite(&size, sizeof(size), 1, overflow_file_) != 1 ||
+      std::fwrite(message.data(), 1, message.size(), overflow_file_) != message.size() ||
+      std::fflush(overflow_file_) != 0) {
+    CLOG(ERROR) << "Failed to write to network delta spool file " << overflow_path_ << ": " << StrError();
+    return false;
+  }
+
+  spilled_messages_++;
+  spilled_bytes_ += sizeof(size) + message.size();
+  COUNTER_INC(CollectorStats::net_spool_spills);
+  UpdateStats();
+  return true;
+}
+
+void DeltaSpool::ClearDelta() {
+  delta_ = NetworkDelta();
+  UpdateStats();
+}
+
+bool DeltaSpool::ForEachSpilled(const std::function<bool(const std::string&)>& fn) {
+  if (spilled_messages_ == 0) {
+    return true;
+  }
+
+  if (std::fseek(overflow_file_, 0, SEEK_SET) != 0) {
+    CLOG(ERROR) << "Failed to read network delta spool file " << overflow_path_ << ": " << StrError();
+    return false;
+  }
+
+  std::string message;
+  for (size_t i = 0; i < spilled_messages_; i++) {
+    uint32_t size;
+    if (std::fread(&size, sizeof(size), 1, overflow_file_) != 1) {
+      CLOG(ERROR) << "Failed to read network delta spool file " << overflow_path_ << ": " << StrError();
+      return false;
+    }
+    message.resize(size);
+    if (std::fread(&message[0], 1, size, overflow_file_) != size) {
+      CLOG(ERROR) << "Failed to read network delta spool file " << overflow_path_ << ": " << StrError();
+      return false;
+    }
+    if (!fn(message)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void DeltaSpool::Clear() {
+  delta_ = NetworkDelta();
+  if (overflow_file_) {
+    overflow_file_.close();
+    std::remove(overflow_path_.c_str());
+  }
+  spilled_messages_ = 0;
+  spilled_bytes_ = 0;
+  UpdateStats();
+}
+
+void DeltaSpool::UpdateStats() const {
+  COUNTER_SET(CollectorStats::net_spool_entries, delta_.size());
+  COUNTER_SET(CollectorStats::net_spool_file_bytes, spilled_bytes_);
+}
+
+}  // namespace collector
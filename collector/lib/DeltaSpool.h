@@ -0,0 +1,84 @@
+#ifndef COLLECTOR_DELTASPOOL_H
+#define COLLECTOR_DELTASPOOL_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "ConnTracker.h"
+#include "FileSystem.h"
+
+namespace collector {
+
+// NetworkDelta holds the connections and endpoints whose status changed, with their latest status.
+struct NetworkDelta {
+  ConnMap conns;
+  AdvertisedEndpointMap endpoints;
+  // Time at which the (oldest part of the) delta was queued.
+  int64_t queued_micros = 0;
+  // Whether the delta holds the full state rather than the changes since the previous delta.
+  bool resync = false;
+  // Whether the delta completes a flush of the pipeline.
+  bool flush = false;
+
+  size_t size() const { return conns.size() + endpoints.size(); }
+  bool empty() const { return conns.empty() && endpoints.empty(); }
+
+  // MergeFrom merges a later delta into this one. The later status of a connection or endpoint supersedes the earlier
+  // one. Returns the number of entries of the later delta that superseded an entry of this one.
+  size_t MergeFrom(NetworkDelta&& later);
+};
+
+// DeltaSpool accumulates the deltas that could not be sent while the stream to Sensor was down, such that only their
+// merge has to be sent once the stream is back. The merged delta is kept in memory up to a fixed number of entries.
+// Beyond that, it has to be spilled, as serialized messages, to an overflow file, if one is configured. The overflow
+// file is limited to a fixed size as well, unless that is 0.
+class DeltaSpool {
+ public:
+  DeltaSpool(size_t max_entries, std::string overflow_path, size_t max_overflow_bytes = 0);
+  ~DeltaSpool();
+
+  DeltaSpool(const DeltaSpool&) = delete;
+  DeltaSpool& operator=(const DeltaSpool&) = delete;
+
+  bool enabled() const { return max_entries_ > 0; }
+  bool has_overflow_file() const { return !overflow_path_.empty(); }
+  bool empty() const { return delta_.empty() && spilled_messages_ == 0; }
+
+  const NetworkDelta& delta() const { return delta_; }
+  size_t spilled_messages() const { return spilled_messages_; }
+  size_t spilled_bytes() const { return spilled_bytes_; }
+
+  // Add merges delta into the spooled delta. Returns false if the spooled delta exceeds the capacity of the spool
+  // afterwards, in which case it has to be spilled (see Spill and ClearDelta) or the spool cleared.
+  bool Add(NetworkDelta&& delta);
+
+  // Spill appends a serialized message to the overflow file. Returns false if it could not be written, or if the file
+  // would exceed its maximum size, in which case the spool has to be cleared.
+  bool Spill(const std::string& message);
+  // ClearDelta clears the spooled delta, once it has been spilled.
+  void ClearDelta();
+
+  // ForEachSpilled calls fn with every message in the overflow file, in the order they were spilled, and stops early if
+  // fn returns false. Returns true if fn was called for all messages.
+  bool ForEachSpilled(const std::function<bool(const std::string&)>& fn);
+
+  // Clear discards the spooled delta and the overflow file.
+  void Clear();
+
+ private:
+  void UpdateStats() const;
+
+  size_t max_entries_;
+  std::string overflow_path_;
+  size_t max_overflow_bytes_;
+
+  NetworkDelta delta_;
+  FileHandle overflow_file_;
+  size_t spilled_messages_ = 0;
+  size_t spilled_bytes_ = 0;
+};
+
+}  // namespace collector
+
+#endif  // COLLECTOR_DELTASPOOL_H
@@ -0,0 +1,127 @@
+#include "DriverBuffers.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <unistd.h>
+
+#include "CollectorStats.h"
+#include "Logging.h"
+
+namespace collector {
+
+namespace {
+
+constexpr uint64_t kMiB = 1024 * 1024;
+constexpr uint64_t kMinBufferBytes = 1 * kMiB;
+constexpr uint64_t kMaxBufferBytes = 16 * kMiB;
+constexpr uint64_t kMaxTotalBytes = 1024 * kMiB;
+constexpr uint64_t kAvailableMemoryFraction = 32;
+
+uint64_t FloorPowerOfTwo(uint64_t n) {
+  uint64_t power = 1;
+  while (power <= n / 2) {
+    power *= 2;
+  }
+  return power;
+}
+
+uint64_t CeilPowerOfTwo(uint64_t n) {
+  uint64_t power = 1;
+  while (power < n) {
+    power *= 2;
+  }
+  return power;
+}
+
+}  // namespace
+
+DriverBufferSizing AutoSizeDriverBuffers(int num_cpus, uint64_t available_memory_bytes, bool shared_buffers) {
+  num_cpus = std::max(num_cpus, 1);
+  uint64_t budget = kMaxTotalBytes;
+  if (available_memory_bytes > 0) {
+    budget = std::min(budget, available_memory_bytes / kAvailableMemoryFraction);
+  }
+
+  uint16_t cpus_per_buffer = 1;
+  uint64_t buffers = num_cpus;
+  while (shared_buffers && budget / buffers < kMinBufferBytes && cpus_per_buffer < num_cpus) {
+    cpus_per_buffer *= 2;
+    buffers = (num_cpus + cpus_per_buffer - 1) / cpus_per_buffer;
+  }
+
+  uint64_t buffer_bytes = std::clamp(FloorPowerOfTwo(budget / buffers), kMinBufferBytes, kMaxBufferBytes);
+  return {buffer_bytes, cpus_per_buffer};
+}
+
+DriverBufferSizing GetDriverBufferSizing(const CollectorConfig& config, const DriverBufferSizing& defaults, bool shared_buffers) {
+  DriverBufferSizing sizing = defaults;
+  if (config.DriverBufferAutoSize()) {
+    int num_cpus = static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN));
+    uint64_t available_memory = ReadMemAvailable(config.HostProc() + "/meminfo");
+    sizing = AutoSizeDriverBuffers(num_cpus, available_memory, shared_buffers);
+    CLOG(INFO) << "Auto-sized the driver buffers for " << num_cpus << " CPUs and " << (available_memory / kMiB)
+               << " MiB of available memory";
+  }
+
+  if (config.DriverBufferBytes() > 0) {
+    // The drivers require buffers of a power of two number of pages.
+    uint64_t page_size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    sizing.buffer_bytes = CeilPowerOfTwo(std::max<uint64_t>(config.DriverBufferBytes(), page_size));
+    if (sizing.buffer_bytes != static_cast<uint64_t>(config.DriverBufferBytes())) {
+      CLOG(WARNING) << "Rounded the driver buffer size up to " << sizing.buffer_bytes << " bytes";
+    }
+  }
+  if (config.DriverCPUsPerBuffer() > 0) {
+    if (shared_buffers) {
+      sizing.cpus_per_buffer = config.DriverCPUsPerBuffer();
+    } else {
+      CLOG(WARNING) << "The driver does not support sharing buffers between CPUs. Using one buffer per CPU.";
+    }
+  }
+
+  CLOG(INFO) << "Driver buffers: " << sizing.buffer_bytes << " bytes for every " << sizing.cpus_per_buffer << " CPU(s)";
+  COUNTER_SET(CollectorStats::driver_buffer_bytes, sizing.buffer_bytes);
+  COUNTER_SET(CollectorStats::driver_cpus_per_buffer, sizing.cpus_per_buffer);
+  return sizing;
+}
+
+uint64_t ReadMemAvailable(const std::string& meminfo_path) {
+  std::ifstream meminfo(meminfo_path);
+  std::string line;
+  while (std::getline(meminfo, line)) {
+    // MemAvailable:   12345678 kB
+    std::istringstream fields(line);
+    std::string key, unit;
+    uint64_t value;
+    if (fields >> key >> value >> unit && key == "MemAvailable:" && unit == "kB") {
+      return value * 1024;
+    }
+  }
+  return 0;
+}
+
+bool ParsePerCPUMetric(const char* name, const char* prefix, int* cpu) {
+  size_t prefix_len = std::strlen(prefix);
+  if (std::strncmp(name, prefix, prefix_len) != 0) {
+    return false;
+  }
+
+  const char* digits = name + prefix_len;
+  if (*digits == '\0') {
+    return false;
+  }
+  int value = 0;
+  for (const char* c = digits; *c; c++) {
+    if (*c < '0' || *c > '9' || value > 100000) {
+      return false;
+    }
+    value = value * 10 + (*c - '0');
+  }
+  *cpu = value;
+  return true;
+}
+
+}  // namespace collector
@@ -0,0 +1,38 @@
+#ifndef COLLECTOR_DRIVERBUFFERS_H
+#define COLLECTOR_DRIVERBUFFERS_H
+
+#include <cstdint>
+#include <string>
+
+#include "CollectorConfig.h"
+
+namespace collector {
+
+// DriverBufferSizing describes the kernel ring buffers the driver copies events into: one buffer of buffer_bytes for
+// every cpus_per_buffer CPUs. Only the modern eBPF probe can share buffers between CPUs.
+struct DriverBufferSizing {
+  uint64_t buffer_bytes;
+  uint16_t cpus_per_buffer;
+};
+
+// AutoSizeDriverBuffers sizes the buffers of num_cpus CPUs such that they take at most 1/32 of the available memory
+// (or 1 GiB): each buffer gets the largest power of two between 1 MiB and 16 MiB that fits. If even 1 MiB buffers do
+// not fit and buffers can be shared, they are shared between enough CPUs to fit. available_memory_bytes is 0 if
+// unknown.
+DriverBufferSizing AutoSizeDriverBuffers(int num_cpus, uint64_t available_memory_bytes, bool shared_buffers);
+
+// GetDriverBufferSizing returns the sizing of the driver buffers: the defaults of the driver, or the auto-sized ones if
+// enabled, overridden by any explicitly configured buffer size and CPUs per buffer. The result is logged and reported
+// in the driver_buffer_bytes and driver_cpus_per_buffer counters.
+DriverBufferSizing GetDriverBufferSizing(const CollectorConfig& config, const DriverBufferSizing& defaults, bool shared_buffers);
+
+// ReadMemAvailable returns the available memory (MemAvailable) in a meminfo file, in bytes, or 0 if unknown.
+uint64_t ReadMemAvailable(const std::string& meminfo_path);
+
+// ParsePerCPUMetric checks if name is the name of a per-CPU driver metric, i.e., the prefix followed by the CPU number,
+// and if so, stores the CPU number in *cpu.
+bool ParsePerCPUMetric(const char* name, const char* prefix, int* cpu);
+
+}  // namespace collector
+
+#endif  // COLLECTOR_DRIVERBUFFERS_H
@@ -535,10 +535,18 @@ class DuplexClientWriter : public DuplexClient, public IDuplexClientWriter<W> {
     return Result(WriteAsyncInternal(obj));
   }
 
+  // Sets a function that is called with every message written, and returns whether the message is to be compressed
+  // (with the compression algorithm set in the client context). If unset, all messages are compressed.
+  void SetCompressionFilter(std::function<bool(const W&)> filter) {
+    compression_filter_ = std::move(filter);
+  }
+
  protected:
   DuplexClientWriter(grpc::ClientContext* context) : DuplexClient(context) {}
 
   virtual OpDescriptor WriteAsyncInternal(const W& obj) = 0;
+
+  std::function<bool(const W&)> compression_filter_;
 };
 
 template <typename W, typename R>
@@ -634,7 +642,11 @@ class DuplexClientReaderWriter : public DuplexClientWriter<W> {
 
   // Async operation implementations. These wrap DoAsync around the corresponding GRPC AsyncClientReaderWriter methods.
   OpDescriptor WriteAsyncInternal(const W& obj) override {
-    return DoAsync<const W&>(&RW::Write, obj, Op::WRITE);
+    grpc::WriteOptions options;
+    if (this->compression_filter_ && !this->compression_filter_(obj)) {
+      options.set_no_compression();
+    }
+    return DoAsync<const W&, grpc::WriteOptions>(&RW::Write, obj, options, Op::WRITE);
   }
 
   OpDescriptor WritesDoneAsyncInternal() override {
@@ -0,0 +1,69 @@
+#ifndef COLLECTOR_ENCODINGCACHE_H
+#define COLLECTOR_ENCODINGCACHE_H
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include "CollectorStats.h"
+#include "Hash.h"
+
+namespace collector {
+
+// EncodingCache holds the serialized protobuf messages of tracked entries (connections or endpoints), such that an
+// entry that is reported repeatedly does not have to be converted and serialized again every time.
+//
+// The cache holds two generations of at most half of max_entries each. Lookups move entries from the old generation to
+// the current one, and once the current generation is full, the old one is evicted and the current one becomes the old
+// one. Entries that have not been used since the last rotation are thus evicted first.
+template <typename Key>
+class EncodingCache {
+ public:
+  explicit EncodingCache(size_t max_entries) : max_entries_(max_entries), generation_size_(std::max<size_t>(max_entries / 2, 1)) {}
+
+  bool enabled() const { return max_entries_ > 0; }
+  size_t size() const { return current_.size() + old_.size(); }
+
+  // Get returns the serialized message for key, calling encode(std::string*) to serialize it if it is not cached.
+  template <typename Encode>
+  const std::string& Get(const Key& key, Encode&& encode) {
+    auto it = current_.find(key);
+    if (it != current_.end()) {
+      COUNTER_INC(CollectorStats::net_encoding_cache_hits);
+      return it->second;
+    }
+
+    std::string encoded;
+    auto old_it = old_.find(key);
+    if (old_it != old_.end()) {
+      COUNTER_INC(CollectorStats::net_encoding_cache_hits);
+      encoded = std::move(old_it->second);
+      old_.erase(old_it);
+    } else {
+      COUNTER_INC(CollectorStats::net_encoding_cache_misses);
+      encode(&encoded);
+    }
+
+    if (current_.size() >= generation_size_) {
+      COUNTER_ADD(CollectorStats::net_encoding_cache_evictions, old_.size());
+      old_ = std::move(current_);
+      current_.clear();
+    }
+    return current_.emplace(key, std::move(encoded)).first->second;
+  }
+
+  void Clear() {
+    current_.clear();
+    old_.clear();
+  }
+
+ private:
+  size_t max_entries_;
+  size_t generation_size_;
+  UnorderedMap<Key, std::string> current_;
+  UnorderedMap<Key, std::string> old_;
+};
+
+}  // namespace collector
+
+#endif  // COLLECTOR_ENCODINGCACHE_H
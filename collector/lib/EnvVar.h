@@ -9,6 +9,7 @@
 #include <cctype>
 #include <cstdlib>
 #include <mutex>
+#include <string>
 #include <utility>
 
 #include "Logging.h"
@@ -57,9 +58,30 @@ struct ParseBool {
   }
 };
 
+struct ParseInt {
+  bool operator()(int* out, const std::string& str_val) const {
+    char* endp;
+    long val = std::strtol(str_val.c_str(), &endp, 10);
+    if (endp == str_val.c_str() || *endp) {
+      return false;
+    }
+    *out = static_cast<int>(val);
+    return true;
+  }
+};
+
+struct ParseString {
+  bool operator()(std::string* out, const std::string& str_val) const {
+    *out = str_val;
+    return true;
+  }
+};
+
 }  // namespace internal
 
 using BoolEnvVar = EnvVar<bool, internal::ParseBool>;
+using IntEnvVar = EnvVar<int, internal::ParseInt>;
+using StringEnvVar = EnvVar<std::string, internal::ParseString>;
 
 }  // namespace collector
 
@@ -0,0 +1,84 @@
+#include "EventTimer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  include <cpuid.h>
+#endif
+
+#include "Logging.h"
+
+namespace collector {
+
+namespace {
+
+constexpr std::chrono::milliseconds kCalibrationTime{20};
+
+}  // namespace
+
+EventTimer::EventTimer(Clock clock, int sample_rate) : clock_(clock), sample_rate_(std::max(sample_rate, 1)) {
+  // The first event of each type is timed.
+  std::fill(std::begin(countdown_), std::end(countdown_), 1);
+
+  if (clock_ == Clock::TSC && !CalibrateTSC()) {
+    CLOG(WARNING) << "No invariant TSC available. Using the coarse clock to time events.";
+    clock_ = Clock::COARSE;
+  }
+}
+
+bool EventTimer::CalibrateTSC() {
+#if defined(__x86_64__) || defined(__i386__)
+  // The TSC runs at a constant rate, independently of frequency scaling and idle states, if CPUID.80000007H:EDX[8] is
+  // set.
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1 << 8))) {
+    return false;
+  }
+
+  using Clock = std::chrono::steady_clock;
+  auto start = Clock::now();
+  uint64_t start_tsc = __rdtsc();
+  std::this_thread::sleep_for(kCalibrationTime);
+  auto end = Clock::now();
+  uint64_t end_tsc = __rdtsc();
+
+  auto micros = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+  if (end_tsc <= start_tsc || micros <= 0) {
+    return false;
+  }
+  tsc_base_ = start_tsc;
+  micros_per_tick_ = static_cast<double>(micros) / (end_tsc - start_tsc);
+  CLOG(DEBUG) << "Calibrated the TSC at " << (1 / micros_per_tick_) << " ticks per microsecond";
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool ParseEventTimerClock(const std::string& name, EventTimer::Clock* clock) {
+  if (name == "system") {
+    *clock = EventTimer::Clock::SYSTEM;
+  } else if (name == "coarse") {
+    *clock = EventTimer::Clock::COARSE;
+  } else if (name == "tsc") {
+    *clock = EventTimer::Clock::TSC;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* EventTimerClockName(EventTimer::Clock clock) {
+  switch (clock) {
+    case EventTimer::Clock::COARSE:
+      return "coarse";
+    case EventTimer::Clock::TSC:
+      return "tsc";
+    default:
+      return "system";
+  }
+}
+
+}  // namespace collector
@@ -0,0 +1,106 @@
+#ifndef COLLECTOR_EVENTTIMER_H
+#define COLLECTOR_EVENTTIMER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+#include "TimeUtil.h"
+#include "ppm_events_public.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#  include <x86intrin.h>
+#endif
+
+namespace collector {
+
+// EventTimer measures the time spent on events, for the per event type timing metrics (parse, filter and process).
+//
+// Reading the system clock for every step of every event is a measurable share of the event loop at high event rates,
+// so the clock can be replaced by a cheaper one, and only one in every sample_rate events of each type may be timed.
+// The durations of the timed events are then scaled up by sample_rate, to estimate the totals for all events.
+//
+// The clocks are:
+//   - SYSTEM: the system clock (NowMicros), as precise as it gets.
+//   - COARSE: CLOCK_MONOTONIC_COARSE, which is read without a system call or TSC read, but only advances every tick
+//     (typically 1-4 ms). Individual durations are thus mostly 0 or a tick, but the totals over many events are
+//     accurate, as the probability of an event spanning a tick is proportional to its duration.
+//   - TSC: the CPU time stamp counter, calibrated against the monotonic clock on construction. Only available on x86
+//     CPUs with an invariant TSC; otherwise COARSE is used. The counters of different CPUs may be slightly apart, so a
+//     duration measured across a migration of the capture thread can come out negative.
+//
+// The clock is chosen once, when the timer is constructed from the configuration at startup.
+class EventTimer {
+ public:
+  enum class Clock {
+    SYSTEM,
+    COARSE,
+    TSC,
+  };
+
+  EventTimer() : EventTimer(Clock::SYSTEM, 1) {}
+  EventTimer(Clock clock, int sample_rate);
+
+  Clock clock() const { return clock_; }
+  int sample_rate() const { return sample_rate_; }
+
+  // Now returns the current time of the clock, in microseconds. Only the SYSTEM clock is relative to the epoch.
+  int64_t Now() const {
+    switch (clock_) {
+      case Clock::COARSE:
+        return CoarseMicros();
+      case Clock::TSC:
+        return TSCMicros();
+      default:
+        return NowMicros();
+    }
+  }
+
+  // Sample returns whether the current event, of the given type, is to be timed.
+  bool Sample(uint16_t event_type) {
+    if (sample_rate_ == 1) return true;
+    if (--countdown_[event_type] > 0) return false;
+    countdown_[event_type] = sample_rate_;
+    return true;
+  }
+
+  // Scale estimates the total duration of the events represented by a timed event. Negative durations count as 0.
+  uint64_t Scale(int64_t micros) const { return static_cast<uint64_t>(std::max<int64_t>(micros, 0)) * sample_rate_; }
+
+ private:
+  static int64_t CoarseMicros() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+  }
+
+  int64_t TSCMicros() const {
+#if defined(__x86_64__) || defined(__i386__)
+    // The TSC of the current CPU may be behind the base, read on another one.
+    return static_cast<int64_t>(static_cast<int64_t>(__rdtsc() - tsc_base_) * micros_per_tick_);
+#else
+    return CoarseMicros();
+#endif
+  }
+
+  // CalibrateTSC measures the frequency of the TSC. Returns false if there is no invariant TSC.
+  bool CalibrateTSC();
+
+  Clock clock_;
+  int sample_rate_;
+  uint64_t tsc_base_ = 0;
+  double micros_per_tick_ = 0;
+  // The number of events of each type until the next one to time.
+  int countdown_[PPM_EVENT_MAX];
+};
+
+// ParseEventTimerClock parses the name of an event timer clock ("system", "coarse" or "tsc").
+bool ParseEventTimerClock(const std::string& name, EventTimer::Clock* clock);
+
+// EventTimerClockName returns the name of an event timer clock, as accepted by ParseEventTimerClock.
+const char* EventTimerClockName(EventTimer::Clock clock);
+
+}  // namespace collector
+
+#endif  // COLLECTOR_EVENTTIMER_H
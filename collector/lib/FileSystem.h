@@ -70,6 +70,7 @@ class ResourceWrapper {
 class FDHandle : public ResourceWrapper<int, FDHandle> {
  public:
   using ResourceWrapper::ResourceWrapper;
+  using ResourceWrapper::operator=;
   FDHandle(FDHandle&& other) : ResourceWrapper(other.release()) {}
 
   static constexpr int Invalid() { return -1; }
@@ -79,6 +80,7 @@ class FDHandle : public ResourceWrapper<int, FDHandle> {
 class FileHandle : public ResourceWrapper<std::FILE*, FileHandle> {
  public:
   using ResourceWrapper::ResourceWrapper;
+  using ResourceWrapper::operator=;
   FileHandle(FileHandle&& other) : ResourceWrapper(other.release()) {}
   FileHandle(FDHandle&& fd, const char* mode) : ResourceWrapper(fdopen(fd.release(), mode)) {}
 
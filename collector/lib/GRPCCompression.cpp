@@ -0,0 +1,96 @@
+#include "GRPCCompression.h"
+
+#include <cmath>
+
+#include <zlib.h>
+
+#include "Logging.h"
+#include "TimeUtil.h"
+
+namespace collector {
+
+constexpr int StreamCompression::kSampleInterval;
+
+bool ParseCompressionAlgorithm(const std::string& name, grpc_compression_algorithm* algorithm) {
+  if (name.empty() || name == "none") {
+    *algorithm = GRPC_COMPRESS_NONE;
+  } else if (name == "deflate") {
+    *algorithm = GRPC_COMPRESS_DEFLATE;
+  } else if (name == "gzip") {
+    *algorithm = GRPC_COMPRESS_GZIP;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* CompressionAlgorithmName(grpc_compression_algorithm algorithm) {
+  switch (algorithm) {
+    case GRPC_COMPRESS_NONE:
+      return "none";
+    case GRPC_COMPRESS_DEFLATE:
+      return "deflate";
+    case GRPC_COMPRESS_GZIP:
+      return "gzip";
+    default:
+      return "unknown";
+  }
+}
+
+void StreamCompression::Apply(grpc::ClientContext* context) const {
+  if (enabled()) {
+    context->set_compression_algorithm(algorithm_);
+  }
+}
+
+bool StreamCompression::OnWrite(const google::protobuf::MessageLite& msg) {
+  size_t size = msg.ByteSizeLong();
+  COUNTER_ADD(counters_.bytes, size);
+
+  bool compress = enabled() && size >= min_bytes_;
+  if (!compress) {
+    compressed_bytes_ += size;
+  } else {
+    if (num_compressed_++ % kSampleInterval == 0) {
+      Sample(msg);
+    }
+    compressed_bytes_ += size * ratio_;
+    compression_us_ += size * cpu_us_per_byte_;
+  }
+
+  COUNTER_SET(counters_.compressed_bytes, std::llround(compressed_bytes_));
+  COUNTER_SET(counters_.compression_us, std::llround(compression_us_));
+  return compress;
+}
+
+void StreamCompression::Sample(const google::protobuf::MessageLite& msg) {
+  if (!msg.SerializeToString(&buffer_) || buffer_.empty()) {
+    return;
+  }
+
+  int64_t start = ThreadCPUTimeMicros();
+
+  z_stream stream = {};
+  // gRPC's deflate is the zlib format, and gzip adds a gzip header and trailer (window bits + 16).
+  int window_bits = (algorithm_ == GRPC_COMPRESS_GZIP) ? 15 + 16 : 15;
+  if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    return;
+  }
+  compressed_buffer_.resize(deflateBound(&stream, buffer_.size()));
+  stream.next_in = reinterpret_cast<Bytef*>(&buffer_[0]);
+  stream.avail_in = buffer_.size();
+  stream.next_out = reinterpret_cast<Bytef*>(&compressed_buffer_[0]);
+  stream.avail_out = compressed_buffer_.size();
+  int result = deflate(&stream, Z_FINISH);
+  size_t compressed_size = stream.total_out;
+  deflateEnd(&stream);
+  if (result != Z_STREAM_END) {
+    CLOG_THROTTLED(WARNING, std::chrono::minutes(10)) << "Failed to estimate the compression ratio of gRPC messages";
+    return;
+  }
+
+  ratio_ = static_cast<double>(compressed_size) / buffer_.size();
+  cpu_us_per_byte_ = static_cast<double>(ThreadCPUTimeMicros() - start) / buffer_.size();
+}
+
+}  // namespace collector
@@ -0,0 +1,70 @@
+#ifndef COLLECTOR_GRPCCOMPRESSION_H
+#define COLLECTOR_GRPCCOMPRESSION_H
+
+#include <string>
+
+#include <google/protobuf/message_lite.h>
+#include <grpc/compression.h>
+#include <grpcpp/client_context.h>
+
+#include "CollectorStats.h"
+
+namespace collector {
+
+// ParseCompressionAlgorithm parses the name of a gRPC compression algorithm ("none", "deflate" or "gzip"). Returns
+// false if the algorithm is unknown or not supported by gRPC.
+bool ParseCompressionAlgorithm(const std::string& name, grpc_compression_algorithm* algorithm);
+
+// CompressionAlgorithmName returns the name of a gRPC compression algorithm, as accepted by ParseCompressionAlgorithm.
+const char* CompressionAlgorithmName(grpc_compression_algorithm algorithm);
+
+// StreamCompression holds the compression settings of a gRPC stream: messages are compressed with the given algorithm
+// if they are at least min_bytes large (smaller messages hardly compress, and are not worth the CPU time).
+//
+// It also accounts for the bytes written to the stream before and after compression, and the CPU time spent on
+// compression. As gRPC compresses the messages internally, the latter two are estimated by compressing one in every
+// kSampleInterval compressed messages.
+class StreamCompression {
+ public:
+  static constexpr int kSampleInterval = 16;
+
+  struct Counters {
+    CollectorStats::CounterType bytes;
+    CollectorStats::CounterType compressed_bytes;
+    CollectorStats::CounterType compression_us;
+  };
+
+  StreamCompression(grpc_compression_algorithm algorithm, size_t min_bytes, Counters counters)
+      : algorithm_(algorithm), min_bytes_(min_bytes), counters_(counters) {}
+
+  bool enabled() const { return algorithm_ != GRPC_COMPRESS_NONE; }
+  grpc_compression_algorithm algorithm() const { return algorithm_; }
+
+  // Apply sets the compression algorithm for the stream using the given context.
+  void Apply(grpc::ClientContext* context) const;
+
+  // OnWrite is called with every message written to the stream. Returns false if the message is to be sent
+  // uncompressed.
+  bool OnWrite(const google::protobuf::MessageLite& msg);
+
+ private:
+  // Sample compresses the serialized message, and updates the compression ratio and CPU time per byte.
+  void Sample(const google::protobuf::MessageLite& msg);
+
+  grpc_compression_algorithm algorithm_;
+  size_t min_bytes_;
+  Counters counters_;
+
+  int num_compressed_ = 0;
+  double ratio_ = 1.0;
+  double cpu_us_per_byte_ = 0.0;
+  // Running totals, to not lose the fractions of the estimates.
+  double compressed_bytes_ = 0.0;
+  double compression_us_ = 0.0;
+  std::string buffer_;
+  std::string compressed_buffer_;
+};
+
+}  // namespace collector
+
+#endif  // COLLECTOR_GRPCCOMPRESSION_H
@@ -0,0 +1,312 @@
+#include "IoUring.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if __has_include(<linux/io_uring.h>)
+#  include <linux/io_uring.h>
+#endif
+
+#include "CollectorStats.h"
+#include "Logging.h"
+
+// The operations used (and probing for them) were added in Linux 5.6, along with IO_URING_OP_SUPPORTED.
+#if defined(__NR_io_uring_setup) && defined(IO_URING_OP_SUPPORTED)
+#  define COLLECTOR_HAVE_IO_URING 1
+#endif
+
+namespace collector {
+
+#ifdef COLLECTOR_HAVE_IO_URING
+
+namespace {
+
+int IoUringSetup(unsigned int entries, io_uring_params* params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int IoUringEnter(int ring_fd, unsigned int to_submit, unsigned int min_complete, unsigned int flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int IoUringRegister(int ring_fd, unsigned int opcode, void* arg, unsigned int nr_args) {
+  return static_cast<int>(syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args));
+}
+
+void* MapRing(int ring_fd, size_t size, off_t offset) {
+  void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, offset);
+  return ptr == MAP_FAILED ? nullptr : ptr;
+}
+
+template <typename T>
+T* RingField(void* ring, uint32_t offset) {
+  return reinterpret_cast<T*>(static_cast<char*>(ring) + offset);
+}
+
+// The user_data of the entries submitted by ReadFiles holds the operation in its upper half, and the index of the
+// request within the chunk in its lower half.
+constexpr uint64_t kIndexMask = 0xffffffff;
+constexpr uint64_t kOpenOp = 0;
+constexpr uint64_t kReadOp = uint64_t(1) << 32;
+constexpr uint64_t kCloseOp = uint64_t(2) << 32;
+
+}  // namespace
+
+std::unique_ptr<IoUring> IoUring::Create(unsigned int entries) {
+  std::unique_ptr<IoUring> ring(new IoUring());
+  if (!ring->Init(entries)) {
+    return nullptr;
+  }
+  return ring;
+}
+
+bool IoUring::Init(unsigned int entries) {
+  io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+
+  ring_fd_ = IoUringSetup(entries, &params);
+  if (!ring_fd_.valid() || !Setup(params)) {
+    CLOG(DEBUG) << "Could not set up io_uring: " << StrError();
+    return false;
+  }
+  if (!SupportsRequiredOps()) {
+    CLOG(DEBUG) << "io_uring does not support all operations required for scraping /proc";
+    return false;
+  }
+  return true;
+}
+
+int IoUring::Enter(unsigned int to_submit, unsigned int min_complete, unsigned int flags) {
+  return IoUringEnter(ring_fd_, to_submit, min_complete, flags);
+}
+
+IoUring::~IoUring() {
+  if (sqes_) munmap(sqes_, sqes_size_);
+  if (cq_ring_ && cq_ring_ != sq_ring_) munmap(cq_ring_, cq_ring_size_);
+  if (sq_ring_) munmap(sq_ring_, sq_ring_size_);
+}
+
+bool IoUring::Setup(const io_uring_params& params) {
+  sq_entries_ = params.sq_entries;
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+  cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+  // Since Linux 5.4, both rings can be mapped with a single mmap call.
+  bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+
+  sq_ring_ = MapRing(ring_fd_, sq_ring_size_, IORING_OFF_SQ_RING);
+  if (!sq_ring_) return false;
+  cq_ring_ = single_mmap ? sq_ring_ : MapRing(ring_fd_, cq_ring_size_, IORING_OFF_CQ_RING);
+  if (!cq_ring_) return false;
+
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  sqes_ = static_cast<io_uring_sqe*>(MapRing(ring_fd_, sqes_size_, IORING_OFF_SQES));
+  if (!sqes_) return false;
+
+  sq_head_ = RingField<unsigned int>(sq_ring_, params.sq_off.head);
+  sq_tail_ = RingField<unsigned int>(sq_ring_, params.sq_off.tail);
+  sq_mask_ = RingField<unsigned int>(sq_ring_, params.sq_off.ring_mask);
+  sq_array_ = RingField<unsigned int>(sq_ring_, params.sq_off.array);
+  cq_head_ = RingField<unsigned int>(cq_ring_, params.cq_off.head);
+  cq_tail_ = RingField<unsigned int>(cq_ring_, params.cq_off.tail);
+  cq_mask_ = RingField<unsigned int>(cq_ring_, params.cq_off.ring_mask);
+  cqes_ = RingField<io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+  return true;
+}
+
+bool IoUring::SupportsRequiredOps() {
+  constexpr unsigned int kNumOps = IORING_OP_LAST;
+  std::vector<char> probe_buf(sizeof(io_uring_probe) + kNumOps * sizeof(io_uring_probe_op), 0);
+  auto* probe = reinterpret_cast<io_uring_probe*>(probe_buf.data());
+
+  if (IoUringRegister(ring_fd_, IORING_REGISTER_PROBE, probe, kNumOps) < 0) return false;
+
+  for (unsigned int op : {IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_CLOSE}) {
+    if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) return false;
+  }
+  return true;
+}
+
+io_uring_sqe* IoUring::NextSqe() {
+  unsigned int index = (*sq_tail_ + sq_pending_) & *sq_mask_;
+  sq_array_[index] = index;
+  sq_pending_++;
+  COUNTER_INC(CollectorStats::procfs_io_uring_ops);
+
+  io_uring_sqe* sqe = &sqes_[index];
+  std::memset(sqe, 0, sizeof(*sqe));
+  return sqe;
+}
+
+bool IoUring::SubmitAndWait(unsigned int count) {
+  __atomic_store_n(sq_tail_, *sq_tail_ + sq_pending_, __ATOMIC_RELEASE);
+  unsigned int to_submit = sq_pending_;
+  sq_pending_ = 0;
+
+  for (;;) {
+    unsigned int available = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE) - *cq_head_;
+    if (to_submit == 0 && available >= count) return true;
+
+    unsigned int min_complete = available >= count ? 0 : count - available;
+    int ret = Enter(to_submit, min_complete, IORING_ENTER_GETEVENTS);
+    COUNTER_INC(CollectorStats::procfs_io_uring_submissions);
+    if (ret < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    to_submit -= std::min<unsigned int>(ret, to_submit);
+  }
+}
+
+template <typename F>
+void IoUring::ReapCompletions(F fn) {
+  unsigned int head = *cq_head_;
+  unsigned int tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+  for (; head != tail; head++) {
+    const io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+    fn(cqe.user_data, cqe.res);
+    reaped_++;
+  }
+  __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+}
+
+unsigned int IoUring::InFlight() const {
+  // Every entry consumed by the kernel, as counted by the head of the submission queue, results in one completion.
+  // This also holds for entries consumed by a failing io_uring_enter call.
+  return __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) - reaped_;
+}
+
+template <typename F>
+bool IoUring::Drain(F fn) {
+  for (;;) {
+    ReapCompletions(fn);
+    unsigned int in_flight = InFlight();
+    if (in_flight == 0) return true;
+
+    // Nothing is submitted, as entries left in the submission queue are never consumed after a failure.
+    int ret = Enter(0, in_flight, IORING_ENTER_GETEVENTS);
+    if (ret < 0 && errno != EINTR) return false;
+  }
+}
+
+bool IoUring::ReadFiles(ReadRequest* requests, size_t num_requests) {
+  // Each request is split into an openat, followed by a read and a close that are linked such that the file is
+  // closed as soon as it has been read. This takes two submissions per chunk of requests, instead of three system
+  // calls per request.
+  if (!usable_) return false;
+
+  const size_t chunk_size = sq_entries_ / 2;
+  // fds[i] holds the file opened for the i-th request of the current chunk, until it has been closed.
+  std::vector<int> fds(std::min(chunk_size, num_requests));
+
+  for (size_t start = 0; start < num_requests; start += chunk_size) {
+    size_t count = std::min(chunk_size, num_requests - start);
+    ReadRequest* chunk = requests + start;
+    std::fill(fds.begin(), fds.end(), -1);
+
+    auto complete = [&fds, chunk](uint64_t user_data, int res) {
+      size_t i = user_data & kIndexMask;
+      switch (user_data & ~kIndexMask) {
+        case kOpenOp:
+          fds[i] = res;
+          if (res < 0) chunk[i].result = res;
+          break;
+        case kReadOp:
+          chunk[i].result = res;
+          break;
+        case kCloseOp:
+          fds[i] = -1;
+          break;
+      }
+    };
+
+    // After a failed submission, the state of the queues is unknown, so the ring is not used anymore. Waiting for
+    // everything that was submitted ensures that no files are left open by operations still in flight.
+    auto fail = [&]() {
+      int err = errno;
+      usable_ = false;
+      CLOG(WARNING) << "io_uring submission failed, falling back to synchronous reads: " << StrError(err);
+      if (!Drain(complete)) {
+        CLOG(ERROR) << "Could not wait for outstanding io_uring operations: " << StrError();
+      } else {
+        for (int fd : fds) {
+          if (fd >= 0) close(fd);
+        }
+      }
+      errno = err;
+      return false;
+    };
+
+    for (size_t i = 0; i < count; i++) {
+      io_uring_sqe* sqe = NextSqe();
+      sqe->opcode = IORING_OP_OPENAT;
+      sqe->fd = chunk[i].dirfd;
+      sqe->addr = reinterpret_cast<uintptr_t>(chunk[i].path);
+      sqe->open_flags = O_RDONLY | O_CLOEXEC;
+      sqe->user_data = kOpenOp | i;
+    }
+    if (!SubmitAndWait(count)) return fail();
+    ReapCompletions(complete);
+
+    unsigned int num_reads = 0;
+    for (size_t i = 0; i < count; i++) {
+      if (fds[i] < 0) continue;
+
+      io_uring_sqe* sqe = NextSqe();
+      sqe->opcode = IORING_OP_READ;
+      sqe->fd = fds[i];
+      sqe->addr = reinterpret_cast<uintptr_t>(chunk[i].buf);
+      sqe->len = chunk[i].size;
+      sqe->flags = IOSQE_IO_HARDLINK;  // close the file even if the read fails
+      sqe->user_data = kReadOp | i;
+
+      sqe = NextSqe();
+      sqe->opcode = IORING_OP_CLOSE;
+      sqe->fd = fds[i];
+      sqe->user_data = kCloseOp | i;
+
+      num_reads++;
+    }
+    if (num_reads == 0) continue;
+    if (!SubmitAndWait(2 * num_reads)) return fail();
+    ReapCompletions(complete);
+  }
+
+  return true;
+}
+
+#else
+
+// io_uring is not supported by the kernel headers this was built against.
+
+std::unique_ptr<IoUring> IoUring::Create(unsigned int entries) {
+  return nullptr;
+}
+
+IoUring::~IoUring() = default;
+
+bool IoUring::Init(unsigned int entries) {
+  return false;
+}
+
+int IoUring::Enter(unsigned int to_submit, unsigned int min_complete, unsigned int flags) {
+  errno = ENOSYS;
+  return -1;
+}
+
+bool IoUring::ReadFiles(ReadRequest* requests, size_t num_requests) {
+  return false;
+}
+
+#endif
+
+}  // namespace collector
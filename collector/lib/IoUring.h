@@ -0,0 +1,104 @@
+#ifndef COLLECTOR_IOURING_H
+#define COLLECTOR_IOURING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/types.h>
+
+#include "FileSystem.h"
+
+struct io_uring_params;
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace collector {
+
+// IoUring is a minimal io_uring instance for batching the file system operations performed when scraping `/proc`.
+// Each batch of operations is submitted, and all of its completions awaited, with a single io_uring_enter system call
+// (counted in procfs_io_uring_submissions, while procfs_io_uring_ops counts the operations).
+// Only the operations needed for that purpose (openat, read and close) are supported, which are available since
+// Linux 5.6. The ring is set up through the raw system calls, so there is no dependency on liburing.
+class IoUring {
+ public:
+  // ReadRequest describes a file to be opened (relative to dirfd), read into buf (at most size bytes, in a single
+  // read) and closed again. Upon completion, result holds the number of bytes read, or a negative errno value.
+  struct ReadRequest {
+    int dirfd;
+    const char* path;
+    char* buf;
+    size_t size;
+    ssize_t result;
+  };
+
+  // Create sets up an io_uring instance with the given number of submission queue entries. It returns null if io_uring
+  // is not available (e.g., on kernels older than 5.6, or if it is blocked by a seccomp profile or sysctl), or if it
+  // does not support all of the operations used.
+  static std::unique_ptr<IoUring> Create(unsigned int entries);
+
+  virtual ~IoUring();
+
+  // ReadFiles performs all of the given read requests. Returns false if the requests could not be submitted, in which
+  // case the caller should resort to performing them synchronously. After such a failure, the ring is no longer
+  // usable, and all further calls return false.
+  bool ReadFiles(ReadRequest* requests, size_t num_requests);
+
+  bool usable() const { return usable_; }
+
+ protected:
+  IoUring() = default;
+
+  // Init sets up the ring for Create. Returns false if io_uring is not available.
+  bool Init(unsigned int entries);
+
+  // Enter calls io_uring_enter on the ring. Tests override it to inject failures.
+  virtual int Enter(unsigned int to_submit, unsigned int min_complete, unsigned int flags);
+
+ private:
+  bool Setup(const io_uring_params& params);
+  bool SupportsRequiredOps();
+
+  io_uring_sqe* NextSqe();
+  // SubmitAndWait submits all queued entries and waits until as many completions are available.
+  bool SubmitAndWait(unsigned int count);
+  // Calls fn(user_data, res) for each available completion.
+  template <typename F>
+  void ReapCompletions(F fn);
+  // Drain waits for the completions of all submitted entries, and calls fn(user_data, res) for each of them. Returns
+  // false if that fails, in which case some of them might still be outstanding.
+  template <typename F>
+  bool Drain(F fn);
+  // InFlight returns the number of entries consumed by the kernel whose completions have not been reaped yet.
+  unsigned int InFlight() const;
+
+  FDHandle ring_fd_;
+  unsigned int sq_entries_ = 0;
+
+  void* sq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  void* cq_ring_ = nullptr;
+  size_t cq_ring_size_ = 0;
+  io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+
+  unsigned int* sq_head_ = nullptr;
+  unsigned int* sq_tail_ = nullptr;
+  unsigned int* sq_mask_ = nullptr;
+  unsigned int* sq_array_ = nullptr;
+  unsigned int* cq_head_ = nullptr;
+  unsigned int* cq_tail_ = nullptr;
+  unsigned int* cq_mask_ = nullptr;
+  io_uring_cqe* cqes_ = nullptr;
+
+  unsigned int sq_pending_ = 0;
+  // Number of completions reaped, which wraps around like the ring indices.
+  unsigned int reaped_ = 0;
+  bool usable_ = true;
+};
+
+}  // namespace collector
+
+#endif  // COLLECTOR_IOURING_H
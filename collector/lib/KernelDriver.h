@@ -11,6 +11,7 @@ extern "C" {
 }
 
 #include "CollectorConfig.h"
+#include "DriverBuffers.h"
 #include "EventNames.h"
 #include "FileSystem.h"
 #include "Logging.h"
@@ -42,8 +43,10 @@ class KernelDriverEBPF : public IKernelDriver {
     auto tp_set = libsinsp::events::enforce_simple_tp_set();
     std::unordered_set<ppm_sc_code> ppm_sc;
 
+    DriverBufferSizing sizing = GetDriverBufferSizing(config, {DEFAULT_DRIVER_BUFFER_BYTES_DIM, 1}, false);
+
     try {
-      inspector.open_bpf(SysdigService::kProbePath, DEFAULT_DRIVER_BUFFER_BYTES_DIM, ppm_sc, tp_set);
+      inspector.open_bpf(SysdigService::kProbePath, sizing.buffer_bytes, ppm_sc, tp_set);
     } catch (const sinsp_exception& ex) {
       CLOG(WARNING) << ex.what();
       return false;
@@ -98,9 +101,12 @@ class KernelDriverCOREEBPF : public IKernelDriver {
       }
     }
 
+    DriverBufferSizing sizing =
+        GetDriverBufferSizing(config, {DEFAULT_DRIVER_BUFFER_BYTES_DIM, DEFAULT_CPU_FOR_EACH_BUFFER}, true);
+
     try {
-      inspector.open_modern_bpf(DEFAULT_DRIVER_BUFFER_BYTES_DIM,
-                                DEFAULT_CPU_FOR_EACH_BUFFER,
+      inspector.open_modern_bpf(sizing.buffer_bytes,
+                                sizing.cpus_per_buffer,
                                 true, ppm_sc, tp_set);
     } catch (const sinsp_exception& ex) {
       if (config.CoReBPFHardfail()) {
@@ -0,0 +1,69 @@
+#ifndef COLLECTOR_MPSCQUEUE_H
+#define COLLECTOR_MPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace collector {
+
+// MPSCQueue is an unbounded lock-free queue for passing items from any number of producer threads to a single consumer
+// thread, which takes all queued items at once. Checking whether the queue is empty is a single atomic load, so the
+// consumer can poll it cheaply.
+template <typename T>
+class MPSCQueue {
+ public:
+  MPSCQueue() = default;
+  MPSCQueue(const MPSCQueue&) = delete;
+  MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+  ~MPSCQueue() {
+    ConsumeAll([](T&&) {});
+  }
+
+  void Push(T item) {
+    Node* node = new Node{std::move(item), head_.load(std::memory_order_relaxed)};
+    while (!head_.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+  }
+
+  bool empty() const { return head_.load(std::memory_order_acquire) == nullptr; }
+
+  // ConsumeAll takes all queued items, and calls fn(T&&) for each of them, in the order in which they were pushed.
+  // Returns the number of items.
+  template <typename F>
+  size_t ConsumeAll(F&& fn) {
+    Node* node = head_.exchange(nullptr, std::memory_order_acquire);
+
+    // The items are linked newest first.
+    Node* oldest = nullptr;
+    while (node) {
+      Node* next = node->next;
+      node->next = oldest;
+      oldest = node;
+      node = next;
+    }
+
+    size_t count = 0;
+    while (oldest) {
+      Node* next = oldest->next;
+      fn(std::move(oldest->item));
+      delete oldest;
+      oldest = next;
+      count++;
+    }
+    return count;
+  }
+
+ private:
+  struct Node {
+    T item;
+    Node* next;
+  };
+
+  std::atomic<Node*> head_{nullptr};
+};
+
+}  // namespace collector
+
+#endif  // COLLECTOR_MPSCQUEUE_H
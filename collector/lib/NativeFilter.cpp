@@ -0,0 +1,382 @@
+#include "NativeFilter.h"
+
+#include <cctype>
+#include <iterator>
+#include <regex>
+
+#include "CollectorException.h"
+#include "EventNames.h"
+
+namespace collector {
+
+namespace {
+
+const std::string kHostContainerID = "host";
+
+struct Token {
+  enum Kind {
+    END,
+    WORD,
+    STRING,
+    LPAREN,
+    RPAREN,
+    COMMA,
+    OPERATOR,
+  } kind;
+  std::string text;
+};
+
+bool IsWordChar(char c) {
+  return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.' || c == '-' || c == '/' || c == ':' || c == '*';
+}
+
+// Tokenize splits a filter expression into tokens. Returns false if it contains unexpected characters or unterminated
+// strings.
+bool Tokenize(const std::string& filter, std::vector<Token>* tokens) {
+  size_t i = 0;
+  while (i < filter.size()) {
+    char c = filter[i];
+    if (std::isspace(static_cast<unsigned char>(c))) {
+      i++;
+    } else if (c == '(' || c == ')' || c == ',') {
+      tokens->push_back({c == '(' ? Token::LPAREN : (c == ')' ? Token::RPAREN : Token::COMMA), std::string(1, c)});
+      i++;
+    } else if (c == '=' || c == '!') {
+      if (i + 1 < filter.size() && filter[i + 1] == '=') {
+        tokens->push_back({Token::OPERATOR, filter.substr(i, 2)});
+        i += 2;
+      } else if (c == '=') {
+        tokens->push_back({Token::OPERATOR, "="});
+        i++;
+      } else {
+        return false;
+      }
+    } else if (c == '\'' || c == '"') {
+      size_t end = filter.find(c, i + 1);
+      if (end == std::string::npos) {
+        return false;
+      }
+      tokens->push_back({Token::STRING, filter.substr(i + 1, end - i - 1)});
+      i = end + 1;
+    } else if (IsWordChar(c)) {
+      size_t start = i;
+      while (i < filter.size() && IsWordChar(filter[i])) {
+        i++;
+      }
+      tokens->push_back({Token::WORD, filter.substr(start, i - start)});
+    } else {
+      return false;
+    }
+  }
+  tokens->push_back({Token::END, ""});
+  return true;
+}
+
+// UnescapeLuaString resolves the escape sequences of the contents of a Lua string literal. Returns false if it
+// contains escape sequences other than the common single character ones.
+bool UnescapeLuaString(const std::string& literal, std::string* out) {
+  out->clear();
+  for (size_t i = 0; i < literal.size(); i++) {
+    if (literal[i] != '\\') {
+      out->push_back(literal[i]);
+      continue;
+    }
+    if (++i == literal.size()) {
+      return false;
+    }
+    switch (literal[i]) {
+      case 'n':
+        out->push_back('\n');
+        break;
+      case 't':
+        out->push_back('\t');
+        break;
+      case '\\':
+      case '"':
+      case '\'':
+        out->push_back(literal[i]);
+        break;
+      default:
+        return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+// Parser is a recursive descent parser for filter expressions:
+//   or_expr    := and_expr ("or" and_expr)*
+//   and_expr   := not_expr ("and" not_expr)*
+//   not_expr   := "not" not_expr | primary
+//   primary    := "(" or_expr ")" | comparison
+//   comparison := field ("=" | "==" | "!=" | "startswith") value | field "in" "(" value ("," value)* ")"
+class NativeFilter::Parser {
+ public:
+  explicit Parser(std::vector<Token> tokens) : tokens_(std::move(tokens)) {}
+
+  bool Parse(Node* root) {
+    return ParseOr(root) && Peek().kind == Token::END;
+  }
+
+ private:
+  const Token& Peek() const { return tokens_[pos_]; }
+  const Token& Next() { return tokens_[pos_ < tokens_.size() - 1 ? pos_++ : pos_]; }
+
+  bool PeekWord(const char* word) const {
+    return Peek().kind == Token::WORD && Peek().text == word;
+  }
+
+  bool ParseBinary(Node::Type type, const char* keyword, bool (Parser::*parse_operand)(Node*), Node* node) {
+    Node operand;
+    if (!(this->*parse_operand)(&operand)) {
+      return false;
+    }
+    if (!PeekWord(keyword)) {
+      *node = std::move(operand);
+      return true;
+    }
+
+    node->type = type;
+    node->children.push_back(std::move(operand));
+    while (PeekWord(keyword)) {
+      Next();
+      node->children.emplace_back();
+      if (!(this->*parse_operand)(&node->children.back())) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool ParseOr(Node* node) { return ParseBinary(Node::OR, "or", &Parser::ParseAnd, node); }
+
+  bool ParseAnd(Node* node) { return ParseBinary(Node::AND, "and", &Parser::ParseNot, node); }
+
+  bool ParseNot(Node* node) {
+    if (!PeekWord("not")) {
+      return ParsePrimary(node);
+    }
+    Next();
+    node->type = Node::NOT;
+    node->children.emplace_back();
+    return ParseNot(&node->children.back());
+  }
+
+  bool ParsePrimary(Node* node) {
+    if (Peek().kind == Token::LPAREN) {
+      Next();
+      return ParseOr(node) && Next().kind == Token::RPAREN;
+    }
+    return ParseComparison(node);
+  }
+
+  bool ParseComparison(Node* node) {
+    const Token& field = Next();
+    if (field.kind != Token::WORD) {
+      return false;
+    }
+    if (field.text == "container.id") {
+      node->field = Field::CONTAINER_ID;
+    } else if (field.text == "proc.name") {
+      node->field = Field::PROC_NAME;
+    } else if (field.text == "proc.exe") {
+      node->field = Field::PROC_EXE;
+    } else if (field.text == "proc.exepath") {
+      node->field = Field::PROC_EXEPATH;
+    } else if (field.text == "evt.type") {
+      node->field = Field::EVT_TYPE;
+    } else {
+      return false;
+    }
+
+    const Token& op = Next();
+    if (op.kind == Token::OPERATOR) {
+      node->type = Node::EQUALS;
+      node->negate = (op.text == "!=");
+      node->values.emplace_back();
+      if (!ParseValue(&node->values.back())) {
+        return false;
+      }
+    } else if (op.kind == Token::WORD && op.text == "in") {
+      node->type = Node::EQUALS;
+      if (Next().kind != Token::LPAREN) {
+        return false;
+      }
+      for (;;) {
+        node->values.emplace_back();
+        if (!ParseValue(&node->values.back())) {
+          return false;
+        }
+        Token::Kind separator = Next().kind;
+        if (separator == Token::RPAREN) {
+          break;
+        }
+        if (separator != Token::COMMA) {
+          return false;
+        }
+      }
+    } else if (op.kind == Token::WORD && op.text == "startswith" && node->field != Field::EVT_TYPE) {
+      node->type = Node::STARTS_WITH;
+      node->values.emplace_back();
+      if (!ParseValue(&node->values.back())) {
+        return false;
+      }
+    } else {
+      return false;
+    }
+
+    if (node->field == Field::EVT_TYPE) {
+      // Event types are compared by id, and match both directions.
+      try {
+        const auto& event_names = EventNames::GetInstance();
+        for (const auto& value : node->values) {
+          for (ppm_event_type id : event_names.GetEventIDs(value)) {
+            node->event_types.set(id);
+          }
+        }
+      } catch (const CollectorException&) {
+        return false;
+      }
+      node->values.clear();
+    }
+    return true;
+  }
+
+  bool ParseValue(std::string* value) {
+    const Token& token = Next();
+    if (token.kind != Token::STRING && token.kind != Token::WORD) {
+      return false;
+    }
+    *value = token.text;
+    return true;
+  }
+
+  std::vector<Token> tokens_;
+  size_t pos_ = 0;
+};
+
+std::unique_ptr<NativeFilter> NativeFilter::Compile(const std::string& filter) {
+  std::vector<Token> tokens;
+  if (!Tokenize(filter, &tokens)) {
+    return nullptr;
+  }
+
+  Node root;
+  Parser parser(std::move(tokens));
+  if (!parser.Parse(&root)) {
+    return nullptr;
+  }
+  return std::unique_ptr<NativeFilter>(new NativeFilter(std::move(root)));
+}
+
+std::unique_ptr<NativeFilter> NativeFilter::CompileChisel(const std::string& chisel) {
+  // The chisel may only define on_init and on_event, and on_event must accept every event that passes the filter.
+  static const std::regex kFunction(R"(\bfunction\s+([A-Za-z_][A-Za-z0-9_.]*))");
+  static const std::regex kTrivialOnEvent(R"(\bfunction\s+on_event\s*\(\s*\)\s*return\s+true\s+end\b)");
+  // The filter is either passed to set_filter as a string literal, or through a variable assigned a string literal.
+  static const std::regex kSetFilterLiteral(R"(chisel\.set_filter\s*\(\s*(["'])((?:\\.|(?!\1).)*)\1\s*\))");
+  static const std::regex kSetFilterVariable(R"(chisel\.set_filter\s*\(\s*([A-Za-z_][A-Za-z0-9_]*)\s*\))");
+
+  for (std::sregex_iterator it(chisel.begin(), chisel.end(), kFunction), end; it != end; ++it) {
+    const std::string name = (*it)[1];
+    if (name != "on_init" && name != "on_event") {
+      return nullptr;
+    }
+  }
+  if (!std::regex_search(chisel, kTrivialOnEvent)) {
+    return nullptr;
+  }
+
+  std::smatch match;
+  std::string literal;
+  if (std::regex_search(chisel, match, kSetFilterLiteral)) {
+    literal = match[2];
+  } else if (std::regex_search(chisel, match, kSetFilterVariable)) {
+    // The variable must be assigned a string literal, exactly once.
+    std::regex any_assignment("\\b" + match[1].str() + R"(\s*=(?!=))");
+    std::regex literal_assignment("\\b" + match[1].str() + R"(\s*=\s*(["'])((?:\\.|(?!\1).)*)\1)");
+    auto assignments = std::distance(std::sregex_iterator(chisel.begin(), chisel.end(), any_assignment), std::sregex_iterator());
+    std::smatch assignment;
+    if (assignments != 1 || !std::regex_search(chisel, assignment, literal_assignment)) {
+      return nullptr;
+    }
+    literal = assignment[2];
+  } else {
+    return nullptr;
+  }
+
+  std::string filter;
+  if (!UnescapeLuaString(literal, &filter)) {
+    return nullptr;
+  }
+  return Compile(filter);
+}
+
+bool NativeFilter::Match(sinsp_evt* evt) const {
+  Fields fields;
+  fields.event_type = evt->get_type();
+
+  sinsp_threadinfo* tinfo = evt->get_thread_info();
+  if (tinfo) {
+    fields.container_id = tinfo->m_container_id.empty() ? &kHostContainerID : &tinfo->m_container_id;
+    fields.proc_name = &tinfo->m_comm;
+    fields.proc_exe = &tinfo->m_exe;
+    fields.proc_exepath = &tinfo->m_exepath;
+  }
+  return Match(fields);
+}
+
+const std::string* NativeFilter::GetField(Field field, const Fields& fields) {
+  switch (field) {
+    case Field::CONTAINER_ID:
+      return fields.container_id;
+    case Field::PROC_NAME:
+      return fields.proc_name;
+    case Field::PROC_EXE:
+      return fields.proc_exe;
+    case Field::PROC_EXEPATH:
+      return fields.proc_exepath;
+    default:
+      return nullptr;
+  }
+}
+
+bool NativeFilter::Evaluate(const Node& node, const Fields& fields) {
+  switch (node.type) {
+    case Node::AND:
+      for (const auto& child : node.children) {
+        if (!Evaluate(child, fields)) return false;
+      }
+      return true;
+    case Node::OR:
+      for (const auto& child : node.children) {
+        if (Evaluate(child, fields)) return true;
+      }
+      return false;
+    case Node::NOT:
+      return !Evaluate(node.children[0], fields);
+    case Node::EQUALS: {
+      if (node.field == Field::EVT_TYPE) {
+        return node.event_types[fields.event_type] != node.negate;
+      }
+      const std::string* value = GetField(node.field, fields);
+      if (!value) return false;
+      bool found = false;
+      for (const auto& candidate : node.values) {
+        if (*value == candidate) {
+          found = true;
+          break;
+        }
+      }
+      return found != node.negate;
+    }
+    case Node::STARTS_WITH: {
+      const std::string* value = GetField(node.field, fields);
+      return value && value->compare(0, node.values[0].size(), node.values[0]) == 0;
+    }
+  }
+  return false;
+}
+
+}  // namespace collector
@@ -0,0 +1,82 @@
+#ifndef COLLECTOR_NATIVEFILTER_H
+#define COLLECTOR_NATIVEFILTER_H
+
+#include <bitset>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "libsinsp/sinsp.h"
+
+#include "ppm_events_public.h"
+
+namespace collector {
+
+// NativeFilter evaluates a filter expression in the syntax of sysdig filters natively, instead of through a Lua chisel
+// and the libsinsp filter engine. Only the most common predicates are supported:
+//   <field> = <value>, <field> == <value>, <field> != <value>, <field> in (<value>, ...), <field> startswith <value>
+// on the fields container.id, proc.name, proc.exe, proc.exepath and evt.type, combined with and, or, not and
+// parentheses. As in libsinsp, container.id is "host" for processes outside of containers, and comparisons on fields
+// of an event without thread info are false.
+class NativeFilter {
+ public:
+  // The fields of an event that filters can check. The string fields are null if the event has no thread info.
+  struct Fields {
+    const std::string* container_id = nullptr;
+    const std::string* proc_name = nullptr;
+    const std::string* proc_exe = nullptr;
+    const std::string* proc_exepath = nullptr;
+    uint16_t event_type = 0;
+  };
+
+  // Compile compiles a filter expression. Returns nullptr if it is invalid or uses anything that is not supported.
+  static std::unique_ptr<NativeFilter> Compile(const std::string& filter);
+
+  // CompileChisel compiles the filter of a Lua chisel whose only job is to filter events, i.e., which sets a constant
+  // filter in on_init and whose on_event returns true. Returns nullptr for any other chisel.
+  static std::unique_ptr<NativeFilter> CompileChisel(const std::string& chisel);
+
+  bool Match(sinsp_evt* evt) const;
+  bool Match(const Fields& fields) const { return Evaluate(root_, fields); }
+
+ private:
+  enum class Field {
+    CONTAINER_ID,
+    PROC_NAME,
+    PROC_EXE,
+    PROC_EXEPATH,
+    EVT_TYPE,
+  };
+
+  struct Node {
+    enum Type {
+      AND,
+      OR,
+      NOT,
+      EQUALS,
+      STARTS_WITH,
+    } type;
+
+    // The operands of AND, OR and NOT.
+    std::vector<Node> children;
+
+    // For EQUALS, true if the field equals any of the values, and for STARTS_WITH, if it starts with the value.
+    Field field;
+    bool negate = false;
+    std::vector<std::string> values;
+    std::bitset<PPM_EVENT_MAX> event_types;
+  };
+
+  class Parser;
+
+  explicit NativeFilter(Node root) : root_(std::move(root)) {}
+
+  static bool Evaluate(const Node& node, const Fields& fields);
+  static const std::string* GetField(Field field, const Fields& fields);
+
+  Node root_;
+};
+
+}  // namespace collector
+
+#endif  // COLLECTOR_NATIVEFILTER_H
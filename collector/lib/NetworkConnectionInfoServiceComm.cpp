@@ -13,10 +13,13 @@ std::unique_ptr<grpc::ClientContext> NetworkConnectionInfoServiceComm::CreateCli
   auto ctx = MakeUnique<grpc::ClientContext>();
   ctx->AddMetadata(kHostnameMetadataKey, hostname_);
   ctx->AddMetadata(kCapsMetadataKey, kSupportedCaps);
+  compression_.Apply(ctx.get());
   return ctx;
 }
 
-NetworkConnectionInfoServiceComm::NetworkConnectionInfoServiceComm(std::string hostname, std::shared_ptr<grpc::Channel> channel) : hostname_(std::move(hostname)), channel_(std::move(channel)) {
+NetworkConnectionInfoServiceComm::NetworkConnectionInfoServiceComm(std::string hostname, std::shared_ptr<grpc::Channel> channel,
+                                                                   grpc_compression_algorithm compression, size_t compression_min_bytes)
+    : hostname_(std::move(hostname)), channel_(std::move(channel)), compression_(compression, compression_min_bytes, {CollectorStats::net_grpc_bytes, CollectorStats::net_grpc_compressed_bytes, CollectorStats::net_grpc_compression_us}) {
   if (channel_) {
     stub_ = sensor::NetworkConnectionInfoService::NewStub(channel_);
   }
@@ -47,9 +50,11 @@ std::unique_ptr<IDuplexClientWriter<sensor::NetworkConnectionInfoMessage>> Netwo
     ResetClientContext();
 
   if (channel_) {
-    return DuplexClient::CreateWithReadCallback(
+    auto writer = DuplexClient::CreateWithReadCallback(
         &sensor::NetworkConnectionInfoService::Stub::AsyncPushNetworkConnectionInfo,
         channel_, context_.get(), std::move(receive_func));
+    writer->SetCompressionFilter([this](const sensor::NetworkConnectionInfoMessage& msg) { return compression_.OnWrite(msg); });
+    return writer;
   } else {
     return MakeUnique<collector::grpc_duplex_impl::StdoutDuplexClientWriter<sensor::NetworkConnectionInfoMessage>>();
   }
@@ -12,6 +12,7 @@
 #include "internalapi/sensor/network_connection_iservice.grpc.pb.h"
 
 #include "DuplexGRPC.h"
+#include "GRPCCompression.h"
 
 namespace collector {
 
@@ -33,7 +34,8 @@ class INetworkConnectionInfoServiceComm {
 
 class NetworkConnectionInfoServiceComm : public INetworkConnectionInfoServiceComm {
  public:
-  NetworkConnectionInfoServiceComm(std::string hostname, std::shared_ptr<grpc::Channel> channel);
+  NetworkConnectionInfoServiceComm(std::string hostname, std::shared_ptr<grpc::Channel> channel,
+                                   grpc_compression_algorithm compression = GRPC_COMPRESS_NONE, size_t compression_min_bytes = 0);
 
   void ResetClientContext() override;
   bool WaitForConnectionReady(const std::function<bool()>& check_interrupted) override;
@@ -57,6 +59,8 @@ class NetworkConnectionInfoServiceComm : public INetworkConnectionInfoServiceCom
   std::string hostname_;
   std::shared_ptr<grpc::Channel> channel_;
   std::unique_ptr<sensor::NetworkConnectionInfoService::Stub> stub_;
+  // Only used by the thread writing to the stream.
+  StreamCompression compression_;
 
   std::mutex context_mutex_;
   std::unique_ptr<grpc::ClientContext> context_;
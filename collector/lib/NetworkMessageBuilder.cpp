@@ -0,0 +1,230 @@
+#include "NetworkMessageBuilder.h"
+
+#include <google/protobuf/util/time_util.h>
+
+#include "CollectorStats.h"
+#include "ProtoUtil.h"
+
+namespace collector {
+
+namespace {
+
+storage::L4Protocol TranslateL4Protocol(L4Proto proto) {
+  switch (proto) {
+    case L4Proto::TCP:
+      return storage::L4_PROTOCOL_TCP;
+    case L4Proto::UDP:
+      return storage::L4_PROTOCOL_UDP;
+    case L4Proto::ICMP:
+      return storage::L4_PROTOCOL_ICMP;
+    default:
+      return storage::L4_PROTOCOL_UNKNOWN;
+  }
+}
+
+sensor::SocketFamily TranslateAddressFamily(Address::Family family) {
+  switch (family) {
+    case Address::Family::IPV4:
+      return sensor::SOCKET_FAMILY_IPV4;
+    case Address::Family::IPV6:
+      return sensor::SOCKET_FAMILY_IPV6;
+    default:
+      return sensor::SOCKET_FAMILY_UNKNOWN;
+  }
+}
+
+}  // namespace
+
+sensor::NetworkConnectionInfoMessage* NetworkMessageBuilder::CreateInfoMessage(ConnMap::const_iterator* conn_it, ConnMap::const_iterator conn_end,
+                                                                                AdvertisedEndpointMap::const_iterator* cep_it, AdvertisedEndpointMap::const_iterator cep_end) {
+  if (*conn_it == conn_end && *cep_it == cep_end) return nullptr;
+
+  Reset();
+  auto* msg = AllocateRoot();
+
+  Chunk chunk;
+  size_t num_conns;
+  if (conn_cache_.enabled()) {
+    // The info is assembled from the serialized connections and endpoints.
+    std::string* info = AddSerializedField(msg, sensor::NetworkConnectionInfoMessage::kInfoFieldNumber);
+    AddSerializedConnections(info, conn_it, conn_end, &chunk);
+    num_conns = chunk.entries;
+    AddSerializedContainerEndpoints(info, cep_it, cep_end, &chunk);
+    AppendMessageField(sensor::NetworkConnectionInfo::kTimeFieldNumber, CurrentTimeProto(), info);
+  } else {
+    auto* info = msg->mutable_info();
+    AddConnections(info->mutable_updated_connections(), conn_it, conn_end, &chunk);
+    num_conns = chunk.entries;
+    AddContainerEndpoints(info->mutable_updated_endpoints(), cep_it, cep_end, &chunk);
+    *info->mutable_time() = CurrentTimeProto();
+  }
+  COUNTER_ADD(CollectorStats::net_conn_deltas, num_conns);
+  COUNTER_ADD(CollectorStats::net_cep_deltas, chunk.entries - num_conns);
+
+  COUNTER_INC(CollectorStats::net_delta_chunks);
+  COUNTER_ADD(CollectorStats::net_delta_chunk_bytes, chunk.bytes);
+  auto& stats = CollectorStats::GetOrCreate();
+  if (static_cast<int64_t>(chunk.bytes) > stats.GetCounter(CollectorStats::net_delta_max_chunk_bytes)) {
+    stats.CounterSet(CollectorStats::net_delta_max_chunk_bytes, chunk.bytes);
+  }
+
+  return msg;
+}
+
+sensor::NetworkConnectionInfoMessage* NetworkMessageBuilder::ParseMessage(const std::string& serialized) {
+  Reset();
+  auto* msg = AllocateRoot();
+  if (!msg->ParseFromString(serialized)) {
+    return nullptr;
+  }
+  return msg;
+}
+
+bool NetworkMessageBuilder::ChunkFull(const Chunk& chunk) const {
+  // A chunk always holds at least one entry, and can exceed the byte limit by the size of its last entry.
+  return (max_chunk_entries_ > 0 && chunk.entries >= max_chunk_entries_) ||
+         (max_chunk_bytes_ > 0 && chunk.bytes >= max_chunk_bytes_);
+}
+
+void NetworkMessageBuilder::AddConnections(::google::protobuf::RepeatedPtrField<sensor::NetworkConnection>* updates, ConnMap::const_iterator* it, ConnMap::const_iterator end, Chunk* chunk) {
+  for (; *it != end && !ChunkFull(*chunk); ++*it) {
+    const auto& delta_entry = **it;
+    auto* conn_proto = ConnToProto(delta_entry.first);
+    if (!delta_entry.second.IsActive()) {
+      *conn_proto->mutable_close_timestamp() = google::protobuf::util::TimeUtil::MicrosecondsToTimestamp(
+          delta_entry.second.LastActiveTime());
+    }
+    chunk->entries++;
+    chunk->bytes += conn_proto->ByteSizeLong();
+    updates->AddAllocated(conn_proto);
+  }
+}
+
+void NetworkMessageBuilder::AddContainerEndpoints(::google::protobuf::RepeatedPtrField<sensor::NetworkEndpoint>* updates, AdvertisedEndpointMap::const_iterator* it, AdvertisedEndpointMap::const_iterator end, Chunk* chunk) {
+  for (; *it != end && !ChunkFull(*chunk); ++*it) {
+    const auto& delta_entry = **it;
+    auto* endpoint_proto = ContainerEndpointToProto(delta_entry.first);
+
+    CLOG(DEBUG) << delta_entry.first << " active:" << delta_entry.second.IsActive();
+
+    if (!delta_entry.second.IsActive()) {
+      *endpoint_proto->mutable_close_timestamp() = google::protobuf::util::TimeUtil::MicrosecondsToTimestamp(
+          delta_entry.second.LastActiveTime());
+    }
+    chunk->entries++;
+    chunk->bytes += endpoint_proto->ByteSizeLong();
+    updates->AddAllocated(endpoint_proto);
+  }
+}
+
+void NetworkMessageBuilder::AddSerializedConnections(std::string* info, ConnMap::const_iterator* it, ConnMap::const_iterator end, Chunk* chunk) {
+  for (; *it != end && !ChunkFull(*chunk); ++*it) {
+    const auto& delta_entry = **it;
+    const std::string& serialized = conn_cache_.Get(delta_entry.first, [this, &delta_entry](std::string* out) {
+      ConnToProto(delta_entry.first)->SerializeToString(out);
+    });
+
+    size_t offset = info->size();
+    AppendSerializedField(sensor::NetworkConnectionInfo::kUpdatedConnectionsFieldNumber, serialized,
+                          SerializeCloseTimestamp(sensor::NetworkConnection::kCloseTimestampFieldNumber, delta_entry.second), info);
+    chunk->entries++;
+    chunk->bytes += info->size() - offset;
+  }
+}
+
+void NetworkMessageBuilder::AddSerializedContainerEndpoints(std::string* info, AdvertisedEndpointMap::const_iterator* it, AdvertisedEndpointMap::const_iterator end, Chunk* chunk) {
+  for (; *it != end && !ChunkFull(*chunk); ++*it) {
+    const auto& delta_entry = **it;
+    const ContainerEndpoint& cep = delta_entry.first;
+    // The originator is serialized along with the close timestamp rather than cached, such that the cache neither
+    // holds on to processes nor reports a stale originator for an endpoint.
+    ContainerEndpoint key(cep.container(), cep.endpoint(), cep.l4proto(), nullptr);
+    const std::string& serialized = cep_cache_.Get(key, [this, &key](std::string* out) {
+      ContainerEndpointToProto(key)->SerializeToString(out);
+    });
+
+    CLOG(DEBUG) << cep << " active:" << delta_entry.second.IsActive();
+
+    endpoint_suffix_.clear();
+    if (cep.originator()) {
+      AppendMessageField(sensor::NetworkEndpoint::kOriginatorFieldNumber, *ProcessToProto(*cep.originator()), &endpoint_suffix_);
+    }
+    endpoint_suffix_ += SerializeCloseTimestamp(sensor::NetworkEndpoint::kCloseTimestampFieldNumber, delta_entry.second);
+
+    size_t offset = info->size();
+    AppendSerializedField(sensor::NetworkConnectionInfo::kUpdatedEndpointsFieldNumber, serialized, endpoint_suffix_, info);
+    chunk->entries++;
+    chunk->bytes += info->size() - offset;
+  }
+}
+
+const std::string& NetworkMessageBuilder::SerializeCloseTimestamp(int field_number, const ConnStatus& status) {
+  close_timestamp_.clear();
+  if (!status.IsActive()) {
+    AppendMessageField(field_number, google::protobuf::util::TimeUtil::MicrosecondsToTimestamp(status.LastActiveTime()), &close_timestamp_);
+  }
+  return close_timestamp_;
+}
+
+sensor::NetworkConnection* NetworkMessageBuilder::ConnToProto(const Connection& conn) {
+  auto* conn_proto = Allocate<sensor::NetworkConnection>();
+  conn_proto->set_container_id(conn.container());
+  conn_proto->set_role(conn.is_server() ? sensor::ROLE_SERVER : sensor::ROLE_CLIENT);
+  conn_proto->set_protocol(TranslateL4Protocol(conn.l4proto()));
+  conn_proto->set_socket_family(TranslateAddressFamily(conn.local().address().family()));
+  conn_proto->set_allocated_local_address(EndpointToProto(conn.local()));
+  conn_proto->set_allocated_remote_address(EndpointToProto(conn.remote()));
+
+  return conn_proto;
+}
+
+sensor::NetworkEndpoint* NetworkMessageBuilder::ContainerEndpointToProto(const ContainerEndpoint& cep) {
+  auto* endpoint_proto = Allocate<sensor::NetworkEndpoint>();
+  endpoint_proto->set_container_id(cep.container());
+  endpoint_proto->set_protocol(TranslateL4Protocol(cep.l4proto()));
+  endpoint_proto->set_socket_family(TranslateAddressFamily(cep.endpoint().address().family()));
+  endpoint_proto->set_allocated_listen_address(EndpointToProto(cep.endpoint()));
+  if (cep.originator()) {
+    endpoint_proto->set_allocated_originator(ProcessToProto(*cep.originator().get()));
+  }
+
+  return endpoint_proto;
+}
+
+sensor::NetworkAddress* NetworkMessageBuilder::EndpointToProto(const collector::Endpoint& endpoint) {
+  if (endpoint.IsNull()) {
+    return nullptr;
+  }
+
+  // Note: We are sending the address data and network data as separate fields for
+  // backward compatibility, although, network field can handle both.
+  // Sensor tries to match address to known cluster entities. If that fails, it tries
+  // to match the network to known external networks,
+
+  auto* addr_proto = Allocate<sensor::NetworkAddress>();
+  auto addr_length = endpoint.address().length();
+  if (endpoint.network().IsAddress()) {
+    addr_proto->set_address_data(endpoint.address().data(), addr_length);
+  }
+  if (endpoint.network().bits() > 0) {
+    std::array<uint8_t, Address::kMaxLen + 1> buff;
+    std::memcpy(buff.data(), endpoint.network().address().data(), addr_length);
+    buff[addr_length] = endpoint.network().bits();
+    addr_proto->set_ip_network(buff.data(), addr_length + 1);
+  }
+  addr_proto->set_port(endpoint.port());
+
+  return addr_proto;
+}
+
+storage::NetworkProcessUniqueKey* NetworkMessageBuilder::ProcessToProto(const collector::IProcess& process) {
+  auto* process_proto = Allocate<storage::NetworkProcessUniqueKey>();
+
+  process_proto->set_process_name(process.comm());
+  process_proto->set_process_exec_file_path(process.exe_path());
+  process_proto->set_process_args(process.args());
+
+  return process_proto;
+}
+
+}  // namespace collector
@@ -0,0 +1,72 @@
+#ifndef COLLECTOR_NETWORKMESSAGEBUILDER_H
+#define COLLECTOR_NETWORKMESSAGEBUILDER_H
+
+#include <string>
+
+#include "internalapi/sensor/network_connection_iservice.pb.h"
+
+#include "ConnTracker.h"
+#include "EncodingCache.h"
+#include "ProtoAllocator.h"
+
+namespace collector {
+
+// NetworkMessageBuilder builds the messages reporting connection and endpoint deltas to Sensor.
+//
+// If the encoding cache is enabled, the serialized form of every reported connection and endpoint is cached, and the
+// messages are assembled from the cached bytes instead of being built field by field. Such messages are identical on
+// the wire, but their contents are not visible through the accessors of the message (e.g., info()) until it has been
+// serialized and parsed again.
+class NetworkMessageBuilder : protected ProtoAllocator<sensor::NetworkConnectionInfoMessage> {
+ public:
+  NetworkMessageBuilder(size_t max_chunk_entries, size_t max_chunk_bytes, size_t encoding_cache_entries)
+      : max_chunk_entries_(max_chunk_entries), max_chunk_bytes_(max_chunk_bytes), conn_cache_(encoding_cache_entries), cep_cache_(encoding_cache_entries) {}
+
+  // CreateInfoMessage creates the message for the next chunk of a delta, starting at the given positions, which are
+  // advanced past the entries added to the message. Returns nullptr if there are no entries left. The message is valid
+  // until the next call to CreateInfoMessage or ParseMessage.
+  sensor::NetworkConnectionInfoMessage* CreateInfoMessage(ConnMap::const_iterator* conn_it, ConnMap::const_iterator conn_end,
+                                                          AdvertisedEndpointMap::const_iterator* cep_it, AdvertisedEndpointMap::const_iterator cep_end);
+
+  // ParseMessage parses a serialized message. Returns nullptr if it is malformed. The message is valid until the next
+  // call to CreateInfoMessage or ParseMessage.
+  sensor::NetworkConnectionInfoMessage* ParseMessage(const std::string& serialized);
+
+ private:
+  // A part of a delta that is sent in a single message.
+  struct Chunk {
+    size_t entries = 0;
+    size_t bytes = 0;
+  };
+
+  bool ChunkFull(const Chunk& chunk) const;
+  void AddConnections(::google::protobuf::RepeatedPtrField<sensor::NetworkConnection>* updates, ConnMap::const_iterator* it, ConnMap::const_iterator end, Chunk* chunk);
+  void AddContainerEndpoints(::google::protobuf::RepeatedPtrField<sensor::NetworkEndpoint>* updates, AdvertisedEndpointMap::const_iterator* it, AdvertisedEndpointMap::const_iterator end, Chunk* chunk);
+  // Like AddConnections and AddContainerEndpoints, but appending the cached serialized entries to a serialized info.
+  void AddSerializedConnections(std::string* info, ConnMap::const_iterator* it, ConnMap::const_iterator end, Chunk* chunk);
+  void AddSerializedContainerEndpoints(std::string* info, AdvertisedEndpointMap::const_iterator* it, AdvertisedEndpointMap::const_iterator end, Chunk* chunk);
+  // SerializeCloseTimestamp returns the close timestamp field with the given number for an entry with the given status,
+  // serialized, or an empty string if the entry is active.
+  const std::string& SerializeCloseTimestamp(int field_number, const ConnStatus& status);
+
+  sensor::NetworkConnection* ConnToProto(const Connection& conn);
+  sensor::NetworkEndpoint* ContainerEndpointToProto(const ContainerEndpoint& cep);
+  sensor::NetworkAddress* EndpointToProto(const Endpoint& endpoint);
+  storage::NetworkProcessUniqueKey* ProcessToProto(const collector::IProcess& process);
+
+  // If non-zero, deltas are sent in chunks of at most this many entries, or (approximately) bytes, respectively. The
+  // allocator is reset for every chunk, so it only needs to hold a single chunk.
+  size_t max_chunk_entries_;
+  size_t max_chunk_bytes_;
+  // The serialized connections and endpoints, without their close timestamp. Endpoints are keyed, and serialized,
+  // without their originator.
+  EncodingCache<Connection> conn_cache_;
+  EncodingCache<ContainerEndpoint> cep_cache_;
+  std::string close_timestamp_;
+  // The originator and close timestamp of the endpoint being added, serialized.
+  std::string endpoint_suffix_;
+};
+
+}  // namespace collector
+
+#endif  // COLLECTOR_NETWORKMESSAGEBUILDER_H
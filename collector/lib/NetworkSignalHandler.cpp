@@ -79,7 +79,7 @@ std::optional<Connection> NetworkSignalHandler::GetConnection(sinsp_evt* evt) {
   return {Connection(*container_id, *local, *remote, l4proto, is_server)};
 }
 
-SignalHandler::Result NetworkSignalHandler::HandleSignal(sinsp_evt* evt) {
+SignalHandler::Result NetworkSignalHandler::ExtractSignal(sinsp_evt* evt, ConnectionUpdate* update) {
   auto modifier = modifiers[evt->get_type()];
   if (modifier == Modifier::INVALID) return SignalHandler::IGNORED;
 
@@ -88,7 +88,20 @@ SignalHandler::Result NetworkSignalHandler::HandleSignal(sinsp_evt* evt) {
     return SignalHandler::IGNORED;
   }
 
-  conn_tracker_->UpdateConnection(*result, evt->get_ts() / 1000UL, modifier == Modifier::ADD);
+  update->conn = std::move(*result);
+  update->timestamp = evt->get_ts() / 1000UL;
+  update->added = modifier == Modifier::ADD;
+  return SignalHandler::PROCESSED;
+}
+
+SignalHandler::Result NetworkSignalHandler::ProcessRecord(const ConnectionUpdate& update) {
+  conn_tracker_->UpdateConnection(update.conn, update.timestamp, update.added);
+  return SignalHandler::PROCESSED;
+}
+
+SignalHandler::Result NetworkSignalHandler::ProcessRecords(const ConnectionUpdate* updates, size_t count, size_t* processed) {
+  conn_tracker_->UpdateConnections(updates, count);
+  *processed = count;
   return SignalHandler::PROCESSED;
 }
 
@@ -97,6 +110,7 @@ std::vector<std::string> NetworkSignalHandler::GetRelevantEvents() {
 }
 
 bool NetworkSignalHandler::Stop() {
+  QueuedSignalHandler::Stop();
   event_extractor_.ClearWrappers();
   return true;
 }
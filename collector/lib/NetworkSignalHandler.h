@@ -4,24 +4,34 @@
 #include <optional>
 
 #include "ConnTracker.h"
-#include "SignalHandler.h"
+#include "QueuedSignalHandler.h"
 #include "SysdigEventExtractor.h"
 #include "SysdigService.h"
 
 namespace collector {
 
-class NetworkSignalHandler final : public SignalHandler {
+// NetworkSignalHandler extracts connection updates on the capture thread, and applies them to the connection tracker
+// on its worker thread.
+class NetworkSignalHandler final : public QueuedSignalHandler<ConnectionUpdate> {
  public:
-  explicit NetworkSignalHandler(sinsp* inspector, std::shared_ptr<ConnectionTracker> conn_tracker, SysdigStats* stats)
-      : conn_tracker_(std::move(conn_tracker)), stats_(stats) {
+  explicit NetworkSignalHandler(sinsp* inspector, std::shared_ptr<ConnectionTracker> conn_tracker, SysdigStats* stats, size_t queue_size = 0)
+      : QueuedSignalHandler(queue_size, {CollectorStats::network_signal_queue_depth, CollectorStats::network_signal_queue_drops, CollectorStats::network_signal_lag_us}),
+        conn_tracker_(std::move(conn_tracker)),
+        stats_(stats) {
     event_extractor_.Init(inspector);
   }
 
+  ~NetworkSignalHandler() override { QueuedSignalHandler::Stop(); }
+
   std::string GetName() override { return "NetworkSignalHandler"; }
-  Result HandleSignal(sinsp_evt* evt) override;
   std::vector<std::string> GetRelevantEvents() override;
   bool Stop() override;
 
+ protected:
+  Result ExtractSignal(sinsp_evt* evt, ConnectionUpdate* update) override;
+  Result ProcessRecord(const ConnectionUpdate& update) override;
+  Result ProcessRecords(const ConnectionUpdate* updates, size_t count, size_t* processed) override;
+
  private:
   std::optional<Connection> GetConnection(sinsp_evt* evt);
 
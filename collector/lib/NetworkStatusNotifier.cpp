@@ -1,12 +1,14 @@
 #include "NetworkStatusNotifier.h"
 
-#include <google/protobuf/util/time_util.h>
+#include <algorithm>
+#include <thread>
+#include <utility>
 
 #include "CollectorStats.h"
 #include "DuplexGRPC.h"
 #include "GRPCUtil.h"
 #include "Profiler.h"
-#include "ProtoUtil.h"
+#include "Sysdig.h"
 #include "TimeUtil.h"
 #include "Utility.h"
 
@@ -14,29 +16,11 @@ namespace collector {
 
 namespace {
 
-storage::L4Protocol TranslateL4Protocol(L4Proto proto) {
-  switch (proto) {
-    case L4Proto::TCP:
-      return storage::L4_PROTOCOL_TCP;
-    case L4Proto::UDP:
-      return storage::L4_PROTOCOL_UDP;
-    case L4Proto::ICMP:
-      return storage::L4_PROTOCOL_ICMP;
-    default:
-      return storage::L4_PROTOCOL_UNKNOWN;
-  }
-}
+// Interval between two steps of an incremental scrape.
+constexpr auto kScrapeStepInterval = std::chrono::seconds(1);
 
-sensor::SocketFamily TranslateAddressFamily(Address::Family family) {
-  switch (family) {
-    case Address::Family::IPV4:
-      return sensor::SOCKET_FAMILY_IPV4;
-    case Address::Family::IPV6:
-      return sensor::SOCKET_FAMILY_IPV6;
-    default:
-      return sensor::SOCKET_FAMILY_UNKNOWN;
-  }
-}
+// Maximum time the sender waits for a delta before checking the stream for control messages and errors.
+constexpr auto kSendPollInterval = std::chrono::seconds(1);
 
 }  // namespace
 
@@ -111,23 +95,23 @@ void NetworkStatusNotifier::Run() {
   Profiler::RegisterCPUThread();
   auto next_attempt = std::chrono::system_clock::now();
 
-  while (thread_.PauseUntil(next_attempt)) {
+  while (SpoolUntil(next_attempt)) {
     comm_->ResetClientContext();
 
-    if (!comm_->WaitForConnectionReady([this] { return thread_.should_stop(); })) {
+    if (!comm_->WaitForConnectionReady([this] { return !SpoolUntil(std::chrono::system_clock::now()); })) {
       break;
     }
 
     auto client_writer = comm_->PushNetworkConnectionInfoOpenStream([this](const sensor::NetworkFlowsControlMessage* msg) { OnRecvControlMessage(msg); });
 
-    if (enable_afterglow_) {
-      RunSingleAfterglow(client_writer.get());
-    } else {
-      RunSingle(client_writer.get());
-    }
+    RunSender(client_writer.get());
     if (thread_.should_stop()) {
       return;
     }
+    if (!spool_.enabled()) {
+      // Sensor might have lost the state sent on this stream.
+      resync_needed_ = true;
+    }
     auto status = client_writer->Finish(std::chrono::seconds(5));
     if (status.ok()) {
       CLOG(ERROR) << "Error streaming network connection info: server hung up unexpectedly";
@@ -141,6 +125,9 @@ void NetworkStatusNotifier::Run() {
 }
 
 void NetworkStatusNotifier::Start() {
+  COUNTER_SET(CollectorStats::net_scrape_interval_seconds, scrape_interval_.interval().count());
+  scraper_thread_.Start([this] { RunScraper(); });
+  delta_engine_thread_ = std::thread([this] { RunDeltaEngine(); });
   thread_.Start([this] { Run(); });
   CLOG(INFO) << "Started network status notifier.";
 }
@@ -148,6 +135,44 @@ void NetworkStatusNotifier::Start() {
 void NetworkStatusNotifier::Stop() {
   comm_->TryCancel();
   thread_.Stop();
+  scraper_thread_.Stop();
+  scrapes_.Shutdown();
+  delta_engine_thread_.join();
+  deltas_.Shutdown();
+}
+
+bool NetworkStatusNotifier::Flush(std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(flush_mutex_);
+  flushed_ = false;
+  scrapes_.Push(Scrape{NowMicros(), false, true}, CoalesceScrapes);
+  return flush_cond_.wait_for(lock, timeout, [this] { return flushed_; });
+}
+
+void NetworkStatusNotifier::OnDeltaSent(bool flush) {
+  if (!flush) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(flush_mutex_);
+  flushed_ = true;
+  flush_cond_.notify_all();
+}
+
+void NetworkStatusNotifier::LogStageTimings() const {
+  const auto& stats = CollectorStats::GetOrCreate();
+  auto log_timer = [&stats](const char* name, CollectorStats::TimerType timer) {
+    int64_t count = stats.GetTimerCount(timer);
+    int64_t micros = stats.GetTimerDurationMicros(timer);
+    CLOG(INFO) << "  " << name << ": " << count << " runs, " << (count ? micros / count : 0) << "us on average";
+  };
+
+  CLOG(INFO) << "Network status notifier stage timings:";
+  log_timer("scraper", CollectorStats::net_scraper_stage);
+  log_timer("delta engine", CollectorStats::net_delta_stage);
+  log_timer("  fetch state", CollectorStats::net_fetch_state);
+  log_timer("delta queue wait", CollectorStats::net_delta_queue_wait);
+  log_timer("sender", CollectorStats::net_sender_stage);
+  log_timer("  create message", CollectorStats::net_create_message);
+  log_timer("  write message", CollectorStats::net_write_message);
 }
 
 void NetworkStatusNotifier::WaitUntilWriterStarted(IDuplexClientWriter<sensor::NetworkConnectionInfoMessage>* writer, int wait_time_seconds) {
@@ -160,7 +185,8 @@ void NetworkStatusNotifier::WaitUntilWriterStarted(IDuplexClientWriter<sensor::N
 }
 
 bool NetworkStatusNotifier::UpdateAllConnsAndEndpoints() {
-  if (turn_off_scraping_) {
+  if (turn_off_scraping_ || IncrementalScrapeEnabled()) {
+    // When scraping incrementally, the connection tracker is updated whenever a sweep completes.
     return true;
   }
 
@@ -181,200 +207,341 @@ bool NetworkStatusNotifier::UpdateAllConnsAndEndpoints() {
   return true;
 }
 
-void NetworkStatusNotifier::RunSingle(IDuplexClientWriter<sensor::NetworkConnectionInfoMessage>* writer) {
-  WaitUntilWriterStarted(writer, 10);
+bool NetworkStatusNotifier::SleepUntil(std::chrono::system_clock::time_point deadline) {
+  if (!IncrementalScrapeEnabled()) {
+    return scraper_thread_.PauseUntil(deadline);
+  }
 
-  ConnMap old_conn_state;
-  AdvertisedEndpointMap old_cep_state;
+  for (auto next_step = std::chrono::system_clock::now(); next_step < deadline; next_step += kScrapeStepInterval) {
+    if (!scraper_thread_.PauseUntil(next_step)) {
+      return false;
+    }
+    ScrapeStep();
+  }
+  return scraper_thread_.PauseUntil(deadline);
+}
+
+void NetworkStatusNotifier::ScrapeStep() {
+  if (!sweep_in_progress_) {
+    int64_t now = NowMicros();
+    if (now < next_sweep_micros_) {
+      return;
+    }
+    sweep_start_micros_ = now;
+    next_sweep_micros_ = now + std::chrono::duration_cast<std::chrono::microseconds>(ScrapeInterval()).count();
+    sweep_in_progress_ = true;
+  }
+
+  bool sweep_complete;
+  std::vector<Connection> all_conns;
+  std::vector<ContainerEndpoint> all_listen_endpoints;
+  WITH_TIMER(CollectorStats::net_scrape_read) {
+    bool success = conn_scraper_->ScrapeStep(scrape_cpu_budget_, &sweep_complete, &all_conns, scrape_listen_endpoints_ ? &all_listen_endpoints : nullptr);
+    if (!success) {
+      CLOG_THROTTLED(ERROR, std::chrono::seconds(10)) << "Failed to scrape connections";
+      sweep_in_progress_ = false;
+      return;
+    }
+  }
+
+  if (!sweep_complete) {
+    return;
+  }
+
+  sweep_in_progress_ = false;
+  CollectorStats::GetOrCreate().EndTimerAt(CollectorStats::net_scrape_sweep, NowMicros() - sweep_start_micros_);
+  WITH_TIMER(CollectorStats::net_scrape_update) {
+    conn_tracker_->UpdateFromSweep(all_conns, all_listen_endpoints, sweep_start_micros_);
+  }
+}
+
+std::chrono::seconds NetworkStatusNotifier::ScrapeInterval() {
+  std::lock_guard<std::mutex> lock(scrape_interval_mutex_);
+  return scrape_interval_.interval();
+}
+
+void NetworkStatusNotifier::UpdateScrapeInterval(size_t delta_size) {
+  uint64_t total_drops = 0;
+  SysdigStats stats;
+  if (sysdig_ && sysdig_->GetStats(&stats)) {
+    total_drops = stats.nDrops;
+  }
+
+  std::lock_guard<std::mutex> lock(scrape_interval_mutex_);
+  auto reason = scrape_interval_.Update(total_drops, delta_size);
+  switch (reason) {
+    case AdaptiveScrapeInterval::Reason::NONE:
+      return;
+    case AdaptiveScrapeInterval::Reason::DROPS:
+      COUNTER_INC(CollectorStats::net_scrape_interval_shortened_drops);
+      break;
+    case AdaptiveScrapeInterval::Reason::DELTA_SPIKE:
+      COUNTER_INC(CollectorStats::net_scrape_interval_shortened_delta);
+      break;
+    case AdaptiveScrapeInterval::Reason::QUIET:
+    case AdaptiveScrapeInterval::Reason::STEADY:
+      COUNTER_INC(CollectorStats::net_scrape_interval_lengthened);
+      break;
+  }
+  COUNTER_SET(CollectorStats::net_scrape_interval_seconds, scrape_interval_.interval().count());
+  CLOG(DEBUG) << "Scrape interval changed to " << scrape_interval_.interval().count() << "s ("
+              << AdaptiveScrapeInterval::ReasonName(reason) << ")";
+}
+
+void NetworkStatusNotifier::CoalesceScrapes(Scrape* pending, Scrape&& latest) {
+  pending->time_micros = latest.time_micros;
+  pending->resync |= latest.resync;
+  pending->flush |= latest.flush;
+}
+
+void NetworkStatusNotifier::MergeDeltas(NetworkDelta* pending, NetworkDelta&& latest) {
+  bool flush = pending->flush || latest.flush;
+  if (latest.resync) {
+    // The full state supersedes all earlier changes.
+    *pending = std::move(latest);
+  } else {
+    pending->MergeFrom(std::move(latest));
+  }
+  pending->flush = flush;
+}
+
+void NetworkStatusNotifier::RunScraper() {
+  Profiler::RegisterCPUThread();
   auto next_scrape = std::chrono::system_clock::now();
 
-  while (writer->Sleep(next_scrape)) {
-    next_scrape = std::chrono::system_clock::now() + std::chrono::seconds(scrape_interval_);
+  while (SleepUntil(next_scrape)) {
+    next_scrape = std::chrono::system_clock::now() + ScrapeInterval();
 
-    if (!UpdateAllConnsAndEndpoints()) {
-      continue;
+    Scrape scrape;
+    WITH_TIMER(CollectorStats::net_scraper_stage) {
+      if (!UpdateAllConnsAndEndpoints()) {
+        continue;
+      }
+      scrape.time_micros = NowMicros();
     }
 
-    const sensor::NetworkConnectionInfoMessage* msg;
-    ConnMap new_conn_state;
-    AdvertisedEndpointMap new_cep_state;
-    WITH_TIMER(CollectorStats::net_fetch_state) {
-      new_conn_state = conn_tracker_->FetchConnState(true, true);
-      ConnectionTracker::ComputeDelta(new_conn_state, &old_conn_state);
-
-      new_cep_state = conn_tracker_->FetchEndpointState(true, true);
-      ConnectionTracker::ComputeDelta(new_cep_state, &old_cep_state);
+    if (!scrapes_.Push(std::move(scrape), CoalesceScrapes)) {
+      COUNTER_INC(CollectorStats::net_scrapes_coalesced);
     }
+  }
+}
 
-    WITH_TIMER(CollectorStats::net_create_message) {
-      msg = CreateInfoMessage(old_conn_state, old_cep_state);
-      old_conn_state = std::move(new_conn_state);
-      old_cep_state = std::move(new_cep_state);
+void NetworkStatusNotifier::RunDeltaEngine() {
+  Profiler::RegisterCPUThread();
+
+  ConnMap old_conn_state;
+  AdvertisedEndpointMap old_cep_state;
+  int64_t time_at_last_scrape = NowMicros();
+
+  Scrape scrape;
+  while (scrapes_.Pop(&scrape)) {
+    if (scrape.resync) {
+      old_conn_state.clear();
+      old_cep_state.clear();
     }
 
-    if (!msg) {
+    NetworkDelta delta;
+    delta.resync = scrape.resync;
+    delta.flush = scrape.flush;
+    WITH_TIMER(CollectorStats::net_delta_stage) {
+      WITH_TIMER(CollectorStats::net_fetch_state) {
+        ConnMap new_conn_state = conn_tracker_->FetchConnState(true, true);
+        if (enable_afterglow_) {
+          ConnectionTracker::ComputeDeltaAfterglow(new_conn_state, old_conn_state, delta.conns, scrape.time_micros, time_at_last_scrape, afterglow_period_micros_);
+          // Add new connections to the old_state and remove inactive connections that are older than the afterglow period.
+          ConnectionTracker::UpdateOldState(&old_conn_state, new_conn_state, scrape.time_micros, afterglow_period_micros_);
+          time_at_last_scrape = scrape.time_micros;
+        } else {
+          ConnectionTracker::ComputeDelta(new_conn_state, &old_conn_state);
+          delta.conns = std::move(old_conn_state);
+          old_conn_state = std::move(new_conn_state);
+        }
+
+        AdvertisedEndpointMap new_cep_state = conn_tracker_->FetchEndpointState(true, true);
+        ConnectionTracker::ComputeDelta(new_cep_state, &old_cep_state);
+        delta.endpoints = std::move(old_cep_state);
+        old_cep_state = std::move(new_cep_state);
+      }
+    }
+
+    UpdateScrapeInterval(delta.size());
+
+    // The full state is passed on even if empty, since the sender waits for it, and so is a flush.
+    if (delta.empty() && !delta.resync && !delta.flush) {
       continue;
     }
 
-    WITH_TIMER(CollectorStats::net_write_message) {
-      if (!writer->Write(*msg, next_scrape)) {
-        CLOG(ERROR) << "Failed to write network connection info";
-        return;
-      }
+    delta.queued_micros = NowMicros();
+    if (!deltas_.Push(std::move(delta), MergeDeltas)) {
+      COUNTER_INC(CollectorStats::net_deltas_merged);
     }
   }
 }
 
-void NetworkStatusNotifier::RunSingleAfterglow(IDuplexClientWriter<sensor::NetworkConnectionInfoMessage>* writer) {
+void NetworkStatusNotifier::RunSender(IDuplexClientWriter<sensor::NetworkConnectionInfoMessage>* writer) {
   WaitUntilWriterStarted(writer, 10);
 
-  ConnMap old_conn_state;
-  AdvertisedEndpointMap old_cep_state;
-  auto next_scrape = std::chrono::system_clock::now();
-  int64_t time_at_last_scrape = NowMicros();
+  if (!FlushSpool(writer)) {
+    return;
+  }
+
+  NetworkDelta delta;
+  while (!thread_.should_stop()) {
+    bool have_delta = deltas_.PopFor(&delta, kSendPollInterval);
 
-  while (writer->Sleep(next_scrape)) {
-    next_scrape = std::chrono::system_clock::now() + std::chrono::seconds(scrape_interval_);
+    // Process control messages from Sensor and check for errors on the stream, without blocking.
+    if (!writer->Sleep(std::chrono::system_clock::now())) {
+      if (have_delta) {
+        Spool(std::move(delta));
+      }
+      return;
+    }
 
-    if (!UpdateAllConnsAndEndpoints()) {
+    if (!have_delta) {
       continue;
     }
 
-    int64_t time_micros = NowMicros();
-    const sensor::NetworkConnectionInfoMessage* msg;
-    AdvertisedEndpointMap new_cep_state;
-    ConnMap new_conn_state, delta_conn;
-    WITH_TIMER(CollectorStats::net_fetch_state) {
-      new_conn_state = conn_tracker_->FetchConnState(true, true);
-      ConnectionTracker::ComputeDeltaAfterglow(new_conn_state, old_conn_state, delta_conn, time_micros, time_at_last_scrape, afterglow_period_micros_);
-
-      new_cep_state = conn_tracker_->FetchEndpointState(true, true);
-      ConnectionTracker::ComputeDelta(new_cep_state, &old_cep_state);
+    if (awaiting_resync_ && !delta.resync) {
+      // Computed before the full state was requested, which supersedes it. A flush has to wait for the full state.
+      if (delta.flush) {
+        scrapes_.Push(Scrape{NowMicros(), false, true}, CoalesceScrapes);
+      }
+      continue;
     }
+    awaiting_resync_ = false;
 
+    WITH_TIMER(CollectorStats::net_sender_stage) {
+      CollectorStats::GetOrCreate().EndTimerAt(CollectorStats::net_delta_queue_wait, NowMicros() - delta.queued_micros);
+      if (!SendDelta(writer, delta)) {
+        Spool(std::move(delta));
+        return;
+      }
+    }
+    OnDeltaSent(delta.flush);
+  }
+}
+
+bool NetworkStatusNotifier::SendDelta(IDuplexClientWriter<sensor::NetworkConnectionInfoMessage>* writer, const NetworkDelta& delta) {
+  auto conn_it = delta.conns.begin();
+  auto cep_it = delta.endpoints.begin();
+  auto deadline = std::chrono::system_clock::now() + ScrapeInterval();
+
+  for (;;) {
+    const sensor::NetworkConnectionInfoMessage* msg;
     WITH_TIMER(CollectorStats::net_create_message) {
-      // Report the deltas
-      msg = CreateInfoMessage(delta_conn, old_cep_state);
-      // Add new connections to the old_state and remove inactive connections that are older than the afterglow period.
-      ConnectionTracker::UpdateOldState(&old_conn_state, new_conn_state, time_micros, afterglow_period_micros_);
-      old_cep_state = std::move(new_cep_state);
-      time_at_last_scrape = time_micros;
+      msg = message_builder_.CreateInfoMessage(&conn_it, delta.conns.end(), &cep_it, delta.endpoints.end());
     }
 
     if (!msg) {
-      continue;
+      return true;
     }
 
     WITH_TIMER(CollectorStats::net_write_message) {
-      if (!writer->Write(*msg, next_scrape)) {
+      if (!writer->Write(*msg, deadline)) {
         CLOG(ERROR) << "Failed to write network connection info";
-        return;
+        return false;
       }
     }
   }
 }
 
-sensor::NetworkConnectionInfoMessage* NetworkStatusNotifier::CreateInfoMessage(const ConnMap& conn_delta, const AdvertisedEndpointMap& endpoint_delta) {
-  if (conn_delta.empty() && endpoint_delta.empty()) return nullptr;
-
-  Reset();
-  auto* msg = AllocateRoot();
-  auto* info = msg->mutable_info();
+void NetworkStatusNotifier::Spool(NetworkDelta&& delta) {
+  flush_spooled_ |= delta.flush;
+  if (resync_needed_ || (awaiting_resync_ && !delta.resync)) {
+    // The full state will be sent anyway.
+    return;
+  }
 
-  AddConnections(info->mutable_updated_connections(), conn_delta);
-  COUNTER_ADD(CollectorStats::net_conn_deltas, conn_delta.size());
-  AddContainerEndpoints(info->mutable_updated_endpoints(), endpoint_delta);
-  COUNTER_ADD(CollectorStats::net_cep_deltas, endpoint_delta.size());
+  if (!spool_.enabled()) {
+    resync_needed_ = true;
+    return;
+  }
 
-  *info->mutable_time() = CurrentTimeProto();
+  if (delta.resync) {
+    // A full state that could not be sent replaces everything spooled so far.
+    spool_.Clear();
+    awaiting_resync_ = false;
+  }
 
-  return msg;
-}
+  if (spool_.Add(std::move(delta))) {
+    return;
+  }
 
-void NetworkStatusNotifier::AddConnections(::google::protobuf::RepeatedPtrField<sensor::NetworkConnection>* updates, const ConnMap& delta) {
-  for (const auto& delta_entry : delta) {
-    auto* conn_proto = ConnToProto(delta_entry.first);
-    if (!delta_entry.second.IsActive()) {
-      *conn_proto->mutable_close_timestamp() = google::protobuf::util::TimeUtil::MicrosecondsToTimestamp(
-          delta_entry.second.LastActiveTime());
-    }
-    updates->AddAllocated(conn_proto);
+  if (spool_.has_overflow_file() && SpillSpool()) {
+    return;
   }
-}
 
-void NetworkStatusNotifier::AddContainerEndpoints(::google::protobuf::RepeatedPtrField<sensor::NetworkEndpoint>* updates, const AdvertisedEndpointMap& delta) {
-  for (const auto& delta_entry : delta) {
-    auto* endpoint_proto = ContainerEndpointToProto(delta_entry.first);
+  CLOG(WARNING) << "Network delta spool is full, the full state will be sent once the stream to Sensor is back";
+  COUNTER_INC(CollectorStats::net_spool_dropped);
+  spool_.Clear();
+  resync_needed_ = true;
+}
 
-    CLOG(DEBUG) << delta_entry.first << " active:" << delta_entry.second.IsActive();
+bool NetworkStatusNotifier::SpillSpool() {
+  const NetworkDelta& delta = spool_.delta();
+  auto conn_it = delta.conns.begin();
+  auto cep_it = delta.endpoints.begin();
 
-    if (!delta_entry.second.IsActive()) {
-      *endpoint_proto->mutable_close_timestamp() = google::protobuf::util::TimeUtil::MicrosecondsToTimestamp(
-          delta_entry.second.LastActiveTime());
+  std::string serialized;
+  while (const auto* msg = message_builder_.CreateInfoMessage(&conn_it, delta.conns.end(), &cep_it, delta.endpoints.end())) {
+    if (!msg->SerializeToString(&serialized) || !spool_.Spill(serialized)) {
+      return false;
     }
-    updates->AddAllocated(endpoint_proto);
   }
-}
-
-sensor::NetworkConnection* NetworkStatusNotifier::ConnToProto(const Connection& conn) {
-  auto* conn_proto = Allocate<sensor::NetworkConnection>();
-  conn_proto->set_container_id(conn.container());
-  conn_proto->set_role(conn.is_server() ? sensor::ROLE_SERVER : sensor::ROLE_CLIENT);
-  conn_proto->set_protocol(TranslateL4Protocol(conn.l4proto()));
-  conn_proto->set_socket_family(TranslateAddressFamily(conn.local().address().family()));
-  conn_proto->set_allocated_local_address(EndpointToProto(conn.local()));
-  conn_proto->set_allocated_remote_address(EndpointToProto(conn.remote()));
 
-  return conn_proto;
+  spool_.ClearDelta();
+  return true;
 }
 
-sensor::NetworkEndpoint* NetworkStatusNotifier::ContainerEndpointToProto(const ContainerEndpoint& cep) {
-  auto* endpoint_proto = Allocate<sensor::NetworkEndpoint>();
-  endpoint_proto->set_container_id(cep.container());
-  endpoint_proto->set_protocol(TranslateL4Protocol(cep.l4proto()));
-  endpoint_proto->set_socket_family(TranslateAddressFamily(cep.endpoint().address().family()));
-  endpoint_proto->set_allocated_listen_address(EndpointToProto(cep.endpoint()));
-  if (cep.originator()) {
-    endpoint_proto->set_allocated_originator(ProcessToProto(*cep.originator().get()));
-  }
+bool NetworkStatusNotifier::SpoolUntil(std::chrono::system_clock::time_point deadline) {
+  NetworkDelta delta;
+  for (;;) {
+    if (thread_.should_stop()) {
+      return false;
+    }
 
-  return endpoint_proto;
+    auto now = std::chrono::system_clock::now();
+    if (deltas_.PopFor(&delta, std::min<std::chrono::system_clock::duration>(std::max(deadline - now, {}), kSendPollInterval))) {
+      Spool(std::move(delta));
+    } else if (now >= deadline) {
+      return true;
+    }
+  }
 }
 
-sensor::NetworkAddress* NetworkStatusNotifier::EndpointToProto(const collector::Endpoint& endpoint) {
-  if (endpoint.IsNull()) {
-    return nullptr;
+bool NetworkStatusNotifier::FlushSpool(IDuplexClientWriter<sensor::NetworkConnectionInfoMessage>* writer) {
+  if (resync_needed_) {
+    resync_needed_ = false;
+    awaiting_resync_ = true;
+    scrapes_.Push(Scrape{NowMicros(), true, std::exchange(flush_spooled_, false)}, CoalesceScrapes);
+    return true;
   }
 
-  // Note: We are sending the address data and network data as separate fields for
-  // backward compatibility, although, network field can handle both.
-  // Sensor tries to match address to known cluster entities. If that fails, it tries
-  // to match the network to known external networks,
-
-  auto* addr_proto = Allocate<sensor::NetworkAddress>();
-  auto addr_length = endpoint.address().length();
-  if (endpoint.network().IsAddress()) {
-    addr_proto->set_address_data(endpoint.address().data(), addr_length);
-  }
-  if (endpoint.network().bits() > 0) {
-    std::array<uint8_t, Address::kMaxLen + 1> buff;
-    std::memcpy(buff.data(), endpoint.network().address().data(), addr_length);
-    buff[addr_length] = endpoint.network().bits();
-    addr_proto->set_ip_network(buff.data(), addr_length + 1);
+  if (spool_.empty()) {
+    OnDeltaSent(std::exchange(flush_spooled_, false));
+    return true;
   }
-  addr_proto->set_port(endpoint.port());
-
-  return addr_proto;
-}
 
-storage::NetworkProcessUniqueKey* NetworkStatusNotifier::ProcessToProto(const collector::IProcess& process) {
-  auto* process_proto = Allocate<storage::NetworkProcessUniqueKey>();
+  CLOG(INFO) << "Sending " << spool_.delta().size() << " spooled network updates and " << spool_.spilled_messages()
+             << " spilled messages";
 
-  process_proto->set_process_name(process.comm());
-  process_proto->set_process_exec_file_path(process.exe_path());
-  process_proto->set_process_args(process.args());
+  auto deadline = std::chrono::system_clock::now() + ScrapeInterval();
+  bool success = spool_.ForEachSpilled([this, writer, deadline](const std::string& serialized) {
+    auto* msg = message_builder_.ParseMessage(serialized);
+    if (!msg) {
+      CLOG(ERROR) << "Skipping corrupt message in the network delta spool";
+      return true;
+    }
+    return static_cast<bool>(writer->Write(*msg, deadline));
+  });
+  if (!success || !SendDelta(writer, spool_.delta())) {
+    CLOG(ERROR) << "Failed to send the network delta spool";
+    return false;
+  }
 
-  return process_proto;
+  spool_.Clear();
+  OnDeltaSent(std::exchange(flush_spooled_, false));
+  return true;
 }
 
 }  // namespace collector
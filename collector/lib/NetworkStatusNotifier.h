@@ -1,59 +1,146 @@
 #ifndef COLLECTOR_NETWORKSTATUSNOTIFIER_H
 #define COLLECTOR_NETWORKSTATUSNOTIFIER_H
 
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 
+#include "AdaptiveScrapeInterval.h"
+#include "BoundedQueue.h"
 #include "CollectorStats.h"
 #include "ConnTracker.h"
+#include "DeltaSpool.h"
 #include "NetworkConnectionInfoServiceComm.h"
+#include "NetworkMessageBuilder.h"
 #include "ProcfsScraper.h"
-#include "ProtoAllocator.h"
 #include "StoppableThread.h"
 
 namespace collector {
 
-class NetworkStatusNotifier : protected ProtoAllocator<sensor::NetworkConnectionInfoMessage> {
+class Sysdig;
+
+// NetworkStatusNotifier streams connection and endpoint deltas to Sensor. It runs as a pipeline of three stages on
+// separate threads:
+//  - the scraper scrapes /proc at the scrape interval and updates the connection tracker,
+//  - the delta engine fetches the state of the connection tracker after every scrape and computes the delta,
+//  - the sender (on the thread owning the stream) serializes the deltas and writes them to Sensor.
+// The stages are connected by bounded queues: if a stage falls behind, the pending scrapes are coalesced and the pending
+// deltas merged, so that a slow Sensor does not delay scraping, and a slow scrape does not delay sending.
+// While the stream is down, the deltas are accumulated in the spool, if enabled, and sent once the stream is back.
+// Otherwise, they are discarded, and the full state is sent on the next stream.
+class NetworkStatusNotifier {
  public:
   NetworkStatusNotifier(std::shared_ptr<IConnScraper> conn_scraper, int scrape_interval, bool scrape_listen_endpoints, bool turn_off_scrape,
                         std::shared_ptr<ConnectionTracker> conn_tracker, int64_t afterglow_period_micros, bool use_afterglow,
-                        std::shared_ptr<INetworkConnectionInfoServiceComm> comm)
-      : conn_scraper_(conn_scraper), scrape_interval_(scrape_interval), turn_off_scraping_(turn_off_scrape), scrape_listen_endpoints_(scrape_listen_endpoints), conn_tracker_(std::move(conn_tracker)), afterglow_period_micros_(afterglow_period_micros), enable_afterglow_(use_afterglow), comm_(comm) {
+                        std::shared_ptr<INetworkConnectionInfoServiceComm> comm, int scrape_cpu_budget_ms = 0,
+                        int scrape_interval_min = 0, int scrape_interval_max = 0, size_t max_chunk_entries = 0, size_t max_chunk_bytes = 0,
+                        size_t spool_max_entries = 0, std::string spool_file = "", size_t spool_file_max_bytes = 0, size_t encoding_cache_entries = 0, const Sysdig* sysdig = nullptr)
+      : conn_scraper_(conn_scraper), scrape_interval_(std::chrono::seconds(scrape_interval), std::chrono::seconds(scrape_interval_min > 0 ? scrape_interval_min : scrape_interval), std::chrono::seconds(scrape_interval_max > 0 ? scrape_interval_max : scrape_interval)), sysdig_(sysdig), turn_off_scraping_(turn_off_scrape), scrape_listen_endpoints_(scrape_listen_endpoints), scrape_cpu_budget_(std::chrono::milliseconds(scrape_cpu_budget_ms)), conn_tracker_(std::move(conn_tracker)), afterglow_period_micros_(afterglow_period_micros), enable_afterglow_(use_afterglow), message_builder_(max_chunk_entries, max_chunk_bytes, encoding_cache_entries), spool_(spool_max_entries, std::move(spool_file), spool_file_max_bytes), comm_(comm), scrapes_(kMaxPendingScrapes), deltas_(kMaxPendingDeltas) {
   }
 
   void Start();
   void Stop();
 
+  // Flush computes a final delta from the current state of the connection tracker, and waits until it has been sent,
+  // for at most the given time. Used at the end of a replay, where no more events update the tracker. Returns false on
+  // timeout, e.g., if the stream to Sensor is down.
+  bool Flush(std::chrono::milliseconds timeout);
+  // LogStageTimings logs the number of runs and the average duration of each stage of the pipeline.
+  void LogStageTimings() const;
+
  private:
-  sensor::NetworkConnectionInfoMessage* CreateInfoMessage(const ConnMap& conn_delta, const AdvertisedEndpointMap& cep_delta);
-  void AddConnections(::google::protobuf::RepeatedPtrField<sensor::NetworkConnection>* updates, const ConnMap& delta);
-  void AddContainerEndpoints(::google::protobuf::RepeatedPtrField<sensor::NetworkEndpoint>* updates, const AdvertisedEndpointMap& delta);
+  void OnRecvControlMessage(const sensor::NetworkFlowsControlMessage* msg);
 
-  sensor::NetworkConnection* ConnToProto(const Connection& conn);
-  sensor::NetworkEndpoint* ContainerEndpointToProto(const ContainerEndpoint& cep);
-  sensor::NetworkAddress* EndpointToProto(const Endpoint& endpoint);
-  storage::NetworkProcessUniqueKey* ProcessToProto(const collector::IProcess& process);
+  // A completed scrape, passed from the scraper to the delta engine.
+  struct Scrape {
+    int64_t time_micros = 0;
+    // Whether the delta engine has to compute the full state rather than the changes since the previous scrape.
+    bool resync = false;
+    // Whether the resulting delta has to be passed on even if empty, to complete a Flush.
+    bool flush = false;
+  };
 
-  void OnRecvControlMessage(const sensor::NetworkFlowsControlMessage* msg);
+  // At most one scrape and one delta wait for the next stage. Later scrapes are coalesced with the pending one (the
+  // delta engine fetches the latest state of the connection tracker anyway), and later deltas are merged into the
+  // pending one, such that a slow sender receives a single, up to date delta once it catches up.
+  static constexpr size_t kMaxPendingScrapes = 1;
+  static constexpr size_t kMaxPendingDeltas = 1;
+
+  static void CoalesceScrapes(Scrape* pending, Scrape&& latest);
+  static void MergeDeltas(NetworkDelta* pending, NetworkDelta&& latest);
 
   void Run();
   void WaitUntilWriterStarted(IDuplexClientWriter<sensor::NetworkConnectionInfoMessage>* writer, int wait_time);
   bool UpdateAllConnsAndEndpoints();
-  void RunSingle(IDuplexClientWriter<sensor::NetworkConnectionInfoMessage>* writer);
-  void RunSingleAfterglow(IDuplexClientWriter<sensor::NetworkConnectionInfoMessage>* writer);
+  bool IncrementalScrapeEnabled() const { return !turn_off_scraping_ && scrape_cpu_budget_.count() > 0; }
+  bool SleepUntil(std::chrono::system_clock::time_point deadline);
+  void ScrapeStep();
+  std::chrono::seconds ScrapeInterval();
+  // UpdateScrapeInterval adapts the scrape interval after a scrape that resulted in a delta of the given size.
+  void UpdateScrapeInterval(size_t delta_size);
+  void RunScraper();
+  void RunDeltaEngine();
+  void RunSender(IDuplexClientWriter<sensor::NetworkConnectionInfoMessage>* writer);
+  // SendDelta writes the delta to the stream, split into chunks. Returns false if a write failed.
+  bool SendDelta(IDuplexClientWriter<sensor::NetworkConnectionInfoMessage>* writer, const NetworkDelta& delta);
+
+  // Spool stores a delta that could not be sent, or discards it if the spool is disabled or full.
+  void Spool(NetworkDelta&& delta);
+  // SpillSpool writes the spooled delta to the overflow file of the spool. Returns false on failure.
+  bool SpillSpool();
+  // SpoolUntil spools the deltas computed until the given time, while the stream is down. Returns false if the
+  // notifier is stopping.
+  bool SpoolUntil(std::chrono::system_clock::time_point deadline);
+  // FlushSpool sends the spooled deltas at the start of a stream, or requests the full state to be sent if deltas
+  // were discarded. Returns false if a write failed.
+  bool FlushSpool(IDuplexClientWriter<sensor::NetworkConnectionInfoMessage>* writer);
+  // OnDeltaSent completes the pending Flush once a delta computed for it has been sent.
+  void OnDeltaSent(bool flush);
   void ReceivePublicIPs(const sensor::IPAddressList& public_ips);
   void ReceiveIPNetworks(const sensor::IPNetworkList& networks);
 
   StoppableThread thread_;
+  StoppableThread scraper_thread_;
+  std::thread delta_engine_thread_;
 
   std::shared_ptr<IConnScraper> conn_scraper_;
-  int scrape_interval_;
+  // The scrape interval is adapted by the delta engine and used by the scraper and the sender.
+  std::mutex scrape_interval_mutex_;
+  AdaptiveScrapeInterval scrape_interval_;
+  // If non-null, the number of events dropped by the kernel is used to adapt the scrape interval.
+  const Sysdig* sysdig_;
   bool turn_off_scraping_;
   bool scrape_listen_endpoints_;
+  // CPU time to spend on scraping per step of an incremental scrape. If zero, /proc is scraped all at once instead.
+  std::chrono::microseconds scrape_cpu_budget_;
+  bool sweep_in_progress_ = false;
+  int64_t sweep_start_micros_ = 0;
+  // A sweep starts at most once per scrape interval, such that its steps are spread over the interval.
+  int64_t next_sweep_micros_ = 0;
   std::shared_ptr<ConnectionTracker> conn_tracker_;
 
   int64_t afterglow_period_micros_;
   bool enable_afterglow_;
+  // Accessed by the sender thread only.
+  NetworkMessageBuilder message_builder_;
+  DeltaSpool spool_;
+  // Whether deltas were discarded, such that the full state has to be sent on the next stream.
+  bool resync_needed_ = false;
+  // Whether the sender discards deltas until the one with the full state arrives.
+  bool awaiting_resync_ = false;
+  // Whether a delta computed for a Flush was spooled, such that the Flush completes once the spool has been sent.
+  bool flush_spooled_ = false;
   std::shared_ptr<INetworkConnectionInfoServiceComm> comm_;
+
+  std::mutex flush_mutex_;
+  std::condition_variable flush_cond_;
+  bool flushed_ = false;
+
+  BoundedQueue<Scrape> scrapes_;
+  BoundedQueue<NetworkDelta> deltas_;
 };
 
 }  // namespace collector
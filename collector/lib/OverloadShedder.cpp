@@ -0,0 +1,56 @@
+#include "OverloadShedder.h"
+
+namespace collector {
+
+const std::vector<std::vector<std::string>> OverloadShedder::kLevels = {
+    // The working directory is also read from /proc when processes are scraped.
+    {"chdir", "fchdir"},
+    // Credential changes only refresh the user of already known processes.
+    {"setuid", "setgid", "setresuid", "setresgid"},
+};
+
+OverloadShedder::OverloadShedder(int drop_permille, int restore_intervals)
+    : drop_permille_(drop_permille), restore_intervals_(restore_intervals) {}
+
+int OverloadShedder::Update(uint64_t events, uint64_t drops) {
+  if (!initialized_ || events < last_events_ || drops < last_drops_) {
+    // First call, or the counters were reset, e.g., because the driver was reopened.
+    initialized_ = true;
+    last_events_ = events;
+    last_drops_ = drops;
+    return level_;
+  }
+
+  // The number of events already includes the dropped ones.
+  uint64_t interval_drops = drops - last_drops_;
+  uint64_t interval_total = events - last_events_;
+  last_events_ = events;
+  last_drops_ = drops;
+
+  if (interval_total < kMinIntervalEvents) {
+    return level_;
+  }
+
+  // Compare in tenths of a permille, for the restore threshold.
+  uint64_t drop_ratio = interval_drops * 10000 / interval_total;
+  uint64_t shed_threshold = static_cast<uint64_t>(drop_permille_) * 10;
+  uint64_t restore_threshold = static_cast<uint64_t>(drop_permille_);
+
+  if (drop_ratio > shed_threshold) {
+    quiet_intervals_ = 0;
+    if (level_ < max_level()) {
+      level_++;
+    }
+  } else if (drop_ratio <= restore_threshold && level_ > 0) {
+    if (++quiet_intervals_ >= restore_intervals_) {
+      quiet_intervals_ = 0;
+      level_--;
+    }
+  } else {
+    quiet_intervals_ = 0;
+  }
+
+  return level_;
+}
+
+}  // namespace collector
@@ -0,0 +1,48 @@
+#ifndef COLLECTOR_OVERLOADSHEDDER_H
+#define COLLECTOR_OVERLOADSHEDDER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace collector {
+
+// OverloadShedder decides which syscalls to stop capturing when the kernel drops events because userspace can't keep
+// up with the event rate. Drops are otherwise random, and may hit the connect/accept and execve events collector can't
+// recover; the shed syscalls are picked among those whose loss the procfs scraping partly compensates for.
+//
+// The syscalls are shed in levels, lowest priority first. Update is called with the cumulative kernel event and drop
+// counts at a regular interval, and the level goes up by one for every interval in which the share of dropped events
+// exceeds the drop threshold. It only goes down by one once the share has stayed under a tenth of the threshold for
+// restore_intervals consecutive intervals, such that the level doesn't flap while the event rate stays high.
+class OverloadShedder {
+ public:
+  // kLevels lists the syscalls shed by each level, in addition to those of the levels below.
+  static const std::vector<std::vector<std::string>> kLevels;
+
+  // Intervals with fewer events than this are too small to judge the drop rate, and leave the level unchanged.
+  static constexpr uint64_t kMinIntervalEvents = 1000;
+
+  // drop_permille is the threshold on the dropped events, per thousand events.
+  OverloadShedder(int drop_permille, int restore_intervals);
+
+  // Update takes the cumulative number of events (including the dropped ones) and drops reported by the kernel, and
+  // returns the new level.
+  int Update(uint64_t events, uint64_t drops);
+
+  int level() const { return level_; }
+  int max_level() const { return static_cast<int>(kLevels.size()); }
+
+ private:
+  int drop_permille_;
+  int restore_intervals_;
+  int level_ = 0;
+  int quiet_intervals_ = 0;
+  bool initialized_ = false;
+  uint64_t last_events_ = 0;
+  uint64_t last_drops_ = 0;
+};
+
+}  // namespace collector
+
+#endif  // COLLECTOR_OVERLOADSHEDDER_H
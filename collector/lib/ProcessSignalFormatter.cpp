@@ -128,9 +128,14 @@ ProcessSignal* ProcessSignalFormatter::CreateProcessSignal(sinsp_evt* event) {
   *timestamp = TimeUtil::NanosecondsToTimestamp(event->get_ts());
   signal->set_allocated_time(timestamp);
 
-  // set container_id
-  if (const std::string* container_id = event_extractor_.get_container_id(event)) {
+  // set container_id (if libsinsp did not attribute the process to a container, e.g., because none of its container
+  // engines recognizes the runtime, fall back to the cgroup of the process, as done when scraping connections)
+  const std::string* container_id = event_extractor_.get_container_id(event);
+  if (container_id && !container_id->empty()) {
     signal->set_container_id(*container_id);
+  } else if (const int64_t* pid = event_extractor_.get_pid(event)) {
+    std::string cgroup_container_id;
+    if (process_scraper_.ScrapeContainerID(*pid, &cgroup_container_id)) signal->set_container_id(cgroup_container_id);
   }
 
   // set process lineage
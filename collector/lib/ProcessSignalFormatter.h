@@ -7,14 +7,16 @@
 
 #include "CollectorStats.h"
 #include "EventNames.h"
+#include "ProcfsScraper.h"
 #include "ProtoSignalFormatter.h"
 #include "SysdigEventExtractor.h"
+#include "Utility.h"
 
 namespace collector {
 
 class ProcessSignalFormatter : public ProtoSignalFormatter<sensor::SignalStreamMessage> {
  public:
-  ProcessSignalFormatter(sinsp* inspector) : event_names_(EventNames::GetInstance()) {
+  ProcessSignalFormatter(sinsp* inspector) : event_names_(EventNames::GetInstance()), process_scraper_(GetHostPath("/proc")) {
     event_extractor_.Init(inspector);
   }
 
@@ -41,6 +43,8 @@ class ProcessSignalFormatter : public ProtoSignalFormatter<sensor::SignalStreamM
 
   const EventNames& event_names_;
   SysdigEventExtractor event_extractor_;
+  // Resolves the container ID of processes libsinsp did not attribute to a container from their cgroup.
+  ProcessScraper process_scraper_;
 };
 
 }  // namespace collector
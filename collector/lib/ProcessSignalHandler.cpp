@@ -22,54 +22,54 @@ std::string compute_process_key(const ::storage::ProcessSignal& s) {
 
 bool ProcessSignalHandler::Start() {
   client_->Start();
-  return true;
+  return QueuedSignalHandler::Start();
 }
 
 bool ProcessSignalHandler::Stop() {
+  // The worker is stopped first, as it is the one pushing signals to the client.
+  QueuedSignalHandler::Stop();
   client_->Stop();
   rate_limiter_.ResetRateLimitCache();
   return true;
 }
 
-SignalHandler::Result ProcessSignalHandler::HandleSignal(sinsp_evt* evt) {
+SignalHandler::Result ProcessSignalHandler::ExtractSignal(sinsp_evt* evt, sensor::SignalStreamMessage* msg) {
   const auto* signal_msg = formatter_.ToProtoMessage(evt);
   if (!signal_msg) {
     ++(stats_->nProcessResolutionFailuresByEvt);
     return IGNORED;
   }
 
-  if (!rate_limiter_.Allow(compute_process_key(signal_msg->signal().process_signal()))) {
-    ++(stats_->nProcessRateLimitCount);
-    return IGNORED;
-  }
-
-  auto result = client_->PushSignals(*signal_msg);
-  if (result == SignalHandler::PROCESSED) {
-    ++(stats_->nProcessSent);
-  } else if (result == SignalHandler::ERROR) {
-    ++(stats_->nProcessSendFailures);
-  }
-
-  return result;
+  return ApplyRateLimit(*signal_msg, msg);
 }
 
-SignalHandler::Result ProcessSignalHandler::HandleExistingProcess(sinsp_threadinfo* tinfo) {
+SignalHandler::Result ProcessSignalHandler::ExtractExistingProcess(sinsp_threadinfo* tinfo, sensor::SignalStreamMessage* msg) {
   const auto* signal_msg = formatter_.ToProtoMessage(tinfo);
   if (!signal_msg) {
     ++(stats_->nProcessResolutionFailuresByTinfo);
     return IGNORED;
   }
 
-  if (!rate_limiter_.Allow(compute_process_key(signal_msg->signal().process_signal()))) {
+  return ApplyRateLimit(*signal_msg, msg);
+}
+
+SignalHandler::Result ProcessSignalHandler::ApplyRateLimit(const sensor::SignalStreamMessage& signal_msg, sensor::SignalStreamMessage* msg) {
+  if (!rate_limiter_.Allow(compute_process_key(signal_msg.signal().process_signal()))) {
     ++(stats_->nProcessRateLimitCount);
     return IGNORED;
   }
 
-  auto result = client_->PushSignals(*signal_msg);
+  // The formatted message is only valid until the next event is formatted.
+  msg->CopyFrom(signal_msg);
+  return PROCESSED;
+}
+
+SignalHandler::Result ProcessSignalHandler::ProcessRecord(const sensor::SignalStreamMessage& msg) {
+  auto result = client_->PushSignals(msg);
   if (result == SignalHandler::PROCESSED) {
-    ++(stats_->nProcessSent);
+    num_sent_.fetch_add(1, std::memory_order_relaxed);
   } else if (result == SignalHandler::ERROR) {
-    ++(stats_->nProcessSendFailures);
+    num_send_failures_.fetch_add(1, std::memory_order_relaxed);
   }
 
   return result;
@@ -79,4 +79,9 @@ std::vector<std::string> ProcessSignalHandler::GetRelevantEvents() {
   return {"execve<"};
 }
 
+void ProcessSignalHandler::SyncStats() {
+  stats_->nProcessSent = num_sent_.load(std::memory_order_relaxed);
+  stats_->nProcessSendFailures = num_send_failures_.load(std::memory_order_relaxed);
+}
+
 }  // namespace collector
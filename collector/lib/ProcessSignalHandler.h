@@ -1,6 +1,7 @@
 #ifndef __PROCESS_SIGNAL_HANDLER_H__
 #define __PROCESS_SIGNAL_HANDLER_H__
 
+#include <atomic>
 #include <memory>
 
 #include "libsinsp/sinsp.h"
@@ -8,29 +9,45 @@
 #include <grpcpp/channel.h>
 
 #include "ProcessSignalFormatter.h"
+#include "QueuedSignalHandler.h"
 #include "RateLimit.h"
-#include "SignalHandler.h"
 #include "SysdigService.h"
 
 namespace collector {
 
-class ProcessSignalHandler : public SignalHandler {
+// ProcessSignalHandler formats process signals on the capture thread, and pushes them to Sensor on its worker thread.
+class ProcessSignalHandler : public QueuedSignalHandler<sensor::SignalStreamMessage> {
  public:
-  ProcessSignalHandler(sinsp* inspector, ISignalServiceClient* client, SysdigStats* stats)
-      : client_(client), formatter_(inspector), stats_(stats) {}
+  ProcessSignalHandler(sinsp* inspector, ISignalServiceClient* client, SysdigStats* stats, size_t queue_size = 0)
+      : QueuedSignalHandler(queue_size, {CollectorStats::process_signal_queue_depth, CollectorStats::process_signal_queue_drops, CollectorStats::process_signal_lag_us}),
+        client_(client),
+        formatter_(inspector),
+        stats_(stats) {}
+
+  ~ProcessSignalHandler() override { QueuedSignalHandler::Stop(); }
 
   bool Start() override;
   bool Stop() override;
-  Result HandleSignal(sinsp_evt* evt) override;
-  Result HandleExistingProcess(sinsp_threadinfo* tinfo) override;
   std::string GetName() override { return "ProcessSignalHandler"; }
   std::vector<std::string> GetRelevantEvents() override;
+  void SyncStats() override;
+
+ protected:
+  Result ExtractSignal(sinsp_evt* evt, sensor::SignalStreamMessage* msg) override;
+  Result ExtractExistingProcess(sinsp_threadinfo* tinfo, sensor::SignalStreamMessage* msg) override;
+  Result ProcessRecord(const sensor::SignalStreamMessage& msg) override;
 
  private:
+  // ApplyRateLimit copies the formatted signal to *msg, unless it is rate limited.
+  Result ApplyRateLimit(const sensor::SignalStreamMessage& signal_msg, sensor::SignalStreamMessage* msg);
+
   ISignalServiceClient* client_;
   ProcessSignalFormatter formatter_;
   SysdigStats* stats_;
   RateLimitCache rate_limiter_;
+  // Counted by ProcessRecord on the worker thread, and copied to stats_ by SyncStats on the capture thread.
+  std::atomic<uint64_t> num_sent_{0};
+  std::atomic<uint64_t> num_send_failures_{0};
 };
 
 }  // namespace collector
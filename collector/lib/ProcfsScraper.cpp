@@ -1,19 +1,26 @@
 #include "ProcfsScraper.h"
 
+#include <algorithm>
 #include <cctype>
+#include <cerrno>
 #include <cinttypes>
 #include <cstring>
 #include <fcntl.h>
 #include <string_view>
+#include <tuple>
+#include <vector>
 
 #include <netinet/tcp.h>
+#include <sys/stat.h>
 
 #include "CollectorStats.h"
 #include "Containers.h"
 #include "FileSystem.h"
 #include "Hash.h"
+#include "IoUring.h"
 #include "Logging.h"
 #include "ProcfsScraper_internal.h"
+#include "TimeUtil.h"
 #include "Utility.h"
 
 namespace collector {
@@ -80,74 +87,179 @@ bool GetNetworkNamespace(int dirfd, ino_t* inode) {
   return ReadINode(dirfd, "ns/net", "net", inode);
 }
 
-// This object represents an opened file-descriptor/socket
-// It also holds a mapping from this socket inode to the process which created it.
-class SocketInfo {
- public:
-  SocketInfo(ino_t inode, uint64_t pid) : inode_(inode), pid_(pid) {}
+// Size of the buffer for reading the `stat` file of a process, which is large enough for the fields up to the start time.
+constexpr size_t kStatBufSize = 512;
 
-  inline ino_t inode() const { return inode_; }
-  inline uint64_t pid() const { return pid_; }
+// ParseStartTime parses the start time of a process (in clock ticks after system boot) from the contents of its `stat`
+// file.
+bool ParseStartTime(const char* buf, ssize_t nread, uint64_t* start_time) {
+  if (nread <= 0) return false;
 
-  size_t Hash() const {
-    return std::hash<ino_t>()(inode_);
-  }
+  // The second field (comm) is enclosed in parentheses and may itself contain spaces and parentheses, hence we
+  // start from the last closing parenthesis, which is followed by field 3 (state).
+  const char* p = static_cast<const char*>(memrchr(buf, ')', nread));
+  if (!p || p + 2 >= buf + nread) return false;
+  p += 2;
 
-  bool operator==(const SocketInfo& o) const {
-    return inode() == o.inode();
-  }
+  // 22: starttime
+  p = rep_nextfield(19, p, buf + nread);
+  if (!p) return false;
 
- private:
-  ino_t inode_;
-  uint64_t pid_;
-};
+  char* parse_endp;
+  uintmax_t parsed = std::strtoumax(p, &parse_endp, 10);
+  if (parse_endp == p) return false;
+  *start_time = static_cast<uint64_t>(parsed);
+  return true;
+}
+
+// ReadStartTime reads the start time of a process from the `stat` file at the given path relative to dirfd.
+bool ReadStartTime(int dirfd, const char* path, uint64_t* start_time) {
+  FDHandle stat_fd = openat(dirfd, path, O_RDONLY);
+  if (!stat_fd.valid()) return false;
+
+  char buf[kStatBufSize];
+  ssize_t nread = read(stat_fd, buf, sizeof(buf) - 1);
+  if (nread <= 0) return false;
+  buf[nread] = '\0';
+
+  return ParseStartTime(buf, nread, start_time);
+}
+
+// ReadFDSize returns the size of the fd table (the `FDSize` field in `status`) of the process represented by dirfd, or 0
+// if it cannot be determined.
+uint64_t ReadFDSize(int dirfd) {
+  FDHandle status_fd = openat(dirfd, "status", O_RDONLY);
+  if (!status_fd.valid()) return 0;
+
+  char buf[4096];
+  ssize_t nread = read(status_fd, buf, sizeof(buf) - 1);
+  if (nread <= 0) return 0;
+  buf[nread] = '\0';
+
+  const char* p = std::strstr(buf, "\nFDSize:");
+  if (!p) return 0;
+  return std::strtoull(p + StrLen("\nFDSize:"), nullptr, 10);
+}
+
+// ReadNetNSSocketCount returns the number of sockets in use in the network namespace of the process represented by
+// dirfd (from `net/sockstat`), or 0 if it cannot be determined.
+uint64_t ReadNetNSSocketCount(int dirfd) {
+  FDHandle sockstat_fd = openat(dirfd, "net/sockstat", O_RDONLY);
+  if (!sockstat_fd.valid()) return 0;
+
+  char buf[512];
+  ssize_t nread = read(sockstat_fd, buf, sizeof(buf) - 1);
+  if (nread <= 0) return 0;
+  buf[nread] = '\0';
 
-// GetSocketINodes returns a list of all socket inodes associated with open file descriptors of the process represented
-// by dirfd.
-bool GetSocketINodes(int dirfd, uint64_t pid, UnorderedSet<SocketInfo>* sock_inodes) {
+  if (std::strncmp(buf, "sockets: used ", StrLen("sockets: used ")) != 0) return 0;
+  return std::strtoull(buf + StrLen("sockets: used "), nullptr, 10);
+}
+
+// ReadSocketINodes reads the inodes of all sockets in the given fd directory with a readlink per fd, appends them to
+// inodes, and returns the number of fds. Reading the link text, rather than stat'ing the fd, never reaches the file
+// system of the fd, which might block (e.g., NFS or FUSE).
+uint64_t ReadSocketINodes(DirHandle* fd_dir, std::vector<ino_t>* inodes) {
+  uint64_t num_fds = 0;
+  while (auto curr = fd_dir->read()) {
+    if (!std::isdigit(curr->d_name[0])) continue;  // only look at fd entries, ignore '.' and '..'.
+    num_fds++;
+
+    ino_t inode;
+    if (!ReadINode(fd_dir->fd(), curr->d_name, "socket", &inode)) continue;  // ignore non-socket fds
+
+    inodes->push_back(inode);
+  }
+  return num_fds;
+}
+
+// GetSocketINodes stores the inodes of all sockets associated with open file descriptors of the process represented by
+// dirfd in snapshot->socket_inodes. Reading the fd table takes a readlink per open fd, which is skipped if the process'
+// fd table appears to be unchanged since the snapshot was taken, unless the snapshot is older than
+// kFdTableRescanInterval scrapes. The snapshot is updated whenever the fd table is read.
+bool GetSocketINodes(int dirfd, uint64_t netns_sockets, uint64_t generation,
+                     ProcessMetadataCache::FdTableSnapshot* snapshot) {
   DirHandle fd_dir = FDHandle(openat(dirfd, "fd", O_RDONLY));
   if (!fd_dir.valid()) {
+    snapshot->valid = false;
     COUNTER_INC(CollectorStats::procfs_could_not_open_fd_dir);
     CLOG_THROTTLED(ERROR, std::chrono::seconds(10)) << "could not open fd directory";
     return false;
   }
 
-  while (auto curr = fd_dir.read()) {
-    if (!std::isdigit(curr->d_name[0])) continue;  // only look at fd entries, ignore '.' and '..'.
+  // Since Linux 6.2, the size of the fd directory is the number of open fds. Earlier kernels always report 0, in which
+  // case we resort to the size of the fd table, which only changes when the table needs to grow.
+  struct stat fd_dir_stat;
+  uint64_t fd_count = (fstat(fd_dir.fd(), &fd_dir_stat) == 0) ? fd_dir_stat.st_size : 0;
+  uint64_t fd_size = fd_count ? 0 : ReadFDSize(dirfd);
 
-    ino_t inode;
-    if (!ReadINode(fd_dir.fd(), curr->d_name, "socket", &inode)) continue;  // ignore non-socket fds
-
-    sock_inodes->emplace(inode, pid);
+  if (snapshot->valid && generation - snapshot->generation < ProcessMetadataCache::kFdTableRescanInterval &&
+      snapshot->fd_count == fd_count && snapshot->fd_size == fd_size && snapshot->netns_sockets == netns_sockets) {
+    COUNTER_INC(CollectorStats::procfs_fd_tables_skipped);
+    COUNTER_ADD(CollectorStats::procfs_fd_readlinks_avoided, snapshot->num_fds);
+    return true;
   }
 
+  snapshot->socket_inodes.clear();
+  uint64_t num_fds = ReadSocketINodes(&fd_dir, &snapshot->socket_inodes);
+
+  snapshot->valid = true;
+  snapshot->fd_count = fd_count;
+  snapshot->fd_size = fd_size;
+  snapshot->netns_sockets = netns_sockets;
+  snapshot->num_fds = num_fds;
+  snapshot->generation = generation;
   return true;
 }
 
-// IsContainerID returns whether the given string view represents a container ID.
-bool IsContainerID(std::string_view str) {
-  if (str.size() != 64) return false;
-  for (auto c : str) {
-    if (!std::isdigit(c) && (c < 'a' || c > 'f')) return false;
+// Size of the buffer the cgroup file of a process is read into. Larger files require more than one read.
+constexpr size_t kCgroupBufSize = 4096;
+
+// ReadCgroups reads the entire cgroup file of the process represented by dirfd. The returned contents are held in a
+// buffer owned by the calling thread, and remain valid until its next call.
+bool ReadCgroups(int dirfd, std::string_view* cgroups) {
+  FDHandle cgroups_fd = openat(dirfd, "cgroup", O_RDONLY);
+  if (!cgroups_fd.valid()) return false;
+
+  thread_local std::vector<char> buf(kCgroupBufSize);
+  size_t len = 0;
+  for (;;) {
+    if (len == buf.size()) buf.resize(2 * buf.size());
+    ssize_t nread = read(cgroups_fd, buf.data() + len, buf.size() - len);
+    if (nread < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    if (nread == 0) break;
+    len += nread;
   }
+
+  *cgroups = std::string_view(buf.data(), len);
   return true;
 }
 
 // GetContainerID retrieves the container ID of the process represented by dirfd. The container ID is extracted from
-// the cgroup.
-bool GetContainerID(int dirfd, std::string* container_id) {
-  FileHandle cgroups_file(FDHandle(openat(dirfd, "cgroup", O_RDONLY)), "r");
-  if (!cgroups_file.valid()) return false;
+// the cgroup. If cgroup_read is non-null, it is set to whether the cgroup file could be read, allowing the caller to
+// tell a non-container process apart from one that has disappeared.
+bool GetContainerID(int dirfd, std::string* container_id, bool* cgroup_read = nullptr) {
+  std::string_view cgroups;
+  bool read_ok = ReadCgroups(dirfd, &cgroups);
+  if (cgroup_read) *cgroup_read = read_ok;
+  if (!read_ok) return false;
+
+  return ContainerIDCache::Instance().Resolve(cgroups, container_id);
+}
 
-  thread_local char* linebuf;
-  thread_local size_t linebuf_cap;
+}  // namespace
 
-  ssize_t line_len;
-  while ((line_len = getline(&linebuf, &linebuf_cap, cgroups_file.get())) != -1) {
-    if (!line_len) continue;
-    if (linebuf[line_len - 1] == '\n') line_len--;
+// ParseContainerID extracts the container ID from the contents of a cgroup file. Returns false if none of the lines
+// contains a container ID.
+bool ParseContainerID(std::string_view cgroups, std::string* container_id) {
+  while (!cgroups.empty()) {
+    auto eol = cgroups.find('\n');
+    std::string_view line = cgroups.substr(0, eol);
+    cgroups.remove_prefix(eol == std::string_view::npos ? cgroups.size() : eol + 1);
 
-    std::string_view line(linebuf, line_len);
     auto short_container_id = ExtractContainerID(line);
     if (short_container_id.empty()) continue;
 
@@ -158,7 +270,9 @@ bool GetContainerID(int dirfd, std::string* container_id) {
   return false;
 }
 
-// Functions for parsing `net/tcp[6]` files
+// Functions for parsing the `net/tcp[6]` and `net/udp[6]` socket tables, which share the same format (up to the inode)
+
+namespace {
 
 // IsHexChar checks if the given character is an (uppercase) hexadecimal character.
 bool IsHexChar(char c) {
@@ -196,27 +310,6 @@ int ReadHexBytes(const char* p, const char* endp, void* buf, int chunk_size, int
   return i;
 }
 
-// ConnLineData is the interesting (for our purposes) subset of the data stored in a single (non-header) line of
-// `net/tcp[6]`.
-struct ConnLineData {
-  Endpoint local;
-  Endpoint remote;
-  uint8_t state;
-  ino_t inode;
-};
-
-struct ConnInfo {
-  Endpoint local;
-  Endpoint remote;
-  L4Proto l4proto;
-  bool is_server;
-};
-
-struct EndpointInfo {
-  Endpoint endpoint;
-  L4Proto l4proto;
-};
-
 // ParseEndpoint parses an endpoint listed in the `net/tcp[6]` file.
 const char* ParseEndpoint(const char* p, const char* endp, Address::Family family, Endpoint* endpoint) {
   static bool needs_byteorder_swap = (htons(42) != 42);
@@ -238,7 +331,129 @@ const char* ParseEndpoint(const char* p, const char* endp, Address::Family famil
   return p;
 }
 
-// ParseConnLine parses an entire line in the `net/tcp[6]` file.
+// SWAR ("SIMD within a register") helpers for the fast parser. All fixed-width fields in `net/tcp[6]` are printed by
+// the kernel as uppercase hexadecimal numbers (`%08X` for each 32-bit word of an address, `%04X` for ports), so we can
+// validate and decode 4 or 8 characters at a time with plain integer arithmetic, without branching on each character.
+
+// IsSpace is a locale-independent equivalent of std::isspace.
+inline bool IsSpace(char c) {
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+// LoadChars loads sizeof(W) characters starting at p into a word, such that the first character ends up in the least
+// significant byte regardless of the host byte order.
+template <typename W>
+inline W LoadChars(const char* p) {
+  W word;
+  std::memcpy(&word, p, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  if constexpr (sizeof(W) == 8) {
+    word = __builtin_bswap64(word);
+  } else {
+    word = __builtin_bswap32(word);
+  }
+#endif
+  return word;
+}
+
+// ByteMask returns the word with every byte set to b.
+template <typename W>
+constexpr W ByteMask(uint8_t b) {
+  return (~W(0) / 0xFF) * b;
+}
+
+// BytesAtLeast returns a word in which the high bit of each byte is set iff the corresponding byte of x is greater than
+// or equal to n. Requires all bytes of x to be ASCII characters (i.e., have their high bit unset).
+template <typename W>
+constexpr W BytesAtLeast(W x, uint8_t n) {
+  return ((x | ByteMask<W>(0x80)) - ByteMask<W>(n)) & ByteMask<W>(0x80);
+}
+
+// HexCharsToNibbles checks that each byte of chars is an uppercase hexadecimal character and, if so, replaces each of
+// them by its numeric value.
+template <typename W>
+inline bool HexCharsToNibbles(W chars, W* nibbles) {
+  if (chars & ByteMask<W>(0x80)) return false;
+
+  W digits = BytesAtLeast(chars, '0') & ~BytesAtLeast(chars, '9' + 1);
+  W letters = BytesAtLeast(chars, 'A') & ~BytesAtLeast(chars, 'F' + 1);
+  if ((digits | letters) != ByteMask<W>(0x80)) return false;
+
+  // '0'-'9' are 0x30-0x39, 'A'-'F' are 0x41-0x46. The low nibble is the value for digits, and needs an offset of 9 for
+  // letters, which are exactly the characters with bit 6 set.
+  *nibbles = (chars & ByteMask<W>(0x0F)) + ((chars >> 6) & ByteMask<W>(0x01)) * 9;
+  return true;
+}
+
+// DecodeHex32 decodes the 8 uppercase hexadecimal characters starting at p into a 32-bit number.
+inline bool DecodeHex32(const char* p, uint32_t* value) {
+  uint64_t nibbles;
+  if (!HexCharsToNibbles(LoadChars<uint64_t>(p), &nibbles)) return false;
+
+  // Combine adjacent nibbles into bytes, and then gather these bytes in the lower half of the word, preserving the
+  // order in which they were written.
+  uint64_t bytes = ((nibbles << 4) | (nibbles >> 8)) & 0x00FF00FF00FF00FFULL;
+  bytes = (bytes | (bytes >> 8)) & 0x0000FFFF0000FFFFULL;
+  bytes = (bytes | (bytes >> 16)) & 0x00000000FFFFFFFFULL;
+  // The most significant byte was written first.
+  *value = __builtin_bswap32(static_cast<uint32_t>(bytes));
+  return true;
+}
+
+// DecodeHex16 decodes the 4 uppercase hexadecimal characters starting at p into a 16-bit number.
+inline bool DecodeHex16(const char* p, uint16_t* value) {
+  uint32_t nibbles;
+  if (!HexCharsToNibbles(LoadChars<uint32_t>(p), &nibbles)) return false;
+
+  uint32_t bytes = ((nibbles << 4) | (nibbles >> 8)) & 0x00FF00FFU;
+  bytes = (bytes | (bytes >> 8)) & 0x0000FFFFU;
+  *value = __builtin_bswap16(static_cast<uint16_t>(bytes));
+  return true;
+}
+
+// SkipSpaces advances to the next non-space character, returning nullptr if the end of the line is reached.
+inline const char* SkipSpaces(const char* p, const char* endp) {
+  while (p < endp && IsSpace(*p)) p++;
+  return p < endp ? p : nullptr;
+}
+
+// SkipFields advances past n space-delimited fields (starting at the beginning of a field), returning a pointer to
+// the beginning of the next field, or nullptr if the end of the line is reached before that.
+inline const char* SkipFields(int n, const char* p, const char* endp) {
+  while (n-- > 0 && p) {
+    while (p < endp && !IsSpace(*p)) p++;
+    p = SkipSpaces(p, endp);
+  }
+  return p;
+}
+
+// ParseEndpointFast parses an endpoint listed in the `net/tcp[6]` file, assuming the fixed-width format used by the
+// kernel.
+const char* ParseEndpointFast(const char* p, const char* endp, Address::Family family, Endpoint* endpoint) {
+  int addr_len = Address::Length(family);
+  if (endp - p < addr_len * 2 + 5) return nullptr;
+
+  // Each 32-bit word of the address is printed as a number in host byte order, hence storing the decoded number
+  // yields the original network byte order representation.
+  std::array<uint8_t, Address::kMaxLen> addr_data = {};
+  for (int i = 0; i < addr_len; i += sizeof(uint32_t)) {
+    uint32_t word;
+    if (!DecodeHex32(p, &word)) return nullptr;
+    std::memcpy(addr_data.data() + i, &word, sizeof(word));
+    p += 2 * sizeof(uint32_t);
+  }
+  if (*p++ != ':') return nullptr;
+
+  uint16_t port;
+  if (!DecodeHex16(p, &port)) return nullptr;
+  p += 2 * sizeof(uint16_t);
+
+  *endpoint = Endpoint(Address(family, addr_data), port);
+  return p;
+}
+
+}  // namespace
+
 bool ParseConnLine(const char* p, const char* endp, Address::Family family, ConnLineData* data) {
   // Strip leading spaces.
   while (std::isspace(*p)) p++;
@@ -275,6 +490,162 @@ bool ParseConnLine(const char* p, const char* endp, Address::Family family, Conn
   return true;
 }
 
+bool ParseConnLineFast(const char* p, const char* endp, Address::Family family, ConnLineData* data) {
+  p = SkipSpaces(p, endp);
+  if (!p) return false;
+
+  // 0: sl (decimal, followed by a colon)
+  const char* sl_start = p;
+  while (p < endp && *p >= '0' && *p <= '9') p++;
+  if (p == sl_start || endp - p < 2 || *p++ != ':' || !IsSpace(*p)) return false;
+
+  p = SkipSpaces(p, endp);
+  if (!p) return false;
+  // 1: local_address
+  p = ParseEndpointFast(p, endp, family, &data->local);
+  if (!p || p == endp || !IsSpace(*p)) return false;
+
+  p = SkipSpaces(p, endp);
+  if (!p) return false;
+  // 2: rem_address
+  p = ParseEndpointFast(p, endp, family, &data->remote);
+  if (!p || p == endp || !IsSpace(*p)) return false;
+
+  p = SkipSpaces(p, endp);
+  if (!p || endp - p < 2) return false;
+  // 3: st
+  if (!IsHexChar(p[0]) || !IsHexChar(p[1])) return false;
+  data->state = HexCharToVal(p[0]) << 4 | HexCharToVal(p[1]);
+
+  // 4-8: tx_queue:rx_queue, tr:tm->when, retrnsmt, uid, timeout
+  p = SkipFields(6, p, endp);
+  if (!p) return false;
+  // 9: inode
+  uint64_t inode = 0;
+  const char* inode_start = p;
+  for (; p < endp && *p >= '0' && *p <= '9'; p++) {
+    inode = inode * 10 + (*p - '0');
+  }
+  // Reject anything that is not followed by a delimiter, as well as values too long to fit into 64 bits.
+  if (p == inode_start || p - inode_start > 19 || (p < endp && !IsSpace(*p))) return false;
+  data->inode = static_cast<ino_t>(inode);
+
+  return true;
+}
+
+namespace {
+
+// AllocationStats tracks the memory allocated through CountingAllocator.
+struct AllocationStats {
+  size_t current = 0;
+  size_t peak = 0;
+};
+
+// CountingAllocator is an std::allocator that records the number of bytes currently allocated, and their peak, in
+// AllocationStats. It is used for the data structures of a scrape, to report the memory they take up.
+template <typename T>
+class CountingAllocator {
+ public:
+  using value_type = T;
+
+  explicit CountingAllocator(AllocationStats* stats) : stats_(stats) {}
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U>& other) : stats_(other.stats()) {}
+
+  T* allocate(size_t n) {
+    stats_->current += n * sizeof(T);
+    stats_->peak = std::max(stats_->peak, stats_->current);
+    return std::allocator<T>().allocate(n);
+  }
+
+  void deallocate(T* p, size_t n) {
+    stats_->current -= n * sizeof(T);
+    std::allocator<T>().deallocate(p, n);
+  }
+
+  AllocationStats* stats() const { return stats_; }
+
+  template <typename U>
+  bool operator==(const CountingAllocator<U>& other) const { return stats_ == other.stats(); }
+  template <typename U>
+  bool operator!=(const CountingAllocator<U>& other) const { return stats_ != other.stats(); }
+
+ private:
+  AllocationStats* stats_;
+};
+
+template <typename K, typename V>
+using CountingMap = std::unordered_map<K, V, Hasher, std::equal_to<K>, CountingAllocator<std::pair<const K, V>>>;
+template <typename T>
+using CountingVector = std::vector<T, CountingAllocator<T>>;
+
+// SocketOwner identifies a container process holding a socket.
+struct SocketOwner {
+  // Index of the container ID in the interned container IDs of the scrape.
+  uint32_t container;
+  ino_t netns;
+  uint64_t pid;
+};
+
+// SocketOwnerIndex maps socket inodes to the container processes holding them. Almost all sockets are held by processes
+// of a single container, so a flat map stores the first owner of each socket, and owners in further containers are
+// kept in an overflow list. Only one owner per container is kept.
+class SocketOwnerIndex {
+ public:
+  explicit SocketOwnerIndex(AllocationStats* stats)
+      : owners_(0, Hasher(), std::equal_to<ino_t>(), CountingAllocator<std::pair<const ino_t, SocketOwner>>(stats)),
+        overflow_(CountingAllocator<std::pair<ino_t, SocketOwner>>(stats)) {}
+
+  void Add(ino_t inode, const SocketOwner& owner) {
+    auto emplace_res = owners_.emplace(inode, owner);
+    if (!emplace_res.second && emplace_res.first->second.container != owner.container) {
+      overflow_.emplace_back(inode, owner);
+    }
+  }
+
+  // Finalize must be called once all sockets have been added, and before calling ForEachOwner.
+  void Finalize() {
+    auto less = [](const std::pair<ino_t, SocketOwner>& a, const std::pair<ino_t, SocketOwner>& b) {
+      return std::tie(a.first, a.second.container) < std::tie(b.first, b.second.container);
+    };
+    auto same_container = [](const std::pair<ino_t, SocketOwner>& a, const std::pair<ino_t, SocketOwner>& b) {
+      return a.first == b.first && a.second.container == b.second.container;
+    };
+    std::sort(overflow_.begin(), overflow_.end(), less);
+    overflow_.erase(std::unique(overflow_.begin(), overflow_.end(), same_container), overflow_.end());
+  }
+
+  // ForEachOwner calls fn for every owner of the socket with the given inode that is in the given network namespace.
+  template <typename F>
+  void ForEachOwner(ino_t inode, ino_t netns, F fn) const {
+    auto it = owners_.find(inode);
+    if (it == owners_.end()) return;
+    if (it->second.netns == netns) fn(it->second);
+
+    if (overflow_.empty()) return;
+    auto overflow_it = std::lower_bound(overflow_.begin(), overflow_.end(), inode,
+                                        [](const std::pair<ino_t, SocketOwner>& entry, ino_t inode) { return entry.first < inode; });
+    for (; overflow_it != overflow_.end() && overflow_it->first == inode; ++overflow_it) {
+      if (overflow_it->second.netns == netns) fn(overflow_it->second);
+    }
+  }
+
+ private:
+  CountingMap<ino_t, SocketOwner> owners_;
+  CountingVector<std::pair<ino_t, SocketOwner>> overflow_;
+};
+
+// NetNSInfo holds what is known about a network namespace during a scrape.
+struct NetNSInfo {
+  explicit NetNSInfo(AllocationStats* stats) : socket_pids(CountingAllocator<uint64_t>(stats)) {}
+
+  // Number of sockets in use in the network namespace, as reported by `net/sockstat`.
+  uint64_t sockstat_sockets = 0;
+  // Container processes in the network namespace that hold sockets, any of which can be used to read its socket
+  // tables.
+  CountingVector<uint64_t> socket_pids;
+};
+
 // LocalIsServer returns true if the connection between local and remote looks like the local end is the server (taking
 // the set of listening endpoints into account), and false otherwise.
 bool LocalIsServer(const Endpoint& local, const Endpoint& remote, const UnorderedSet<Endpoint>& listen_endpoints) {
@@ -290,187 +661,450 @@ bool LocalIsServer(const Endpoint& local, const Endpoint& remote, const Unordere
   return IsEphemeralPort(remote.port()) > IsEphemeralPort(local.port());
 }
 
-// ReadConnectionsFromFile reads all connections from a `net/tcp[6]` file and stores them by inode in the given map.
-bool ReadConnectionsFromFile(Address::Family family, L4Proto l4proto, std::FILE* f,
-                             UnorderedMap<ino_t, ConnInfo>* connections, UnorderedMap<ino_t, EndpointInfo>* listen_endpoints) {
-  char line[512];
+// ReadFileContents reads the entire contents of the file referred to by fd into buf, growing it as needed, and stores
+// the number of bytes read in size. Reading a socket table in few large chunks instead of line by line greatly
+// reduces the number of syscalls for large tables, as procfs returns at most one page per read.
+bool ReadFileContents(int fd, std::vector<char>* buf, size_t* size) {
+  static constexpr size_t kInitialSize = 64 * 1024;
+  if (buf->size() < kInitialSize) buf->resize(kInitialSize);
+
+  size_t total = 0;
+  for (;;) {
+    if (total == buf->size()) buf->resize(2 * buf->size());
+    ssize_t nread = read(fd, buf->data() + total, buf->size() - total);
+    if (nread < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    if (nread == 0) break;
+    total += nread;
+  }
+  *size = total;
+  return true;
+}
+
+// SocketResolver turns the entries of the socket tables of a network namespace into connections and listen endpoints
+// of the containers whose processes hold the respective sockets.
+struct SocketResolver {
+  const SocketOwnerIndex& owners;
+  const CountingVector<std::string>& container_ids;
+  std::shared_ptr<ProcessStore> process_store;
+  std::vector<Connection>* connections;
+  std::vector<ContainerEndpoint>* listen_endpoints;
+};
+
+// SocketTable describes one of the socket tables of a network namespace, and which of its entries correspond to listen
+// sockets and to connections.
+struct SocketTable {
+  const char* path;
+  Address::Family family;
+  L4Proto l4proto;
+  // State of listen sockets. For UDP, these are sockets that are bound but not connected.
+  uint8_t listen_state;
+  // State of connections. For UDP, these are connected sockets.
+  uint8_t connection_state;
+  // Whether listen sockets on ephemeral ports are ignored. A UDP socket is implicitly bound to an ephemeral port when a
+  // datagram is sent through it without binding it first, which is common for clients.
+  bool ignore_ephemeral_listen;
+};
+
+const SocketTable kSocketTables[] = {
+    {"net/tcp", Address::Family::IPV4, L4Proto::TCP, TCP_LISTEN, TCP_ESTABLISHED, false},
+    {"net/tcp6", Address::Family::IPV6, L4Proto::TCP, TCP_LISTEN, TCP_ESTABLISHED, false},
+    {"net/udp", Address::Family::IPV4, L4Proto::UDP, TCP_CLOSE, TCP_ESTABLISHED, true},
+    {"net/udp6", Address::Family::IPV6, L4Proto::UDP, TCP_CLOSE, TCP_ESTABLISHED, true},
+};
+
+// ReadConnectionsFromFile reads all connections and listen sockets from the given socket table of the network namespace
+// netns, and resolves them to the containers holding the respective sockets.
+bool ReadConnectionsFromFile(const SocketTable& table, int fd, ino_t netns, const SocketResolver& resolver) {
+  thread_local std::vector<char> buf;
+  thread_local std::vector<ConnLineData> connection_lines;
+
+  size_t size;
+  if (!ReadFileContents(fd, &buf, &size)) return false;
 
-  if (!std::fgets(line, sizeof(line), f)) return false;  // ignore the first *header) line.
+  const char* p = buf.data();
+  const char* endp = p + size;
+  auto eol = static_cast<const char*>(std::memchr(p, '\n', endp - p));
+  if (!eol) return false;  // ignore the first (header) line.
 
   UnorderedSet<Endpoint> all_listen_endpoints;
+  connection_lines.clear();
+
+  for (p = eol + 1; p < endp; p = eol + 1) {
+    eol = static_cast<const char*>(std::memchr(p, '\n', endp - p));
+    if (!eol) eol = endp;
 
-  while (std::fgets(line, sizeof(line), f)) {
     ConnLineData data;
-    if (!ParseConnLine(line, line + sizeof(line), family, &data)) continue;
-    if (data.state == TCP_LISTEN) {  // listen socket
+    if (!ParseConnLineFast(p, eol, table.family, &data)) continue;
+    if (data.state == table.listen_state) {  // listen socket
+      if (table.ignore_ephemeral_listen && IsEphemeralPort(data.local.port()) >= 3) continue;
       all_listen_endpoints.insert(data.local);
-      if (data.inode && listen_endpoints) {
-        auto& endpoint_info = (*listen_endpoints)[data.inode];
-        endpoint_info.endpoint = data.local;
-        endpoint_info.l4proto = l4proto;
-      }
+      if (!data.inode || !resolver.listen_endpoints || !IsRelevantEndpoint(data.local)) continue;
+
+      resolver.owners.ForEachOwner(data.inode, netns, [&](const SocketOwner& owner) {
+        std::shared_ptr<IProcess> process;
+        if (resolver.process_store) {
+          process = resolver.process_store->Fetch(owner.pid);
+        }
+        resolver.listen_endpoints->emplace_back(resolver.container_ids[owner.container], data.local, table.l4proto, process);
+      });
       continue;
     }
-    if (data.state != TCP_ESTABLISHED) {
+    if (data.state != table.connection_state) {
       continue;
     }
 
     if (!data.inode) continue;  // socket was closed or otherwise unavailable
-    auto& conn_info = (*connections)[data.inode];
-    conn_info.local = data.local;
-    conn_info.remote = data.remote;
-    conn_info.l4proto = l4proto;
-    // Note that the layout of net/tcp guarantees that all listen sockets will be listed before all active or closed
-    // connections, hence we can assume listen_endpoint to have its final value at this point.
-    conn_info.is_server = LocalIsServer(data.local, data.remote, all_listen_endpoints);
+    connection_lines.push_back(data);
+  }
+
+  // Connections are resolved once all listen sockets are known. `net/tcp[6]` lists all listen sockets first, but the
+  // entries of `net/udp[6]` are ordered by port.
+  for (const auto& data : connection_lines) {
+    resolver.owners.ForEachOwner(data.inode, netns, [&](const SocketOwner& owner) {
+      Connection connection(resolver.container_ids[owner.container], data.local, data.remote, table.l4proto,
+                            LocalIsServer(data.local, data.remote, all_listen_endpoints));
+      if (!IsRelevantConnection(connection)) return;
+      resolver.connections->push_back(std::move(connection));
+    });
   }
 
   return true;
 }
 
-// GetConnections reads all active connections (inode -> connection info mapping) for a given network NS, addressed by
-// the dir FD for a proc entry of a process in that network namespace.
-bool GetConnections(int dirfd, UnorderedMap<ino_t, ConnInfo>* connections, UnorderedMap<ino_t, EndpointInfo>* listen_endpoints) {
+// GetConnections reads all active connections and listen sockets of a given network NS from each of its socket tables,
+// addressed by the dir FD for a proc entry of a process in that network namespace, and resolves them to containers.
+bool GetConnections(int dirfd, ino_t netns, const SocketResolver& resolver) {
   bool success = true;
-  {
-    FDHandle net_tcp_fd = openat(dirfd, "net/tcp", O_RDONLY);
-    if (net_tcp_fd.valid()) {
-      FileHandle net_tcp(std::move(net_tcp_fd), "r");
-      success = ReadConnectionsFromFile(Address::Family::IPV4, L4Proto::TCP, net_tcp, connections, listen_endpoints) && success;
+  for (const auto& table : kSocketTables) {
+    FDHandle table_fd = openat(dirfd, table.path, O_RDONLY);
+    if (table_fd.valid()) {
+      success = ReadConnectionsFromFile(table, table_fd, netns, resolver) && success;
     } else {
-      success = false;  // there should always be a net/tcp file
+      success = false;  // all socket tables should always be there
     }
   }
 
-  {
-    FDHandle net_tcp6_fd = openat(dirfd, "net/tcp6", O_RDONLY);
-    if (net_tcp6_fd.valid()) {
-      FileHandle net_tcp6(std::move(net_tcp6_fd), "r");
-      success = ReadConnectionsFromFile(Address::Family::IPV6, L4Proto::TCP, net_tcp6, connections, listen_endpoints) && success;
-    } else {
-      success = false;
-    }
+  return success;
+}
+
+// ReadProcessMetadata reads the container ID and network namespace of the process represented by dirfd, and stores
+// them in metadata_cache. If cgroups is non-null, it holds the already read contents of the process' cgroup file. The
+// returned entry is null if the information could not be determined.
+ProcessMetadataCache::Entry* ReadProcessMetadata(int dirfd, uint64_t pid, uint64_t start_time, const std::string_view* cgroups,
+                                                 ProcessMetadataCache* metadata_cache) {
+  ProcessMetadataCache::Entry entry;
+  entry.start_time = start_time;
+
+  bool cgroup_read = true;
+  entry.is_container = cgroups ? ContainerIDCache::Instance().Resolve(*cgroups, &entry.container_id)
+                               : GetContainerID(dirfd, &entry.container_id, &cgroup_read);
+  if (!cgroup_read) {
+    return nullptr;  // do not cache a verdict for a process we could not inspect
   }
 
-  return success;
+  if (entry.is_container && !GetNetworkNamespace(dirfd, &entry.netns_inode)) {
+    // TODO ROX-13962: Improve logging to indicate when a process is defunct.
+    COUNTER_INC(CollectorStats::procfs_could_not_get_network_namespace);
+    CLOG_THROTTLED(ERROR, std::chrono::seconds(10)) << "Could not determine network namespace: " << StrError();
+    return nullptr;
+  }
+
+  return metadata_cache->Insert(pid, std::move(entry));
 }
 
-struct NSNetworkData {
-  UnorderedMap<ino_t, ConnInfo> connections;
-  UnorderedMap<ino_t, EndpointInfo> listen_endpoints;
+}  // namespace
+
+// ConnScrapeSweep holds the state of a sweep over all processes in a `/proc`-like directory. The open directory stream
+// serves as the cursor, which allows spreading a sweep over several calls.
+//
+// While visiting the processes, the sweep only collects the network namespaces along with their member processes, and
+// the sockets held by each container process. The socket tables of each network namespace are read exactly once when
+// the sweep is finished, and their entries are resolved to containers through the socket owner index.
+struct ConnScrapeSweep {
+  ConnScrapeSweep(const char* proc_path, bool read_listen_endpoints, IoUring* io_uring)
+      : procdir(opendir(proc_path)),
+        read_listen_endpoints(read_listen_endpoints),
+        io_uring(io_uring),
+        container_ids(CountingAllocator<std::string>(&alloc_stats)),
+        container_index(0, Hasher(), std::equal_to<std::string>(), CountingAllocator<std::pair<const std::string, uint32_t>>(&alloc_stats)),
+        netns_infos(0, Hasher(), std::equal_to<ino_t>(), CountingAllocator<std::pair<const ino_t, NetNSInfo>>(&alloc_stats)),
+        socket_owners(&alloc_stats) {}
+
+  // InternContainerID returns the index of the given container ID in container_ids, adding it if necessary.
+  uint32_t InternContainerID(const std::string& container_id) {
+    auto emplace_res = container_index.emplace(container_id, container_ids.size());
+    if (emplace_res.second) container_ids.push_back(container_id);
+    return emplace_res.first->second;
+  }
+
+  DirHandle procdir;
+  bool read_listen_endpoints;
+  // If non-null, processes are scraped in batches, with their files being read through io_uring.
+  IoUring* io_uring;
+
+  // Memory allocated for the data structures below, which have to be declared after it as they refer to it.
+  AllocationStats alloc_stats;
+  CountingVector<std::string> container_ids;
+  CountingMap<std::string, uint32_t> container_index;
+  CountingMap<ino_t, NetNSInfo> netns_infos;
+  SocketOwnerIndex socket_owners;
 };
 
-// netns -> (inode -> connection info) mapping
-using ConnsByNS = UnorderedMap<ino_t, NSNetworkData>;
-// container id -> (netns -> socket) mapping
-using SocketsByContainer = UnorderedMap<std::string, UnorderedMap<ino_t, UnorderedSet<SocketInfo>>>;
-
-// ResolveSocketInodes takes a netns -> (inode -> connection info) mapping and a
-// container id -> (netns -> socket) mapping, and synthesizes this to a list of (container id, connection info)
-// tuples.
-void ResolveSocketInodes(const SocketsByContainer& sockets_by_container, const ConnsByNS& conns_by_ns,
-                         std::shared_ptr<ProcessStore> process_store,
-                         std::vector<Connection>* connections, std::vector<ContainerEndpoint>* listen_endpoints) {
-  for (const auto& container_sockets : sockets_by_container) {
-    const auto& container_id = container_sockets.first;
-    for (const auto& netns_sockets : container_sockets.second) {
-      const auto* ns_network_data = Lookup(conns_by_ns, netns_sockets.first);
-      if (!ns_network_data) continue;
-      for (const auto& socket : netns_sockets.second) {
-        if (const auto* conn = Lookup(ns_network_data->connections, socket.inode())) {
-          Connection connection(container_id, conn->local, conn->remote, conn->l4proto, conn->is_server);
-          if (!IsRelevantConnection(connection)) continue;
-          connections->push_back(std::move(connection));
-        } else if (listen_endpoints) {
-          if (const auto* ep = Lookup(ns_network_data->listen_endpoints, socket.inode())) {
-            if (!IsRelevantEndpoint(ep->endpoint)) continue;
-
-            std::shared_ptr<IProcess> process;
-
-            if (process_store) {
-              process = process_store->Fetch(socket.pid());
-            }
-
-            listen_endpoints->emplace_back(container_id, ep->endpoint, ep->l4proto, process);
-          }
-        }
+namespace {
+
+// BeginSweep starts a sweep over all processes in the `/proc`-like directory opened by the sweep.
+bool BeginSweep(const char* proc_path, ProcessMetadataCache* metadata_cache, ConnScrapeSweep* sweep) {
+  if (!sweep->procdir.valid()) {
+    COUNTER_INC(CollectorStats::procfs_could_not_open_proc_dir);
+    CLOG_THROTTLED(ERROR, std::chrono::seconds(10)) << "Could not open " << proc_path << ": " << StrError();
+    return false;
+  }
+
+  metadata_cache->BeginScrape();
+  return true;
+}
+
+// ScrapeProcess records the network namespace of the process with the given `/proc` entry and, if it runs in a
+// container, the sockets it holds. metadata is the cached entry for the process, if any, and cgroups the contents of
+// its cgroup file, if they have already been read.
+void ScrapeProcess(const char* name, uint64_t pid, uint64_t start_time, ProcessMetadataCache::Entry* metadata,
+                   const std::string_view* cgroups, ProcessMetadataCache* metadata_cache, ConnScrapeSweep* sweep) {
+  if (metadata && !metadata->is_container) return;
+
+  FDHandle dirfd = sweep->procdir.openat(name, O_RDONLY);
+  if (!dirfd.valid()) {
+    COUNTER_INC(CollectorStats::procfs_could_not_open_pid_dir);
+    CLOG(DEBUG) << "Could not open process directory " << name << ": " << StrError();
+    return;
+  }
+
+  if (!metadata) {
+    metadata = ReadProcessMetadata(dirfd, pid, start_time, cgroups, metadata_cache);
+    if (!metadata || !metadata->is_container) return;
+  }
+
+  ino_t netns_inode = metadata->netns_inode;
+  auto netns_it = sweep->netns_infos.find(netns_inode);
+  if (netns_it == sweep->netns_infos.end()) {
+    netns_it = sweep->netns_infos.emplace(netns_inode, NetNSInfo(&sweep->alloc_stats)).first;
+    netns_it->second.sockstat_sockets = ReadNetNSSocketCount(dirfd);
+  }
+  NetNSInfo& netns_info = netns_it->second;
+
+  if (!GetSocketINodes(dirfd, netns_info.sockstat_sockets, metadata_cache->generation(), &metadata->fd_table)) {
+    COUNTER_INC(CollectorStats::procfs_could_not_get_socket_inodes);
+    CLOG_THROTTLED(ERROR, std::chrono::seconds(10)) << "Could not obtain socket inodes: " << StrError();
+    return;
+  }
+
+  const auto& socket_inodes = metadata->fd_table.socket_inodes;
+  if (socket_inodes.empty()) return;
+
+  SocketOwner owner{sweep->InternContainerID(metadata->container_id), netns_inode, pid};
+  for (ino_t inode : socket_inodes) {
+    sweep->socket_owners.Add(inode, owner);
+  }
+  netns_info.socket_pids.push_back(pid);
+}
+
+// ReadNetNSConnections reads the socket tables of every network namespace in which container processes hold sockets,
+// through the first of these processes that is still alive and in the same network namespace, and resolves them.
+void ReadNetNSConnections(ConnScrapeSweep* sweep, const SocketResolver& resolver) {
+  for (const auto& netns_entry : sweep->netns_infos) {
+    ino_t netns_inode = netns_entry.first;
+
+    for (uint64_t pid : netns_entry.second.socket_pids) {
+      char name[32];
+      snprintf(name, sizeof(name), "%" PRIu64, pid);
+      FDHandle dirfd = sweep->procdir.openat(name, O_RDONLY);
+
+      // Make sure the pid has not been reused by a process in another network namespace since it was visited.
+      ino_t current_netns_inode;
+      if (!dirfd.valid() || !GetNetworkNamespace(dirfd, &current_netns_inode) || current_netns_inode != netns_inode) {
+        continue;
+      }
+
+      size_t num_connections = resolver.connections->size();
+      size_t num_listen_endpoints = resolver.listen_endpoints ? resolver.listen_endpoints->size() : 0;
+      if (GetConnections(dirfd, netns_inode, resolver)) break;
+
+      // If there was an error reading connections, that could be due to a number of reasons.
+      // We need to differentiate persistent errors (e.g., expected net/tcp6 file not found)
+      // from spurious/race condition errors caused by the process disappearing while reading
+      // the directory. To determine if the latter is the root cause, we reattempt to read the
+      // network namespace inode; if that succeeds, we assume that the process is still alive
+      // and any errors encountered are persistent. Otherwise, we discard what has been read
+      // and try the next process.
+      if (GetNetworkNamespace(dirfd, &current_netns_inode) && current_netns_inode == netns_inode) break;
+
+      resolver.connections->erase(resolver.connections->begin() + num_connections, resolver.connections->end());
+      if (resolver.listen_endpoints) {
+        resolver.listen_endpoints->erase(resolver.listen_endpoints->begin() + num_listen_endpoints, resolver.listen_endpoints->end());
       }
     }
   }
 }
 
-// ReadContainerConnections reads all container connection info from the given `/proc`-like directory. All connections
-// from non-container processes are ignored.
-// process_store, when provided, is used to to link the originator process of a ContainerEndpoint.
-bool ReadContainerConnections(const char* proc_path, std::shared_ptr<ProcessStore> process_store,
-                              std::vector<Connection>* connections, std::vector<ContainerEndpoint>* listen_endpoints) {
-  DirHandle procdir = opendir(proc_path);
-  if (!procdir.valid()) {
-    COUNTER_INC(CollectorStats::procfs_could_not_open_proc_dir);
-    CLOG_THROTTLED(ERROR, std::chrono::seconds(10)) << "Could not open " << proc_path << ": " << StrError();
-    return false;
+// VisitProcess scrapes the process with the given `/proc` entry.
+void VisitProcess(const char* name, ProcessMetadataCache* metadata_cache, ConnScrapeSweep* sweep) {
+  long long pid = strtoll(name, 0, 10);
+
+  // Reading the start time is all it takes to recognize a process we have already seen. Non-container processes
+  // are thus skipped without opening their directory.
+  char stat_path[sizeof(dirent::d_name) + StrLen("/stat")];
+  snprintf(stat_path, sizeof(stat_path), "%s/stat", name);
+  uint64_t start_time;
+  if (!ReadStartTime(sweep->procdir.fd(), stat_path, &start_time)) return;  // process is gone
+
+  auto* metadata = metadata_cache->Lookup(pid, start_time);
+  ScrapeProcess(name, pid, start_time, metadata, nullptr, metadata_cache, sweep);
+}
+
+// Number of processes visited together when scraping through io_uring. The cgroup file of each process is read into a
+// buffer of kCgroupBufSize, larger files are read synchronously.
+constexpr size_t kProcessBatchSize = 64;
+
+// VisitProcessBatch is equivalent to calling VisitProcess for each of the given `/proc` entries, but reads the `stat`
+// files of all processes, and the cgroup files of those not in the metadata cache, with one io_uring submission each.
+void VisitProcessBatch(const std::vector<std::string>& names, ProcessMetadataCache* metadata_cache, ConnScrapeSweep* sweep) {
+  thread_local std::vector<std::string> paths;
+  thread_local std::vector<char> bufs;
+  thread_local std::vector<IoUring::ReadRequest> requests;
+  thread_local std::vector<size_t> request_index;
+
+  const size_t num_procs = names.size();
+  bufs.resize(num_procs * kCgroupBufSize);
+  paths.resize(num_procs);
+  requests.resize(num_procs);
+  for (size_t i = 0; i < num_procs; i++) {
+    paths[i] = names[i] + "/stat";
+    requests[i] = {sweep->procdir.fd(), paths[i].c_str(), &bufs[i * kCgroupBufSize], kStatBufSize - 1, 0};
   }
 
-  ConnsByNS conns_by_ns;
-  SocketsByContainer sockets_by_container_and_ns;
+  if (!sweep->io_uring->ReadFiles(requests.data(), num_procs)) {
+    for (const auto& name : names) VisitProcess(name.c_str(), metadata_cache, sweep);
+    return;
+  }
 
-  // Read all the information from proc.
-  while (auto curr = procdir.read()) {
-    if (!std::isdigit(curr->d_name[0])) continue;  // only look for <pid> entries
-    long long pid = strtoll(curr->d_name, 0, 10);
+  struct ProcEntry {
+    uint64_t pid;
+    uint64_t start_time;
+    ProcessMetadataCache::Entry* metadata;
+    ssize_t cgroups_size;
+  };
+  thread_local std::vector<ProcEntry> procs;
+  procs.assign(num_procs, ProcEntry{0, 0, nullptr, -1});
+
+  // Look up all processes, and collect the cgroup files of those we have not seen before.
+  request_index.clear();
+  for (size_t i = 0; i < num_procs; i++) {
+    auto& proc = procs[i];
+    char* buf = &bufs[i * kCgroupBufSize];
+    if (requests[i].result <= 0) continue;  // process is gone
+    buf[requests[i].result] = '\0';
+    if (!ParseStartTime(buf, requests[i].result, &proc.start_time)) continue;
+
+    proc.pid = strtoll(names[i].c_str(), 0, 10);
+    proc.metadata = metadata_cache->Lookup(proc.pid, proc.start_time);
+    if (proc.metadata) continue;
+
+    paths[i] = names[i] + "/cgroup";
+    requests[request_index.size()] = {sweep->procdir.fd(), paths[i].c_str(), buf, kCgroupBufSize, 0};
+    request_index.push_back(i);
+  }
 
-    FDHandle dirfd = procdir.openat(curr->d_name, O_RDONLY);
-    if (!dirfd.valid()) {
-      COUNTER_INC(CollectorStats::procfs_could_not_open_pid_dir);
-      CLOG(DEBUG) << "Could not open process directory " << curr->d_name << ": " << StrError();
+  if (sweep->io_uring->ReadFiles(requests.data(), request_index.size())) {
+    for (size_t j = 0; j < request_index.size(); j++) {
+      procs[request_index[j]].cgroups_size = requests[j].result;
+    }
+  }
+
+  for (size_t i = 0; i < num_procs; i++) {
+    auto& proc = procs[i];
+    if (!proc.start_time) continue;
+
+    // A cgroup file that filled the entire buffer might have been truncated, so it is read again synchronously.
+    if (proc.metadata || proc.cgroups_size < 0 || proc.cgroups_size >= static_cast<ssize_t>(kCgroupBufSize)) {
+      ScrapeProcess(names[i].c_str(), proc.pid, proc.start_time, proc.metadata, nullptr, metadata_cache, sweep);
       continue;
     }
 
+    std::string_view cgroups(&bufs[i * kCgroupBufSize], proc.cgroups_size);
     std::string container_id;
-    if (!GetContainerID(dirfd, &container_id)) continue;
-
-    uint64_t netns_inode;
-    if (!GetNetworkNamespace(dirfd, &netns_inode)) {
-      // TODO ROX-13962: Improve logging to indicate when a process is defunct.
-      COUNTER_INC(CollectorStats::procfs_could_not_get_network_namespace);
-      CLOG_THROTTLED(ERROR, std::chrono::seconds(10)) << "Could not determine network namespace: " << StrError();
+    if (!ContainerIDCache::Instance().Resolve(cgroups, &container_id)) {
+      // Non-container processes are cached without opening their directory.
+      ProcessMetadataCache::Entry entry;
+      entry.start_time = proc.start_time;
+      metadata_cache->Insert(proc.pid, std::move(entry));
       continue;
     }
 
-    auto& container_ns_sockets = sockets_by_container_and_ns[container_id][netns_inode];
-    bool no_sockets = container_ns_sockets.empty();
+    ScrapeProcess(names[i].c_str(), proc.pid, proc.start_time, nullptr, &cgroups, metadata_cache, sweep);
+  }
+}
 
-    if (!GetSocketINodes(dirfd, pid, &container_ns_sockets)) {
-      COUNTER_INC(CollectorStats::procfs_could_not_get_socket_inodes);
-      CLOG_THROTTLED(ERROR, std::chrono::seconds(10)) << "Could not obtain socket inodes: " << StrError();
-      continue;
+// ContinueSweep scrapes the remaining processes of the sweep, and returns true once all of them have been visited. If
+// cpu_deadline_micros is non-zero, it returns false as soon as the CPU time of the calling thread (as returned by
+// ThreadCPUTimeMicros) reaches it.
+bool ContinueSweep(ConnScrapeSweep* sweep, ProcessMetadataCache* metadata_cache, int64_t cpu_deadline_micros) {
+  if (!sweep->io_uring || !sweep->io_uring->usable()) {
+    while (auto curr = sweep->procdir.read()) {
+      if (!std::isdigit(curr->d_name[0])) continue;  // only look for <pid> entries
+
+      VisitProcess(curr->d_name, metadata_cache, sweep);
+
+      if (cpu_deadline_micros && ThreadCPUTimeMicros() >= cpu_deadline_micros) return false;
     }
+    return true;
+  }
 
-    if (no_sockets && !container_ns_sockets.empty()) {
-      // These are the first sockets for this (container, netns) pair. Make sure we actually have the information about
-      // connections in this network namespace.
-      auto emplace_res = conns_by_ns.emplace(netns_inode, NSNetworkData());
-      if (emplace_res.second) {
-        auto& ns_network_data = emplace_res.first->second;
-
-        if (!GetConnections(dirfd, &ns_network_data.connections, listen_endpoints ? &ns_network_data.listen_endpoints : nullptr)) {
-          // If there was an error reading connections, that could be due to a number of reasons.
-          // We need to differentiate persistent errors (e.g., expected net/tcp6 file not found)
-          // from spurious/race condition errors caused by the process disappearing while reading
-          // the directory. To determine if the latter is the root cause, we reattempt to read the
-          // network namespace inode; if that succeeds, we assume that the process is still alive
-          // and any errors encountered are persistent.
-          uint64_t netns_inode2;
-          if (!GetNetworkNamespace(dirfd, &netns_inode2) || netns_inode2 != netns_inode) {
-            conns_by_ns.erase(emplace_res.first);
-            continue;
-          }
-        }
-      }
+  thread_local std::vector<std::string> names;
+  for (;;) {
+    names.clear();
+    while (names.size() < kProcessBatchSize) {
+      auto curr = sweep->procdir.read();
+      if (!curr) break;
+      if (!std::isdigit(curr->d_name[0])) continue;  // only look for <pid> entries
+      names.emplace_back(curr->d_name);
     }
+    if (names.empty()) return true;
+
+    VisitProcessBatch(names, metadata_cache, sweep);
+
+    if (cpu_deadline_micros && ThreadCPUTimeMicros() >= cpu_deadline_micros) return false;
   }
+}
+
+// FinishSweep reads the socket tables of the network namespaces found during a sweep, and synthesizes them into a list of
+// connections and listen endpoints.
+void FinishSweep(ConnScrapeSweep* sweep, std::shared_ptr<ProcessStore> process_store, ProcessMetadataCache* metadata_cache,
+                 std::vector<Connection>* connections, std::vector<ContainerEndpoint>* listen_endpoints) {
+  COUNTER_ADD(CollectorStats::procfs_metadata_cache_evictions, metadata_cache->EvictStale());
+
+  sweep->socket_owners.Finalize();
+  SocketResolver resolver{sweep->socket_owners, sweep->container_ids, std::move(process_store), connections,
+                          sweep->read_listen_endpoints ? listen_endpoints : nullptr};
+  ReadNetNSConnections(sweep, resolver);
 
-  ResolveSocketInodes(sockets_by_container_and_ns, conns_by_ns, process_store, connections, listen_endpoints);
+  COUNTER_SET(CollectorStats::procfs_scrape_peak_alloc_bytes, sweep->alloc_stats.peak);
+}
+
+// ReadContainerConnections reads all container connection info from the given `/proc`-like directory. All connections
+// from non-container processes are ignored.
+// process_store, when provided, is used to to link the originator process of a ContainerEndpoint.
+// metadata_cache is used to avoid re-reading immutable per-process information on every scrape.
+// io_uring, when provided, is used to batch the reads from `/proc`.
+bool ReadContainerConnections(const char* proc_path, std::shared_ptr<ProcessStore> process_store,
+                              ProcessMetadataCache* metadata_cache, IoUring* io_uring,
+                              std::vector<Connection>* connections, std::vector<ContainerEndpoint>* listen_endpoints) {
+  ConnScrapeSweep sweep(proc_path, listen_endpoints != nullptr, io_uring);
+  if (!BeginSweep(proc_path, metadata_cache, &sweep)) return false;
+
+  ContinueSweep(&sweep, metadata_cache, 0);
+  FinishSweep(&sweep, process_store, metadata_cache, connections, listen_endpoints);
   return true;
 }
 
@@ -544,12 +1178,137 @@ std::string_view ExtractContainerID(std::string_view cgroup_line) {
   if (container_id_part[0] != '/' && container_id_part[0] != '-') return {};
   container_id_part.remove_prefix(1);
 
-  if (!IsContainerID(container_id_part)) return {};
+  if (!IsContainerIDFast(container_id_part)) return {};
   return container_id_part.substr(0, 12);
 }
 
+bool IsContainerID(std::string_view str) {
+  if (str.size() != 64) return false;
+  for (auto c : str) {
+    if (!std::isdigit(c) && (c < 'a' || c > 'f')) return false;
+  }
+  return true;
+}
+
+bool IsContainerIDFast(std::string_view str) {
+  if (str.size() != 64) return false;
+
+  // Any character outside of '0'-'9' and 'a'-'f' (including non-ASCII ones, for which the range checks are meaningless)
+  // leaves a high bit set in invalid.
+  uint64_t invalid = 0;
+  for (size_t i = 0; i < 64; i += sizeof(uint64_t)) {
+    auto chars = LoadChars<uint64_t>(str.data() + i);
+    uint64_t digits = BytesAtLeast(chars, '0') & ~BytesAtLeast(chars, '9' + 1);
+    uint64_t letters = BytesAtLeast(chars, 'a') & ~BytesAtLeast(chars, 'f' + 1);
+    invalid |= chars | ((digits | letters) ^ ByteMask<uint64_t>(0x80));
+  }
+  return !(invalid & ByteMask<uint64_t>(0x80));
+}
+
+bool ContainerIDCache::Resolve(std::string_view cgroups, std::string* container_id) {
+  if (!cgroups.empty() && cgroups.back() == '\n') cgroups.remove_suffix(1);
+  if (cgroups.substr(0, 3) != "0::" || cgroups.find('\n') != std::string_view::npos) {
+    return ParseContainerID(cgroups, container_id);
+  }
+
+  // The path is copied into a buffer owned by the calling thread, such that looking up a cached cgroup does not
+  // allocate.
+  thread_local std::string cgroup_path;
+  cgroup_path.assign(cgroups.substr(3));
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = container_ids_.find(cgroup_path);
+  if (it != container_ids_.end()) {
+    COUNTER_INC(CollectorStats::procfs_container_id_cache_hits);
+  } else {
+    COUNTER_INC(CollectorStats::procfs_container_id_cache_misses);
+    if (container_ids_.size() >= kMaxEntries) container_ids_.clear();
+    it = container_ids_.emplace(cgroup_path, std::string(ExtractContainerID(cgroups))).first;
+  }
+
+  if (it->second.empty()) return false;
+  *container_id = it->second;
+  return true;
+}
+
+size_t ContainerIDCache::size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return container_ids_.size();
+}
+
+void ContainerIDCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  container_ids_.clear();
+}
+
+ProcessMetadataCache::Entry* ProcessMetadataCache::Lookup(uint64_t pid, uint64_t start_time) {
+  auto it = entries_.find(pid);
+  if (it == entries_.end() || it->second.start_time != start_time) {
+    COUNTER_INC(CollectorStats::procfs_metadata_cache_misses);
+    return nullptr;
+  }
+
+  COUNTER_INC(CollectorStats::procfs_metadata_cache_hits);
+  it->second.generation = generation_;
+  return &it->second;
+}
+
+ProcessMetadataCache::Entry* ProcessMetadataCache::Insert(uint64_t pid, Entry entry) {
+  entry.generation = generation_;
+  auto& cached = entries_[pid];
+  cached = std::move(entry);
+  return &cached;
+}
+
+size_t ProcessMetadataCache::EvictStale() {
+  size_t evicted = 0;
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (it->second.generation != generation_) {
+      it = entries_.erase(it);
+      evicted++;
+    } else {
+      ++it;
+    }
+  }
+  return evicted;
+}
+
+ConnScraper::ConnScraper(std::string proc_path, std::shared_ptr<ProcessStore> process_store, bool use_io_uring)
+    : proc_path_(std::move(proc_path)),
+      process_store_(process_store) {
+  if (use_io_uring) {
+    io_uring_ = IoUring::Create(kIoUringEntries);
+    if (io_uring_) {
+      CLOG(INFO) << "Using io_uring for scraping " << proc_path_;
+    } else {
+      CLOG(WARNING) << "io_uring is not available, falling back to synchronous reads for scraping " << proc_path_;
+    }
+  }
+}
+
+ConnScraper::~ConnScraper() = default;
+
 bool ConnScraper::Scrape(std::vector<Connection>* connections, std::vector<ContainerEndpoint>* listen_endpoints) {
-  return ReadContainerConnections(proc_path_.c_str(), process_store_, connections, listen_endpoints);
+  return ReadContainerConnections(proc_path_.c_str(), process_store_, &metadata_cache_, io_uring_.get(), connections, listen_endpoints);
+}
+
+bool ConnScraper::ScrapeStep(std::chrono::microseconds cpu_budget, bool* sweep_complete,
+                             std::vector<Connection>* connections, std::vector<ContainerEndpoint>* listen_endpoints) {
+  *sweep_complete = false;
+
+  int64_t cpu_deadline = ThreadCPUTimeMicros() + cpu_budget.count();
+  if (!sweep_) {
+    auto sweep = MakeUnique<ConnScrapeSweep>(proc_path_.c_str(), listen_endpoints != nullptr, io_uring_.get());
+    if (!BeginSweep(proc_path_.c_str(), &metadata_cache_, sweep.get())) return false;
+    sweep_ = std::move(sweep);
+  }
+
+  if (!ContinueSweep(sweep_.get(), &metadata_cache_, cpu_deadline)) return true;
+
+  FinishSweep(sweep_.get(), process_store_, &metadata_cache_, connections, listen_endpoints);
+  sweep_.reset();
+  *sweep_complete = true;
+  return true;
 }
 
 bool ProcessScraper::Scrape(uint64_t pid, ProcessInfo& process_info) {
@@ -570,4 +1329,16 @@ bool ProcessScraper::Scrape(uint64_t pid, ProcessInfo& process_info) {
          ReadProcessCmdline(process_path, dirfd, process_info.exe, process_info.args);
 }
 
+bool ProcessScraper::ScrapeContainerID(uint64_t pid, std::string* container_id) {
+  char process_path[64];
+  snprintf(process_path, sizeof(process_path), "%s/%" PRIu64, proc_path_.c_str(), pid);
+
+  FDHandle dirfd = open(process_path, O_DIRECTORY | O_RDONLY);
+  if (!dirfd.valid()) {
+    return false;
+  }
+
+  return GetContainerID(dirfd, container_id);
+}
+
 }  // namespace collector
@@ -1,10 +1,17 @@
 #ifndef COLLECTOR_PROCFSSCRAPER_H
 #define COLLECTOR_PROCFSSCRAPER_H
 
+#include <chrono>
 #include <cstring>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include <sys/types.h>
+
+#include "Hash.h"
 #include "NetworkConnection.h"
 
 namespace collector {
@@ -13,22 +20,138 @@ namespace collector {
 class IConnScraper {
  public:
   virtual bool Scrape(std::vector<Connection>* connections, std::vector<ContainerEndpoint>* listen_endpoints) = 0;
+
+  // ScrapeStep performs part of a scrape, spending roughly cpu_budget of CPU time. Once a sweep over all processes has
+  // been completed, *sweep_complete is set to true and the results of the entire sweep are returned. The default
+  // implementation performs a full scrape on every call.
+  virtual bool ScrapeStep(std::chrono::microseconds cpu_budget, bool* sweep_complete,
+                          std::vector<Connection>* connections, std::vector<ContainerEndpoint>* listen_endpoints) {
+    *sweep_complete = true;
+    return Scrape(connections, listen_endpoints);
+  }
+
   virtual ~IConnScraper() {}
 };
 
+// ProcessMetadataCache caches the information about a process that is immutable for its lifetime (container ID and
+// network namespace), so that subsequent scrapes do not need to re-read it from `/proc/<pid>`. Entries are keyed by
+// pid and validated against the process start time, such that a reused pid is never mistaken for its predecessor.
+// Additionally, it keeps the socket inodes found in the fd table of each process during the last scrape, which allows
+// skipping fd tables that appear to be unchanged.
+class ProcessMetadataCache {
+ public:
+  // An fd table that appears to be unchanged is still re-read after this many scrapes, as the signals used to detect
+  // changes do not catch every change (e.g., a socket being closed and another one being opened in its place).
+  static constexpr uint64_t kFdTableRescanInterval = 5;
+
+  // FdTableSnapshot holds the socket inodes found in the fd table of a process, along with cheaply obtainable signals
+  // that change whenever the fd table changes in most cases.
+  struct FdTableSnapshot {
+    bool valid = false;
+    // Number of open fds as reported in the size of the `fd` directory (Linux 6.2+), 0 if unsupported.
+    uint64_t fd_count = 0;
+    // Size of the fd table (`FDSize` in `status`), only used if the number of open fds is not available.
+    uint64_t fd_size = 0;
+    // Number of sockets in use in the network namespace of the process.
+    uint64_t netns_sockets = 0;
+    // Number of fd entries read (one readlink each) when the snapshot was taken.
+    uint64_t num_fds = 0;
+    // The scrape generation in which the fd table was last read in full.
+    uint64_t generation = 0;
+    std::vector<ino_t> socket_inodes;
+  };
+
+  struct Entry {
+    uint64_t start_time = 0;
+    // Whether the process runs in a container. Non-container processes are cached as well, so that they can be
+    // skipped without inspecting their cgroup.
+    bool is_container = false;
+    std::string container_id;
+    ino_t netns_inode = 0;
+    // The scrape generation in which this process was last seen.
+    uint64_t generation = 0;
+    FdTableSnapshot fd_table;
+  };
+
+  // BeginScrape starts a new scrape generation. Every pid looked up or inserted afterwards counts as present.
+  void BeginScrape() { ++generation_; }
+
+  // generation returns the current scrape generation.
+  uint64_t generation() const { return generation_; }
+
+  // Lookup returns the cached entry for the given pid, or null if there is no entry or the entry belongs to an
+  // earlier process with the same pid.
+  Entry* Lookup(uint64_t pid, uint64_t start_time);
+
+  // Insert adds or replaces the entry for the given pid.
+  Entry* Insert(uint64_t pid, Entry entry);
+
+  // EvictStale removes the entries of all processes that were not seen since the last call to BeginScrape, and returns
+  // the number of evicted entries.
+  size_t EvictStale();
+
+  size_t size() const { return entries_.size(); }
+
+ private:
+  UnorderedMap<uint64_t, Entry> entries_;
+  uint64_t generation_ = 0;
+};
+
+// ContainerIDCache maps cgroup v2 paths to the ID of the container they belong to, or to none for host cgroups. On
+// cgroup v2 hosts, all processes of a container share a single cgroup, so the container ID only needs to be extracted
+// once per container. The instance returned by Instance() is shared by ConnScraper, ProcessScraper and the process
+// signal path, which use it from different threads.
+class ContainerIDCache {
+ public:
+  // Once this many cgroups are cached, the cache is cleared, such that the cgroups of containers that are gone do not
+  // accumulate.
+  static constexpr size_t kMaxEntries = 8192;
+
+  static ContainerIDCache& Instance() {
+    static ContainerIDCache instance;
+    return instance;
+  }
+
+  // Resolve extracts the container ID from the contents of a cgroup file. Returns false if the cgroup does not belong
+  // to a container. Only cgroup v2 files, consisting of a single `0::<path>` line, are cached. The lines of cgroup v1
+  // files are parsed one by one, as every process lists its own set of controllers.
+  bool Resolve(std::string_view cgroups, std::string* container_id);
+
+  size_t size();
+  void Clear();
+
+ private:
+  std::mutex mutex_;
+  UnorderedMap<std::string, std::string> container_ids_;
+};
+
+class IoUring;
+struct ConnScrapeSweep;
+
 // ConnScraper is a class that allows scraping a `/proc`-like directory structure for active network connections.
 class ConnScraper : public IConnScraper {
  public:
-  explicit ConnScraper(std::string proc_path, std::shared_ptr<ProcessStore> process_store = 0)
-      : proc_path_(std::move(proc_path)),
-        process_store_(process_store) {}
+  // If use_io_uring is true, the files in `/proc` are read in batches through io_uring, if it is available.
+  explicit ConnScraper(std::string proc_path, std::shared_ptr<ProcessStore> process_store = 0, bool use_io_uring = false);
+  ~ConnScraper();
 
   // Scrape returns a snapshot of all active network connections in the given vector.
   bool Scrape(std::vector<Connection>* connections, std::vector<ContainerEndpoint>* listen_endpoints);
 
+  // ScrapeStep continues the current sweep over the processes in `/proc` (starting a new one if there is none) until
+  // the calling thread has used up cpu_budget of CPU time. The position in `/proc` is kept between calls, such that the
+  // cost of a full sweep can be spread over a longer period of time.
+  bool ScrapeStep(std::chrono::microseconds cpu_budget, bool* sweep_complete,
+                  std::vector<Connection>* connections, std::vector<ContainerEndpoint>* listen_endpoints);
+
  private:
+  static constexpr unsigned int kIoUringEntries = 256;
+
   std::string proc_path_;
   std::shared_ptr<ProcessStore> process_store_;
+  ProcessMetadataCache metadata_cache_;
+  std::unique_ptr<IoUring> io_uring_;
+  std::unique_ptr<ConnScrapeSweep> sweep_;
 };
 
 class ProcessScraper {
@@ -47,6 +170,10 @@ class ProcessScraper {
 
   bool Scrape(uint64_t pid, ProcessInfo& pi);
 
+  // ScrapeContainerID only retrieves the container ID of the process with the given pid. Returns false if the process
+  // does not run in a container, or if its cgroup could not be read.
+  bool ScrapeContainerID(uint64_t pid, std::string* container_id);
+
  private:
   std::string proc_path_;
 };
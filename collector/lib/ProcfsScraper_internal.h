@@ -1,13 +1,50 @@
 #ifndef COLLECTOR_PROCFSSCRAPER_INTERNAL_H
 #define COLLECTOR_PROCFSSCRAPER_INTERNAL_H
 
+#include <cstdint>
+#include <string>
 #include <string_view>
 
+#include <sys/types.h>
+
+#include "NetworkConnection.h"
+
 namespace collector {
 
 // ExtractContainerID tries to extract a container ID from a cgroup line.
 std::string_view ExtractContainerID(std::string_view cgroup_line);
 
+// ParseContainerID extracts the container ID from the contents of a cgroup file. Returns false if none of the lines
+// contains a container ID.
+bool ParseContainerID(std::string_view cgroups, std::string* container_id);
+
+// IsContainerID returns whether the given string view represents a (full, 64 character) container ID. This is the
+// character-by-character reference implementation IsContainerIDFast is tested against.
+bool IsContainerID(std::string_view str);
+
+// IsContainerIDFast is equivalent to IsContainerID, but validates 8 characters at a time.
+bool IsContainerIDFast(std::string_view str);
+
+// ConnLineData is the interesting (for our purposes) subset of the data stored in a single (non-header) line of
+// `net/tcp[6]`.
+struct ConnLineData {
+  Endpoint local;
+  Endpoint remote;
+  uint8_t state;
+  ino_t inode;
+};
+
+// ParseConnLine parses an entire line in the `net/tcp[6]` file. This is the original, character-by-character parser,
+// which is lenient with respect to the exact formatting of the line. It is no longer used for scraping, but serves as
+// the reference implementation ParseConnLineFast is tested against.
+bool ParseConnLine(const char* p, const char* endp, Address::Family family, ConnLineData* data);
+
+// ParseConnLineFast parses a line in the `net/tcp[6]` or `net/udp[6]` file (excluding the trailing newline) in the
+// fixed-width format printed by the kernel, decoding the hexadecimal address and port fields several characters at a
+// time. Every line accepted by this function is parsed to the same result by ParseConnLine, but it is stricter about
+// the format.
+bool ParseConnLineFast(const char* p, const char* endp, Address::Family family, ConnLineData* data);
+
 }  // namespace collector
 
 #endif
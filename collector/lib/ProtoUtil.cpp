@@ -2,7 +2,10 @@
 
 #include <chrono>
 
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/unknown_field_set.h>
 #include <google/protobuf/util/time_util.h>
+#include <google/protobuf/wire_format_lite.h>
 
 namespace collector {
 
@@ -11,4 +14,36 @@ google::protobuf::Timestamp CurrentTimeProto() {
       std::chrono::system_clock::now().time_since_epoch() / std::chrono::microseconds(1));
 }
 
+namespace {
+
+void AppendTagAndLength(int field_number, size_t length, std::string* out) {
+  using google::protobuf::internal::WireFormatLite;
+
+  // The tag and the length are varints of at most 5 bytes each.
+  uint8_t buf[10];
+  uint8_t* end = WireFormatLite::WriteTagToArray(field_number, WireFormatLite::WIRETYPE_LENGTH_DELIMITED, buf);
+  end = google::protobuf::io::CodedOutputStream::WriteVarint32ToArray(length, end);
+  out->append(reinterpret_cast<const char*>(buf), end - buf);
+}
+
+}  // namespace
+
+std::string* AddSerializedField(google::protobuf::Message* msg, int field_number) {
+  return msg->GetReflection()->MutableUnknownFields(msg)->AddLengthDelimited(field_number);
+}
+
+void AppendMessageField(int field_number, const google::protobuf::MessageLite& field, std::string* out) {
+  size_t size = field.ByteSizeLong();
+  AppendTagAndLength(field_number, size, out);
+  size_t offset = out->size();
+  out->resize(offset + size);
+  field.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t*>(&(*out)[offset]));
+}
+
+void AppendSerializedField(int field_number, const std::string& serialized, const std::string& suffix, std::string* out) {
+  AppendTagAndLength(field_number, serialized.size() + suffix.size(), out);
+  out->append(serialized);
+  out->append(suffix);
+}
+
 }  // namespace collector
@@ -1,6 +1,9 @@
 #ifndef COLLECTOR_PROTOUTIL_H
 #define COLLECTOR_PROTOUTIL_H
 
+#include <string>
+
+#include <google/protobuf/message.h>
 #include <google/protobuf/timestamp.pb.h>
 
 namespace collector {
@@ -10,6 +13,19 @@ namespace collector {
 // granularity.
 google::protobuf::Timestamp CurrentTimeProto();
 
+// Adds a message field with the given number to msg, and returns its serialized contents, to which the fields of the
+// message can be appended (see AppendMessageField and AppendSerializedField). The field is kept with the unknown fields
+// of msg: it is serialized as is, and indistinguishable from a regular field on the wire, but it is not visible through
+// the accessors of msg.
+std::string* AddSerializedField(google::protobuf::Message* msg, int field_number);
+
+// Appends field as the message field with the given number to the serialized message in out.
+void AppendMessageField(int field_number, const google::protobuf::MessageLite& field, std::string* out);
+
+// Appends the message field with the given number and serialized contents (the concatenation of serialized and
+// suffix) to the serialized message in out.
+void AppendSerializedField(int field_number, const std::string& serialized, const std::string& suffix, std::string* out);
+
 }  // namespace collector
 
 #endif  // COLLECTOR_PROTOUTIL_H
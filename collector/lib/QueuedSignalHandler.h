@@ -0,0 +1,313 @@
+#ifndef COLLECTOR_QUEUEDSIGNALHANDLER_H
+#define COLLECTOR_QUEUEDSIGNALHANDLER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "CollectorStats.h"
+#include "SPSCQueue.h"
+#include "SignalHandler.h"
+#include "TimeUtil.h"
+
+namespace collector {
+
+// QueuedSignalHandler splits the handling of an event in two stages. The fields of the event needed by the handler are
+// extracted into a self-contained Record on the capture thread, which is the only thread accessing libsinsp. The
+// record is then handed to a worker thread of the handler over a bounded SPSC queue and processed there, such that a
+// slow handler (e.g., one blocked on a gRPC write) does not hold up the capture thread and cause kernel buffer drops.
+//
+// If the queue is full, the records of live events are dropped rather than blocking the capture thread. Records of
+// existing processes (sent after NEEDS_REFRESH) wait for space instead, as the process table is only walked once.
+// NEEDS_REFRESH and FINISHED results of the worker are reported by the next call to HandleSignal. The record that
+// resulted in NEEDS_REFRESH, and all records of events after it, are held back by the worker until the existing
+// processes have been processed, such that the order is the same as when handling events on the capture thread.
+//
+// With a queue size of 0, or while the worker is not running, records are processed on the capture thread right away.
+//
+// The lag of the queue is measured on every kLagSampleInterval-th record only, to save reading the clock for every
+// event on the capture thread.
+//
+// The worker takes up to kMaxBatchSize records off the queue at a time, and processes them with ProcessRecords, which
+// handlers can override to pay per record costs (e.g., taking a lock) only once per batch. Events themselves can't be
+// batched, as libsinsp reuses the event (and possibly its thread info) for the next one.
+//
+// Derived classes must stop the worker (QueuedSignalHandler::Stop) in their destructor, as it calls ProcessRecord.
+template <typename Record>
+class QueuedSignalHandler : public SignalHandler {
+ public:
+  static constexpr size_t kMaxBatchSize = 64;
+  static constexpr uint64_t kLagSampleInterval = 16;
+
+  struct Counters {
+    CollectorStats::CounterType queue_depth;
+    CollectorStats::CounterType queue_drops;
+    CollectorStats::CounterType lag_us;
+  };
+
+  QueuedSignalHandler(size_t queue_size, Counters counters) : counters_(counters) {
+    if (queue_size > 0) {
+      queue_ = std::make_unique<SPSCQueue<Entry>>(queue_size);
+    }
+  }
+
+  ~QueuedSignalHandler() override = default;
+
+  bool Start() override {
+    if (queue_ && !worker_.joinable()) {
+      stop_.store(false, std::memory_order_relaxed);
+      holding_ = false;
+      held_.clear();
+      worker_ = std::thread(&QueuedSignalHandler::RunWorker, this);
+    }
+    return true;
+  }
+
+  bool Stop() override {
+    StopWorker();
+    return true;
+  }
+
+  Result HandleSignal(sinsp_evt* evt) final {
+    Result pending = pending_result_.exchange(PROCESSED, std::memory_order_acq_rel);
+    if (pending == NEEDS_REFRESH) {
+      refreshing_ = true;
+    }
+    if (pending != PROCESSED) {
+      return pending;
+    }
+
+    if (refreshing_) {
+      // The existing processes have been sent (or that failed) after the previous call, so the worker can go on with
+      // the records it held back.
+      refreshing_ = false;
+      if (queue_ && worker_.joinable()) {
+        Enqueue(Entry{Record(), 0, EntryKind::REFRESH_DONE});
+      }
+    }
+
+    Record record;
+    Result result = ExtractSignal(evt, &record);
+    if (result != PROCESSED) {
+      return result;
+    }
+    return Dispatch(std::move(record), EntryKind::EVENT);
+  }
+
+  Result HandleExistingProcess(sinsp_threadinfo* tinfo) final {
+    Record record;
+    Result result = ExtractExistingProcess(tinfo, &record);
+    if (result != PROCESSED) {
+      return result;
+    }
+    return Dispatch(std::move(record), EntryKind::EXISTING_PROCESS);
+  }
+
+ protected:
+  // ExtractSignal extracts the record of an event, on the capture thread. Returns PROCESSED if the record is to be
+  // processed, or the result of handling the event otherwise.
+  virtual Result ExtractSignal(sinsp_evt* evt, Record* record) = 0;
+
+  // ExtractExistingProcess is like ExtractSignal, for an existing process.
+  virtual Result ExtractExistingProcess(sinsp_threadinfo* tinfo, Record* record) { return IGNORED; }
+
+  // ProcessRecord processes a record, on the worker thread (or the capture thread, if there is no queue).
+  virtual Result ProcessRecord(const Record& record) = 0;
+
+  // ProcessRecords processes count records in order, on the worker thread. It stops at the first record resulting in
+  // NEEDS_REFRESH or FINISHED, and returns that result with the number of records before it in *processed. Otherwise,
+  // it returns PROCESSED with *processed set to count.
+  virtual Result ProcessRecords(const Record* records, size_t count, size_t* processed) {
+    for (*processed = 0; *processed < count; ++*processed) {
+      Result result = ProcessRecord(records[*processed]);
+      if (result == NEEDS_REFRESH || result == FINISHED) {
+        return result;
+      }
+    }
+    return PROCESSED;
+  }
+
+ private:
+  enum class EntryKind {
+    EVENT,
+    EXISTING_PROCESS,
+    // Marks the end of a refresh, and holds no record.
+    REFRESH_DONE,
+  };
+
+  struct Entry {
+    Record record;
+    // Zero unless the record is sampled for measuring the lag.
+    int64_t enqueued_micros = 0;
+    EntryKind kind = EntryKind::EVENT;
+  };
+
+  // How long the idle worker sleeps at most before checking the queue again, should a wake-up get lost.
+  static constexpr std::chrono::milliseconds kIdleWait{100};
+
+  Result Dispatch(Record&& record, EntryKind kind) {
+    if (!queue_ || !worker_.joinable()) {
+      return ProcessRecord(record);
+    }
+    int64_t enqueued_micros = num_dispatched_++ % kLagSampleInterval == 0 ? NowMicros() : 0;
+    return Enqueue(Entry{std::move(record), enqueued_micros, kind}) ? PROCESSED : IGNORED;
+  }
+
+  // Enqueue pushes an entry to the worker. Only entries of events are dropped if the queue is full.
+  bool Enqueue(Entry&& entry) {
+    bool wait = entry.kind != EntryKind::EVENT;
+    while (!queue_->TryPush(std::move(entry))) {
+      if (!wait || stop_.load(std::memory_order_relaxed)) {
+        COUNTER_INC(counters_.queue_drops);
+        return false;
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+
+    // Pairs with the fence in WaitForRecords: either the worker sees the new record, or we see that it is waiting.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting_.load(std::memory_order_relaxed)) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      cond_.notify_one();
+    }
+    return true;
+  }
+
+  void RunWorker() {
+    Entry entry;
+    std::vector<Record> batch;
+    batch.reserve(kMaxBatchSize);
+    while (!stop_.load(std::memory_order_relaxed)) {
+      batch.clear();
+      int64_t oldest_enqueued_micros = 0;
+      bool refresh_done = false;
+      while (batch.size() < kMaxBatchSize && queue_->TryPop(&entry)) {
+        if (entry.kind == EntryKind::REFRESH_DONE) {
+          refresh_done = true;
+          break;
+        }
+        if (holding_ && entry.kind == EntryKind::EVENT) {
+          Hold(std::move(entry.record));
+          continue;
+        }
+        if (oldest_enqueued_micros == 0) {
+          oldest_enqueued_micros = entry.enqueued_micros;
+        }
+        batch.push_back(std::move(entry.record));
+      }
+      if (batch.empty() && !refresh_done) {
+        WaitForRecords();
+        continue;
+      }
+
+      COUNTER_SET(counters_.queue_depth, queue_->size());
+      if (oldest_enqueued_micros != 0) {
+        COUNTER_SET(counters_.lag_us, NowMicros() - oldest_enqueued_micros);
+      }
+
+      bool finished = !ProcessBatch(&batch);
+      if (!finished && refresh_done && holding_) {
+        holding_ = false;
+        batch.swap(held_);
+        held_.clear();
+        finished = !ProcessBatch(&batch);
+      }
+      if (finished) {
+        pending_result_.store(FINISHED, std::memory_order_release);
+        stop_.store(true, std::memory_order_relaxed);
+        break;
+      }
+    }
+    COUNTER_ZERO(counters_.queue_depth);
+  }
+
+  // ProcessBatch processes a batch of records taken off the queue. Returns false if the handler has finished.
+  bool ProcessBatch(std::vector<Record>* batch) {
+    size_t processed = 0;
+    Result result = ProcessRecords(batch->data(), batch->size(), &processed);
+    if (result == FINISHED) {
+      return false;
+    }
+    if (result == NEEDS_REFRESH) {
+      pending_result_.store(NEEDS_REFRESH, std::memory_order_release);
+      if (!holding_) {
+        // As on the capture thread, the record is processed again after the existing processes, and so are the
+        // records after it.
+        holding_ = true;
+        for (size_t i = processed; i < batch->size(); i++) {
+          Hold(std::move((*batch)[i]));
+        }
+      }
+      // Otherwise, an existing process failed during a refresh, and the next refresh sends the remaining ones again.
+    }
+    return true;
+  }
+
+  // Hold holds back a record until the refresh in progress is done. Like when the queue is full, records are dropped
+  // once as many as fit into the queue are held back.
+  void Hold(Record&& record) {
+    if (held_.size() >= queue_->capacity()) {
+      COUNTER_INC(counters_.queue_drops);
+      return;
+    }
+    held_.push_back(std::move(record));
+  }
+
+  void WaitForRecords() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    waiting_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (queue_->empty() && !stop_.load(std::memory_order_relaxed)) {
+      cond_.wait_for(lock, kIdleWait);
+    }
+    waiting_.store(false, std::memory_order_relaxed);
+  }
+
+  void StopWorker() {
+    if (!worker_.joinable()) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_.store(true, std::memory_order_relaxed);
+    }
+    cond_.notify_one();
+    worker_.join();
+  }
+
+  Counters counters_;
+  std::unique_ptr<SPSCQueue<Entry>> queue_;
+  std::thread worker_;
+  std::atomic<bool> stop_{false};
+  std::atomic<Result> pending_result_{PROCESSED};
+  // Whether the existing processes are being sent after NEEDS_REFRESH. Only accessed on the capture thread.
+  bool refreshing_ = false;
+  // The number of records pushed to the queue. Only accessed on the capture thread.
+  uint64_t num_dispatched_ = 0;
+  // Whether the worker holds back the records of events, and those records, until the refresh has been done. Only
+  // accessed on the worker thread.
+  bool holding_ = false;
+  std::vector<Record> held_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::atomic<bool> waiting_{false};
+};
+
+template <typename Record>
+constexpr size_t QueuedSignalHandler<Record>::kMaxBatchSize;
+
+template <typename Record>
+constexpr uint64_t QueuedSignalHandler<Record>::kLagSampleInterval;
+
+template <typename Record>
+constexpr std::chrono::milliseconds QueuedSignalHandler<Record>::kIdleWait;
+
+}  // namespace collector
+
+#endif  // COLLECTOR_QUEUEDSIGNALHANDLER_H
@@ -0,0 +1,85 @@
+#ifndef COLLECTOR_SPSCQUEUE_H
+#define COLLECTOR_SPSCQUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace collector {
+
+// SPSCQueue is a bounded lock-free queue for passing items from a single producer thread to a single consumer thread.
+// TryPush may only be called by the producer, and TryPop only by the consumer; size and empty may be called by either.
+//
+// The capacity is rounded up to a power of two. Items are moved in and out of preallocated slots, so T must be default
+// constructible and move assignable.
+template <typename T>
+class SPSCQueue {
+ public:
+  explicit SPSCQueue(size_t capacity) : slots_(RoundUpToPowerOfTwo(capacity)), mask_(slots_.size() - 1) {}
+
+  SPSCQueue(const SPSCQueue&) = delete;
+  SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+  // TryPush moves item into the queue. Returns false, leaving item untouched, if the queue is full.
+  bool TryPush(T&& item) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_cache_ == slots_.size()) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (tail - head_cache_ == slots_.size()) {
+        return false;
+      }
+    }
+    slots_[tail & mask_] = std::move(item);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // TryPop moves the oldest item of the queue to *item. Returns false if the queue is empty.
+  bool TryPop(T* item) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_cache_) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+      if (head == tail_cache_) {
+        return false;
+      }
+    }
+    *item = std::move(slots_[head & mask_]);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t size() const {
+    // The head is loaded first, as it never passes the tail.
+    size_t head = head_.load(std::memory_order_acquire);
+    return tail_.load(std::memory_order_acquire) - head;
+  }
+
+  bool empty() const { return size() == 0; }
+
+  size_t capacity() const { return slots_.size(); }
+
+ private:
+  static size_t RoundUpToPowerOfTwo(size_t n) {
+    size_t capacity = 1;
+    while (capacity < std::max<size_t>(n, 1)) {
+      capacity <<= 1;
+    }
+    return capacity;
+  }
+
+  std::vector<T> slots_;
+  const size_t mask_;
+
+  // The consumer's and the producer's position are kept on separate cache lines, each next to the other side's last
+  // known position, which only its own thread accesses.
+  alignas(64) std::atomic<size_t> head_{0};
+  size_t tail_cache_ = 0;
+  alignas(64) std::atomic<size_t> tail_{0};
+  size_t head_cache_ = 0;
+};
+
+}  // namespace collector
+
+#endif  // COLLECTOR_SPSCQUEUE_H
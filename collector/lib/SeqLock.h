@@ -0,0 +1,52 @@
+#ifndef COLLECTOR_SEQLOCK_H
+#define COLLECTOR_SEQLOCK_H
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace collector {
+
+// SeqLock publishes a value written by a single thread to any number of reader threads, without the writer ever
+// waiting for readers. A reader copies the value and retries if it was written to in the meantime, so it is meant for
+// values that are written periodically and read rarely, such as statistics.
+template <typename T>
+class SeqLock {
+ public:
+  SeqLock() = default;
+  SeqLock(const SeqLock&) = delete;
+  SeqLock& operator=(const SeqLock&) = delete;
+
+  // Store publishes value. Must only be called by a single writer thread at a time.
+  void Store(const T& value) {
+    uint64_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    value_ = value;
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  // Load copies the last published value to *value. Returns false if no value has been published yet.
+  bool Load(T* value) const {
+    for (;;) {
+      uint64_t seq = seq_.load(std::memory_order_acquire);
+      if (seq & 1) {
+        std::this_thread::yield();
+        continue;
+      }
+      *value = value_;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (seq_.load(std::memory_order_relaxed) == seq) {
+        return seq != 0;
+      }
+    }
+  }
+
+ private:
+  std::atomic<uint64_t> seq_{0};
+  T value_;
+};
+
+}  // namespace collector
+
+#endif  // COLLECTOR_SEQLOCK_H
@@ -0,0 +1,26 @@
+#include "SignalDispatchTable.h"
+
+#include <algorithm>
+
+namespace collector {
+
+void SignalDispatchTable::Add(SignalHandler* handler, const std::vector<uint16_t>& event_types) {
+  for (uint16_t type : event_types) {
+    table_[type].push_back(handler);
+  }
+}
+
+void SignalDispatchTable::Remove(SignalHandler* handler, const std::vector<uint16_t>& event_types) {
+  for (uint16_t type : event_types) {
+    auto& handlers = table_[type];
+    handlers.erase(std::remove(handlers.begin(), handlers.end(), handler), handlers.end());
+  }
+}
+
+void SignalDispatchTable::Clear() {
+  for (auto& handlers : table_) {
+    handlers.clear();
+  }
+}
+
+}  // namespace collector
@@ -0,0 +1,36 @@
+#ifndef COLLECTOR_SIGNALDISPATCHTABLE_H
+#define COLLECTOR_SIGNALDISPATCHTABLE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "SignalHandler.h"
+#include "ppm_events_public.h"
+
+namespace collector {
+
+// SignalDispatchTable lists, for each event type, the signal handlers interested in events of that type, in the order
+// in which they were added. This spares the event loop from checking the event filter of every handler for every
+// event, as most handlers are only interested in a few event types.
+class SignalDispatchTable {
+ public:
+  SignalDispatchTable() : table_(PPM_EVENT_MAX) {}
+
+  // Add adds the handler to the lists of the given event types.
+  void Add(SignalHandler* handler, const std::vector<uint16_t>& event_types);
+
+  // Remove removes the handler from the lists of the given event types, which are the only lists it touches. This
+  // invalidates the references returned by Handlers for these types.
+  void Remove(SignalHandler* handler, const std::vector<uint16_t>& event_types);
+
+  void Clear();
+
+  const std::vector<SignalHandler*>& Handlers(uint16_t event_type) const { return table_[event_type]; }
+
+ private:
+  std::vector<std::vector<SignalHandler*>> table_;
+};
+
+}  // namespace collector
+
+#endif  // COLLECTOR_SIGNALDISPATCHTABLE_H
@@ -23,6 +23,8 @@ class SignalHandler {
     FINISHED,
   };
 
+  virtual ~SignalHandler() = default;
+
   virtual std::string GetName() = 0;
   virtual bool Start() { return true; }
   virtual bool Stop() { return true; }
@@ -31,6 +33,9 @@ class SignalHandler {
     return IGNORED;
   }
   virtual std::vector<std::string> GetRelevantEvents() = 0;
+  // SyncStats is called on the capture thread before the stats are published (and before the handler is removed), for
+  // handlers that count into them from another thread.
+  virtual void SyncStats() {}
 };
 
 }  // namespace collector
@@ -28,7 +28,10 @@ bool SignalServiceClient::EstablishGRPCStreamSingle() {
 
   // stream writer
   context_ = MakeUnique<grpc::ClientContext>();
-  writer_ = DuplexClient::CreateWithReadsIgnored(&SignalService::Stub::AsyncPushSignals, channel_, context_.get());
+  compression_.Apply(context_.get());
+  auto writer = DuplexClient::CreateWithReadsIgnored(&SignalService::Stub::AsyncPushSignals, channel_, context_.get());
+  writer->SetCompressionFilter([this](const SignalStreamMessage& msg) { return compression_.OnWrite(msg); });
+  writer_ = std::move(writer);
   if (!writer_->WaitUntilStarted(std::chrono::seconds(30))) {
     CLOG(ERROR) << "Signal stream not ready after 30 seconds. Retrying ...";
     CLOG(ERROR) << "Error message: " << writer_->FinishNow().error_message();
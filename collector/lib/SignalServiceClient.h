@@ -14,6 +14,7 @@
 #include "internalapi/sensor/signal_iservice.grpc.pb.h"
 
 #include "DuplexGRPC.h"
+#include "GRPCCompression.h"
 #include "SignalHandler.h"
 #include "StoppableThread.h"
 
@@ -35,8 +36,9 @@ class SignalServiceClient : public ISignalServiceClient {
   using SignalService = sensor::SignalService;
   using SignalStreamMessage = sensor::SignalStreamMessage;
 
-  explicit SignalServiceClient(std::shared_ptr<grpc::Channel> channel)
-      : channel_(std::move(channel)), stream_active_(false) {}
+  explicit SignalServiceClient(std::shared_ptr<grpc::Channel> channel, grpc_compression_algorithm compression = GRPC_COMPRESS_NONE,
+                               size_t compression_min_bytes = 0)
+      : channel_(std::move(channel)), stream_active_(false), compression_(compression, compression_min_bytes, {CollectorStats::signal_grpc_bytes, CollectorStats::signal_grpc_compressed_bytes, CollectorStats::signal_grpc_compression_us}) {}
 
   void Start();
   void Stop();
@@ -58,6 +60,9 @@ class SignalServiceClient : public ISignalServiceClient {
   std::unique_ptr<IDuplexClientWriter<SignalStreamMessage>> writer_;
 
   bool first_write_;
+
+  // Only used by the thread pushing signals.
+  StreamCompression compression_;
 };
 
 class StdoutSignalServiceClient : public ISignalServiceClient {
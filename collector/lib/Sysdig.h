@@ -16,16 +16,25 @@ namespace collector {
 struct SysdigStats {
   using uint64_t = std::uint64_t;
 
+  static constexpr int kMaxCPUs = 1024;
+
   // stats gathered in kernel space
   volatile uint64_t nEvents = 0;       // the number of kernel events
   volatile uint64_t nDrops = 0;        // the number of drops
   volatile uint64_t nPreemptions = 0;  // the number of preemptions
 
+  // per-CPU stats gathered in kernel space, if reported by the driver
+  volatile uint64_t nCPUs = 0;                      // the number of CPUs with per-CPU stats
+  volatile uint64_t nEventsPerCPU[kMaxCPUs] = {0};  // the number of kernel events per CPU
+  volatile uint64_t nDropsPerCPU[kMaxCPUs] = {0};   // the number of drops per CPU
+
   // stats gathered in user space
   volatile uint64_t nFilteredEvents[PPM_EVENT_MAX] = {0};         // events post chisel filter
   volatile uint64_t nUserspaceEvents[PPM_EVENT_MAX] = {0};        // events pre chisel filter, should be (nEvents - nDrops)
   volatile uint64_t nChiselCacheHitsAccept[PPM_EVENT_MAX] = {0};  // number of events that hit the filter cache
   volatile uint64_t nChiselCacheHitsReject[PPM_EVENT_MAX] = {0};  // number of events that hit the filter cache
+  volatile uint64_t nChiselCacheMisses = 0;                       // number of events that missed the filter cache
+  volatile uint64_t nChiselCacheEvictions = 0;                    // number of containers evicted from the filter cache
   volatile uint64_t nGRPCSendFailures = 0;                        // number of signals that were not sent on GRPC
 
   // process related metrics
@@ -37,6 +46,7 @@ struct SysdigStats {
 
   // Timing metrics
   volatile uint64_t event_parse_micros[PPM_EVENT_MAX] = {0};    // total microseconds spent parsing event type (correlates w/ nUserspaceEvents)
+  volatile uint64_t event_filter_micros[PPM_EVENT_MAX] = {0};   // total microseconds spent filtering event type (correlates w/ nUserspaceEvents)
   volatile uint64_t event_process_micros[PPM_EVENT_MAX] = {0};  // total microseconds spent processing event type (correlates w/ nFilteredevents)
 };
 
@@ -46,6 +56,7 @@ class Sysdig {
 
   virtual void Init(const CollectorConfig& config, std::shared_ptr<ConnectionTracker> conn_tracker) = 0;
   virtual bool InitKernel(const CollectorConfig& config, const DriverCandidate& candidate) = 0;
+  virtual bool InitReplay(const CollectorConfig& config) = 0;
   virtual void Start() = 0;
   virtual void Run(const std::atomic<ControlValue>& control) = 0;
   virtual void CleanUp() = 0;
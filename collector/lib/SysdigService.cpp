@@ -1,5 +1,6 @@
 #include "SysdigService.h"
 
+#include <algorithm>
 #include <cap-ng.h>
 #include <thread>
 
@@ -9,6 +10,8 @@
 
 #include "CollectionMethod.h"
 #include "CollectorException.h"
+#include "CollectorStats.h"
+#include "DriverBuffers.h"
 #include "EventNames.h"
 #include "HostInfo.h"
 #include "KernelDriver.h"
@@ -26,6 +29,34 @@ constexpr char SysdigService::kModulePath[];
 constexpr char SysdigService::kModuleName[];
 constexpr char SysdigService::kProbePath[];
 constexpr char SysdigService::kProbeName[];
+constexpr std::chrono::milliseconds SysdigService::kStatsPublishInterval;
+constexpr std::chrono::seconds SysdigService::kSheddingInterval;
+
+namespace {
+
+// GetPPMSC returns the codes of the given syscalls, among those collected.
+std::vector<ppm_sc_code> GetPPMSC(const std::vector<std::string>& syscalls, const std::vector<std::string>& collected) {
+  std::vector<ppm_sc_code> codes;
+  const EventNames& event_names = EventNames::GetInstance();
+  for (const auto& syscall_str : syscalls) {
+    if (std::find(collected.begin(), collected.end(), syscall_str) == collected.end()) {
+      continue;
+    }
+    for (ppm_event_type event_id : event_names.GetEventIDs(syscall_str)) {
+      uint16_t syscall_id = event_names.GetEventSyscallID(event_id);
+      if (!syscall_id) {
+        continue;
+      }
+      auto code = static_cast<ppm_sc_code>(g_syscall_table[syscall_id].ppm_sc);
+      if (std::find(codes.begin(), codes.end(), code) == codes.end()) {
+        codes.push_back(code);
+      }
+    }
+  }
+  return codes;
+}
+
+}  // namespace
 
 void SysdigService::Init(const CollectorConfig& config, std::shared_ptr<ConnectionTracker> conn_tracker) {
   if (chisel_) {
@@ -40,17 +71,18 @@ void SysdigService::Init(const CollectorConfig& config, std::shared_ptr<Connecti
   AddSignalHandler(MakeUnique<SelfCheckNetworkHandler>(inspector_.get()));
 
   if (conn_tracker) {
-    AddSignalHandler(MakeUnique<NetworkSignalHandler>(inspector_.get(), conn_tracker, &userspace_stats_));
+    AddSignalHandler(MakeUnique<NetworkSignalHandler>(inspector_.get(), conn_tracker, &userspace_stats_, config.SignalQueueSize()));
   }
 
   if (config.grpc_channel) {
-    signal_client_.reset(new SignalServiceClient(std::move(config.grpc_channel)));
+    signal_client_.reset(new SignalServiceClient(std::move(config.grpc_channel), config.SignalCompression(), config.CompressionMinBytes()));
   } else {
     signal_client_.reset(new StdoutSignalServiceClient());
   }
   AddSignalHandler(MakeUnique<ProcessSignalHandler>(inspector_.get(),
                                                     signal_client_.get(),
-                                                    &userspace_stats_));
+                                                    &userspace_stats_,
+                                                    config.SignalQueueSize()));
 
   if (signal_handlers_.size() == 2) {
     // self-check handlers do not count towards this check, because they
@@ -58,28 +90,46 @@ void SysdigService::Init(const CollectorConfig& config, std::shared_ptr<Connecti
     CLOG(FATAL) << "Internal error: There are no signal handlers.";
   }
 
-  SetChisel(config.Chisel());
+  if (config.UseChiselCache()) {
+    chisel_cache_ = MakeUnique<ChiselCache>(config.ChiselCacheSize());
+  }
+  use_native_filter_ = config.UseNativeFilter();
+  timer_ = EventTimer(config.EventTimingClock(), config.EventTimingSampleRate());
+  record_file_ = config.RecordFile();
+
+  if (config.OverloadShedding()) {
+    overload_shedder_ = MakeUnique<OverloadShedder>(config.OverloadDropPermille(), config.OverloadRestoreSeconds());
+    for (const auto& syscalls : OverloadShedder::kLevels) {
+      shed_ppm_sc_.push_back(GetPPMSC(syscalls, config.Syscalls()));
+    }
+  }
 
-  use_chisel_cache_ = config.UseChiselCache();
+  SetChisel(config.Chisel());
 }
 
-bool SysdigService::InitKernel(const CollectorConfig& config, const DriverCandidate& candidate) {
-  if (!inspector_) {
-    inspector_.reset(new_inspector());
-
-    // peeking into arguments has a big overhead, so we prevent it from happening
-    inspector_->set_snaplen(0);
+void SysdigService::CreateInspector(const CollectorConfig& config) {
+  if (inspector_) {
+    return;
+  }
 
-    if (logging::GetLogLevel() == logging::LogLevel::TRACE) {
-      inspector_->set_log_stderr();
-    }
+  inspector_.reset(new_inspector());
 
-    inspector_->set_import_users(config.ImportUsers());
+  // peeking into arguments has a big overhead, so we prevent it from happening
+  inspector_->set_snaplen(0);
 
-    default_formatter_.reset(new sinsp_evt_formatter(inspector_.get(),
-                                                     DEFAULT_OUTPUT_STR));
+  if (logging::GetLogLevel() == logging::LogLevel::TRACE) {
+    inspector_->set_log_stderr();
   }
 
+  inspector_->set_import_users(config.ImportUsers());
+
+  default_formatter_.reset(new sinsp_evt_formatter(inspector_.get(),
+                                                   DEFAULT_OUTPUT_STR));
+}
+
+bool SysdigService::InitKernel(const CollectorConfig& config, const DriverCandidate& candidate) {
+  CreateInspector(config);
+
   std::unique_ptr<IKernelDriver> driver;
   if (candidate.GetCollectionMethod() == CollectionMethod::EBPF) {
     driver = std::make_unique<KernelDriverEBPF>(KernelDriverEBPF());
@@ -95,9 +145,24 @@ bool SysdigService::InitKernel(const CollectorConfig& config, const DriverCandid
   return true;
 }
 
+bool SysdigService::InitReplay(const CollectorConfig& config) {
+  CreateInspector(config);
+
+  try {
+    inspector_->open_savefile(config.ReplayFile());
+  } catch (const sinsp_exception& ex) {
+    CLOG(ERROR) << "Failed to open capture file " << config.ReplayFile() << ": " << ex.what();
+    return false;
+  }
+
+  CLOG(INFO) << "Replaying capture file " << config.ReplayFile();
+  replaying_ = true;
+  return true;
+}
+
 bool SysdigService::FilterEvent(sinsp_evt* event) {
-  if (!use_chisel_cache_) {
-    return chisel_->process(event);
+  if (!chisel_cache_) {
+    return RunChisel(event);
   }
 
   sinsp_threadinfo* tinfo = event->get_thread_info();
@@ -105,38 +170,35 @@ bool SysdigService::FilterEvent(sinsp_evt* event) {
     return false;
   }
 
-  auto pair = chisel_cache_.emplace(tinfo->m_container_id, ACCEPTED);
-  ChiselCacheStatus& cache_status = pair.first->second;
-  bool res;
-
-  if (pair.second) {  // was newly inserted
-    res = chisel_->process(event);
-    if (chisel_cache_.size() > 1024) {
-      CLOG(INFO) << "Flushing chisel cache";
-      chisel_cache_.clear();
-      return res;
-    }
-    cache_status = res ? ACCEPTED : BLOCKED_USERSPACE;
-  } else {
-    res = (cache_status == ACCEPTED);
-
-    if (res) {
+  switch (chisel_cache_->Lookup(tinfo->m_container_id)) {
+    case ChiselCache::ACCEPTED:
       ++userspace_stats_.nChiselCacheHitsAccept[event->get_type()];
-    } else {
+      return true;
+    case ChiselCache::BLOCKED:
       ++userspace_stats_.nChiselCacheHitsReject[event->get_type()];
-    }
+      return false;
+    case ChiselCache::MISS:
+      break;
   }
 
+  ++userspace_stats_.nChiselCacheMisses;
+  bool res = RunChisel(event);
+  if (chisel_cache_->Insert(tinfo->m_container_id, res)) {
+    ++userspace_stats_.nChiselCacheEvictions;
+  }
   return res;
 }
 
-sinsp_evt* SysdigService::GetNext() {
-  std::lock_guard<std::mutex> lock(libsinsp_mutex_);
+sinsp_evt* SysdigService::GetNext(int64_t parse_start, bool* timed) {
   sinsp_evt* event;
 
-  auto parse_start = NowMicros();
   auto res = inspector_->next(&event);
-  if (res != SCAP_SUCCESS) return nullptr;
+  if (res != SCAP_SUCCESS) {
+    if (res == SCAP_EOF && replaying_) {
+      replay_finished_ = true;
+    }
+    return nullptr;
+  }
 
 #ifdef TRACE_SINSP_EVENTS
   // Do not allow to change sinsp events tracing at runtime, as the output
@@ -164,10 +226,20 @@ sinsp_evt* SysdigService::GetNext() {
     return nullptr;
   }
 
-  userspace_stats_.event_parse_micros[event->get_type()] += (NowMicros() - parse_start);
-  ++userspace_stats_.nUserspaceEvents[event->get_type()];
+  uint16_t type = event->get_type();
+  *timed = timer_.Sample(type);
+  int64_t filter_start = 0;
+  if (*timed) {
+    filter_start = timer_.Now();
+    userspace_stats_.event_parse_micros[type] += timer_.Scale(filter_start - parse_start);
+  }
+  ++userspace_stats_.nUserspaceEvents[type];
 
-  if (!FilterEvent(event)) {
+  bool accepted = FilterEvent(event);
+  if (*timed) {
+    userspace_stats_.event_filter_micros[type] += timer_.Scale(timer_.Now() - filter_start);
+  }
+  if (!accepted) {
     return nullptr;
   }
   ++userspace_stats_.nFilteredEvents[event->get_type()];
@@ -176,8 +248,6 @@ sinsp_evt* SysdigService::GetNext() {
 }
 
 void SysdigService::Start() {
-  std::lock_guard<std::mutex> libsinsp_lock(libsinsp_mutex_);
-
   if (!inspector_ || !chisel_) {
     throw CollectorException("Invalid state: SysdigService was not initialized");
   }
@@ -190,14 +260,23 @@ void SysdigService::Start() {
 
   inspector_->start_capture();
 
-  // trigger the self check process only once capture has started,
-  // to verify the driver is working correctly. SelfCheckHandlers will
-  // verify the live events.
-  std::thread self_checks_thread(self_checks::start_self_check_process);
-  self_checks_thread.detach();
+  if (!record_file_.empty()) {
+    inspector_->autodump_start(record_file_, false);
+    CLOG(INFO) << "Recording events to " << record_file_;
+  }
 
-  std::lock_guard<std::mutex> running_lock(running_mutex_);
-  running_ = true;
+  if (replaying_) {
+    replay_start_micros_ = NowMicros();
+  } else {
+    // trigger the self check process only once capture has started,
+    // to verify the driver is working correctly. SelfCheckHandlers will
+    // verify the live events.
+    std::thread self_checks_thread(self_checks::start_self_check_process);
+    self_checks_thread.detach();
+  }
+
+  PublishStats(timer_.Now());
+  running_.store(true, std::memory_order_release);
 }
 
 void SysdigService::Run(const std::atomic<ControlValue>& control) {
@@ -205,40 +284,77 @@ void SysdigService::Run(const std::atomic<ControlValue>& control) {
     throw CollectorException("Invalid state: SysdigService was not initialized");
   }
 
-  while (control.load(std::memory_order_relaxed) == ControlValue::RUN) {
-    ServePendingProcessRequests();
+  while (!replay_finished_ && control.load(std::memory_order_relaxed) == ControlValue::RUN) {
+    if (!pending_process_requests_.empty()) {
+      ServePendingProcessRequests();
+    }
 
-    sinsp_evt* evt = GetNext();
+    // A single clock read per iteration, which GetNext also uses as the start of parsing the event.
+    int64_t now = timer_.Now();
+    if (now >= next_stats_publish_micros_) {
+      PublishStats(now);
+    }
+
+    bool timed = false;
+    sinsp_evt* evt = GetNext(now, &timed);
     if (!evt) continue;
 
-    auto process_start = NowMicros();
-    for (auto it = signal_handlers_.begin(); it != signal_handlers_.end(); it++) {
-      auto& signal_handler = *it;
-      if (!signal_handler.ShouldHandle(evt)) continue;
-      auto result = signal_handler.handler->HandleSignal(evt);
+    int64_t process_start = timed ? timer_.Now() : 0;
+    const auto& handlers = dispatch_table_.Handlers(evt->get_type());
+    for (size_t i = 0; i < handlers.size(); i++) {
+      SignalHandler* signal_handler = handlers[i];
+      auto result = signal_handler->HandleSignal(evt);
       if (result == SignalHandler::NEEDS_REFRESH) {
-        if (!SendExistingProcesses(signal_handler.handler.get())) {
+        if (!SendExistingProcesses(signal_handler)) {
           continue;
         }
-        result = signal_handler.handler->HandleSignal(evt);
+        result = signal_handler->HandleSignal(evt);
       } else if (result == SignalHandler::FINISHED) {
         // This signal handler has finished processing events,
         // so remove it from the signal handler list.
         //
-        // We don't need to update the iterator post-deletion
-        // because we also stop iteration at this point.
-        signal_handlers_.erase(it);
+        // This invalidates the list of handlers for this event
+        // type, but we also stop iteration at this point.
+        RemoveSignalHandler(signal_handler);
         break;
       }
     }
 
-    userspace_stats_.event_process_micros[evt->get_type()] += (NowMicros() - process_start);
+    if (timed) {
+      userspace_stats_.event_process_micros[evt->get_type()] += timer_.Scale(timer_.Now() - process_start);
+    }
+  }
+
+  if (replay_finished_) {
+    PublishStats(timer_.Now());
+    LogReplaySummary(NowMicros() - replay_start_micros_);
   }
 }
 
-bool SysdigService::SendExistingProcesses(SignalHandler* handler) {
-  std::lock_guard<std::mutex> lock(libsinsp_mutex_);
+void SysdigService::LogReplaySummary(int64_t elapsed_micros) {
+  uint64_t userspace = 0, filtered = 0, parse_micros = 0, filter_micros = 0, process_micros = 0;
+  for (int i = 0; i < PPM_EVENT_MAX; i++) {
+    userspace += userspace_stats_.nUserspaceEvents[i];
+    filtered += userspace_stats_.nFilteredEvents[i];
+    parse_micros += userspace_stats_.event_parse_micros[i];
+    filter_micros += userspace_stats_.event_filter_micros[i];
+    process_micros += userspace_stats_.event_process_micros[i];
+  }
+
+  double seconds = std::max<int64_t>(elapsed_micros, 1) / 1e6;
+  auto per_event = [](uint64_t micros, uint64_t events) { return events ? 1000.0 * micros / events : 0.0; };
+  const auto& stats = CollectorStats::GetOrCreate();
+
+  CLOG(INFO) << "Replay finished: " << userspace << " events (" << filtered << " after filtering) in " << seconds
+             << "s, " << static_cast<uint64_t>(userspace / seconds) << " events/s";
+  CLOG(INFO) << "Replay timings per event: parse " << per_event(parse_micros, userspace) << "ns, filter "
+             << per_event(filter_micros, userspace) << "ns, process " << per_event(process_micros, filtered) << "ns";
+  CLOG(INFO) << "Replay signal queue drops: process "
+             << stats.GetCounter(CollectorStats::process_signal_queue_drops) << ", network "
+             << stats.GetCounter(CollectorStats::network_signal_queue_drops);
+}
 
+bool SysdigService::SendExistingProcesses(SignalHandler* handler) {
   if (!inspector_ || !chisel_) {
     throw CollectorException("Invalid state: SysdigService was not initialized");
   }
@@ -263,9 +379,10 @@ bool SysdigService::SendExistingProcesses(SignalHandler* handler) {
 }
 
 void SysdigService::CleanUp() {
-  std::lock_guard<std::mutex> libsinsp_lock(libsinsp_mutex_);
-  std::lock_guard<std::mutex> running_lock(running_mutex_);
-  running_ = false;
+  running_.store(false, std::memory_order_release);
+  if (!record_file_.empty()) {
+    inspector_->autodump_stop();
+  }
   inspector_->close();
   chisel_.reset();
   inspector_.reset();
@@ -276,43 +393,92 @@ void SysdigService::CleanUp() {
     }
   }
 
+  dispatch_table_.Clear();
   signal_handlers_.clear();
 
   // Cancel all pending process requests
-  std::lock_guard<std::mutex> lock(process_requests_mutex_);
-
-  while (!pending_process_requests_.empty()) {
-    auto& request = pending_process_requests_.front();
+  pending_process_requests_.ConsumeAll([](std::pair<uint64_t, ProcessInfoCallbackRef>&& request) {
     auto callback = request.second.lock();
 
     if (callback) (*callback)(0);
-
-    pending_process_requests_.pop_front();
-  }
+  });
 }
 
 bool SysdigService::GetStats(SysdigStats* stats) const {
-  std::lock_guard<std::mutex> libsinsp_lock(libsinsp_mutex_);
-  std::lock_guard<std::mutex> running_lock(running_mutex_);
-  if (!running_ || !inspector_) return false;
+  if (!running_.load(std::memory_order_acquire)) return false;
 
+  return published_stats_.Load(stats);
+}
+
+void SysdigService::PublishStats(int64_t now) {
   scap_stats kernel_stats;
   inspector_->get_capture_stats(&kernel_stats);
-  *stats = userspace_stats_;
-  stats->nEvents = kernel_stats.n_evts;
-  stats->nDrops = kernel_stats.n_drops;
-  stats->nPreemptions = kernel_stats.n_preemptions;
+  userspace_stats_.nEvents = kernel_stats.n_evts;
+  userspace_stats_.nDrops = kernel_stats.n_drops;
+  userspace_stats_.nPreemptions = kernel_stats.n_preemptions;
+  if (overload_shedder_ && now >= next_shedding_update_micros_) {
+    UpdateShedding(now, kernel_stats);
+  }
 
-  return true;
+  // Drivers reporting per-CPU counters name them n_evts_cpu_<N> and n_drops_cpu_<N>.
+  uint32_t nstats = 0;
+  int32_t rc = 0;
+  const scap_stats_v2* metrics = inspector_->get_capture_stats_v2(PPM_SCAP_STATS_KERNEL_COUNTERS, &nstats, &rc);
+  uint64_t num_cpus = 0;
+  for (uint32_t i = 0; metrics && rc == SCAP_SUCCESS && i < nstats; i++) {
+    int cpu;
+    if (ParsePerCPUMetric(metrics[i].name, "n_evts_cpu_", &cpu) && cpu < SysdigStats::kMaxCPUs) {
+      userspace_stats_.nEventsPerCPU[cpu] = metrics[i].value.u64;
+    } else if (ParsePerCPUMetric(metrics[i].name, "n_drops_cpu_", &cpu) && cpu < SysdigStats::kMaxCPUs) {
+      userspace_stats_.nDropsPerCPU[cpu] = metrics[i].value.u64;
+    } else {
+      continue;
+    }
+    num_cpus = std::max<uint64_t>(num_cpus, cpu + 1);
+  }
+  userspace_stats_.nCPUs = num_cpus;
+
+  for (auto& signal_handler : signal_handlers_) {
+    signal_handler.handler->SyncStats();
+  }
+
+  published_stats_.Store(userspace_stats_);
+  next_stats_publish_micros_ = now + std::chrono::microseconds(kStatsPublishInterval).count();
+}
+
+void SysdigService::UpdateShedding(int64_t now, const scap_stats& kernel_stats) {
+  int level = overload_shedder_->level();
+  int new_level = overload_shedder_->Update(kernel_stats.n_evts, kernel_stats.n_drops);
+  next_shedding_update_micros_ = now + std::chrono::microseconds(kSheddingInterval).count();
+  if (new_level == level) {
+    return;
+  }
+
+  // Levels only move by one per update.
+  bool shed = new_level > level;
+  const auto& codes = shed_ppm_sc_[shed ? level : new_level];
+  for (ppm_sc_code code : codes) {
+    inspector_->mark_ppm_sc_of_interest(code, !shed);
+  }
+  CLOG(WARNING) << (shed ? "Kernel drops above threshold, no longer capturing " : "Kernel drops under threshold, capturing again ")
+                << codes.size() << " syscall(s). Overload shedding level: " << new_level;
+  COUNTER_SET(CollectorStats::overload_shedding_level, new_level);
 }
 
 void SysdigService::SetChisel(const std::string& chisel) {
-  std::lock_guard<std::mutex> lock(libsinsp_mutex_);
-  CLOG(DEBUG) << "Updating chisel and flushing chisel cache";
+  CLOG(DEBUG) << "Updating chisel and invalidating chisel cache";
   CLOG(DEBUG) << "New chisel: " << chisel;
   chisel_.reset(new_chisel(inspector_.get(), chisel, false));
   chisel_->on_init();
-  chisel_cache_.clear();
+  if (chisel_cache_) {
+    chisel_cache_->Invalidate();
+  }
+
+  native_filter_.reset();
+  if (use_native_filter_) {
+    native_filter_ = NativeFilter::CompileChisel(chisel);
+    CLOG(DEBUG) << (native_filter_ ? "Evaluating the chisel filter natively" : "The chisel can only be run through Lua");
+  }
 }
 
 void SysdigService::AddSignalHandler(std::unique_ptr<SignalHandler> signal_handler) {
@@ -330,29 +496,45 @@ void SysdigService::AddSignalHandler(std::unique_ptr<SignalHandler> signal_handl
     }
   }
 
-  signal_handlers_.emplace_back(std::move(signal_handler), event_filter);
+  std::vector<uint16_t> event_types;
+  for (uint16_t type = 0; type < PPM_EVENT_MAX; type++) {
+    if (event_filter[type]) {
+      event_types.push_back(type);
+    }
+  }
+
+  dispatch_table_.Add(signal_handler.get(), event_types);
+  signal_handlers_.emplace_back(std::move(signal_handler), std::move(event_types));
 }
 
-void SysdigService::GetProcessInformation(uint64_t pid, ProcessInfoCallbackRef callback) {
-  std::lock_guard<std::mutex> lock(process_requests_mutex_);
+void SysdigService::RemoveSignalHandler(SignalHandler* signal_handler) {
+  auto it = std::find_if(signal_handlers_.begin(), signal_handlers_.end(),
+                         [signal_handler](const SignalHandlerEntry& entry) { return entry.handler.get() == signal_handler; });
+  if (it == signal_handlers_.end()) {
+    return;
+  }
 
-  pending_process_requests_.emplace_back(pid, callback);
+  signal_handler->SyncStats();
+  dispatch_table_.Remove(signal_handler, it->event_types);
+  // The dispatch table determines the order in which handlers are called, so this one can be swapped with the last one
+  // rather than shifting all following ones.
+  std::swap(*it, signal_handlers_.back());
+  signal_handlers_.pop_back();
 }
 
-void SysdigService::ServePendingProcessRequests() {
-  std::lock_guard<std::mutex> lock(process_requests_mutex_);
+void SysdigService::GetProcessInformation(uint64_t pid, ProcessInfoCallbackRef callback) {
+  pending_process_requests_.Push({pid, std::move(callback)});
+}
 
-  while (!pending_process_requests_.empty()) {
-    auto& request = pending_process_requests_.front();
+void SysdigService::ServePendingProcessRequests() {
+  pending_process_requests_.ConsumeAll([this](std::pair<uint64_t, ProcessInfoCallbackRef>&& request) {
     uint64_t pid = request.first;
     auto callback = request.second.lock();
 
     if (callback) {
       (*callback)(inspector_->get_thread_ref(pid, true));
     }
-
-    pending_process_requests_.pop_front();
-  }
+  });
 }
 
 }  // namespace collector
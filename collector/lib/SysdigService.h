@@ -3,9 +3,10 @@
 
 #include <atomic>
 #include <bitset>
+#include <chrono>
 #include <memory>
-#include <mutex>
 #include <string>
+#include <vector>
 
 // clang-format off
 // sinsp.h needs to be included before chisel.h
@@ -14,13 +15,26 @@
 #include "chisel.h"
 // clang-format on
 
+#include "ChiselCache.h"
 #include "Control.h"
+#include "EventTimer.h"
+#include "MPSCQueue.h"
+#include "NativeFilter.h"
+#include "OverloadShedder.h"
+#include "SeqLock.h"
+#include "SignalDispatchTable.h"
 #include "SignalHandler.h"
 #include "SignalServiceClient.h"
 #include "Sysdig.h"
 
 namespace collector {
 
+// SysdigService captures events with libsinsp and dispatches them to the signal handlers.
+//
+// The inspector is only accessed from the thread calling Start, Run, SetChisel and CleanUp, such that the event loop
+// does not need to take any locks. Other threads only interact with it through lock-free structures: process
+// information requests are queued in an MPSCQueue and served by the event loop, and the stats returned by GetStats
+// are a snapshot published by the event loop every kStatsPublishInterval.
 class SysdigService : public Sysdig {
  public:
   static constexpr char kModulePath[] = "/module/collector.ko";
@@ -29,6 +43,8 @@ class SysdigService : public Sysdig {
   static constexpr char kProbeName[] = "collector-ebpf";
   static constexpr int kMessageBufferSize = 8192;
   static constexpr int kKeyBufferSize = 48;
+  static constexpr std::chrono::milliseconds kStatsPublishInterval{100};
+  static constexpr std::chrono::seconds kSheddingInterval{1};
 
   SysdigService() = default;
 
@@ -41,56 +57,89 @@ class SysdigService : public Sysdig {
   bool GetStats(SysdigStats* stats) const override;
 
   bool InitKernel(const CollectorConfig& config, const DriverCandidate& candidate) override;
+  // InitReplay opens the capture file configured with ROX_COLLECTOR_REPLAY_FILE instead of a kernel driver. Run then
+  // handles its events as fast as possible, and returns for good once all have been handled.
+  bool InitReplay(const CollectorConfig& config) override;
+
+  // ReplayFinished returns whether all the events of the replayed capture file have been handled.
+  bool ReplayFinished() const { return replay_finished_; }
 
   typedef std::weak_ptr<std::function<void(threadinfo_map_t::ptr_t)>> ProcessInfoCallbackRef;
 
   void GetProcessInformation(uint64_t pid, ProcessInfoCallbackRef callback);
 
  private:
-  enum ChiselCacheStatus : int {
-    BLOCKED_USERSPACE,
-    BLOCKED_KERNEL,
-    ACCEPTED,
-  };
-
   struct SignalHandlerEntry {
     std::unique_ptr<SignalHandler> handler;
-    std::bitset<PPM_EVENT_MAX> event_filter;
+    // The event types the handler is interested in, such that removing it from the dispatch table only touches those.
+    std::vector<uint16_t> event_types;
 
-    SignalHandlerEntry(std::unique_ptr<SignalHandler> handler, std::bitset<PPM_EVENT_MAX> event_filter)
-        : handler(std::move(handler)), event_filter(event_filter) {}
-
-    bool ShouldHandle(sinsp_evt* evt) const {
-      return event_filter[evt->get_type()];
-    }
+    SignalHandlerEntry(std::unique_ptr<SignalHandler> handler, std::vector<uint16_t> event_types)
+        : handler(std::move(handler)), event_types(std::move(event_types)) {}
   };
 
-  sinsp_evt* GetNext();
+  // GetNext returns the next event to handle, if any. parse_start is the current time of timer_, and *timed is set if
+  // the event is to be timed.
+  sinsp_evt* GetNext(int64_t parse_start, bool* timed);
 
   bool FilterEvent(sinsp_evt* event);
+  // RunChisel checks the event against the chisel, natively if possible.
+  bool RunChisel(sinsp_evt* event) {
+    return native_filter_ ? native_filter_->Match(event) : chisel_->process(event);
+  }
   bool SendExistingProcesses(SignalHandler* handler);
 
   void AddSignalHandler(std::unique_ptr<SignalHandler> signal_handler);
+  // RemoveSignalHandler removes (and destroys) a handler, e.g., once it has finished. This takes a scan of the (few)
+  // handlers, and touches the dispatch table only for the event types of the handler.
+  void RemoveSignalHandler(SignalHandler* signal_handler);
+
+  // CreateInspector creates the inspector, if not done yet.
+  void CreateInspector(const CollectorConfig& config);
+
+  // LogReplaySummary logs the throughput and time spent in each step of the replay, which took elapsed_micros.
+  void LogReplaySummary(int64_t elapsed_micros);
+
+  // PublishStats publishes the kernel and userspace stats for GetStats. now is the current time of timer_.
+  void PublishStats(int64_t now);
+
+  // UpdateShedding feeds the kernel stats to the overload shedder, and stops or resumes capturing the syscalls of the
+  // levels it moved across. now is the current time of timer_.
+  void UpdateShedding(int64_t now, const scap_stats& kernel_stats);
 
-  mutable std::mutex libsinsp_mutex_;
   std::unique_ptr<sinsp> inspector_;
   std::unique_ptr<sinsp_evt_formatter> default_formatter_;
   std::unique_ptr<sinsp_chisel> chisel_;
+  std::unique_ptr<NativeFilter> native_filter_;
+  bool use_native_filter_ = true;
   std::unique_ptr<ISignalServiceClient> signal_client_;
   std::vector<SignalHandlerEntry> signal_handlers_;
+  SignalDispatchTable dispatch_table_;
   SysdigStats userspace_stats_;
+  EventTimer timer_;
+  SeqLock<SysdigStats> published_stats_;
+  int64_t next_stats_publish_micros_ = 0;
   std::bitset<PPM_EVENT_MAX> global_event_filter_;
 
-  std::unordered_map<std::string, ChiselCacheStatus> chisel_cache_;
-  bool use_chisel_cache_;
+  // Null if the chisel cache is disabled.
+  std::unique_ptr<ChiselCache> chisel_cache_;
+
+  // Null if overload shedding is disabled. shed_ppm_sc_ holds the syscall codes of each level of the shedder.
+  std::unique_ptr<OverloadShedder> overload_shedder_;
+  std::vector<std::vector<ppm_sc_code>> shed_ppm_sc_;
+  int64_t next_shedding_update_micros_ = 0;
+
+  // Capture file events are recorded to, if any.
+  std::string record_file_;
+  bool replaying_ = false;
+  bool replay_finished_ = false;
+  int64_t replay_start_micros_ = 0;
 
-  mutable std::mutex running_mutex_;
-  bool running_ = false;
+  std::atomic<bool> running_{false};
 
   void ServePendingProcessRequests();
-  mutable std::mutex process_requests_mutex_;
-  // [ ( pid, callback ), ( pid, callback ), ... ]
-  std::list<std::pair<uint64_t, ProcessInfoCallbackRef>> pending_process_requests_;
+  // ( pid, callback )
+  MPSCQueue<std::pair<uint64_t, ProcessInfoCallbackRef>> pending_process_requests_;
 };
 
 }  // namespace collector
@@ -2,6 +2,7 @@
 #define COLLECTOR_TIME_UTIL_H
 
 #include <chrono>
+#include <ctime>
 
 namespace collector {
 
@@ -10,6 +11,13 @@ inline int64_t NowMicros() {
   return std::chrono::system_clock::now().time_since_epoch() / std::chrono::microseconds(1);
 }
 
+// ThreadCPUTimeMicros returns the CPU time consumed by the calling thread so far, in microseconds.
+inline int64_t ThreadCPUTimeMicros() {
+  struct timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return 0;
+  return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
 }  // namespace collector
 
 #endif  // COLLECTOR_TIME_UTIL_H
@@ -0,0 +1,121 @@
+#include <chrono>
+
+#include "AdaptiveScrapeInterval.h"
+#include "gtest/gtest.h"
+
+namespace collector {
+
+namespace {
+
+using std::chrono::seconds;
+using Reason = AdaptiveScrapeInterval::Reason;
+
+TEST(AdaptiveScrapeIntervalTest, FixedInterval) {
+  AdaptiveScrapeInterval interval(seconds(30), seconds(30), seconds(30));
+  EXPECT_FALSE(interval.enabled());
+
+  EXPECT_EQ(interval.Update(100, 0), Reason::NONE);
+  EXPECT_EQ(interval.Update(200, 100000), Reason::NONE);
+  EXPECT_EQ(interval.interval(), seconds(30));
+}
+
+TEST(AdaptiveScrapeIntervalTest, ClampsToBounds) {
+  AdaptiveScrapeInterval interval(seconds(30), seconds(5), seconds(20));
+  EXPECT_EQ(interval.interval(), seconds(20));
+
+  AdaptiveScrapeInterval zero(seconds(0), seconds(0), seconds(0));
+  EXPECT_EQ(zero.interval(), seconds(1));
+}
+
+TEST(AdaptiveScrapeIntervalTest, ShortenOnDrops) {
+  AdaptiveScrapeInterval interval(seconds(30), seconds(5), seconds(60));
+
+  EXPECT_EQ(interval.Update(10, 10), Reason::DROPS);
+  EXPECT_EQ(interval.interval(), seconds(15));
+  EXPECT_EQ(interval.Update(20, 10), Reason::DROPS);
+  EXPECT_EQ(interval.interval(), seconds(7));
+  EXPECT_EQ(interval.Update(30, 10), Reason::DROPS);
+  EXPECT_EQ(interval.interval(), seconds(5));
+
+  // Already at the lower bound.
+  EXPECT_EQ(interval.Update(40, 10), Reason::NONE);
+  EXPECT_EQ(interval.interval(), seconds(5));
+}
+
+TEST(AdaptiveScrapeIntervalTest, LengthenWhenQuiet) {
+  AdaptiveScrapeInterval interval(seconds(10), seconds(5), seconds(20));
+
+  EXPECT_EQ(interval.Update(0, 10), Reason::QUIET);
+  EXPECT_EQ(interval.interval(), seconds(12));
+  EXPECT_EQ(interval.Update(0, 0), Reason::QUIET);
+  EXPECT_EQ(interval.interval(), seconds(15));
+  EXPECT_EQ(interval.Update(0, 0), Reason::QUIET);
+  EXPECT_EQ(interval.interval(), seconds(18));
+  EXPECT_EQ(interval.Update(0, 0), Reason::QUIET);
+  EXPECT_EQ(interval.interval(), seconds(20));
+
+  // Already at the upper bound.
+  EXPECT_EQ(interval.Update(0, 0), Reason::NONE);
+  EXPECT_EQ(interval.interval(), seconds(20));
+}
+
+TEST(AdaptiveScrapeIntervalTest, SteadyDeltasKeepInterval) {
+  AdaptiveScrapeInterval interval(seconds(10), seconds(5), seconds(40));
+
+  // Deltas that are neither small nor spikes do not lengthen the interval, not even on the first update, or while the
+  // delta per second falls as the interval grows.
+  for (int i = 0; i < 10; i++) {
+    EXPECT_EQ(interval.Update(0, 50), Reason::NONE);
+  }
+  EXPECT_EQ(interval.interval(), seconds(10));
+}
+
+TEST(AdaptiveScrapeIntervalTest, RecoverConfiguredInterval) {
+  AdaptiveScrapeInterval interval(seconds(10), seconds(5), seconds(40));
+
+  EXPECT_EQ(interval.Update(1, 50), Reason::DROPS);
+  EXPECT_EQ(interval.interval(), seconds(5));
+
+  // Steady deltas lengthen a shortened interval, but not beyond the configured one.
+  EXPECT_EQ(interval.Update(1, 50), Reason::STEADY);
+  EXPECT_EQ(interval.interval(), seconds(6));
+  EXPECT_EQ(interval.Update(1, 50), Reason::STEADY);
+  EXPECT_EQ(interval.Update(1, 50), Reason::STEADY);
+  EXPECT_EQ(interval.interval(), seconds(8));
+  EXPECT_EQ(interval.Update(1, 50), Reason::STEADY);
+  EXPECT_EQ(interval.interval(), seconds(10));
+  EXPECT_EQ(interval.Update(1, 50), Reason::NONE);
+  EXPECT_EQ(interval.interval(), seconds(10));
+
+  // Small deltas lengthen it further.
+  EXPECT_EQ(interval.Update(1, AdaptiveScrapeInterval::kMaxQuietDeltaSize), Reason::QUIET);
+  EXPECT_EQ(interval.interval(), seconds(12));
+}
+
+TEST(AdaptiveScrapeIntervalTest, ShortenOnDeltaSpike) {
+  AdaptiveScrapeInterval interval(seconds(20), seconds(5), seconds(20));
+
+  EXPECT_EQ(interval.Update(0, 200), Reason::NONE);
+  EXPECT_EQ(interval.Update(0, 1000), Reason::DELTA_SPIKE);
+  EXPECT_EQ(interval.interval(), seconds(10));
+
+  // Small deltas never count as a spike.
+  AdaptiveScrapeInterval small(seconds(20), seconds(5), seconds(20));
+  EXPECT_EQ(small.Update(0, 1), Reason::NONE);
+  EXPECT_EQ(small.Update(0, 50), Reason::NONE);
+  EXPECT_EQ(small.interval(), seconds(20));
+}
+
+TEST(AdaptiveScrapeIntervalTest, DropsAreCountedSinceLastUpdate) {
+  AdaptiveScrapeInterval interval(seconds(20), seconds(5), seconds(40));
+
+  EXPECT_EQ(interval.Update(5, 0), Reason::DROPS);
+  EXPECT_EQ(interval.interval(), seconds(10));
+  // The total did not change, so there were no new drops.
+  EXPECT_EQ(interval.Update(5, 0), Reason::QUIET);
+  EXPECT_EQ(interval.interval(), seconds(12));
+}
+
+}  // namespace
+
+}  // namespace collector
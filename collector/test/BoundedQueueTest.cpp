@@ -0,0 +1,93 @@
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "BoundedQueue.h"
+#include "gtest/gtest.h"
+
+namespace collector {
+
+namespace {
+
+void Append(std::vector<int>* pending, std::vector<int>&& item) {
+  pending->insert(pending->end(), item.begin(), item.end());
+}
+
+TEST(BoundedQueueTest, PushPop) {
+  BoundedQueue<std::vector<int>> queue(2);
+
+  EXPECT_TRUE(queue.Push({1}, Append));
+  EXPECT_TRUE(queue.Push({2}, Append));
+  EXPECT_EQ(queue.size(), 2);
+
+  std::vector<int> item;
+  ASSERT_TRUE(queue.Pop(&item));
+  EXPECT_EQ(item, std::vector<int>({1}));
+  ASSERT_TRUE(queue.Pop(&item));
+  EXPECT_EQ(item, std::vector<int>({2}));
+  EXPECT_FALSE(queue.PopFor(&item, std::chrono::milliseconds(1)));
+}
+
+TEST(BoundedQueueTest, MergeWhenFull) {
+  BoundedQueue<std::vector<int>> queue(2);
+
+  EXPECT_TRUE(queue.Push({1}, Append));
+  EXPECT_TRUE(queue.Push({2}, Append));
+  EXPECT_FALSE(queue.Push({3}, Append));
+  EXPECT_FALSE(queue.Push({4}, Append));
+  EXPECT_EQ(queue.size(), 2);
+
+  std::vector<int> item;
+  ASSERT_TRUE(queue.Pop(&item));
+  EXPECT_EQ(item, std::vector<int>({1}));
+  ASSERT_TRUE(queue.Pop(&item));
+  EXPECT_EQ(item, std::vector<int>({2, 3, 4}));
+}
+
+TEST(BoundedQueueTest, ShutdownWakesConsumer) {
+  BoundedQueue<std::vector<int>> queue(1);
+  queue.Push({1}, Append);
+
+  std::thread consumer([&queue] {
+    std::vector<int> item;
+    while (queue.Pop(&item)) {
+    }
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  queue.Shutdown();
+  consumer.join();
+
+  EXPECT_TRUE(queue.Push({2}, Append));
+  EXPECT_EQ(queue.size(), 0);
+}
+
+TEST(BoundedQueueTest, ProducerConsumer) {
+  constexpr int kNumItems = 10000;
+  BoundedQueue<std::vector<int>> queue(4);
+
+  std::thread producer([&queue] {
+    for (int i = 0; i < kNumItems; i++) {
+      queue.Push({i}, Append);
+    }
+    queue.Push({-1}, Append);
+  });
+
+  // Every item is received exactly once and in order, regardless of how the items were merged.
+  std::vector<int> received;
+  std::vector<int> item;
+  while (received.empty() || received.back() != -1) {
+    ASSERT_TRUE(queue.PopFor(&item, std::chrono::seconds(5)));
+    Append(&received, std::move(item));
+  }
+  producer.join();
+
+  ASSERT_EQ(received.size(), kNumItems + 1);
+  for (int i = 0; i < kNumItems; i++) {
+    EXPECT_EQ(received[i], i);
+  }
+}
+
+}  // namespace
+
+}  // namespace collector
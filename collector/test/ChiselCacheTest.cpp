@@ -0,0 +1,78 @@
+#include <string>
+
+#include "ChiselCache.h"
+#include "gtest/gtest.h"
+
+namespace collector {
+
+namespace {
+
+TEST(ChiselCacheTest, LookupAndInsert) {
+  ChiselCache cache(4);
+  EXPECT_EQ(cache.Lookup("a"), ChiselCache::MISS);
+
+  EXPECT_FALSE(cache.Insert("a", true));
+  EXPECT_FALSE(cache.Insert("b", false));
+  EXPECT_EQ(cache.Lookup("a"), ChiselCache::ACCEPTED);
+  EXPECT_EQ(cache.Lookup("b"), ChiselCache::BLOCKED);
+  EXPECT_EQ(cache.size(), 2);
+
+  // Inserting an existing container updates its result.
+  EXPECT_FALSE(cache.Insert("b", true));
+  EXPECT_EQ(cache.Lookup("b"), ChiselCache::ACCEPTED);
+  EXPECT_EQ(cache.size(), 2);
+}
+
+TEST(ChiselCacheTest, EvictsLeastRecentlyUsed) {
+  ChiselCache cache(3);
+  cache.Insert("a", true);
+  cache.Insert("b", true);
+  cache.Insert("c", true);
+
+  // The first sweep clears all referenced bits, and evicts a.
+  EXPECT_TRUE(cache.Insert("d", true));
+  EXPECT_EQ(cache.Lookup("a"), ChiselCache::MISS);
+
+  // b and c are not referenced anymore, unless they are used again.
+  EXPECT_EQ(cache.Lookup("b"), ChiselCache::ACCEPTED);
+  EXPECT_TRUE(cache.Insert("e", true));
+  EXPECT_EQ(cache.Lookup("b"), ChiselCache::ACCEPTED);
+  EXPECT_EQ(cache.Lookup("c"), ChiselCache::MISS);
+  EXPECT_EQ(cache.Lookup("d"), ChiselCache::ACCEPTED);
+  EXPECT_EQ(cache.Lookup("e"), ChiselCache::ACCEPTED);
+  EXPECT_EQ(cache.size(), 3);
+}
+
+TEST(ChiselCacheTest, Invalidate) {
+  ChiselCache cache(2);
+  cache.Insert("a", true);
+  cache.Insert("b", false);
+  cache.Invalidate();
+
+  EXPECT_EQ(cache.Lookup("a"), ChiselCache::MISS);
+  EXPECT_EQ(cache.Lookup("b"), ChiselCache::MISS);
+
+  // Results of previous generations are reclaimed without counting as evictions.
+  EXPECT_FALSE(cache.Insert("b", true));
+  EXPECT_FALSE(cache.Insert("c", true));
+  EXPECT_EQ(cache.Lookup("a"), ChiselCache::MISS);
+  EXPECT_EQ(cache.Lookup("b"), ChiselCache::ACCEPTED);
+  EXPECT_EQ(cache.Lookup("c"), ChiselCache::ACCEPTED);
+  EXPECT_TRUE(cache.Insert("d", true));
+}
+
+TEST(ChiselCacheTest, Churn) {
+  ChiselCache cache(16);
+  for (int i = 0; i < 1000; i++) {
+    std::string id = "container-" + std::to_string(i);
+    cache.Insert(id, i % 2 == 0);
+    ASSERT_EQ(cache.Lookup(id), i % 2 == 0 ? ChiselCache::ACCEPTED : ChiselCache::BLOCKED);
+  }
+  EXPECT_EQ(cache.size(), 16);
+  EXPECT_EQ(cache.Lookup("container-999"), ChiselCache::BLOCKED);
+  EXPECT_EQ(cache.Lookup("container-0"), ChiselCache::MISS);
+}
+
+}  // namespace
+
+}  // namespace collector
@@ -1,5 +1,14 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
 #include <string_view>
 
+#include <unistd.h>
+
+#include "CollectorStats.h"
+#include "IoUring.h"
+#include "ProcfsScraper.h"
 #include "ProcfsScraper_internal.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -8,6 +17,128 @@ namespace collector {
 
 namespace {
 
+const char kContainerCgroup[] = "0::/kubepods/besteffort/pod8e18d5f1-1421-42b7-8151-fb1c3be4bd4d/e73c55f3e7f5b6a9cfc32a89bf13e44d348bcc4fa7b079f804d61fb1532ddbe5";
+const char kSidecarCgroup[] = "0::/kubepods/besteffort/pod8e18d5f1-1421-42b7-8151-fb1c3be4bd4d/9b1a5f0a3c2d4e6f8091a2b3c4d5e6f708192a3b4c5d6e7f8091a2b3c4d5e6f7";
+const char kHostCgroup[] = "0::/user.slice/user-1000.slice/session-2.scope";
+
+const char kNetTCPHeader[] = "  sl  local_address rem_address   st tx_queue rx_queue tr tm->when retrnsmt   uid  timeout inode\n";
+const char kNetTCP6Header[] = "  sl  local_address                         remote_address                        st tx_queue rx_queue tr tm->when retrnsmt   uid  timeout inode\n";
+const char kNetUDPHeader[] = "   sl  local_address rem_address   st tx_queue rx_queue tr tm->when retrnsmt   uid  timeout inode ref pointer drops\n";
+const char kNetUDP6Header[] = "  sl  local_address                         remote_address                        st tx_queue rx_queue tr tm->when retrnsmt   uid  timeout inode ref pointer drops\n";
+
+// FakeProcDir creates a minimal `/proc`-like directory structure in a temporary directory, in the spirit of
+// integration-tests/scripts/create-fake-proc-dir.sh.
+class FakeProcDir {
+ public:
+  FakeProcDir() {
+    char path_template[] = "/tmp/connscraper-test-XXXXXX";
+    path_ = mkdtemp(path_template);
+  }
+
+  ~FakeProcDir() {
+    std::filesystem::remove_all(path_);
+  }
+
+  const std::string& path() const { return path_; }
+
+  void AddProcess(uint64_t pid, uint64_t start_time, const std::string& cgroup, ino_t netns_inode,
+                  const std::vector<ino_t>& socket_inodes, const std::string& net_tcp = kNetTCPHeader,
+                  const std::string& net_udp = kNetUDPHeader) {
+    std::string pid_dir = PidDir(pid);
+    std::filesystem::create_directories(pid_dir + "/ns");
+    std::filesystem::create_directories(pid_dir + "/fd");
+    std::filesystem::create_directories(pid_dir + "/net");
+
+    SetStartTime(pid, start_time);
+    WriteFile(pid_dir + "/cgroup", cgroup + "\n");
+    std::filesystem::create_symlink("net:[" + std::to_string(netns_inode) + "]", pid_dir + "/ns/net");
+
+    int fd = 3;
+    for (ino_t inode : socket_inodes) {
+      std::filesystem::create_symlink("socket:[" + std::to_string(inode) + "]", pid_dir + "/fd/" + std::to_string(fd++));
+    }
+    std::filesystem::create_symlink("/dev/null", pid_dir + "/fd/" + std::to_string(fd));
+
+    WriteFile(pid_dir + "/net/tcp", net_tcp);
+    WriteFile(pid_dir + "/net/tcp6", kNetTCP6Header);
+    WriteFile(pid_dir + "/net/udp", net_udp);
+    WriteFile(pid_dir + "/net/udp6", kNetUDP6Header);
+  }
+
+  // SetStartTime writes a `stat` file for the given pid. The comm field intentionally contains spaces and parentheses.
+  void SetStartTime(uint64_t pid, uint64_t start_time) {
+    WriteFile(PidDir(pid) + "/stat", std::to_string(pid) + " (a (b) c) S 1 1 1 0 -1 4194560 100 0 0 0 0 0 0 0 20 0 1 0 " + std::to_string(start_time) + " 1000 100 18446744073709551615 1 1 0 0 0 0 0 0 0 0 0 0 17 0 0 0 0 0 0\n");
+  }
+
+  void RemoveProcess(uint64_t pid) {
+    std::filesystem::remove_all(PidDir(pid));
+  }
+
+  // SetSocket points the given fd of a process to the socket with the given inode.
+  void SetSocket(uint64_t pid, int fd, ino_t inode) {
+    std::string fd_path = PidDir(pid) + "/fd/" + std::to_string(fd);
+    std::filesystem::remove(fd_path);
+    std::filesystem::create_symlink("socket:[" + std::to_string(inode) + "]", fd_path);
+  }
+
+  // SetNetNSSockets writes a `net/sockstat` file for the given pid, reporting the given number of sockets in use.
+  void SetNetNSSockets(uint64_t pid, int sockets) {
+    WriteFile(PidDir(pid) + "/net/sockstat", "sockets: used " + std::to_string(sockets) + "\nTCP: inuse 1 orphan 0 tw 0 alloc 1 mem 0\n");
+  }
+
+ private:
+  std::string PidDir(uint64_t pid) const { return path_ + "/" + std::to_string(pid); }
+
+  static void WriteFile(const std::string& path, const std::string& content) {
+    std::ofstream out(path);
+    out << content;
+  }
+
+  std::string path_;
+};
+
+int64_t GetCounter(CollectorStats::CounterType counter) {
+  return CollectorStats::GetOrCreate().GetCounter(counter);
+}
+
+// RandomConnLine returns a random `net/tcp[6]` line (without the trailing newline), formatted like the kernel does.
+std::string RandomConnLine(std::mt19937* rng, int sl, Address::Family family, ino_t inode) {
+  std::uniform_int_distribution<uint32_t> u32;
+  auto endpoint = [&]() {
+    std::string result;
+    char buf[16];
+    for (size_t i = 0; i < Address::Length(family) / 4; i++) {
+      std::snprintf(buf, sizeof(buf), "%08X", u32(*rng));
+      result += buf;
+    }
+    std::snprintf(buf, sizeof(buf), ":%04X", u32(*rng) & 0xFFFF);
+    return result + buf;
+  };
+
+  std::string local = endpoint();
+  std::string remote = endpoint();
+  char line[512];
+  std::snprintf(line, sizeof(line), "%4d: %s %s %02X %08X:%08X %02X:%08X %08X %5u %8d %lu %d 0000000000000000 %u %u %u %u %d",
+                sl, local.c_str(), remote.c_str(), u32(*rng) % 12 + 1, u32(*rng) % 4096, u32(*rng) % 4096,
+                u32(*rng) % 5, u32(*rng), u32(*rng) % 16, u32(*rng) % 65536, 0, static_cast<unsigned long>(inode),
+                1, 20, 4, 30, 10, -1);
+  return line;
+}
+
+// ParseConnLineReference invokes the reference parser the way it used to be invoked on fgets()-ed lines.
+bool ParseConnLineReference(const std::string& line, Address::Family family, ConnLineData* data) {
+  char buf[512] = {};
+  line.copy(buf, sizeof(buf) - 1);
+  return ParseConnLine(buf, buf + sizeof(buf), family, data);
+}
+
+void ExpectSameConnLineData(const ConnLineData& expected, const ConnLineData& actual, const std::string& line) {
+  EXPECT_EQ(expected.local, actual.local) << line;
+  EXPECT_EQ(expected.remote, actual.remote) << line;
+  EXPECT_EQ(expected.state, actual.state) << line;
+  EXPECT_EQ(expected.inode, actual.inode) << line;
+}
+
 TEST(ConnScraperTest, TestExtractContainerID) {
   struct TestCase {
     std::string_view input, expected_output;
@@ -46,6 +177,445 @@ TEST(ConnScraperTest, TestExtractContainerID) {
   }
 }
 
+TEST(ConnScraperTest, TestIsContainerIDFast) {
+  const std::string valid = "e73c55f3e7f5b6a9cfc32a89bf13e44d348bcc4fa7b079f804d61fb1532ddbe5";
+  EXPECT_TRUE(IsContainerIDFast(valid));
+  EXPECT_FALSE(IsContainerIDFast(valid.substr(1)));
+  EXPECT_FALSE(IsContainerIDFast(valid + "0"));
+  EXPECT_FALSE(IsContainerIDFast(""));
+
+  // Replacing any single character by any other byte gives the same verdict as the reference implementation.
+  for (size_t i = 0; i < valid.size(); i++) {
+    for (int c = 0; c < 256; c++) {
+      std::string mutated = valid;
+      mutated[i] = static_cast<char>(c);
+      ASSERT_EQ(IsContainerIDFast(mutated), IsContainerID(mutated)) << "position " << i << ", byte " << c;
+    }
+  }
+}
+
+TEST(ConnScraperTest, TestContainerIDCache) {
+  ContainerIDCache cache;
+  std::string container_id;
+
+  int64_t hits = GetCounter(CollectorStats::procfs_container_id_cache_hits);
+  int64_t misses = GetCounter(CollectorStats::procfs_container_id_cache_misses);
+  EXPECT_TRUE(cache.Resolve(std::string(kContainerCgroup) + "\n", &container_id));
+  EXPECT_EQ(container_id, "e73c55f3e7f5");
+  EXPECT_TRUE(cache.Resolve(kContainerCgroup, &container_id));
+  EXPECT_EQ(container_id, "e73c55f3e7f5");
+  EXPECT_EQ(GetCounter(CollectorStats::procfs_container_id_cache_hits) - hits, 1);
+  EXPECT_EQ(GetCounter(CollectorStats::procfs_container_id_cache_misses) - misses, 1);
+
+  // Host cgroups are cached as well.
+  container_id.clear();
+  EXPECT_FALSE(cache.Resolve(kHostCgroup, &container_id));
+  EXPECT_FALSE(cache.Resolve(kHostCgroup, &container_id));
+  EXPECT_EQ(container_id, "");
+  EXPECT_EQ(cache.size(), 2);
+
+  // cgroup v1 files are parsed, but not cached.
+  EXPECT_TRUE(cache.Resolve("5:pids:/docker/951e643e3c241b225b6284ef2b79a37c13fc64cbf65b5d46bda95fcb98fe63a4\n1:name=systemd:/\n", &container_id));
+  EXPECT_EQ(container_id, "951e643e3c24");
+  EXPECT_EQ(cache.size(), 2);
+
+  // Once full, the cache starts over.
+  cache.Clear();
+  for (size_t i = 0; i < ContainerIDCache::kMaxEntries; i++) {
+    cache.Resolve("0::/system.slice/unit-" + std::to_string(i) + ".service", &container_id);
+  }
+  EXPECT_EQ(cache.size(), ContainerIDCache::kMaxEntries);
+  EXPECT_TRUE(cache.Resolve(kSidecarCgroup, &container_id));
+  EXPECT_EQ(container_id, "9b1a5f0a3c2d");
+  EXPECT_EQ(cache.size(), 1);
+}
+
+TEST(ConnScraperTest, TestContainerIDCacheShared) {
+  const std::string cgroup = "0::/kubepods.slice/kubepods-besteffort.slice/cri-containerd-4f0c2d7e9a1b3c5d7e9f0a2b4c6d8e0f1a3b5c7d9e1f2a4b6c8d0e2f4a6b8c0d.scope";
+  FakeProcDir proc;
+  proc.AddProcess(200, 1000, cgroup, 4026532000, {});
+  proc.AddProcess(201, 1000, cgroup, 4026532000, {});
+
+  // The first lookup of the cgroup extracts the container ID, every other process of the container hits the cache,
+  // whether it is scraped by a ProcessScraper or a ConnScraper.
+  int64_t hits = GetCounter(CollectorStats::procfs_container_id_cache_hits);
+  int64_t misses = GetCounter(CollectorStats::procfs_container_id_cache_misses);
+  ProcessScraper process_scraper(proc.path());
+  std::string container_id;
+  ASSERT_TRUE(process_scraper.ScrapeContainerID(200, &container_id));
+  EXPECT_EQ(container_id, "4f0c2d7e9a1b");
+  EXPECT_FALSE(process_scraper.ScrapeContainerID(202, &container_id));
+
+  ConnScraper conn_scraper(proc.path());
+  std::vector<Connection> connections;
+  ASSERT_TRUE(conn_scraper.Scrape(&connections, nullptr));
+  EXPECT_EQ(GetCounter(CollectorStats::procfs_container_id_cache_misses) - misses, 1);
+  EXPECT_EQ(GetCounter(CollectorStats::procfs_container_id_cache_hits) - hits, 2);
+}
+
+TEST(ConnScraperTest, TestScrapeFakeProc) {
+  FakeProcDir proc;
+  // 10.0.1.32:80 <- 192.168.1.4:50000, established
+  proc.AddProcess(200, 1000, kContainerCgroup, 4026532000, {5000},
+                  std::string(kNetTCPHeader) + "   0: 2001000A:0050 0401A8C0:C350 01 00000000:00000000 00:00000000 00000000     0        0 5000 1 0000000000000000 20 4 30 10 -1\n");
+  proc.AddProcess(100, 500, kHostCgroup, 4026531992, {6000});
+
+  ConnScraper scraper(proc.path());
+  std::vector<Connection> connections;
+  ASSERT_TRUE(scraper.Scrape(&connections, nullptr));
+
+  Connection expected("e73c55f3e7f5", Endpoint(Address(10, 0, 1, 32), 80), Endpoint(Address(192, 168, 1, 4), 50000), L4Proto::TCP, true);
+  EXPECT_THAT(connections, testing::ElementsAre(expected));
+}
+
+TEST(ConnScraperTest, TestScrapeUDP) {
+  // The entries of `net/udp` are not ordered by state, so the connected socket of the server is listed before the
+  // socket it is bound with.
+  std::string net_udp = std::string(kNetUDPHeader) +
+                        // 10.0.1.32:53 <- 192.168.1.4:50000, connected
+                        "   53: 2001000A:0035 0401A8C0:C350 01 00000000:00000000 00:00000000 00000000     0        0 5001 2 0000000000000000 0\n"
+                        // 0.0.0.0:53, bound
+                        "   53: 00000000:0035 00000000:0000 07 00000000:00000000 00:00000000 00000000     0        0 5000 2 0000000000000000 0\n"
+                        // 0.0.0.0:41000, implicitly bound by a client
+                        "  170: 00000000:A028 00000000:0000 07 00000000:00000000 00:00000000 00000000     0        0 5002 2 0000000000000000 0\n"
+                        // 10.0.1.32:41001 -> 10.0.2.10:5353, connected
+                        "  171: 2001000A:A029 0A02000A:14E9 01 00000000:00000000 00:00000000 00000000     0        0 5003 2 0000000000000000 0\n";
+  FakeProcDir proc;
+  proc.AddProcess(200, 1000, kContainerCgroup, 4026532000, {5000, 5001, 5002, 5003}, kNetTCPHeader, net_udp);
+
+  ConnScraper scraper(proc.path());
+  std::vector<Connection> connections;
+  std::vector<ContainerEndpoint> listen_endpoints;
+  ASSERT_TRUE(scraper.Scrape(&connections, &listen_endpoints));
+
+  Connection server_conn("e73c55f3e7f5", Endpoint(Address(10, 0, 1, 32), 53), Endpoint(Address(192, 168, 1, 4), 50000), L4Proto::UDP, true);
+  Connection client_conn("e73c55f3e7f5", Endpoint(Address(10, 0, 1, 32), 41001), Endpoint(Address(10, 0, 2, 10), 5353), L4Proto::UDP, false);
+  EXPECT_THAT(connections, testing::UnorderedElementsAre(server_conn, client_conn));
+
+  ContainerEndpoint expected_endpoint("e73c55f3e7f5", Endpoint(Address(0, 0, 0, 0), 53), L4Proto::UDP, nullptr);
+  EXPECT_THAT(listen_endpoints, testing::ElementsAre(expected_endpoint));
+}
+
+TEST(ConnScraperTest, TestScrapeIoUring) {
+  FakeProcDir proc;
+  // More processes than are scraped in a single batch, every third one in a container with one connection.
+  for (int i = 0; i < 150; i++) {
+    if (i % 3) {
+      proc.AddProcess(100 + i, 1000 + i, kHostCgroup, 4026531992, {ino_t(6000 + i)});
+      continue;
+    }
+    // 10.0.1.32:<1000 + i> <- 192.168.1.4:50000, established, in a network namespace of its own
+    char line[256];
+    snprintf(line, sizeof(line), "   0: 2001000A:%04X 0401A8C0:C350 01 00000000:00000000 00:00000000 00000000     0        0 %d 1 0000000000000000 20 4 30 10 -1\n",
+             1000 + i, 5000 + i);
+    proc.AddProcess(100 + i, 1000 + i, kContainerCgroup, 4026532000 + i, {ino_t(5000 + i)}, kNetTCPHeader + std::string(line));
+  }
+
+  ConnScraper sync_scraper(proc.path());
+  ConnScraper io_uring_scraper(proc.path(), nullptr, true);
+
+  std::vector<Connection> expected, connections;
+  ASSERT_TRUE(sync_scraper.Scrape(&expected, nullptr));
+  EXPECT_EQ(expected.size(), 50);
+
+  // Scrape twice, such that both the uncached and the cached paths are covered. Without io_uring, the scraper falls back
+  // to synchronous reads.
+  bool have_io_uring = IoUring::Create(8) != nullptr;
+  for (int i = 0; i < 2; i++) {
+    int64_t submissions = GetCounter(CollectorStats::procfs_io_uring_submissions);
+    connections.clear();
+    ASSERT_TRUE(io_uring_scraper.Scrape(&connections, nullptr));
+    EXPECT_THAT(connections, testing::UnorderedElementsAreArray(expected));
+    EXPECT_EQ(GetCounter(CollectorStats::procfs_io_uring_submissions) > submissions, have_io_uring);
+  }
+}
+
+TEST(ConnScraperTest, TestParseConnLineFast) {
+  std::string line = "   0: 2001000A:0050 0401A8C0:C350 01 00000000:00000000 00:00000000 00000000     0        0 5000 1 0000000000000000 20 4 30 10 -1";
+  ConnLineData data;
+  ASSERT_TRUE(ParseConnLineFast(line.data(), line.data() + line.size(), Address::Family::IPV4, &data));
+  EXPECT_EQ(data.local, Endpoint(Address(10, 0, 1, 32), 80));
+  EXPECT_EQ(data.remote, Endpoint(Address(192, 168, 1, 4), 50000));
+  EXPECT_EQ(data.state, 1);
+  EXPECT_EQ(data.inode, 5000);
+
+  // ::ffff:10.0.1.32:80 <- ::1:50000
+  line = "   0: 0000000000000000FFFF00002001000A:0050 00000000000000000000000001000000:C350 01 00000000:00000000 00:00000000 00000000     0        0 5001 1 0000000000000000 20 4 30 10 -1";
+  ASSERT_TRUE(ParseConnLineFast(line.data(), line.data() + line.size(), Address::Family::IPV6, &data));
+  ConnLineData expected;
+  ASSERT_TRUE(ParseConnLineReference(line, Address::Family::IPV6, &expected));
+  ExpectSameConnLineData(expected, data, line);
+  EXPECT_EQ(data.local.port(), 80);
+  EXPECT_EQ(data.inode, 5001);
+
+  // Lowercase hex digits are never printed by the kernel.
+  line = "   0: 2001000a:0050 0401A8C0:C350 01 00000000:00000000 00:00000000 00000000     0        0 5000";
+  EXPECT_FALSE(ParseConnLineFast(line.data(), line.data() + line.size(), Address::Family::IPV4, &data));
+  // Truncated lines.
+  for (size_t len = 0; len < line.size() - 4; len++) {
+    EXPECT_FALSE(ParseConnLineFast(line.data(), line.data() + len, Address::Family::IPV4, &data)) << len;
+  }
+}
+
+// Differential test of the fast parser against the reference parser.
+TEST(ConnScraperTest, TestParseConnLineFastMatchesReference) {
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<uint64_t> u64;
+
+  for (auto family : {Address::Family::IPV4, Address::Family::IPV6}) {
+    for (int i = 0; i < 10000; i++) {
+      std::string line = RandomConnLine(&rng, i, family, i % 10 ? u64(rng) % (uint64_t(1) << (i % 64)) : 0);
+
+      ConnLineData expected, actual;
+      ASSERT_TRUE(ParseConnLineReference(line, family, &expected)) << line;
+      ASSERT_TRUE(ParseConnLineFast(line.data(), line.data() + line.size(), family, &actual)) << line;
+      ExpectSameConnLineData(expected, actual, line);
+    }
+  }
+}
+
+// Mutates valid lines at random. The fast parser is stricter than the reference parser, but every line it accepts
+// must be parsed to the same result by both.
+TEST(ConnScraperTest, TestParseConnLineFastMutated) {
+  static constexpr char kAlphabet[] = "0123456789ABCDEFGabcdefg:+- \t";
+  std::mt19937 rng(5678);
+  std::uniform_int_distribution<uint32_t> u32;
+
+  int accepted = 0;
+  for (auto family : {Address::Family::IPV4, Address::Family::IPV6}) {
+    for (int i = 0; i < 20000; i++) {
+      std::string line = RandomConnLine(&rng, i % 100, family, u32(rng));
+      int num_mutations = 1 + u32(rng) % 3;
+      for (int j = 0; j < num_mutations; j++) {
+        size_t pos = u32(rng) % line.size();
+        char c = kAlphabet[u32(rng) % (sizeof(kAlphabet) - 1)];
+        switch (u32(rng) % 3) {
+          case 0:
+            line[pos] = c;
+            break;
+          case 1:
+            line.insert(pos, 1, c);
+            break;
+          default:
+            line.erase(pos, 1);
+            break;
+        }
+      }
+
+      ConnLineData actual;
+      if (!ParseConnLineFast(line.data(), line.data() + line.size(), family, &actual)) continue;
+      accepted++;
+
+      ConnLineData expected;
+      ASSERT_TRUE(ParseConnLineReference(line, family, &expected)) << line;
+      ExpectSameConnLineData(expected, actual, line);
+    }
+  }
+  // Many mutations do not affect any of the fields we are interested in.
+  EXPECT_GT(accepted, 0);
+}
+
+TEST(ConnScraperTest, TestScrapeLargeNetTable) {
+  // Make the table larger than the initial read buffer, and put the interesting line at the end.
+  std::mt19937 rng(42);
+  std::string net_tcp = kNetTCPHeader;
+  int sl = 0;
+  while (net_tcp.size() < 256 * 1024) {
+    net_tcp += RandomConnLine(&rng, sl++, Address::Family::IPV4, 0) + "\n";
+  }
+  net_tcp += std::to_string(sl) + ": 2001000A:0050 0401A8C0:C350 01 00000000:00000000 00:00000000 00000000     0        0 5000 1 0000000000000000 20 4 30 10 -1\n";
+
+  FakeProcDir proc;
+  proc.AddProcess(200, 1000, kContainerCgroup, 4026532000, {5000}, net_tcp);
+
+  ConnScraper scraper(proc.path());
+  std::vector<Connection> connections;
+  ASSERT_TRUE(scraper.Scrape(&connections, nullptr));
+
+  Connection expected("e73c55f3e7f5", Endpoint(Address(10, 0, 1, 32), 80), Endpoint(Address(192, 168, 1, 4), 50000), L4Proto::TCP, true);
+  EXPECT_THAT(connections, testing::ElementsAre(expected));
+}
+
+TEST(ConnScraperTest, TestProcessMetadataCache) {
+  FakeProcDir proc;
+  proc.AddProcess(200, 1000, kContainerCgroup, 4026532000, {});
+  proc.AddProcess(100, 500, kHostCgroup, 4026531992, {});
+
+  ConnScraper scraper(proc.path());
+  std::vector<Connection> connections;
+
+  ASSERT_TRUE(scraper.Scrape(&connections, nullptr));
+
+  // Both processes are known now, so the next scrape hits the cache for each of them.
+  int64_t hits = GetCounter(CollectorStats::procfs_metadata_cache_hits);
+  int64_t misses = GetCounter(CollectorStats::procfs_metadata_cache_misses);
+  ASSERT_TRUE(scraper.Scrape(&connections, nullptr));
+  EXPECT_EQ(GetCounter(CollectorStats::procfs_metadata_cache_hits) - hits, 2);
+  EXPECT_EQ(GetCounter(CollectorStats::procfs_metadata_cache_misses) - misses, 0);
+
+  // A different start time means the pid was reused by another process.
+  proc.SetStartTime(200, 2000);
+  misses = GetCounter(CollectorStats::procfs_metadata_cache_misses);
+  ASSERT_TRUE(scraper.Scrape(&connections, nullptr));
+  EXPECT_EQ(GetCounter(CollectorStats::procfs_metadata_cache_misses) - misses, 1);
+
+  // Processes that disappear are evicted.
+  proc.RemoveProcess(100);
+  int64_t evictions = GetCounter(CollectorStats::procfs_metadata_cache_evictions);
+  ASSERT_TRUE(scraper.Scrape(&connections, nullptr));
+  EXPECT_EQ(GetCounter(CollectorStats::procfs_metadata_cache_evictions) - evictions, 1);
+}
+
+TEST(ConnScraperTest, TestSkipUnchangedFdTables) {
+  FakeProcDir proc;
+  // 10.0.1.32:80 <- 192.168.1.4:50000 and 10.0.1.32:80 <- 192.168.1.5:50000, both established
+  proc.AddProcess(200, 1000, kContainerCgroup, 4026532000, {5000},
+                  std::string(kNetTCPHeader) +
+                      "   0: 2001000A:0050 0401A8C0:C350 01 00000000:00000000 00:00000000 00000000     0        0 5000 1 0000000000000000 20 4 30 10 -1\n"
+                      "   1: 2001000A:0050 0501A8C0:C350 01 00000000:00000000 00:00000000 00000000     0        0 5001 1 0000000000000000 20 4 30 10 -1\n");
+  proc.SetNetNSSockets(200, 1);
+  Connection conn1("e73c55f3e7f5", Endpoint(Address(10, 0, 1, 32), 80), Endpoint(Address(192, 168, 1, 4), 50000), L4Proto::TCP, true);
+  Connection conn2("e73c55f3e7f5", Endpoint(Address(10, 0, 1, 32), 80), Endpoint(Address(192, 168, 1, 5), 50000), L4Proto::TCP, true);
+
+  ConnScraper scraper(proc.path());
+  std::vector<Connection> connections;
+  ASSERT_TRUE(scraper.Scrape(&connections, nullptr));
+  EXPECT_THAT(connections, testing::ElementsAre(conn1));
+
+  // Nothing changed, so the fd table (one socket, one other fd) is not read again.
+  int64_t skipped = GetCounter(CollectorStats::procfs_fd_tables_skipped);
+  int64_t avoided = GetCounter(CollectorStats::procfs_fd_readlinks_avoided);
+  connections.clear();
+  ASSERT_TRUE(scraper.Scrape(&connections, nullptr));
+  EXPECT_THAT(connections, testing::ElementsAre(conn1));
+  EXPECT_EQ(GetCounter(CollectorStats::procfs_fd_tables_skipped) - skipped, 1);
+  EXPECT_EQ(GetCounter(CollectorStats::procfs_fd_readlinks_avoided) - avoided, 2);
+
+  // A new socket in the network namespace is noticed right away.
+  proc.SetSocket(200, 5, 5001);
+  proc.SetNetNSSockets(200, 2);
+  connections.clear();
+  ASSERT_TRUE(scraper.Scrape(&connections, nullptr));
+  EXPECT_THAT(connections, testing::UnorderedElementsAre(conn1, conn2));
+
+  // Replacing a socket without changing any of the signals goes unnoticed until the periodic full rescan.
+  proc.SetSocket(200, 3, 5002);
+  connections.clear();
+  ASSERT_TRUE(scraper.Scrape(&connections, nullptr));
+  EXPECT_THAT(connections, testing::UnorderedElementsAre(conn1, conn2));
+
+  for (uint64_t i = 1; i < ProcessMetadataCache::kFdTableRescanInterval && connections.size() == 2; i++) {
+    connections.clear();
+    ASSERT_TRUE(scraper.Scrape(&connections, nullptr));
+  }
+  EXPECT_THAT(connections, testing::ElementsAre(conn2));
+}
+
+TEST(ConnScraperTest, TestScrapeStep) {
+  FakeProcDir proc;
+  std::string net_tcp = kNetTCPHeader;
+  std::vector<Connection> expected;
+  for (int i = 0; i < 10; i++) {
+    // 10.0.1.32:80 <- 192.168.1.<i>:50000
+    char line[256];
+    snprintf(line, sizeof(line), "%4d: 2001000A:0050 %02X01A8C0:C350 01 00000000:00000000 00:00000000 00000000     0        0 %d 1 0000000000000000 20 4 30 10 -1\n", i, i, 5000 + i);
+    net_tcp += line;
+    expected.emplace_back("e73c55f3e7f5", Endpoint(Address(10, 0, 1, 32), 80), Endpoint(Address(192, 168, 1, i), 50000), L4Proto::TCP, true);
+  }
+  for (int i = 0; i < 10; i++) {
+    proc.AddProcess(200 + i, 1000, kContainerCgroup, 4026532000, {static_cast<ino_t>(5000 + i)}, net_tcp);
+  }
+
+  ConnScraper scraper(proc.path());
+  std::vector<Connection> connections;
+
+  // With a negligible budget, every step scrapes a single process.
+  for (int sweep = 0; sweep < 2; sweep++) {
+    int steps = 0;
+    bool sweep_complete = false;
+    while (!sweep_complete) {
+      ASSERT_TRUE(scraper.ScrapeStep(std::chrono::microseconds(0), &sweep_complete, &connections, nullptr));
+      ASSERT_LE(++steps, 11);
+      if (!sweep_complete) {
+        EXPECT_THAT(connections, testing::IsEmpty());
+      }
+    }
+    EXPECT_GE(steps, 10);
+    EXPECT_THAT(connections, testing::UnorderedElementsAreArray(expected));
+    connections.clear();
+  }
+
+  // A sufficient budget completes the sweep in a single step.
+  bool sweep_complete = false;
+  ASSERT_TRUE(scraper.ScrapeStep(std::chrono::seconds(10), &sweep_complete, &connections, nullptr));
+  EXPECT_TRUE(sweep_complete);
+  EXPECT_THAT(connections, testing::UnorderedElementsAreArray(expected));
+}
+
+TEST(ConnScraperTest, TestScrapeSharedNetNS) {
+  // Two containers of a pod share a network namespace. The sidecar holds a socket of its own, and shares another one
+  // with the main container.
+  std::string net_tcp = std::string(kNetTCPHeader) +
+                        "   0: 2001000A:0050 0401A8C0:C350 01 00000000:00000000 00:00000000 00000000     0        0 5000 1 0000000000000000 20 4 30 10 -1\n"
+                        "   1: 2001000A:0050 0501A8C0:C350 01 00000000:00000000 00:00000000 00000000     0        0 5001 1 0000000000000000 20 4 30 10 -1\n";
+  FakeProcDir proc;
+  proc.AddProcess(200, 1000, kContainerCgroup, 4026532000, {5000}, net_tcp);
+  proc.AddProcess(201, 1000, kContainerCgroup, 4026532000, {5000}, net_tcp);
+  proc.AddProcess(300, 1000, kSidecarCgroup, 4026532000, {5000, 5001}, net_tcp);
+
+  ConnScraper scraper(proc.path());
+  std::vector<Connection> connections;
+  ASSERT_TRUE(scraper.Scrape(&connections, nullptr));
+
+  Connection conn1("e73c55f3e7f5", Endpoint(Address(10, 0, 1, 32), 80), Endpoint(Address(192, 168, 1, 4), 50000), L4Proto::TCP, true);
+  Connection sidecar_conn1("9b1a5f0a3c2d", Endpoint(Address(10, 0, 1, 32), 80), Endpoint(Address(192, 168, 1, 4), 50000), L4Proto::TCP, true);
+  Connection sidecar_conn2("9b1a5f0a3c2d", Endpoint(Address(10, 0, 1, 32), 80), Endpoint(Address(192, 168, 1, 5), 50000), L4Proto::TCP, true);
+  EXPECT_THAT(connections, testing::UnorderedElementsAre(conn1, sidecar_conn1, sidecar_conn2));
+  EXPECT_GT(GetCounter(CollectorStats::procfs_scrape_peak_alloc_bytes), 0);
+}
+
+TEST(ConnScraperTest, TestScrapeNetNSMemberGone) {
+  std::string net_tcp = std::string(kNetTCPHeader) +
+                        "   0: 2001000A:0050 0401A8C0:C350 01 00000000:00000000 00:00000000 00000000     0        0 5000 1 0000000000000000 20 4 30 10 -1\n";
+  FakeProcDir proc;
+  proc.AddProcess(200, 1000, kContainerCgroup, 4026532000, {5000}, net_tcp);
+  proc.AddProcess(201, 1000, kContainerCgroup, 4026532000, {5000}, net_tcp);
+
+  ConnScraper scraper(proc.path());
+  std::vector<Connection> connections;
+
+  // Visit both processes, one per step, without finishing the sweep.
+  bool sweep_complete = false;
+  for (int i = 0; i < 2; i++) {
+    ASSERT_TRUE(scraper.ScrapeStep(std::chrono::microseconds(0), &sweep_complete, &connections, nullptr));
+    ASSERT_FALSE(sweep_complete);
+  }
+
+  // The socket tables of the network namespace are read through the remaining process.
+  proc.RemoveProcess(200);
+  ASSERT_TRUE(scraper.ScrapeStep(std::chrono::microseconds(0), &sweep_complete, &connections, nullptr));
+  ASSERT_TRUE(sweep_complete);
+
+  Connection expected("e73c55f3e7f5", Endpoint(Address(10, 0, 1, 32), 80), Endpoint(Address(192, 168, 1, 4), 50000), L4Proto::TCP, true);
+  EXPECT_THAT(connections, testing::ElementsAre(expected));
+}
+
+TEST(ConnScraperTest, TestProcessMetadataCacheEvictStale) {
+  ProcessMetadataCache cache;
+  ProcessMetadataCache::Entry entry;
+  entry.start_time = 42;
+
+  cache.BeginScrape();
+  cache.Insert(1, entry);
+  cache.Insert(2, entry);
+
+  cache.BeginScrape();
+  EXPECT_NE(cache.Lookup(1, 42), nullptr);
+  EXPECT_EQ(cache.Lookup(2, 43), nullptr);
+  EXPECT_EQ(cache.EvictStale(), 1);
+  EXPECT_EQ(cache.size(), 1);
+}
+
 }  // namespace
 
 }  // namespace collector
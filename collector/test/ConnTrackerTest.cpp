@@ -63,6 +63,26 @@ TEST(ConnTrackerTest, TestAddRemove) {
   EXPECT_THAT(state, UnorderedElementsAre(std::make_pair(conn2, ConnStatus(time_micros, true))));
 }
 
+TEST(ConnTrackerTest, TestUpdateConnections) {
+  Endpoint a(Address(192, 168, 0, 1), 80);
+  Endpoint b(Address(192, 168, 1, 10), 9999);
+
+  Connection conn1("xyz", a, b, L4Proto::TCP, true);
+  Connection conn2("xzy", b, a, L4Proto::TCP, false);
+
+  // Updates are applied in order, so later updates of the same connection win.
+  ConnectionUpdate updates[] = {
+      {conn1, 1000, true},
+      {conn2, 1000, true},
+      {conn1, 2000, false},
+  };
+  ConnectionTracker tracker;
+  tracker.UpdateConnections(updates, 3);
+
+  auto state = tracker.FetchConnState();
+  EXPECT_THAT(state, UnorderedElementsAre(std::make_pair(conn1, ConnStatus(2000, false)), std::make_pair(conn2, ConnStatus(1000, true))));
+}
+
 TEST(ConnTrackerTest, TestUpdate) {
   Endpoint a(Address(192, 168, 0, 1), 80);
   Endpoint b(Address(192, 168, 1, 10), 9999);
@@ -90,6 +110,36 @@ TEST(ConnTrackerTest, TestUpdate) {
   EXPECT_THAT(state, UnorderedElementsAre(std::make_pair(conn1, ConnStatus(time_micros2, true))));
 }
 
+TEST(ConnTrackerTest, TestUpdateFromSweep) {
+  Endpoint a(Address(192, 168, 0, 1), 80);
+  Endpoint b(Address(192, 168, 1, 10), 9999);
+  Endpoint c(Address(192, 168, 1, 11), 9999);
+
+  Connection conn1("xyz", a, b, L4Proto::TCP, true);
+  Connection conn2("xyz", a, c, L4Proto::TCP, true);
+  Connection conn3("xzy", b, a, L4Proto::TCP, false);
+
+  ConnectionTracker tracker;
+  tracker.Update({conn1, conn2}, {}, 1000);
+
+  // The sweep starts at 2000. conn3 is opened, and conn2 closed, while the sweep is in progress. The sweep did not see
+  // conn3, and still saw conn2.
+  tracker.AddConnection(conn3, 2005);
+  tracker.RemoveConnection(conn2, 2010);
+  tracker.UpdateFromSweep({conn1, conn2}, {}, 2000);
+
+  auto state = tracker.FetchConnState();
+  EXPECT_THAT(state, UnorderedElementsAre(std::make_pair(conn1, ConnStatus(2000, true)),
+                                          std::make_pair(conn2, ConnStatus(2010, false)),
+                                          std::make_pair(conn3, ConnStatus(2005, true))));
+
+  // The next sweep no longer sees conn1, and sees conn3.
+  tracker.UpdateFromSweep({conn3}, {}, 3000);
+  state = tracker.FetchConnState();
+  EXPECT_THAT(state, UnorderedElementsAre(std::make_pair(conn1, ConnStatus(2000, false)),
+                                          std::make_pair(conn3, ConnStatus(3000, true))));
+}
+
 TEST(ConnTrackerTest, TestUpdateIgnoredL4ProtoPortPairs) {
   Endpoint a(Address(192, 168, 0, 1), 80);
   Endpoint b(Address(192, 168, 1, 10), 9999);
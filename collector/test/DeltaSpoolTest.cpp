@@ -0,0 +1,146 @@
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "DeltaSpool.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace collector {
+
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::UnorderedElementsAre;
+
+class DeltaSpoolTest : public testing::Test {
+ protected:
+  DeltaSpoolTest()
+      : a_(Address(192, 168, 0, 1), 80),
+        b_(Address(192, 168, 1, 10), 9999),
+        conn1_("xyz", a_, b_, L4Proto::TCP, true),
+        conn2_("xzy", b_, a_, L4Proto::TCP, false),
+        cep_("xyz", a_, L4Proto::TCP, nullptr) {}
+
+  static std::string TempPath() {
+    return "/tmp/delta_spool_test." + std::to_string(getpid());
+  }
+
+  Endpoint a_, b_;
+  Connection conn1_, conn2_;
+  ContainerEndpoint cep_;
+};
+
+TEST_F(DeltaSpoolTest, MergeKeepsLatestStatus) {
+  NetworkDelta earlier;
+  earlier.conns = {{conn1_, ConnStatus(1000, true)}, {conn2_, ConnStatus(1000, true)}};
+  earlier.endpoints = {{cep_, ConnStatus(1000, true)}};
+
+  NetworkDelta later;
+  later.conns = {{conn1_, ConnStatus(2000, false)}};
+  later.endpoints = {{cep_, ConnStatus(2000, false)}};
+
+  EXPECT_EQ(earlier.MergeFrom(std::move(later)), 2);
+  EXPECT_THAT(earlier.conns, UnorderedElementsAre(std::make_pair(conn1_, ConnStatus(2000, false)),
+                                                  std::make_pair(conn2_, ConnStatus(1000, true))));
+  EXPECT_THAT(earlier.endpoints, UnorderedElementsAre(std::make_pair(cep_, ConnStatus(2000, false))));
+}
+
+TEST_F(DeltaSpoolTest, AddUntilFull) {
+  DeltaSpool spool(2, "");
+  EXPECT_TRUE(spool.enabled());
+  EXPECT_FALSE(spool.has_overflow_file());
+  EXPECT_TRUE(spool.empty());
+
+  NetworkDelta delta;
+  delta.conns = {{conn1_, ConnStatus(1000, true)}};
+  EXPECT_TRUE(spool.Add(std::move(delta)));
+
+  // Updates of the same connection do not take up more space.
+  delta = NetworkDelta();
+  delta.conns = {{conn1_, ConnStatus(2000, false)}};
+  EXPECT_TRUE(spool.Add(std::move(delta)));
+  EXPECT_EQ(spool.delta().size(), 1);
+
+  delta = NetworkDelta();
+  delta.conns = {{conn2_, ConnStatus(2000, true)}};
+  delta.endpoints = {{cep_, ConnStatus(2000, true)}};
+  EXPECT_FALSE(spool.Add(std::move(delta)));
+  EXPECT_EQ(spool.delta().size(), 3);
+
+  spool.Clear();
+  EXPECT_TRUE(spool.empty());
+}
+
+TEST_F(DeltaSpoolTest, SpillRoundTrip) {
+  std::string path = TempPath();
+  {
+    DeltaSpool spool(1, path);
+    EXPECT_TRUE(spool.has_overflow_file());
+
+    // Nothing is written until the first spill.
+    EXPECT_NE(access(path.c_str(), F_OK), 0);
+
+    ASSERT_TRUE(spool.Spill("first"));
+    ASSERT_TRUE(spool.Spill(""));
+    ASSERT_TRUE(spool.Spill("third message"));
+    EXPECT_EQ(spool.spilled_messages(), 3);
+    EXPECT_FALSE(spool.empty());
+
+    std::vector<std::string> messages;
+    auto collect = [&messages](const std::string& message) {
+      messages.push_back(message);
+      return true;
+    };
+    ASSERT_TRUE(spool.ForEachSpilled(collect));
+    EXPECT_THAT(messages, ElementsAre("first", "", "third message"));
+
+    // Reading does not consume the messages, and spilling can continue afterwards.
+    ASSERT_TRUE(spool.Spill("fourth"));
+    messages.clear();
+    ASSERT_TRUE(spool.ForEachSpilled(collect));
+    EXPECT_THAT(messages, ElementsAre("first", "", "third message", "fourth"));
+
+    // Stops once the callback fails.
+    int calls = 0;
+    EXPECT_FALSE(spool.ForEachSpilled([&calls](const std::string&) { return ++calls < 2; }));
+    EXPECT_EQ(calls, 2);
+
+    spool.Clear();
+    EXPECT_TRUE(spool.empty());
+    EXPECT_EQ(spool.spilled_bytes(), 0);
+    EXPECT_NE(access(path.c_str(), F_OK), 0);
+
+    ASSERT_TRUE(spool.Spill("again"));
+    EXPECT_EQ(access(path.c_str(), F_OK), 0);
+  }
+  // The spool file is removed with the spool.
+  EXPECT_NE(access(path.c_str(), F_OK), 0);
+}
+
+TEST_F(DeltaSpoolTest, SpillUpToMaxSize) {
+  std::string path = TempPath();
+  // Room for two messages of 8 bytes, each with its 4 byte size.
+  DeltaSpool spool(1, path, 24);
+
+  ASSERT_TRUE(spool.Spill("message1"));
+  ASSERT_TRUE(spool.Spill("message2"));
+  EXPECT_FALSE(spool.Spill("m"));
+  EXPECT_EQ(spool.spilled_messages(), 2);
+  EXPECT_EQ(spool.spilled_bytes(), 24);
+
+  // Clearing the spool makes room again.
+  spool.Clear();
+  EXPECT_TRUE(spool.Spill("m"));
+}
+
+TEST_F(DeltaSpoolTest, SpillToUnwritablePath) {
+  DeltaSpool spool(1, "/nonexistent/delta_spool");
+  EXPECT_FALSE(spool.Spill("message"));
+  EXPECT_TRUE(spool.empty());
+}
+
+}  // namespace
+
+}  // namespace collector
@@ -0,0 +1,88 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include <unistd.h>
+
+#include "DriverBuffers.h"
+#include "gtest/gtest.h"
+
+namespace collector {
+
+namespace {
+
+constexpr uint64_t kMiB = 1024 * 1024;
+constexpr uint64_t kGiB = 1024 * kMiB;
+
+TEST(DriverBuffersTest, AutoSize) {
+  // Plenty of memory: capped at 16 MiB per buffer.
+  auto sizing = AutoSizeDriverBuffers(4, 64 * kGiB, false);
+  EXPECT_EQ(sizing.buffer_bytes, 16 * kMiB);
+  EXPECT_EQ(sizing.cpus_per_buffer, 1);
+
+  // 1 GiB available: 32 MiB shared by 8 CPUs.
+  sizing = AutoSizeDriverBuffers(8, 1 * kGiB, false);
+  EXPECT_EQ(sizing.buffer_bytes, 4 * kMiB);
+  EXPECT_EQ(sizing.cpus_per_buffer, 1);
+
+  // Rounded down to a power of two.
+  sizing = AutoSizeDriverBuffers(6, 1 * kGiB, false);
+  EXPECT_EQ(sizing.buffer_bytes, 4 * kMiB);
+
+  // Unknown memory: at most 1 GiB in total.
+  sizing = AutoSizeDriverBuffers(256, 0, false);
+  EXPECT_EQ(sizing.buffer_bytes, 4 * kMiB);
+
+  // Too little memory for 1 MiB buffers: shared if possible, else the minimum.
+  sizing = AutoSizeDriverBuffers(64, 512 * kMiB, true);
+  EXPECT_EQ(sizing.buffer_bytes, 1 * kMiB);
+  EXPECT_EQ(sizing.cpus_per_buffer, 4);
+  sizing = AutoSizeDriverBuffers(64, 512 * kMiB, false);
+  EXPECT_EQ(sizing.buffer_bytes, 1 * kMiB);
+  EXPECT_EQ(sizing.cpus_per_buffer, 1);
+
+  // Never shared between more CPUs than there are.
+  sizing = AutoSizeDriverBuffers(2, 1 * kMiB, true);
+  EXPECT_EQ(sizing.buffer_bytes, 1 * kMiB);
+  EXPECT_EQ(sizing.cpus_per_buffer, 2);
+}
+
+TEST(DriverBuffersTest, ReadMemAvailable) {
+  std::string path = "/tmp/driver_buffers_test." + std::to_string(getpid());
+  {
+    std::ofstream meminfo(path);
+    meminfo << "MemTotal:       16318412 kB\n"
+            << "MemFree:          523348 kB\n"
+            << "MemAvailable:    8053044 kB\n"
+            << "Buffers:          436084 kB\n";
+  }
+  EXPECT_EQ(ReadMemAvailable(path), 8053044ULL * 1024);
+
+  {
+    std::ofstream meminfo(path);
+    meminfo << "MemTotal:       16318412 kB\n";
+  }
+  EXPECT_EQ(ReadMemAvailable(path), 0);
+
+  std::remove(path.c_str());
+  EXPECT_EQ(ReadMemAvailable(path), 0);
+}
+
+TEST(DriverBuffersTest, ParsePerCPUMetric) {
+  int cpu = -1;
+  EXPECT_TRUE(ParsePerCPUMetric("n_drops_cpu_0", "n_drops_cpu_", &cpu));
+  EXPECT_EQ(cpu, 0);
+  EXPECT_TRUE(ParsePerCPUMetric("n_evts_cpu_117", "n_evts_cpu_", &cpu));
+  EXPECT_EQ(cpu, 117);
+
+  cpu = -1;
+  EXPECT_FALSE(ParsePerCPUMetric("n_drops_cpu_", "n_drops_cpu_", &cpu));
+  EXPECT_FALSE(ParsePerCPUMetric("n_drops_cpu_1a", "n_drops_cpu_", &cpu));
+  EXPECT_FALSE(ParsePerCPUMetric("n_drops_buffer_1", "n_drops_cpu_", &cpu));
+  EXPECT_FALSE(ParsePerCPUMetric("n_evts", "n_evts_cpu_", &cpu));
+  EXPECT_EQ(cpu, -1);
+}
+
+}  // namespace
+
+}  // namespace collector
@@ -0,0 +1,63 @@
+#include <string>
+
+#include "EncodingCache.h"
+#include "gtest/gtest.h"
+
+namespace collector {
+
+namespace {
+
+// Get returns the cached encoding of key, and records the keys that had to be encoded.
+const std::string& Get(EncodingCache<int>* cache, int key, std::string* encoded_keys) {
+  return cache->Get(key, [key, encoded_keys](std::string* out) {
+    *out = "encoded " + std::to_string(key);
+    *encoded_keys += std::to_string(key);
+  });
+}
+
+TEST(EncodingCacheTest, Disabled) {
+  EncodingCache<int> cache(0);
+  EXPECT_FALSE(cache.enabled());
+}
+
+TEST(EncodingCacheTest, EncodesOnce) {
+  EncodingCache<int> cache(10);
+  EXPECT_TRUE(cache.enabled());
+
+  std::string encoded_keys;
+  EXPECT_EQ(Get(&cache, 1, &encoded_keys), "encoded 1");
+  EXPECT_EQ(Get(&cache, 2, &encoded_keys), "encoded 2");
+  EXPECT_EQ(Get(&cache, 1, &encoded_keys), "encoded 1");
+  EXPECT_EQ(Get(&cache, 2, &encoded_keys), "encoded 2");
+  EXPECT_EQ(encoded_keys, "12");
+  EXPECT_EQ(cache.size(), 2);
+
+  cache.Clear();
+  EXPECT_EQ(Get(&cache, 1, &encoded_keys), "encoded 1");
+  EXPECT_EQ(encoded_keys, "121");
+}
+
+TEST(EncodingCacheTest, EvictsUnusedEntries) {
+  // Two generations of two entries each.
+  EncodingCache<int> cache(4);
+
+  std::string encoded_keys;
+  Get(&cache, 1, &encoded_keys);
+  Get(&cache, 2, &encoded_keys);
+  // Rotates: 1 and 2 move to the old generation.
+  Get(&cache, 3, &encoded_keys);
+  // 1 is moved back to the current generation.
+  Get(&cache, 1, &encoded_keys);
+  // Rotates again: 2 is evicted, 3 and 1 move to the old generation.
+  Get(&cache, 4, &encoded_keys);
+  EXPECT_EQ(encoded_keys, "1234");
+  EXPECT_LE(cache.size(), 4);
+
+  Get(&cache, 3, &encoded_keys);
+  Get(&cache, 2, &encoded_keys);
+  EXPECT_EQ(encoded_keys, "12342");
+}
+
+}  // namespace
+
+}  // namespace collector
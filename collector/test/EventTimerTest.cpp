@@ -0,0 +1,67 @@
+#include <chrono>
+#include <thread>
+
+#include "EventTimer.h"
+#include "gtest/gtest.h"
+
+namespace collector {
+
+namespace {
+
+TEST(EventTimerTest, SampleEveryEvent) {
+  EventTimer timer;
+  for (int i = 0; i < 10; i++) {
+    EXPECT_TRUE(timer.Sample(3));
+  }
+  EXPECT_EQ(timer.Scale(5), 5);
+}
+
+TEST(EventTimerTest, SamplePerEventType) {
+  EventTimer timer(EventTimer::Clock::SYSTEM, 4);
+  // The first event of each type is timed, and then every fourth one.
+  for (int i = 0; i < 12; i++) {
+    EXPECT_EQ(timer.Sample(3), i % 4 == 0) << i;
+    EXPECT_EQ(timer.Sample(4), i % 4 == 0) << i;
+  }
+  EXPECT_EQ(timer.Scale(5), 20);
+}
+
+TEST(EventTimerTest, ScaleNegativeDuration) {
+  EventTimer timer(EventTimer::Clock::SYSTEM, 4);
+  EXPECT_EQ(timer.Scale(-5), 0);
+}
+
+TEST(EventTimerTest, InvalidSampleRate) {
+  EventTimer timer(EventTimer::Clock::SYSTEM, 0);
+  EXPECT_EQ(timer.sample_rate(), 1);
+  EXPECT_TRUE(timer.Sample(3));
+}
+
+TEST(EventTimerTest, Clocks) {
+  for (auto clock : {EventTimer::Clock::SYSTEM, EventTimer::Clock::COARSE, EventTimer::Clock::TSC}) {
+    EventTimer timer(clock, 1);
+    // TSC falls back to COARSE if there is no invariant TSC.
+    EXPECT_TRUE(timer.clock() == clock || (clock == EventTimer::Clock::TSC && timer.clock() == EventTimer::Clock::COARSE));
+
+    int64_t start = timer.Now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    int64_t elapsed = timer.Now() - start;
+    EXPECT_GE(elapsed, 40000) << EventTimerClockName(timer.clock());
+    EXPECT_LT(elapsed, 5000000) << EventTimerClockName(timer.clock());
+  }
+}
+
+TEST(EventTimerTest, ParseClock) {
+  for (auto clock : {EventTimer::Clock::SYSTEM, EventTimer::Clock::COARSE, EventTimer::Clock::TSC}) {
+    EventTimer::Clock parsed;
+    ASSERT_TRUE(ParseEventTimerClock(EventTimerClockName(clock), &parsed));
+    EXPECT_EQ(parsed, clock);
+  }
+
+  EventTimer::Clock parsed;
+  EXPECT_FALSE(ParseEventTimerClock("rdtsc", &parsed));
+}
+
+}  // namespace
+
+}  // namespace collector
@@ -0,0 +1,100 @@
+#include <string>
+
+#include "internalapi/sensor/network_connection_iservice.pb.h"
+
+#include "CollectorStats.h"
+#include "GRPCCompression.h"
+#include "gtest/gtest.h"
+
+namespace collector {
+
+namespace {
+
+const StreamCompression::Counters kCounters = {CollectorStats::net_grpc_bytes, CollectorStats::net_grpc_compressed_bytes, CollectorStats::net_grpc_compression_us};
+
+// MakeMessage creates a message with the given number of (identical, so highly compressible) connections.
+sensor::NetworkConnectionInfoMessage MakeMessage(int num_conns) {
+  sensor::NetworkConnectionInfoMessage msg;
+  for (int i = 0; i < num_conns; i++) {
+    auto* conn = msg.mutable_info()->add_updated_connections();
+    conn->set_container_id("0123456789ab");
+    conn->set_role(sensor::ROLE_CLIENT);
+    conn->mutable_remote_address()->set_ip_network(std::string("\x0a\x00\x00\x01", 4));
+    conn->mutable_remote_address()->set_port(443);
+  }
+  return msg;
+}
+
+class GRPCCompressionTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    auto& stats = CollectorStats::GetOrCreate();
+    stats.CounterSet(kCounters.bytes, 0);
+    stats.CounterSet(kCounters.compressed_bytes, 0);
+    stats.CounterSet(kCounters.compression_us, 0);
+  }
+
+  static int64_t Counter(CollectorStats::CounterType counter) {
+    return CollectorStats::GetOrCreate().GetCounter(counter);
+  }
+};
+
+TEST_F(GRPCCompressionTest, ParseAlgorithm) {
+  grpc_compression_algorithm algorithm;
+  ASSERT_TRUE(ParseCompressionAlgorithm("gzip", &algorithm));
+  EXPECT_EQ(algorithm, GRPC_COMPRESS_GZIP);
+  ASSERT_TRUE(ParseCompressionAlgorithm("deflate", &algorithm));
+  EXPECT_EQ(algorithm, GRPC_COMPRESS_DEFLATE);
+  ASSERT_TRUE(ParseCompressionAlgorithm("none", &algorithm));
+  EXPECT_EQ(algorithm, GRPC_COMPRESS_NONE);
+  ASSERT_TRUE(ParseCompressionAlgorithm("", &algorithm));
+  EXPECT_EQ(algorithm, GRPC_COMPRESS_NONE);
+  EXPECT_FALSE(ParseCompressionAlgorithm("zstd", &algorithm));
+
+  for (auto algo : {GRPC_COMPRESS_NONE, GRPC_COMPRESS_DEFLATE, GRPC_COMPRESS_GZIP}) {
+    ASSERT_TRUE(ParseCompressionAlgorithm(CompressionAlgorithmName(algo), &algorithm));
+    EXPECT_EQ(algorithm, algo);
+  }
+}
+
+TEST_F(GRPCCompressionTest, Disabled) {
+  StreamCompression compression(GRPC_COMPRESS_NONE, 0, kCounters);
+  EXPECT_FALSE(compression.enabled());
+
+  auto msg = MakeMessage(100);
+  EXPECT_FALSE(compression.OnWrite(msg));
+  EXPECT_EQ(Counter(kCounters.bytes), static_cast<int64_t>(msg.ByteSizeLong()));
+  EXPECT_EQ(Counter(kCounters.compressed_bytes), static_cast<int64_t>(msg.ByteSizeLong()));
+  EXPECT_EQ(Counter(kCounters.compression_us), 0);
+}
+
+TEST_F(GRPCCompressionTest, Threshold) {
+  for (auto algorithm : {GRPC_COMPRESS_DEFLATE, GRPC_COMPRESS_GZIP}) {
+    SetUp();
+    StreamCompression compression(algorithm, 1024, kCounters);
+    EXPECT_TRUE(compression.enabled());
+
+    // Small messages are sent uncompressed.
+    auto small = MakeMessage(1);
+    ASSERT_LT(small.ByteSizeLong(), 1024);
+    EXPECT_FALSE(compression.OnWrite(small));
+    EXPECT_EQ(Counter(kCounters.compressed_bytes), static_cast<int64_t>(small.ByteSizeLong()));
+
+    auto large = MakeMessage(100);
+    ASSERT_GE(large.ByteSizeLong(), 1024);
+    for (int i = 0; i < 2 * StreamCompression::kSampleInterval; i++) {
+      EXPECT_TRUE(compression.OnWrite(large));
+    }
+
+    int64_t bytes = Counter(kCounters.bytes);
+    EXPECT_EQ(bytes, static_cast<int64_t>(small.ByteSizeLong() + 2 * StreamCompression::kSampleInterval * large.ByteSizeLong()));
+    // The repeated connections compress well.
+    EXPECT_GT(Counter(kCounters.compressed_bytes), static_cast<int64_t>(small.ByteSizeLong()));
+    EXPECT_LT(Counter(kCounters.compressed_bytes), bytes / 4);
+    EXPECT_GE(Counter(kCounters.compression_us), 0);
+  }
+}
+
+}  // namespace
+
+}  // namespace collector
@@ -0,0 +1,130 @@
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "FileSystem.h"
+#include "IoUring.h"
+#include "gtest/gtest.h"
+
+namespace collector {
+
+namespace {
+
+size_t CountOpenFiles() {
+  size_t count = 0;
+  for (const auto& entry : std::filesystem::directory_iterator("/proc/self/fd")) {
+    (void)entry;
+    count++;
+  }
+  return count;
+}
+
+// FailingIoUring makes the n-th io_uring_enter call report a failure after it has submitted its entries.
+class FailingIoUring : public IoUring {
+ public:
+  static std::unique_ptr<FailingIoUring> Create(unsigned int entries, unsigned int n) {
+    std::unique_ptr<FailingIoUring> ring(new FailingIoUring(n));
+    if (!ring->Init(entries)) return nullptr;
+    return ring;
+  }
+
+ protected:
+  int Enter(unsigned int to_submit, unsigned int min_complete, unsigned int flags) override {
+    int ret = IoUring::Enter(to_submit, min_complete, flags);
+    if (ret >= 0 && countdown_ > 0 && --countdown_ == 0) {
+      errno = EIO;
+      return -1;
+    }
+    return ret;
+  }
+
+ private:
+  explicit FailingIoUring(unsigned int n) : countdown_(n) {}
+
+  unsigned int countdown_;
+};
+
+// IoUringTest skips the tests if io_uring is not available, e.g., on older kernels or when blocked by seccomp.
+class IoUringTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    io_uring_ = IoUring::Create(8);
+    if (!io_uring_) GTEST_SKIP() << "io_uring is not available";
+  }
+
+  std::unique_ptr<IoUring> io_uring_;
+};
+
+}  // namespace
+
+TEST_F(IoUringTest, TestReadFiles) {
+  char path_template[] = "/tmp/iouring-test-XXXXXX";
+  std::string dir = mkdtemp(path_template);
+  DirHandle dir_handle = opendir(dir.c_str());
+  ASSERT_TRUE(dir_handle.valid());
+
+  // More requests than fit into the ring at once, plus one for a file that does not exist.
+  std::vector<std::string> names;
+  for (int i = 0; i < 20; i++) {
+    names.push_back("file" + std::to_string(i));
+    std::ofstream(dir + "/" + names.back()) << "content of file " << i;
+  }
+  names.push_back("missing");
+
+  std::vector<std::vector<char>> bufs(names.size(), std::vector<char>(64));
+  std::vector<IoUring::ReadRequest> requests;
+  for (size_t i = 0; i < names.size(); i++) {
+    requests.push_back({dir_handle.fd(), names[i].c_str(), bufs[i].data(), bufs[i].size(), 0});
+  }
+
+  ASSERT_TRUE(io_uring_->ReadFiles(requests.data(), requests.size()));
+  for (int i = 0; i < 20; i++) {
+    std::string expected = "content of file " + std::to_string(i);
+    ASSERT_EQ(requests[i].result, expected.size());
+    EXPECT_EQ(std::string(bufs[i].data(), requests[i].result), expected);
+  }
+  EXPECT_EQ(requests.back().result, -ENOENT);
+
+  std::filesystem::remove_all(dir);
+}
+
+TEST_F(IoUringTest, TestFailedSubmission) {
+  char path_template[] = "/tmp/iouring-test-XXXXXX";
+  std::string dir = mkdtemp(path_template);
+  DirHandle dir_handle = opendir(dir.c_str());
+  ASSERT_TRUE(dir_handle.valid());
+
+  std::vector<std::string> names = {"file0", "file1", "file2"};
+  for (const auto& name : names) {
+    std::ofstream(dir + "/" + name) << "content of " << name;
+  }
+
+  // Fail the submission of the openat operations, and that of the read and close operations.
+  for (unsigned int n : {1, 2}) {
+    auto io_uring = FailingIoUring::Create(8, n);
+    ASSERT_TRUE(io_uring);
+
+    std::vector<std::vector<char>> bufs(names.size(), std::vector<char>(64));
+    std::vector<IoUring::ReadRequest> requests;
+    for (size_t i = 0; i < names.size(); i++) {
+      requests.push_back({dir_handle.fd(), names[i].c_str(), bufs[i].data(), bufs[i].size(), 0});
+    }
+
+    size_t open_files = CountOpenFiles();
+    EXPECT_FALSE(io_uring->ReadFiles(requests.data(), requests.size()));
+    EXPECT_FALSE(io_uring->usable());
+    EXPECT_EQ(CountOpenFiles(), open_files) << "failing submission " << n;
+
+    // The ring is not used anymore.
+    EXPECT_FALSE(io_uring->ReadFiles(requests.data(), requests.size()));
+  }
+
+  std::filesystem::remove_all(dir);
+}
+
+}  // namespace collector
@@ -0,0 +1,72 @@
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "MPSCQueue.h"
+#include "gtest/gtest.h"
+
+namespace collector {
+
+namespace {
+
+TEST(MPSCQueueTest, ConsumeAllInOrder) {
+  MPSCQueue<int> queue;
+  EXPECT_TRUE(queue.empty());
+
+  queue.Push(1);
+  queue.Push(2);
+  queue.Push(3);
+  EXPECT_FALSE(queue.empty());
+
+  std::vector<int> items;
+  EXPECT_EQ(queue.ConsumeAll([&items](int&& item) { items.push_back(item); }), 3);
+  EXPECT_EQ(items, std::vector<int>({1, 2, 3}));
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(queue.ConsumeAll([](int&&) { FAIL(); }), 0);
+}
+
+TEST(MPSCQueueTest, DestroysRemainingItems) {
+  auto item = std::make_shared<int>(1);
+  {
+    MPSCQueue<std::shared_ptr<int>> queue;
+    queue.Push(item);
+    EXPECT_EQ(item.use_count(), 2);
+  }
+  EXPECT_EQ(item.use_count(), 1);
+}
+
+TEST(MPSCQueueTest, ConcurrentProducers) {
+  constexpr int kNumProducers = 4;
+  constexpr int kItemsPerProducer = 10000;
+  MPSCQueue<std::pair<int, int>> queue;
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kNumProducers; p++) {
+    producers.emplace_back([&queue, p] {
+      for (int i = 0; i < kItemsPerProducer; i++) {
+        queue.Push({p, i});
+      }
+    });
+  }
+
+  // Every item is received exactly once, and the items of each producer in order.
+  std::vector<int> next(kNumProducers, 0);
+  int received = 0;
+  auto consume = [&](std::pair<int, int>&& item) {
+    EXPECT_EQ(item.second, next[item.first]++);
+    received++;
+  };
+  while (received < kNumProducers * kItemsPerProducer) {
+    if (queue.ConsumeAll(consume) == 0) {
+      std::this_thread::yield();
+    }
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  EXPECT_TRUE(queue.empty());
+}
+
+}  // namespace
+
+}  // namespace collector
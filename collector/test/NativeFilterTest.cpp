@@ -0,0 +1,163 @@
+#include <string>
+
+#include "CollectorConfig.h"
+#include "EventNames.h"
+#include "NativeFilter.h"
+#include "gtest/gtest.h"
+
+namespace collector {
+
+namespace {
+
+const std::string kHost = "host";
+
+class FieldsBuilder {
+ public:
+  FieldsBuilder& ContainerID(std::string id) {
+    container_id_ = std::move(id);
+    fields_.container_id = &container_id_;
+    return *this;
+  }
+
+  FieldsBuilder& Process(std::string name, std::string exepath) {
+    proc_name_ = std::move(name);
+    proc_exepath_ = std::move(exepath);
+    fields_.proc_name = &proc_name_;
+    fields_.proc_exe = &proc_exepath_;
+    fields_.proc_exepath = &proc_exepath_;
+    return *this;
+  }
+
+  FieldsBuilder& EventType(const std::string& name) {
+    fields_.event_type = EventNames::GetInstance().GetEventIDs(name)[0];
+    return *this;
+  }
+
+  const NativeFilter::Fields& Build() { return fields_; }
+
+ private:
+  std::string container_id_;
+  std::string proc_name_;
+  std::string proc_exepath_;
+  NativeFilter::Fields fields_;
+};
+
+TEST(NativeFilterTest, DefaultChisel) {
+  auto filter = NativeFilter::CompileChisel(CollectorConfig::kChisel);
+  ASSERT_NE(filter, nullptr);
+
+  EXPECT_TRUE(filter->Match(FieldsBuilder().ContainerID("0123456789ab").Process("nginx", "/usr/sbin/nginx").Build()));
+  EXPECT_FALSE(filter->Match(FieldsBuilder().ContainerID(kHost).Process("bash", "/bin/bash").Build()));
+  EXPECT_TRUE(filter->Match(FieldsBuilder().ContainerID(kHost).Process("self-checks", "/usr/local/bin/self-checks").Build()));
+  // Without thread info, neither comparison matches.
+  EXPECT_FALSE(filter->Match(NativeFilter::Fields()));
+}
+
+TEST(NativeFilterTest, Operators) {
+  FieldsBuilder builder;
+  const auto& fields = builder.ContainerID("abc").Process("curl", "/usr/bin/curl").EventType("execve").Build();
+
+  struct {
+    const char* filter;
+    bool match;
+  } tests[] = {
+      {"container.id = abc", true},
+      {"container.id == 'abc'", true},
+      {"container.id != \"abc\"", false},
+      {"proc.name in (wget, curl)", true},
+      {"proc.name in ('wget')", false},
+      {"proc.exepath startswith /usr/", true},
+      {"proc.exe startswith /bin/", false},
+      {"evt.type = execve", true},
+      {"evt.type in (connect, accept)", false},
+      {"evt.type != connect", true},
+      {"not proc.name = curl", false},
+      {"not not proc.name = curl", true},
+      {"proc.name = wget or container.id = abc and proc.name = curl", true},
+      {"(proc.name = wget or container.id = abc) and proc.name = wget", false},
+      {"proc.name = wget or proc.name = bash or proc.name = curl", true},
+  };
+
+  for (const auto& test : tests) {
+    auto filter = NativeFilter::Compile(test.filter);
+    ASSERT_NE(filter, nullptr) << test.filter;
+    EXPECT_EQ(filter->Match(fields), test.match) << test.filter;
+  }
+}
+
+TEST(NativeFilterTest, Unsupported) {
+  const char* filters[] = {
+      "",
+      "proc.name",
+      "proc.name =",
+      "proc.name = curl and",
+      "(proc.name = curl",
+      "proc.name in (curl",
+      "proc.name contains curl",
+      "fd.name = /etc/passwd",
+      "proc.name = 'curl",
+      "evt.type = not_an_event",
+      "evt.type startswith exec",
+      "proc.pid > 1",
+  };
+
+  for (const auto* filter : filters) {
+    EXPECT_EQ(NativeFilter::Compile(filter), nullptr) << filter;
+  }
+}
+
+TEST(NativeFilterTest, Chisels) {
+  // The filter may be set through a literal.
+  EXPECT_NE(NativeFilter::CompileChisel(R"(
+function on_event()
+    return true
+end
+function on_init()
+    chisel.set_filter('container.id != \'host\'')
+    return true
+end
+)"),
+            nullptr);
+
+  // Chisels doing anything but filtering are left to Lua.
+  EXPECT_EQ(NativeFilter::CompileChisel(R"(
+function on_event()
+    print(evt.field(name))
+    return true
+end
+function on_init()
+    chisel.set_filter("container.id != 'host'")
+    return true
+end
+)"),
+            nullptr);
+  EXPECT_EQ(NativeFilter::CompileChisel(R"(
+function on_event()
+    return true
+end
+function on_capture_end()
+    return true
+end
+function on_init()
+    chisel.set_filter("container.id != 'host'")
+    return true
+end
+)"),
+            nullptr);
+  EXPECT_EQ(NativeFilter::CompileChisel(R"(
+function on_event()
+    return true
+end
+function on_init()
+    filter = "container.id != 'host'"
+    filter = filter .. " and proc.name = 'curl'"
+    chisel.set_filter(filter)
+    return true
+end
+)"),
+            nullptr);
+}
+
+}  // namespace
+
+}  // namespace collector
@@ -0,0 +1,169 @@
+#include <memory>
+#include <string>
+
+#include <google/protobuf/util/message_differencer.h>
+
+#include "CollectorStats.h"
+#include "NetworkMessageBuilder.h"
+#include "gtest/gtest.h"
+
+namespace collector {
+
+namespace {
+
+class FakeProcess : public IProcess {
+ public:
+  FakeProcess(uint64_t pid, std::string comm, std::string exe_path, std::string args)
+      : pid_(pid), comm_(std::move(comm)), exe_path_(std::move(exe_path)), args_(std::move(args)) {}
+
+  uint64_t pid() const override { return pid_; }
+  std::string container_id() const override { return "container"; }
+  std::string comm() const override { return comm_; }
+  std::string exe() const override { return exe_path_; }
+  std::string exe_path() const override { return exe_path_; }
+  std::string args() const override { return args_; }
+
+ private:
+  uint64_t pid_;
+  std::string comm_;
+  std::string exe_path_;
+  std::string args_;
+};
+
+class NetworkMessageBuilderTest : public testing::Test {
+ protected:
+  NetworkMessageBuilderTest() {
+    Endpoint server(Address(10, 0, 0, 1), 80);
+    Endpoint client(Address(192, 168, 1, 10), 9999);
+    Endpoint external(IPNet(Address(139, 45, 0, 0), 16), 443);
+    Endpoint server6(Address(htonll(0xfd00000000000000ULL), htonll(1ULL)), 8080);
+    auto process = std::make_shared<FakeProcess>(2, "nginx", "/usr/sbin/nginx", "-g daemon off;");
+
+    conns_ = {
+        {Connection("container", server, client, L4Proto::TCP, true), ConnStatus(1000, true)},
+        {Connection("container", client, external, L4Proto::TCP, false), ConnStatus(2000, false)},
+        {Connection("other", server6, Endpoint(), L4Proto::UDP, true), ConnStatus(3000, false)},
+    };
+    endpoints_ = {
+        {ContainerEndpoint("container", Endpoint(Address(), 80), L4Proto::TCP, process), ConnStatus(1000, true)},
+        {ContainerEndpoint("other", Endpoint(Address(), 53), L4Proto::UDP, nullptr), ConnStatus(4000, false)},
+    };
+  }
+
+  // Build creates a single message for the test delta, and returns it as received by Sensor, without its time.
+  sensor::NetworkConnectionInfoMessage Build(NetworkMessageBuilder* builder) {
+    auto conn_it = conns_.cbegin();
+    auto cep_it = endpoints_.cbegin();
+    auto* msg = builder->CreateInfoMessage(&conn_it, conns_.cend(), &cep_it, endpoints_.cend());
+    EXPECT_NE(msg, nullptr);
+    if (!msg) return {};
+    EXPECT_EQ(conn_it, conns_.cend());
+    EXPECT_EQ(cep_it, endpoints_.cend());
+
+    std::string serialized;
+    EXPECT_TRUE(msg->SerializeToString(&serialized));
+    auto parsed = Parse(serialized);
+    EXPECT_TRUE(parsed.info().has_time());
+    parsed.mutable_info()->clear_time();
+    return parsed;
+  }
+
+  static sensor::NetworkConnectionInfoMessage Parse(const std::string& serialized) {
+    sensor::NetworkConnectionInfoMessage msg;
+    EXPECT_TRUE(msg.ParseFromString(serialized));
+    return msg;
+  }
+
+  ConnMap conns_;
+  AdvertisedEndpointMap endpoints_;
+};
+
+TEST_F(NetworkMessageBuilderTest, CachedMessageIsEquivalent) {
+  NetworkMessageBuilder uncached(0, 0, 0);
+  NetworkMessageBuilder cached(0, 0, 100);
+
+  auto expected = Build(&uncached);
+  EXPECT_EQ(expected.info().updated_connections_size(), 3);
+  EXPECT_EQ(expected.info().updated_endpoints_size(), 2);
+
+  // Both when the entries are serialized for the first time, and when they are taken from the cache.
+  for (int i = 0; i < 2; i++) {
+    auto actual = Build(&cached);
+    EXPECT_EQ(actual.ByteSizeLong(), expected.ByteSizeLong());
+    EXPECT_TRUE(google::protobuf::util::MessageDifferencer::Equals(actual, expected));
+  }
+}
+
+TEST_F(NetworkMessageBuilderTest, CacheHits) {
+  auto& stats = CollectorStats::GetOrCreate();
+  NetworkMessageBuilder builder(0, 0, 100);
+
+  auto hits = stats.GetCounter(CollectorStats::net_encoding_cache_hits);
+  auto misses = stats.GetCounter(CollectorStats::net_encoding_cache_misses);
+  Build(&builder);
+  EXPECT_EQ(stats.GetCounter(CollectorStats::net_encoding_cache_hits), hits);
+  EXPECT_EQ(stats.GetCounter(CollectorStats::net_encoding_cache_misses), misses + 5);
+
+  // The close timestamp is not part of the cached form, so a connection can change its status and still hit the cache.
+  for (auto& entry : conns_) {
+    entry.second = ConnStatus(5000, !entry.second.IsActive());
+  }
+  auto cached = Build(&builder);
+  EXPECT_EQ(stats.GetCounter(CollectorStats::net_encoding_cache_hits), hits + 5);
+  EXPECT_EQ(stats.GetCounter(CollectorStats::net_encoding_cache_misses), misses + 5);
+
+  NetworkMessageBuilder uncached(0, 0, 0);
+  EXPECT_TRUE(google::protobuf::util::MessageDifferencer::Equals(cached, Build(&uncached)));
+}
+
+TEST_F(NetworkMessageBuilderTest, CacheExcludesOriginator) {
+  auto& stats = CollectorStats::GetOrCreate();
+  NetworkMessageBuilder builder(0, 0, 100);
+
+  std::weak_ptr<IProcess> nginx;
+  for (const auto& entry : endpoints_) {
+    if (entry.first.originator()) nginx = entry.first.originator();
+  }
+  ASSERT_FALSE(nginx.expired());
+  Build(&builder);
+
+  // The same endpoint, now reported with another originator.
+  auto envoy = std::make_shared<FakeProcess>(3, "envoy", "/usr/local/bin/envoy", "-c envoy.yaml");
+  endpoints_ = {
+      {ContainerEndpoint("container", Endpoint(Address(), 80), L4Proto::TCP, envoy), ConnStatus(1000, true)},
+  };
+  EXPECT_TRUE(nginx.expired()) << "the cache holds on to the previous originator";
+
+  auto hits = stats.GetCounter(CollectorStats::net_encoding_cache_hits);
+  auto cached = Build(&builder);
+  EXPECT_EQ(stats.GetCounter(CollectorStats::net_encoding_cache_hits), hits + 4);
+  ASSERT_EQ(cached.info().updated_endpoints_size(), 1);
+  EXPECT_EQ(cached.info().updated_endpoints(0).originator().process_name(), "envoy");
+
+  NetworkMessageBuilder uncached(0, 0, 0);
+  EXPECT_TRUE(google::protobuf::util::MessageDifferencer::Equals(cached, Build(&uncached)));
+}
+
+TEST_F(NetworkMessageBuilderTest, ChunksWithCache) {
+  NetworkMessageBuilder builder(2, 0, 100);
+
+  auto conn_it = conns_.cbegin();
+  auto cep_it = endpoints_.cbegin();
+  int num_entries = 0;
+  int num_messages = 0;
+  while (auto* msg = builder.CreateInfoMessage(&conn_it, conns_.cend(), &cep_it, endpoints_.cend())) {
+    std::string serialized;
+    ASSERT_TRUE(msg->SerializeToString(&serialized));
+    auto parsed = Parse(serialized);
+    int entries = parsed.info().updated_connections_size() + parsed.info().updated_endpoints_size();
+    EXPECT_LE(entries, 2);
+    num_entries += entries;
+    num_messages++;
+  }
+  EXPECT_EQ(num_entries, 5);
+  EXPECT_EQ(num_messages, 3);
+}
+
+}  // namespace
+
+}  // namespace collector
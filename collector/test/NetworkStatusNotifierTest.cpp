@@ -1,6 +1,8 @@
+#include <atomic>
 #include <chrono>
 #include <mutex>
 #include <string>
+#include <thread>
 
 #include <google/protobuf/util/time_util.h>
 
@@ -19,6 +21,7 @@ namespace {
 
 using grpc_duplex_impl::Result;
 using grpc_duplex_impl::Status;
+using ::testing::ElementsAre;
 using ::testing::Invoke;
 using ::testing::Return;
 using ::testing::ReturnPointee;
@@ -76,6 +79,7 @@ class MockCollectorConfig : public collector::CollectorConfig {
 class MockConnScraper : public IConnScraper {
  public:
   MOCK_METHOD(bool, Scrape, (std::vector<Connection> * connections, std::vector<ContainerEndpoint>* listen_endpoints), (override));
+  MOCK_METHOD(bool, ScrapeStep, (std::chrono::microseconds cpu_budget, bool* sweep_complete, std::vector<Connection>* connections, std::vector<ContainerEndpoint>* listen_endpoints), (override));
 };
 
 class MockDuplexClientWriter : public IDuplexClientWriter<sensor::NetworkConnectionInfoMessage> {
@@ -235,6 +239,234 @@ TEST(NetworkStatusNotifier, SimpleStartStop) {
   net_status_notifier->Stop();
 }
 
+/* With a CPU budget for scraping, the scraper is invoked in steps, and the connection tracker is updated once a sweep
+   over all processes has completed. */
+TEST(NetworkStatusNotifier, IncrementalScrape) {
+  bool running = true;
+  CollectorConfig config_(0);
+  std::shared_ptr<MockConnScraper> conn_scraper = std::make_shared<MockConnScraper>();
+  auto conn_tracker = std::make_shared<ConnectionTracker>();
+  auto comm = std::make_shared<MockNetworkConnectionInfoServiceComm>();
+  Semaphore sem(0);  // to wait for the service to accomplish its job.
+
+  EXPECT_CALL(*comm, WaitForConnectionReady).WillRepeatedly(Return(true));
+  EXPECT_CALL(*comm, TryCancel).Times(1).WillOnce([&running] { running = false; });
+
+  EXPECT_CALL(*comm, PushNetworkConnectionInfoOpenStream)
+      .Times(1)
+      .WillOnce([&sem, &running](std::function<void(const sensor::NetworkFlowsControlMessage*)> receive_func) -> std::unique_ptr<IDuplexClientWriter<sensor::NetworkConnectionInfoMessage>> {
+        auto duplex_writer = MakeUnique<MockDuplexClientWriter>();
+
+        EXPECT_CALL(*duplex_writer, Write).WillRepeatedly([&sem](const sensor::NetworkConnectionInfoMessage& msg, const gpr_timespec& deadline) -> Result {
+          for (const auto& cnx : msg.info().updated_connections()) {
+            if (cnx.container_id() == "containerId" && !cnx.has_close_timestamp()) {
+              sem.release();
+            }
+          }
+          return Result(Status::OK);
+        });
+        EXPECT_CALL(*duplex_writer, Sleep).WillRepeatedly(ReturnPointee(&running));
+        EXPECT_CALL(*duplex_writer, WaitUntilStarted).WillRepeatedly(Return(Result(Status::OK)));
+
+        return duplex_writer;
+      });
+
+  // Full scrapes must not be used.
+  EXPECT_CALL(*conn_scraper, Scrape).Times(0);
+  // Every sweep takes two steps, and only the second one returns the results.
+  int steps = 0;
+  EXPECT_CALL(*conn_scraper, ScrapeStep).WillRepeatedly([&steps](std::chrono::microseconds cpu_budget, bool* sweep_complete, std::vector<Connection>* connections, std::vector<ContainerEndpoint>* listen_endpoints) -> bool {
+    EXPECT_EQ(cpu_budget, std::chrono::milliseconds(20));
+    *sweep_complete = (++steps % 2 == 0);
+    if (*sweep_complete) {
+      connections->emplace_back("containerId", Endpoint(Address(10, 0, 1, 32), 1024), Endpoint(Address(139, 45, 27, 4), 999), L4Proto::TCP, true);
+    }
+    return true;
+  });
+
+  // Scrape every second, such that a sweep completes and is reported well within the timeout.
+  auto net_status_notifier = MakeUnique<NetworkStatusNotifier>(conn_scraper,
+                                                               1, config_.ScrapeListenEndpoints(),
+                                                               config_.TurnOffScrape(),
+                                                               conn_tracker,
+                                                               config_.AfterglowPeriod(), config_.EnableAfterglow(),
+                                                               comm, 20);
+
+  net_status_notifier->Start();
+
+  EXPECT_TRUE(sem.try_acquire_for(std::chrono::seconds(5)));
+
+  net_status_notifier->Stop();
+}
+
+/* A sweep that completes within its first step is not started again before the scrape interval has elapsed, even
+   though the scraper keeps stepping every second. */
+TEST(NetworkStatusNotifier, IncrementalScrapeOneSweepPerInterval) {
+  bool running = true;
+  CollectorConfig config_(0);
+  std::shared_ptr<MockConnScraper> conn_scraper = std::make_shared<MockConnScraper>();
+  auto conn_tracker = std::make_shared<ConnectionTracker>();
+  auto comm = std::make_shared<MockNetworkConnectionInfoServiceComm>();
+
+  EXPECT_CALL(*comm, WaitForConnectionReady).WillRepeatedly(Return(true));
+  EXPECT_CALL(*comm, TryCancel).Times(1).WillOnce([&running] { running = false; });
+
+  EXPECT_CALL(*comm, PushNetworkConnectionInfoOpenStream)
+      .Times(1)
+      .WillOnce([&running](std::function<void(const sensor::NetworkFlowsControlMessage*)> receive_func) -> std::unique_ptr<IDuplexClientWriter<sensor::NetworkConnectionInfoMessage>> {
+        auto duplex_writer = MakeUnique<MockDuplexClientWriter>();
+
+        EXPECT_CALL(*duplex_writer, Write).WillRepeatedly(Return(Result(Status::OK)));
+        EXPECT_CALL(*duplex_writer, Sleep).WillRepeatedly(ReturnPointee(&running));
+        EXPECT_CALL(*duplex_writer, WaitUntilStarted).WillRepeatedly(Return(Result(Status::OK)));
+
+        return duplex_writer;
+      });
+
+  EXPECT_CALL(*conn_scraper, Scrape).Times(0);
+  std::atomic<int> sweeps{0};
+  EXPECT_CALL(*conn_scraper, ScrapeStep).WillRepeatedly([&sweeps](std::chrono::microseconds cpu_budget, bool* sweep_complete, std::vector<Connection>* connections, std::vector<ContainerEndpoint>* listen_endpoints) -> bool {
+    *sweep_complete = true;
+    ++sweeps;
+    return true;
+  });
+
+  // The scraper steps about 3 times within the first interval.
+  auto net_status_notifier = MakeUnique<NetworkStatusNotifier>(conn_scraper,
+                                                               10, config_.ScrapeListenEndpoints(),
+                                                               config_.TurnOffScrape(),
+                                                               conn_tracker,
+                                                               config_.AfterglowPeriod(), config_.EnableAfterglow(),
+                                                               comm, 20);
+
+  net_status_notifier->Start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(3500));
+  net_status_notifier->Stop();
+
+  EXPECT_EQ(sweeps.load(), 1);
+}
+
+/* With a maximum number of entries per message, a delta is sent as several messages, back to back. */
+TEST(NetworkStatusNotifier, ChunkedDelta) {
+  bool running = true;
+  CollectorConfig config_(0);
+  std::shared_ptr<MockConnScraper> conn_scraper = std::make_shared<MockConnScraper>();
+  auto conn_tracker = std::make_shared<ConnectionTracker>();
+  auto comm = std::make_shared<MockNetworkConnectionInfoServiceComm>();
+  Semaphore sem(0);  // to wait for the service to accomplish its job.
+
+  constexpr int kNumConnections = 10;
+  std::mutex mutex;
+  std::vector<int> chunk_sizes;
+  std::unordered_map<Connection, bool, Hasher> received;
+
+  EXPECT_CALL(*comm, WaitForConnectionReady).WillRepeatedly(Return(true));
+  EXPECT_CALL(*comm, TryCancel).Times(1).WillOnce([&running] { running = false; });
+
+  EXPECT_CALL(*comm, PushNetworkConnectionInfoOpenStream)
+      .Times(1)
+      .WillOnce([&](std::function<void(const sensor::NetworkFlowsControlMessage*)> receive_func) -> std::unique_ptr<IDuplexClientWriter<sensor::NetworkConnectionInfoMessage>> {
+        auto duplex_writer = MakeUnique<MockDuplexClientWriter>();
+
+        EXPECT_CALL(*duplex_writer, Write).WillRepeatedly([&](const sensor::NetworkConnectionInfoMessage& msg, const gpr_timespec& deadline) -> Result {
+          std::lock_guard<std::mutex> lock(mutex);
+          chunk_sizes.push_back(msg.info().updated_connections_size());
+          NetworkConnectionInfoMessageParser parser(msg);
+          received.insert(parser.get_updated_connections().begin(), parser.get_updated_connections().end());
+          if (received.size() == kNumConnections) {
+            sem.release();
+          }
+          return Result(Status::OK);
+        });
+        EXPECT_CALL(*duplex_writer, Sleep).WillRepeatedly(ReturnPointee(&running));
+        EXPECT_CALL(*duplex_writer, WaitUntilStarted).WillRepeatedly(Return(Result(Status::OK)));
+
+        return duplex_writer;
+      });
+
+  EXPECT_CALL(*conn_scraper, Scrape).WillRepeatedly([](std::vector<Connection>* connections, std::vector<ContainerEndpoint>* listen_endpoints) -> bool {
+    for (int i = 0; i < kNumConnections; i++) {
+      connections->emplace_back("containerId", Endpoint(Address(10, 0, 1, 32), 1024 + i), Endpoint(Address(139, 45, 27, 4), 999), L4Proto::TCP, true);
+    }
+    return true;
+  });
+
+  auto net_status_notifier = MakeUnique<NetworkStatusNotifier>(conn_scraper,
+                                                               config_.ScrapeInterval(), config_.ScrapeListenEndpoints(),
+                                                               config_.TurnOffScrape(),
+                                                               conn_tracker,
+                                                               config_.AfterglowPeriod(), config_.EnableAfterglow(),
+                                                               comm, 0, 0, 0, 3);
+
+  net_status_notifier->Start();
+
+  EXPECT_TRUE(sem.try_acquire_for(std::chrono::seconds(5)));
+
+  net_status_notifier->Stop();
+
+  std::lock_guard<std::mutex> lock(mutex);
+  EXPECT_THAT(chunk_sizes, ElementsAre(3, 3, 3, 1));
+  EXPECT_EQ(received.size(), kNumConnections);
+}
+
+/* At the end of a replay, Flush sends the connections added to the tracker since the last delta, without waiting for
+   the next scrape and without scraping /proc. */
+TEST(NetworkStatusNotifier, FlushWithScrapingTurnedOff) {
+  bool running = true;
+  CollectorConfig config_(0);
+  std::shared_ptr<MockConnScraper> conn_scraper = std::make_shared<MockConnScraper>();
+  auto conn_tracker = std::make_shared<ConnectionTracker>();
+  auto comm = std::make_shared<MockNetworkConnectionInfoServiceComm>();
+
+  std::mutex mutex;
+  std::unordered_map<Connection, bool, Hasher> received;
+
+  EXPECT_CALL(*comm, WaitForConnectionReady).WillRepeatedly(Return(true));
+  EXPECT_CALL(*comm, TryCancel).Times(1).WillOnce([&running] { running = false; });
+
+  EXPECT_CALL(*comm, PushNetworkConnectionInfoOpenStream)
+      .Times(1)
+      .WillOnce([&](std::function<void(const sensor::NetworkFlowsControlMessage*)> receive_func) -> std::unique_ptr<IDuplexClientWriter<sensor::NetworkConnectionInfoMessage>> {
+        auto duplex_writer = MakeUnique<MockDuplexClientWriter>();
+
+        EXPECT_CALL(*duplex_writer, Write).WillRepeatedly([&](const sensor::NetworkConnectionInfoMessage& msg, const gpr_timespec& deadline) -> Result {
+          std::lock_guard<std::mutex> lock(mutex);
+          NetworkConnectionInfoMessageParser parser(msg);
+          received.insert(parser.get_updated_connections().begin(), parser.get_updated_connections().end());
+          return Result(Status::OK);
+        });
+        EXPECT_CALL(*duplex_writer, Sleep).WillRepeatedly(ReturnPointee(&running));
+        EXPECT_CALL(*duplex_writer, WaitUntilStarted).WillRepeatedly(Return(Result(Status::OK)));
+
+        return duplex_writer;
+      });
+
+  EXPECT_CALL(*conn_scraper, Scrape).Times(0);
+
+  auto net_status_notifier = MakeUnique<NetworkStatusNotifier>(conn_scraper,
+                                                               config_.ScrapeInterval(), config_.ScrapeListenEndpoints(),
+                                                               true,
+                                                               conn_tracker,
+                                                               config_.AfterglowPeriod(), false,
+                                                               comm);
+
+  net_status_notifier->Start();
+
+  Connection conn("containerId", Endpoint(Address(10, 0, 1, 32), 1024), Endpoint(Address(139, 45, 27, 4), 999), L4Proto::TCP, true);
+  // the same connection, as normalized by the connection tracker
+  Connection normalized_conn("containerId", Endpoint(Address(), 1024), Endpoint(Address(255, 255, 255, 255), 0), L4Proto::TCP, true);
+  conn_tracker->AddConnection(conn, NowMicros());
+
+  EXPECT_TRUE(net_status_notifier->Flush(std::chrono::seconds(5)));
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    EXPECT_THAT(received, ElementsAre(std::make_pair(normalized_conn, true)));
+  }
+
+  net_status_notifier->Stop();
+}
+
 /* This test checks whether deltas are computed appropriately in case the "known network" list is received after a connection
    is already reported (and matches one of the networks).
    - scrapper initialy reports a connection
@@ -297,7 +529,7 @@ TEST(NetworkStatusNotifier, UpdateIPnoAfterglow) {
             .WillRepeatedly(Return(Result(Status::OK)));
 
         EXPECT_CALL(*duplex_writer, Sleep)
-            .WillOnce(ReturnPointee(&running))  // first time, we let the scrapper do its job
+            .WillOnce(ReturnPointee(&running))  // first time, before the first delta is sent
             .WillOnce([&running, &network_flows_callback](const gpr_timespec& deadline) {
               // The connection is known now, let's declare a "known network"
               sensor::NetworkFlowsControlMessage msg;
@@ -323,8 +555,9 @@ TEST(NetworkStatusNotifier, UpdateIPnoAfterglow) {
     return true;
   });
 
+  // Scrape every second, such that the scrape after the known network was received happens within the timeout.
   auto net_status_notifier = MakeUnique<NetworkStatusNotifier>(conn_scraper,
-                                                               config.ScrapeInterval(), config.ScrapeListenEndpoints(),
+                                                               1, config.ScrapeListenEndpoints(),
                                                                config.TurnOffScrape(),
                                                                conn_tracker,
                                                                config.AfterglowPeriod(), config.EnableAfterglow(),
@@ -0,0 +1,72 @@
+#include "OverloadShedder.h"
+#include "gtest/gtest.h"
+
+namespace collector {
+
+namespace {
+
+// Feeds intervals of events, of which the given number were dropped, to the shedder, and returns the level after the
+// last one.
+class Feeder {
+ public:
+  explicit Feeder(OverloadShedder* shedder) : shedder_(shedder) { shedder_->Update(0, 0); }
+
+  int Interval(uint64_t events, uint64_t drops) {
+    events_ += events;
+    drops_ += drops;
+    return shedder_->Update(events_, drops_);
+  }
+
+ private:
+  OverloadShedder* shedder_;
+  uint64_t events_ = 0;
+  uint64_t drops_ = 0;
+};
+
+TEST(OverloadShedderTest, ShedsAndRestoresWithHysteresis) {
+  OverloadShedder shedder(10, 3);
+  Feeder feeder(&shedder);
+  ASSERT_EQ(shedder.max_level(), 2);
+
+  EXPECT_EQ(feeder.Interval(10000, 0), 0);
+  EXPECT_EQ(feeder.Interval(10000, 100), 0);  // 1% is not above the threshold
+  EXPECT_EQ(feeder.Interval(10000, 500), 1);
+  EXPECT_EQ(feeder.Interval(10000, 500), 2);
+  EXPECT_EQ(feeder.Interval(10000, 500), 2);
+
+  // Drops between the restore threshold and the threshold keep the level.
+  for (int i = 0; i < 5; i++) {
+    EXPECT_EQ(feeder.Interval(10000, 50), 2);
+  }
+
+  // Restored one level for every 3 consecutive quiet intervals.
+  EXPECT_EQ(feeder.Interval(10000, 5), 2);
+  EXPECT_EQ(feeder.Interval(10000, 5), 2);
+  EXPECT_EQ(feeder.Interval(10000, 50), 2);  // not quiet, starts over
+  EXPECT_EQ(feeder.Interval(10000, 0), 2);
+  EXPECT_EQ(feeder.Interval(10000, 0), 2);
+  EXPECT_EQ(feeder.Interval(10000, 0), 1);
+  EXPECT_EQ(feeder.Interval(10000, 0), 1);
+  EXPECT_EQ(feeder.Interval(10000, 0), 1);
+  EXPECT_EQ(feeder.Interval(10000, 0), 0);
+  EXPECT_EQ(feeder.Interval(10000, 0), 0);
+}
+
+TEST(OverloadShedderTest, IgnoresSmallIntervalsAndResets) {
+  OverloadShedder shedder(10, 1);
+  Feeder feeder(&shedder);
+
+  // Too few events to judge.
+  EXPECT_EQ(feeder.Interval(10, 10), 0);
+  // The drops are part of the events, and are not added to them.
+  EXPECT_EQ(feeder.Interval(600, 600), 0);
+  EXPECT_EQ(feeder.Interval(OverloadShedder::kMinIntervalEvents, OverloadShedder::kMinIntervalEvents), 1);
+
+  // Counters going back, e.g., when the driver is reopened, only reset the baseline.
+  EXPECT_EQ(shedder.Update(0, 0), 1);
+  EXPECT_EQ(shedder.Update(10000, 0), 0);
+}
+
+}  // namespace
+
+}  // namespace collector
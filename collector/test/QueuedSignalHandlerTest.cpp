@@ -0,0 +1,252 @@
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "CollectorStats.h"
+#include "QueuedSignalHandler.h"
+#include "gtest/gtest.h"
+
+namespace collector {
+
+namespace {
+
+// FakeHandler extracts increasing numbers as records, and processes them by recording them along with the thread they
+// were processed on. The events themselves are not used.
+class FakeHandler : public QueuedSignalHandler<int> {
+ public:
+  explicit FakeHandler(size_t queue_size)
+      : QueuedSignalHandler(queue_size, {CollectorStats::process_signal_queue_depth, CollectorStats::process_signal_queue_drops, CollectorStats::process_signal_lag_us}) {}
+
+  ~FakeHandler() override { QueuedSignalHandler::Stop(); }
+
+  std::string GetName() override { return "FakeHandler"; }
+  std::vector<std::string> GetRelevantEvents() override { return {}; }
+
+  std::vector<int> Processed() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return processed_;
+  }
+
+  std::vector<std::thread::id> Threads() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return threads_;
+  }
+
+  std::vector<size_t> BatchSizes() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return batch_sizes_;
+  }
+
+  // WaitForProcessed waits until n records have been processed.
+  bool WaitForProcessed(size_t n) {
+    for (int i = 0; i < 500; i++) {
+      if (Processed().size() >= n) {
+        return true;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+  }
+
+  std::atomic<bool> blocked{false};
+  std::atomic<Result> next_result{PROCESSED};
+  // The record whose processing requests a refresh, once.
+  std::atomic<int> refresh_record{0};
+
+ protected:
+  Result ExtractSignal(sinsp_evt* evt, int* record) override {
+    *record = next_record_++;
+    return PROCESSED;
+  }
+
+  Result ExtractExistingProcess(sinsp_threadinfo* tinfo, int* record) override {
+    *record = -(next_record_++);
+    return PROCESSED;
+  }
+
+  Result ProcessRecord(const int& record) override {
+    while (blocked) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      processed_.push_back(record);
+      threads_.push_back(std::this_thread::get_id());
+    }
+    if (record == refresh_record.load()) {
+      refresh_record = 0;
+      return NEEDS_REFRESH;
+    }
+    return next_result.exchange(PROCESSED);
+  }
+
+  Result ProcessRecords(const int* records, size_t count, size_t* processed) override {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      batch_sizes_.push_back(count);
+    }
+    return QueuedSignalHandler::ProcessRecords(records, count, processed);
+  }
+
+ private:
+  int next_record_ = 1;
+  std::mutex mutex_;
+  std::vector<int> processed_;
+  std::vector<std::thread::id> threads_;
+  std::vector<size_t> batch_sizes_;
+};
+
+class QueuedSignalHandlerTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    COUNTER_ZERO(CollectorStats::process_signal_queue_drops);
+  }
+};
+
+TEST_F(QueuedSignalHandlerTest, Synchronous) {
+  FakeHandler handler(0);
+  ASSERT_TRUE(handler.Start());
+
+  EXPECT_EQ(handler.HandleSignal(nullptr), SignalHandler::PROCESSED);
+  EXPECT_EQ(handler.HandleSignal(nullptr), SignalHandler::PROCESSED);
+  EXPECT_EQ(handler.Processed(), std::vector<int>({1, 2}));
+  EXPECT_EQ(handler.Threads()[0], std::this_thread::get_id());
+
+  handler.next_result = SignalHandler::NEEDS_REFRESH;
+  EXPECT_EQ(handler.HandleSignal(nullptr), SignalHandler::NEEDS_REFRESH);
+}
+
+TEST_F(QueuedSignalHandlerTest, ProcessedOnWorker) {
+  FakeHandler handler(16);
+  ASSERT_TRUE(handler.Start());
+
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(handler.HandleSignal(nullptr), SignalHandler::PROCESSED);
+    // Give the worker a chance to keep up, so that nothing is dropped.
+    if (i % 8 == 0) {
+      handler.WaitForProcessed(i + 1);
+    }
+  }
+  ASSERT_TRUE(handler.WaitForProcessed(100));
+
+  auto processed = handler.Processed();
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(processed[i], i + 1);
+  }
+  for (const auto& id : handler.Threads()) {
+    EXPECT_NE(id, std::this_thread::get_id());
+  }
+  EXPECT_TRUE(handler.Stop());
+}
+
+TEST_F(QueuedSignalHandlerTest, DropWhenFull) {
+  FakeHandler handler(2);
+  ASSERT_TRUE(handler.Start());
+
+  // The worker is stuck on the first record, and the queue holds two more.
+  handler.blocked = true;
+  EXPECT_EQ(handler.HandleSignal(nullptr), SignalHandler::PROCESSED);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(handler.HandleSignal(nullptr), SignalHandler::PROCESSED);
+  EXPECT_EQ(handler.HandleSignal(nullptr), SignalHandler::PROCESSED);
+  EXPECT_EQ(handler.HandleSignal(nullptr), SignalHandler::IGNORED);
+  EXPECT_EQ(CollectorStats::GetOrCreate().GetCounter(CollectorStats::process_signal_queue_drops), 1);
+  EXPECT_EQ(CollectorStats::GetOrCreate().GetCounter(CollectorStats::process_signal_queue_depth), 0);
+
+  // Existing processes wait for space instead.
+  std::thread unblock([&handler] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    handler.blocked = false;
+  });
+  EXPECT_EQ(handler.HandleExistingProcess(nullptr), SignalHandler::PROCESSED);
+  unblock.join();
+
+  ASSERT_TRUE(handler.WaitForProcessed(4));
+  EXPECT_EQ(handler.Processed(), std::vector<int>({1, 2, 3, -5}));
+}
+
+TEST_F(QueuedSignalHandlerTest, Lag) {
+  FakeHandler handler(16);
+  ASSERT_TRUE(handler.Start());
+  auto lag = [] { return CollectorStats::GetOrCreate().GetCounter(CollectorStats::process_signal_lag_us); };
+
+  // The worker is stuck on a sampled record, while the records queued after it are not sampled, until every
+  // kLagSampleInterval-th one.
+  for (size_t round = 1; round <= 2; round++) {
+    handler.blocked = true;
+    EXPECT_EQ(handler.HandleSignal(nullptr), SignalHandler::PROCESSED);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    size_t queued = round == 1 ? FakeHandler::kLagSampleInterval - 1 : FakeHandler::kLagSampleInterval;
+    for (size_t i = 0; i < queued; i++) {
+      EXPECT_EQ(handler.HandleSignal(nullptr), SignalHandler::PROCESSED);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    handler.blocked = false;
+    ASSERT_TRUE(handler.WaitForProcessed(round * FakeHandler::kLagSampleInterval + round - 1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    if (round == 1) {
+      EXPECT_LT(lag(), 20000);
+    } else {
+      EXPECT_GE(lag(), 20000);
+    }
+  }
+}
+
+TEST_F(QueuedSignalHandlerTest, WorkerResults) {
+  FakeHandler handler(16);
+  ASSERT_TRUE(handler.Start());
+
+  // A refresh requested by the worker is reported by the next event, which is not queued. The record that requested
+  // it is processed again after the existing processes, as on the capture thread.
+  handler.next_result = SignalHandler::NEEDS_REFRESH;
+  EXPECT_EQ(handler.HandleSignal(nullptr), SignalHandler::PROCESSED);
+  ASSERT_TRUE(handler.WaitForProcessed(1));
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(handler.HandleSignal(nullptr), SignalHandler::NEEDS_REFRESH);
+  EXPECT_EQ(handler.HandleExistingProcess(nullptr), SignalHandler::PROCESSED);
+  EXPECT_EQ(handler.HandleSignal(nullptr), SignalHandler::PROCESSED);
+  ASSERT_TRUE(handler.WaitForProcessed(4));
+  EXPECT_EQ(handler.Processed(), std::vector<int>({1, -2, 1, 3}));
+
+  handler.next_result = SignalHandler::FINISHED;
+  EXPECT_EQ(handler.HandleSignal(nullptr), SignalHandler::PROCESSED);
+  ASSERT_TRUE(handler.WaitForProcessed(5));
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(handler.HandleSignal(nullptr), SignalHandler::FINISHED);
+}
+
+TEST_F(QueuedSignalHandlerTest, Batches) {
+  FakeHandler handler(16);
+  ASSERT_TRUE(handler.Start());
+
+  // The records queued while the worker is stuck on the first one are processed as a batch. The record requesting a
+  // refresh, and those after it, are held back until the existing processes have been processed.
+  handler.blocked = true;
+  handler.refresh_record = 3;
+  EXPECT_EQ(handler.HandleSignal(nullptr), SignalHandler::PROCESSED);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  for (int i = 0; i < 4; i++) {
+    EXPECT_EQ(handler.HandleSignal(nullptr), SignalHandler::PROCESSED);
+  }
+  handler.blocked = false;
+
+  ASSERT_TRUE(handler.WaitForProcessed(3));
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(handler.Processed(), std::vector<int>({1, 2, 3}));
+
+  EXPECT_EQ(handler.HandleSignal(nullptr), SignalHandler::NEEDS_REFRESH);
+  EXPECT_EQ(handler.HandleExistingProcess(nullptr), SignalHandler::PROCESSED);
+  EXPECT_EQ(handler.HandleSignal(nullptr), SignalHandler::PROCESSED);
+
+  ASSERT_TRUE(handler.WaitForProcessed(8));
+  EXPECT_EQ(handler.Processed(), std::vector<int>({1, 2, 3, -6, 3, 4, 5, 7}));
+  // The held back records are processed as a batch of their own.
+  EXPECT_EQ(handler.BatchSizes(), std::vector<size_t>({1, 4, 1, 3, 1}));
+}
+
+}  // namespace
+
+}  // namespace collector
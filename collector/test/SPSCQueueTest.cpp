@@ -0,0 +1,70 @@
+#include <memory>
+#include <thread>
+
+#include "SPSCQueue.h"
+#include "gtest/gtest.h"
+
+namespace collector {
+
+namespace {
+
+TEST(SPSCQueueTest, PushPop) {
+  SPSCQueue<int> queue(3);
+  EXPECT_EQ(queue.capacity(), 4);
+  EXPECT_TRUE(queue.empty());
+
+  for (int i = 0; i < 4; i++) {
+    int item = i;
+    EXPECT_TRUE(queue.TryPush(std::move(item)));
+  }
+  int item = 4;
+  EXPECT_FALSE(queue.TryPush(std::move(item)));
+  EXPECT_EQ(queue.size(), 4);
+
+  for (int i = 0; i < 4; i++) {
+    ASSERT_TRUE(queue.TryPop(&item));
+    EXPECT_EQ(item, i);
+  }
+  EXPECT_FALSE(queue.TryPop(&item));
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(SPSCQueueTest, FullPushLeavesItem) {
+  SPSCQueue<std::unique_ptr<int>> queue(1);
+
+  auto item = std::make_unique<int>(1);
+  EXPECT_TRUE(queue.TryPush(std::move(item)));
+  item = std::make_unique<int>(2);
+  EXPECT_FALSE(queue.TryPush(std::move(item)));
+  ASSERT_NE(item, nullptr);
+  EXPECT_EQ(*item, 2);
+}
+
+TEST(SPSCQueueTest, ProducerConsumer) {
+  constexpr int kNumItems = 100000;
+  SPSCQueue<int> queue(16);
+
+  std::thread producer([&queue] {
+    for (int i = 0; i < kNumItems; i++) {
+      int item = i;
+      while (!queue.TryPush(std::move(item))) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  // Every item is received exactly once and in order, across many wrap-arounds of the queue.
+  for (int i = 0; i < kNumItems; i++) {
+    int item;
+    while (!queue.TryPop(&item)) {
+      std::this_thread::yield();
+    }
+    ASSERT_EQ(item, i);
+  }
+  producer.join();
+  EXPECT_TRUE(queue.empty());
+}
+
+}  // namespace
+
+}  // namespace collector
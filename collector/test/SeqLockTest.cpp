@@ -0,0 +1,57 @@
+#include <atomic>
+#include <thread>
+
+#include "SeqLock.h"
+#include "gtest/gtest.h"
+
+namespace collector {
+
+namespace {
+
+struct Values {
+  uint64_t a[64] = {};
+};
+
+TEST(SeqLockTest, LoadBeforeStore) {
+  SeqLock<Values> lock;
+  Values values;
+  EXPECT_FALSE(lock.Load(&values));
+
+  values.a[0] = 42;
+  lock.Store(values);
+  Values loaded;
+  ASSERT_TRUE(lock.Load(&loaded));
+  EXPECT_EQ(loaded.a[0], 42);
+}
+
+TEST(SeqLockTest, ConsistentSnapshots) {
+  SeqLock<Values> lock;
+  lock.Store(Values());
+  std::atomic<bool> done(false);
+
+  // All fields are written with the same value, so a torn read would show different values.
+  std::thread writer([&lock, &done] {
+    Values values;
+    for (uint64_t i = 1; i <= 100000; i++) {
+      for (auto& v : values.a) v = i;
+      lock.Store(values);
+    }
+    done = true;
+  });
+
+  uint64_t last = 0;
+  while (!done) {
+    Values values;
+    ASSERT_TRUE(lock.Load(&values));
+    for (auto v : values.a) {
+      ASSERT_EQ(v, values.a[0]);
+    }
+    EXPECT_GE(values.a[0], last);
+    last = values.a[0];
+  }
+  writer.join();
+}
+
+}  // namespace
+
+}  // namespace collector
@@ -0,0 +1,48 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "SignalDispatchTable.h"
+#include "gtest/gtest.h"
+
+namespace collector {
+
+namespace {
+
+class NopHandler : public SignalHandler {
+ public:
+  std::string GetName() override { return "NopHandler"; }
+  Result HandleSignal(sinsp_evt* evt) override { return PROCESSED; }
+  std::vector<std::string> GetRelevantEvents() override { return {}; }
+};
+
+using EventTypes = std::vector<uint16_t>;
+using Handlers = std::vector<SignalHandler*>;
+
+TEST(SignalDispatchTableTest, AddRemove) {
+  NopHandler a, b, c;
+  SignalDispatchTable table;
+  table.Add(&a, EventTypes({1, 2}));
+  table.Add(&b, EventTypes({2, 3}));
+  table.Add(&c, EventTypes({1, 2, 3}));
+
+  EXPECT_EQ(table.Handlers(0), Handlers());
+  EXPECT_EQ(table.Handlers(1), Handlers({&a, &c}));
+  EXPECT_EQ(table.Handlers(2), Handlers({&a, &b, &c}));
+  EXPECT_EQ(table.Handlers(3), Handlers({&b, &c}));
+
+  // Removal keeps the order of the remaining handlers.
+  table.Remove(&b, EventTypes({2, 3}));
+  EXPECT_EQ(table.Handlers(1), Handlers({&a, &c}));
+  EXPECT_EQ(table.Handlers(2), Handlers({&a, &c}));
+  EXPECT_EQ(table.Handlers(3), Handlers({&c}));
+
+  table.Clear();
+  for (int type = 0; type < PPM_EVENT_MAX; type++) {
+    EXPECT_TRUE(table.Handlers(type).empty());
+  }
+}
+
+}  // namespace
+
+}  // namespace collector